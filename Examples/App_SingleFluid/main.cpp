@@ -1,5 +1,6 @@
 #include <iostream>
 #include <memory>
+#include <string>
 #include <cuda.h>
 #include <cuda_runtime_api.h>
 #include <GL/glew.h>
@@ -11,6 +12,7 @@
 #include "Framework/Framework/Log.h"
 
 #include "Dynamics/ParticleSystem/ParticleFluid.h"
+#include "Dynamics/ParticleSystem/PositionBasedFluidModel.h"
 #include "Dynamics/RigidBody/RigidBody.h"
 #include "Dynamics/ParticleSystem/StaticBoundary.h"
 
@@ -36,7 +38,7 @@ void RecieveLogMessage(const Log::Message& m)
 	}
 }
 
-void CreateScene()
+void CreateScene(bool compressNeighbors)
 {
 	SceneGraph& scene = SceneGraph::getInstance();
 	scene.setUpperBound(Vector3f(1.5, 1, 1.5));
@@ -59,15 +61,32 @@ void CreateScene()
 	child1->setMass(100);
 	child1->getVelocity()->connect(ptRender->m_vecIndex);
 
+	//Optional, keep neighbors close in memory so that the density solver can read 16-bit neighbor offsets,
+	//the sizes of the plain and encoded neighbor lists are logged on the first step
+	if (compressNeighbors)
+	{
+		child1->enableReordering(20, 0.006);
+		auto pbf = child1->getModule<PositionBasedFluidModel<DataType3f>>("pbd");
+		pbf->setNeighborCompression(true);
+	}
+
 	std::shared_ptr<RigidBody<DataType3f>> rigidbody = std::make_shared<RigidBody<DataType3f>>();
 	root->addRigidBody(rigidbody);
 	rigidbody->loadShape("../../Media/bowl/bowl.obj");
 	rigidbody->setActive(false);
 }
 
-int main()
+int main(int argc, char** argv)
 {
-	CreateScene();
+	//Pass --compress-neighbors to compare the neighbor list sizes and frame times with the default run
+	bool compressNeighbors = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--compress-neighbors")
+			compressNeighbors = true;
+	}
+
+	CreateScene(compressNeighbors);
 
 	Log::setOutput("console_log.txt");
 	Log::setLevel(Log::Info);
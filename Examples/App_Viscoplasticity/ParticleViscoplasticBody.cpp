@@ -78,7 +78,11 @@ namespace PhysIKA
 	{
 		m_integrator->begin();
 
-		m_integrator->integrate();
+		if (!m_integrator->integrate())
+		{
+			m_integrator->end();
+			return;
+		}
 
 		m_nbrQuery->compute();
 		m_plasticity->solveElasticity();
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cuda_runtime_api.h>
+
+#include "Core/Utility/CTimer.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Framework/Topology/NeighborQuery.h"
+#include "Framework/Topology/HostNeighborQuery.h"
+
+using namespace std;
+using namespace PhysIKA;
+
+typedef DataType3f::Coord Coord;
+typedef DataType3f::Real Real;
+
+const int RepeatNum = 5;
+
+/**
+ * Uniformly distributed points in the unit cube, the radius is chosen such that each point has about 30 neighbors
+ */
+Real createPoints(std::vector<Coord>& points, int num)
+{
+	std::mt19937 gen(0);
+	std::uniform_real_distribution<Real> dist(0, 1);
+
+	points.resize(num);
+	for (int i = 0; i < num; i++)
+	{
+		points[i] = Coord(dist(gen), dist(gen), dist(gen));
+	}
+
+	return std::pow(Real(30 * 3) / (4 * Real(3.14159265) * num), Real(1) / 3);
+}
+
+double benchmarkGPU(std::vector<Coord>& points, Real h, long long& nbrNum)
+{
+	DeviceArray<Coord> pos;
+	pos.resize(points.size());
+	Function1Pt::copy(pos, points);
+
+	NeighborQuery<DataType3f> query(pos);
+	query.setBoundingBox(Coord(0), Coord(1));
+
+	NeighborList<int> nbr;
+	nbr.resize(points.size());
+
+	//Warm up
+	query.queryParticleNeighbors(nbr, pos, h);
+
+	CTimer timer;
+	timer.start();
+	for (int i = 0; i < RepeatNum; i++)
+	{
+		query.queryParticleNeighbors(nbr, pos, h);
+	}
+	cudaDeviceSynchronize();
+	timer.stop();
+
+	nbrNum = nbr.getElements().size();
+
+	nbr.release();
+	pos.release();
+
+	return timer.getElapsedTime() / RepeatNum;
+}
+
+double benchmarkCPU(std::vector<Coord>& points, Real h, long long& nbrNum)
+{
+	HostArray<Coord> pos;
+	pos.resize(points.size());
+	Function1Pt::copy(pos, points);
+
+	HostNeighborQuery<DataType3f> query;
+	query.setSpace(h, Coord(0), Coord(1));
+
+	HostNeighborList<int> nbr;
+	nbr.resize(points.size());
+
+	query.construct(pos);
+	query.queryNeighbors(nbr, pos, h);
+
+	CTimer timer;
+	timer.start();
+	for (int i = 0; i < RepeatNum; i++)
+	{
+		query.construct(pos);
+		query.queryNeighbors(nbr, pos, h);
+	}
+	timer.stop();
+
+	nbrNum = nbr.getElements().size();
+
+	nbr.release();
+	pos.release();
+
+	return timer.getElapsedTime() / RepeatNum;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> sizes;
+	for (int i = 1; i < argc; i++)
+	{
+		sizes.push_back(atoi(argv[i]));
+	}
+	if (sizes.empty())
+	{
+		sizes.push_back(1000000);
+		sizes.push_back(10000000);
+	}
+
+	cout << "CPU threads: " << ThreadPool::getInstance().getThreadNum() << endl;
+
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		std::vector<Coord> points;
+		Real h = createPoints(points, sizes[i]);
+
+		long long gpuNbr, cpuNbr;
+		double gpuTime = benchmarkGPU(points, h, gpuNbr);
+		double cpuTime = benchmarkCPU(points, h, cpuNbr);
+
+		cout << "Particles: " << sizes[i] << ", radius: " << h << endl;
+		cout << "  GPU: " << gpuTime * 1000 << " ms, " << gpuNbr / gpuTime << " neighbors/s" << endl;
+		cout << "  CPU: " << cpuTime * 1000 << " ms, " << cpuNbr / cpuTime << " neighbors/s" << endl;
+		if (gpuNbr != cpuNbr)
+		{
+			cout << "  Neighbor counts differ: " << gpuNbr << " vs " << cpuNbr << endl;
+		}
+	}
+
+	return 0;
+}
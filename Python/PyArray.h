@@ -0,0 +1,97 @@
+#pragma once
+#include "PyCommon.h"
+#include <pybind11/numpy.h>
+
+#include "Core/Vector.h"
+#include "Core/Array/Array.h"
+#include "Core/Utility/cuda_utilities.h"
+
+/*!
+*	\struct	ArrayTraits
+*	\brief	Maps an array element type to the scalar type and the number of components seen from NumPy.
+*/
+template<typename T>
+struct ArrayTraits
+{
+	typedef T Scalar;
+	static const int components = 1;
+};
+
+template<typename T, int dim>
+struct ArrayTraits<PhysIKA::Vector<T, dim>>
+{
+	typedef T Scalar;
+	static const int components = dim;
+};
+
+template<typename T>
+using numpy_array = py::array_t<typename ArrayTraits<T>::Scalar, py::array::c_style | py::array::forcecast>;
+
+/**
+ * @brief Buffer description of num elements starting at ptr, shaped (N) for scalars and (N, dim) for vectors
+ */
+template<typename T>
+py::buffer_info array_buffer_info(T* ptr, int num)
+{
+	typedef typename ArrayTraits<T>::Scalar Scalar;
+	const int comps = ArrayTraits<T>::components;
+	static_assert(sizeof(T) == comps * sizeof(Scalar), "Array elements must be tightly packed");
+
+	if (comps == 1)
+	{
+		return py::buffer_info(ptr, sizeof(Scalar), py::format_descriptor<Scalar>::format(), 1,
+			{ (py::ssize_t)num }, { (py::ssize_t)sizeof(T) });
+	}
+
+	return py::buffer_info(ptr, sizeof(Scalar), py::format_descriptor<Scalar>::format(), 2,
+		{ (py::ssize_t)num, (py::ssize_t)comps }, { (py::ssize_t)sizeof(T), (py::ssize_t)sizeof(Scalar) });
+}
+
+/**
+ * @brief Zero-copy NumPy view of host memory, base keeps the owner of the memory alive
+ */
+template<typename T>
+py::array host_array_view(T* ptr, int num, py::handle base)
+{
+	return py::array(array_buffer_info(ptr, num), base);
+}
+
+/**
+ * @brief Number of elements of type T stored in a NumPy array, -1 if the shape does not match
+ */
+template<typename T>
+int element_count(const numpy_array<T>& arr)
+{
+	const int comps = ArrayTraits<T>::components;
+	if (comps == 1 && arr.ndim() == 1)
+		return (int)arr.shape(0);
+	if (arr.ndim() == 2 && arr.shape(1) == comps)
+		return (int)arr.shape(0);
+	if (arr.ndim() == 1 && arr.shape(0) % comps == 0)
+		return (int)arr.shape(0) / comps;
+
+	return -1;
+}
+
+template<typename T>
+int checked_element_count(const numpy_array<T>& arr)
+{
+	int num = element_count<T>(arr);
+	if (num < 0)
+		throw py::value_error("Array shape should be (N, " + std::to_string(ArrayTraits<T>::components) + ")");
+	return num;
+}
+
+/**
+ * @brief Copy device memory into a new NumPy array with a single memcpy
+ */
+template<typename T>
+py::array device_to_numpy(T* devicePtr, int num)
+{
+	py::array arr(array_buffer_info<T>(nullptr, num));
+	if (num > 0)
+	{
+		cuSafeCall(cudaMemcpy(arr.mutable_data(), devicePtr, num * sizeof(T), cudaMemcpyDeviceToHost));
+	}
+	return arr;
+}
@@ -1,4 +1,5 @@
 #include "PyCore.h"
+#include "PyArray.h"
 
 #include "Core/Utility/CTimer.h"
 #include "Core/Vector.h"
@@ -91,6 +92,31 @@ void declare_matrix(py::module &m, std::string typestr) {
 		.def_static("identity_matrix", &Matrix::identityMatrix);
 }
 
+template <typename T>
+void declare_host_array(py::module &m, std::string typestr) {
+	using Class = PhysIKA::HostArray<T>;
+	std::string pyclass_name = std::string("HostArray") + typestr;
+	py::class_<Class, std::shared_ptr<Class>>(m, pyclass_name.c_str(), py::buffer_protocol())
+		.def(py::init([](int num) {
+			//Array does not free its memory on destruction, arrays created from Python release it here
+			return std::shared_ptr<Class>(new Class(num), [](Class* arr) { arr->release(); delete arr; });
+			}))
+		.def(py::init([](numpy_array<T> arr) {
+			int num = checked_element_count<T>(arr);
+			auto ret = std::shared_ptr<Class>(new Class(num), [](Class* a) { a->release(); delete a; });
+			memcpy(ret->getDataPtr(), arr.data(), num * sizeof(T));
+			return ret;
+			}))
+		.def_buffer([](Class& arr) { return array_buffer_info(arr.getDataPtr(), arr.size()); })
+		.def("numpy", [](py::object self) {
+			Class& arr = self.cast<Class&>();
+			return host_array_view(arr.getDataPtr(), arr.size(), self);
+			}, "Zero-copy view of the array")
+		.def("size", &Class::size)
+		.def("__len__", &Class::size)
+		.def("reset", &Class::reset);
+}
+
 void pybind_core(py::module& m)
 {
 	py::class_<PhysIKA::CTimer>(m, "CTimer")
@@ -110,6 +136,10 @@ void pybind_core(py::module& m)
 	declare_matrix<float, 2>(m, "2f");
 	declare_matrix<float, 3>(m, "3f");
 	declare_matrix<float, 4>(m, "4f");
+
+	declare_host_array<float>(m, "f");
+	declare_host_array<int>(m, "i");
+	declare_host_array<PhysIKA::Vector<float, 3>>(m, "3f");
 // 
 // 	declare_matrix<double, 2>(m, "2d");
 // 	declare_matrix<double, 3>(m, "3d");
@@ -1,14 +1,24 @@
 #include "PyFramework.h"
+#include "PyArray.h"
+
+#include <functional>
+#include <algorithm>
+#include <mutex>
 
 #include "Framework/Framework/Node.h"
 #include "Framework/Framework/ModuleVisual.h"
 #include "Framework/Framework/SceneGraph.h"
 #include "Framework/Framework/Log.h"
+#include "Framework/Framework/FieldArray.h"
+#include "Framework/Topology/PointSet.h"
 
 using Node = PhysIKA::Node;
 using SceneGraph = PhysIKA::SceneGraph;
 using VisualModule = PhysIKA::VisualModule;
 using Log = PhysIKA::Log;
+using Module = PhysIKA::Module;
+using ModuleStatistics = PhysIKA::ModuleStatistics;
+using StatisticsNode = PhysIKA::StatisticsNode;
 
 
 template<class TNode, class ...Args>
@@ -16,6 +26,24 @@ std::shared_ptr<TNode> create_root(SceneGraph& scene, Args&& ... args) {
 	return scene.createNewScene<TNode>(std::forward<Args>(args)...);
 }
 
+static std::mutex s_errorMutex;
+static std::exception_ptr s_pendingError;
+
+void set_pending_error(std::exception_ptr error)
+{
+	std::lock_guard<std::mutex> lock(s_errorMutex);
+	if (!s_pendingError)
+		s_pendingError = error;
+}
+
+std::exception_ptr take_pending_error()
+{
+	std::lock_guard<std::mutex> lock(s_errorMutex);
+	std::exception_ptr error = s_pendingError;
+	s_pendingError = nullptr;
+	return error;
+}
+
 void pybind_log(py::module& m)
 {
 	py::class_<Log>(m, "Log")
@@ -23,12 +51,244 @@ void pybind_log(py::module& m)
 		.def_static("set_output", &Log::setOutput)
 		.def_static("get_output", &Log::getOutput)
 		.def_static("send_message", &Log::sendMessage)
-		.def_static("set_level", &Log::setLevel);
+		.def_static("set_level", &Log::setLevel)
+		.def_static("flush", &Log::flush)
+		.def_static("get_dropped_count", &Log::getDroppedCount);
+}
+
+void pybind_statistics(py::module& m)
+{
+	py::class_<ModuleStatistics>(m, "ModuleStatistics")
+		.def_readonly("total_time", &ModuleStatistics::totalTime)
+		.def_readonly("frame_time", &ModuleStatistics::frameTime)
+		.def_readonly("calls", &ModuleStatistics::calls)
+		.def_readonly("frame_calls", &ModuleStatistics::frameCalls)
+		.def_readonly("iterations", &ModuleStatistics::iterations)
+		.def_readonly("frame_iterations", &ModuleStatistics::frameIterations)
+		.def_readonly("elements", &ModuleStatistics::elements);
+
+	py::class_<StatisticsNode::ModuleEntry>(m, "ModuleStatisticsEntry")
+		.def_readonly("name", &StatisticsNode::ModuleEntry::name)
+		.def_readonly("type", &StatisticsNode::ModuleEntry::type)
+		.def_readonly("stats", &StatisticsNode::ModuleEntry::stats);
+
+	py::class_<StatisticsNode>(m, "StatisticsNode")
+		.def_readonly("name", &StatisticsNode::name)
+		.def_readonly("type", &StatisticsNode::type)
+		.def_readonly("modules", &StatisticsNode::modules)
+		.def_readonly("children", &StatisticsNode::children)
+		.def("to_json", &StatisticsNode::toJSON);
+
+	m.def("set_statistics_enabled", &Module::setStatisticsEnabled, "Turn the collection of module statistics on/off");
+}
+
+template <typename T>
+void declare_host_array_field(py::module &m, std::string typestr) {
+	using Class = PhysIKA::HostArrayField<T>;
+	std::string pyclass_name = std::string("HostArrayField") + typestr;
+	py::class_<Class>(m, pyclass_name.c_str(), py::buffer_protocol())
+		.def(py::init<>())
+		.def_buffer([](Class& f) {
+			if (f.isEmpty()) throw py::value_error("The field is empty");
+			return array_buffer_info(f.getValue().getDataPtr(), f.getValue().size());
+			})
+		.def("numpy", [](py::object self) {
+			Class& f = self.cast<Class&>();
+			if (f.isEmpty()) throw py::value_error("The field is empty");
+			return host_array_view(f.getValue().getDataPtr(), f.getValue().size(), self);
+			}, "Zero-copy view of the field")
+		.def("from_numpy", [](Class& f, numpy_array<T> arr) {
+			int num = checked_element_count<T>(arr);
+			if (num < 1) throw py::value_error("The input array is empty");
+			if (f.isEmpty() || (int)f.getElementCount() != num)
+				f.setElementCount(num);
+			memcpy(f.getValue().getDataPtr(), arr.data(), num * sizeof(T));
+			})
+		.def("size", &Class::getElementCount)
+		.def("is_empty", &Class::isEmpty);
+}
+
+template <typename T>
+void declare_device_array_field(py::module &m, std::string typestr) {
+	using Class = PhysIKA::DeviceArrayField<T>;
+	std::string pyclass_name = std::string("DeviceArrayField") + typestr;
+	py::class_<Class>(m, pyclass_name.c_str())
+		.def(py::init<>())
+		.def("to_numpy", [](Class& f) {
+			if (f.isEmpty()) throw py::value_error("The field is empty");
+			return device_to_numpy(f.getValue().getDataPtr(), f.getValue().size());
+			}, "Copy the field into a new array")
+		.def("from_numpy", [](Class& f, numpy_array<T> arr) {
+			int num = checked_element_count<T>(arr);
+			if (num < 1) throw py::value_error("The input array is empty");
+			if (f.isEmpty() || (int)f.getElementCount() != num)
+				f.setElementCount(num);
+			cuSafeCall(cudaMemcpy(f.getValue().getDataPtr(), arr.data(), num * sizeof(T), cudaMemcpyHostToDevice));
+			}, "Upload an array to the field")
+		.def("size", &Class::getElementCount)
+		.def("is_empty", &Class::isEmpty);
+}
+
+void pybind_field(py::module& m)
+{
+	declare_host_array_field<float>(m, "f");
+	declare_host_array_field<int>(m, "i");
+	declare_host_array_field<PhysIKA::Vector<float, 3>>(m, "3f");
+
+	declare_device_array_field<float>(m, "f");
+	declare_device_array_field<int>(m, "i");
+	declare_device_array_field<PhysIKA::Vector<float, 3>>(m, "3f");
+}
+
+typedef std::function<py::object()> FieldView;
+
+template <typename T>
+bool add_field_view(py::handle obj, std::vector<FieldView>& views)
+{
+	if (py::isinstance<PhysIKA::HostArrayField<T>>(obj))
+	{
+		auto f = obj.cast<PhysIKA::HostArrayField<T>*>();
+		py::object owner = py::reinterpret_borrow<py::object>(obj);
+		views.push_back([f, owner]() -> py::object {
+			if (f->isEmpty()) return py::none();
+			return host_array_view(f->getValue().getDataPtr(), f->getValue().size(), owner);
+			});
+		return true;
+	}
+
+	if (py::isinstance<PhysIKA::DeviceArrayField<T>>(obj))
+	{
+		//Device data is staged in a host array that is reused for every callback
+		auto f = obj.cast<PhysIKA::DeviceArrayField<T>*>();
+		auto staging = std::make_shared<py::array>();
+		views.push_back([f, staging]() -> py::object {
+			if (f->isEmpty()) return py::none();
+
+			int num = f->getValue().size();
+			if (staging->size() != (py::ssize_t)num * ArrayTraits<T>::components)
+				*staging = py::array(array_buffer_info<T>(nullptr, num));
+
+			cuSafeCall(cudaMemcpy(staging->mutable_data(), f->getValue().getDataPtr(), num * sizeof(T), cudaMemcpyDeviceToHost));
+			return *staging;
+			});
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Advance the scene by a number of frames without holding the GIL.
+ *
+ * Every interval frames the callback is invoked with the frame number and views of the given fields,
+ * the views are only valid during the call. Returning False from the callback stops the run.
+ */
+py::dict run_frames(SceneGraph& scene, int frames, py::object callback, int interval, py::list fields)
+{
+	if (interval < 1)
+		throw py::value_error("The callback interval should be at least 1");
+
+	std::vector<FieldView> views;
+	for (auto obj : fields)
+	{
+		bool added = add_field_view<PhysIKA::Vector<float, 3>>(obj, views)
+			|| add_field_view<float>(obj, views)
+			|| add_field_view<int>(obj, views);
+		if (!added)
+			throw py::type_error("Unsupported field type");
+	}
+
+	frames = std::max(frames, 0);
+	std::vector<float> frameCost(frames);
+	std::vector<int> substeps(frames);
+	std::vector<float> minTimeStep(frames);
+	std::vector<float> maxTimeStep(frames);
+
+	//Errors left by earlier calls outside run_frames do not belong to these frames
+	take_pending_error();
+
+	int finished = 0;
+	while (finished < frames)
+	{
+		int batch = callback.is_none() ? frames - finished : std::min(interval, frames - finished);
+		std::exception_ptr error;
+		{
+			py::gil_scoped_release release;
+
+			if (!scene.isInitialized())
+				scene.initialize();
+
+			for (int i = finished; i < finished + batch; i++)
+			{
+				scene.takeOneFrame();
+				frameCost[i] = scene.getTimeCostPerFrame();
+				substeps[i] = scene.getSubstepNumber();
+				minTimeStep[i] = scene.getMinTimeStep();
+				maxTimeStep[i] = scene.getMaxTimeStep();
+
+				//A failed callback has aborted the steps of its node, stop advancing the scene
+				error = take_pending_error();
+				if (error)
+					break;
+			}
+		}
+		if (error)
+			std::rethrow_exception(error);
+
+		finished += batch;
+
+		if (!callback.is_none())
+		{
+			py::list arrays;
+			for (size_t i = 0; i < views.size(); i++)
+			{
+				arrays.append(views[i]());
+			}
+
+			py::object ret = callback(scene.getFrameNumber(), arrays);
+			if (!ret.is_none() && !ret.cast<bool>())
+				break;
+		}
+	}
+
+	py::dict timing;
+	timing["frame_cost"] = py::array_t<float>(finished, frameCost.data());
+	timing["substeps"] = py::array_t<int>(finished, substeps.data());
+	timing["min_time_step"] = py::array_t<float>(finished, minTimeStep.data());
+	timing["max_time_step"] = py::array_t<float>(finished, maxTimeStep.data());
+	return timing;
+}
+
+template <typename TDataType>
+void declare_point_set(py::module &m, std::string typestr) {
+	using Class = PhysIKA::PointSet<TDataType>;
+	using Coord = typename TDataType::Coord;
+	std::string pyclass_name = std::string("PointSet") + typestr;
+	py::class_<Class, std::shared_ptr<Class>>(m, pyclass_name.c_str())
+		.def(py::init<>())
+		.def("set_points", [](Class& c, numpy_array<Coord> arr) {
+			int num = checked_element_count<Coord>(arr);
+			if (num < 1) throw py::value_error("The input array is empty");
+			c.setPoints(reinterpret_cast<const Coord*>(arr.data()), num);
+			}, "Set the points from an (N, 3) array")
+		.def("get_points", [](Class& c) { return device_to_numpy(c.getPoints().getDataPtr(), c.getPointSize()); })
+		.def("get_point_size", &Class::getPointSize)
+		.def("load_obj_file", &Class::loadObjFile)
+		.def("scale", (void (Class::*)(typename Class::Real)) &Class::scale)
+		.def("translate", &Class::translate);
+}
+
+void pybind_topology(py::module& m)
+{
+	declare_point_set<PhysIKA::DataType3f>(m, "3f");
 }
 
 void pybind_framework(py::module& m)
 {
 	pybind_log(m);
+	pybind_statistics(m);
+	pybind_field(m);
+	pybind_topology(m);
 
 	py::class_<Node, std::shared_ptr<Node>>(m, "Node")
 		.def(py::init<>())
@@ -40,10 +300,14 @@ void pybind_framework(py::module& m)
 		.def(py::init<>());
 
 	py::class_<SceneGraph>(m, "SceneGraph")
+		.def(py::init<>())
 		.def_static("get_instance", &SceneGraph::getInstance, py::return_value_policy::reference, "Return an instance")
 		.def("set_root_node", &SceneGraph::setRootNode)
 		.def("is_initialized", &SceneGraph::isInitialized)
 		.def("initialize", &SceneGraph::initialize)
+		.def("take_one_frame", &SceneGraph::takeOneFrame)
+		.def("run_frames", &run_frames, "Advance a number of frames with the GIL released",
+			py::arg("frames"), py::arg("callback") = py::none(), py::arg("interval") = 1, py::arg("fields") = py::list())
 		.def("set_total_time", &SceneGraph::setTotalTime)
 		.def("get_total_time", &SceneGraph::getTotalTime)
 		.def("set_frame_rate", &SceneGraph::setFrameRate)
@@ -51,6 +315,11 @@ void pybind_framework(py::module& m)
 		.def("get_timecost_perframe", &SceneGraph::getTimeCostPerFrame)
 		.def("get_frame_interval", &SceneGraph::getFrameInterval)
 		.def("get_frame_number", &SceneGraph::getFrameNumber)
+		.def("get_substep_number", &SceneGraph::getSubstepNumber)
+		.def("get_min_time_step", &SceneGraph::getMinTimeStep)
+		.def("get_max_time_step", &SceneGraph::getMaxTimeStep)
+		.def("get_statistics", &SceneGraph::getStatistics)
+		.def("get_statistics_json", &SceneGraph::getStatisticsJSON)
 		.def("set_gravity", &SceneGraph::setGravity)
 		.def("get_gravity", &SceneGraph::getGravity)
 		.def("get_lower_bound", &SceneGraph::getLowerBound)
@@ -1,6 +1,18 @@
 #pragma once
 #include "PyCommon.h"
+#include <exception>
 
 void pybind_log(py::module& m);
 
-void pybind_framework(py::module& m);
\ No newline at end of file
+void pybind_statistics(py::module& m);
+
+void pybind_field(py::module& m);
+
+void pybind_topology(py::module& m);
+
+void pybind_framework(py::module& m);
+
+/// Keeps the first exception raised by a Python callback while a scene is advanced, run_frames raises it once the frame ends
+void set_pending_error(std::exception_ptr error);
+
+std::exception_ptr take_pending_error();
@@ -1,9 +1,13 @@
 #include "PyParticleSystem.h"
+#include "PyFramework.h"
+#include "PyArray.h"
 
 #include "Dynamics/ParticleSystem/ParticleElasticBody.h"
 #include "Dynamics/ParticleSystem/StaticBoundary.h"
 #include "Dynamics/ParticleSystem/ElasticityModule.h"
+#include "Dynamics/ParticleSystem/CallbackForce.h"
 #include "Dynamics/RigidBody/RigidBody.h"
+#include "Framework/Topology/PointSet.h"
 
 template <typename TDataType>
 void declare_static_boundary(py::module &m, std::string typestr) {
@@ -14,7 +18,7 @@ void declare_static_boundary(py::module &m, std::string typestr) {
 		.def(py::init<>())
 		.def("add_rigid_body", &Class::addRigidBody)
 		.def("add_particle_system", &Class::addParticleSystem)
-		.def("load_sdf", &Class::loadSDF)
+		.def("load_sdf", (void (Class::*)(std::string, bool)) &Class::loadSDF)
 		.def("load_cube", &Class::loadCube)
 		.def("load_sphere", &Class::loadShpere)
 		.def("translate", &Class::translate)
@@ -28,7 +32,66 @@ void declare_particle_system(py::module &m, std::string typestr) {
 	using Parent = PhysIKA::Node;
 	std::string pyclass_name = std::string("ParticleSystem") + typestr;
 	py::class_<Class, Parent, std::shared_ptr<Class>>(m, pyclass_name.c_str(), py::buffer_protocol(), py::dynamic_attr())
-		.def(py::init<>());
+		.def(py::init<>())
+		.def("enable_adaptive_time_step", [](Class& c, typename Class::Real h) { c.enableAdaptiveTimeStep(h); })
+		.def("get_position", &Class::getPosition, py::return_value_policy::reference_internal)
+		.def("get_velocity", &Class::getVelocity, py::return_value_policy::reference_internal)
+		.def("get_force", &Class::getForce, py::return_value_policy::reference_internal)
+		.def("get_point_set", [](Class& c) { return std::dynamic_pointer_cast<PhysIKA::PointSet<TDataType>>(c.getTopologyModule()); })
+		.def("add_force_module", [](Class& c, std::shared_ptr<PhysIKA::CallbackForce<TDataType>> force) {
+			c.getPosition()->connect(force->m_position);
+			c.getVelocity()->connect(force->m_velocity);
+			c.getForce()->connect(force->m_forceDensity);
+			c.addForceModule(force);
+			});
+}
+
+/**
+ * The callback is called once per step as callback(position, velocity, dt) with (N, 3) views of the whole
+ * particle arrays and returns an (N, 3) force density, there is no per-particle entry point.
+ */
+template <typename TDataType>
+void declare_py_force_module(py::module &m, std::string pyclass_name) {
+	using Class = PhysIKA::CallbackForce<TDataType>;
+	using Coord = typename TDataType::Coord;
+	using Real = typename TDataType::Real;
+	py::class_<Class, std::shared_ptr<Class>>(m, pyclass_name.c_str())
+		.def(py::init<>())
+		.def("set_callback", [](Class& c, py::function callback) {
+			//The callback may be released from a thread that does not hold the GIL
+			std::shared_ptr<py::function> func(new py::function(callback), [](py::function* f) {
+				py::gil_scoped_acquire acquire;
+				delete f;
+			});
+
+			c.setForceFunction([func](PhysIKA::HostArray<Coord>& pos, PhysIKA::HostArray<Coord>& vel, Real dt, PhysIKA::HostArray<Coord>& force) {
+				py::gil_scoped_acquire acquire;
+				try
+				{
+					py::object ret = (*func)(
+						host_array_view(pos.getDataPtr(), pos.size(), py::none()),
+						host_array_view(vel.getDataPtr(), vel.size(), py::none()),
+						dt);
+
+					numpy_array<Coord> arr = numpy_array<Coord>::ensure(ret);
+					if (!arr || element_count<Coord>(arr) != force.size())
+					{
+						PhysIKA::Log::sendMessage(PhysIKA::Log::Error, "PyForceModule: the callback should return an (N, 3) array");
+						set_pending_error(std::make_exception_ptr(py::value_error("PyForceModule: the callback should return an (N, 3) array")));
+						return false;
+					}
+
+					memcpy(force.getDataPtr(), arr.data(), force.size() * sizeof(Coord));
+					return true;
+				}
+				catch (py::error_already_set& e)
+				{
+					PhysIKA::Log::sendMessage(PhysIKA::Log::Error, std::string("PyForceModule: ") + e.what());
+					set_pending_error(std::current_exception());
+					return false;
+				}
+			});
+		}, "Set the function computing the force density of all particles");
 }
 
 template <typename TDataType>
@@ -48,6 +111,7 @@ void declare_particle_elastic_body(py::module &m, std::string typestr) {
 void pybind_particle_system(py::module& m)
 {
 	declare_static_boundary<PhysIKA::DataType3f>(m, "3f");
+	declare_py_force_module<PhysIKA::DataType3f>(m, "PyForceModule");
 	declare_particle_system<PhysIKA::DataType3f>(m, "3f");
 	declare_particle_elastic_body<PhysIKA::DataType3f>(m, "3f");
 }
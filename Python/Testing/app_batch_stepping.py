@@ -0,0 +1,21 @@
+import PyPhysIKA as pk
+
+scene = pk.SceneGraph()
+
+bound = pk.StaticBoundary3f()
+bound.load_cube(pk.Vector3f([0, 0, 0]), pk.Vector3f([1, 1, 1]), 0.005, True, False)
+scene.set_root_node(bound)
+
+el = pk.ParticleElasticBody3f()
+el.load_particles("../../Media/bunny/bunny_points.obj")
+el.translate(pk.Vector3f([0.5, 0.2, 0.5]))
+bound.add_particle_system(el)
+
+
+def report(frame, fields):
+    position = fields[0]
+    print("frame", frame, "lowest particle", position[:, 1].min())
+
+
+timing = scene.run_frames(200, report, interval=50, fields=[el.get_position()])
+print("average frame cost", timing["frame_cost"].mean(), "max substeps", timing["substeps"].max())
@@ -0,0 +1,31 @@
+import numpy as np
+import PyPhysIKA as pk
+
+scene = pk.SceneGraph()
+
+bound = pk.StaticBoundary3f()
+bound.load_cube(pk.Vector3f([0, 0, 0]), pk.Vector3f([1, 1, 1]), 0.005, True, False)
+scene.set_root_node(bound)
+
+el = pk.ParticleElasticBody3f()
+el.load_particles("../../Media/bunny/bunny_points.obj")
+el.translate(pk.Vector3f([0.5, 0.2, 0.5]))
+bound.add_particle_system(el)
+
+center = np.array([0.5, 0.5, 0.5], dtype=np.float32)
+
+
+def wind_and_attractor(position, velocity, dt):
+    # One call per step over all particles
+    force = np.zeros_like(position)
+    force[:, 0] = 2.0 * np.sin(4.0 * position[:, 1])
+    force += 5.0 * (center - position)
+    return force
+
+
+wind = pk.PyForceModule()
+wind.set_callback(wind_and_attractor)
+el.add_force_module(wind)
+
+timing = scene.run_frames(100)
+print("average frame cost", timing["frame_cost"].mean())
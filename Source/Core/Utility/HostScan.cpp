@@ -0,0 +1,55 @@
+#include "HostScan.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <algorithm>
+
+namespace PhysIKA {
+
+	int HostScan::exclusive(int* data, int length)
+	{
+		if (length <= 0)
+			return 0;
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		int blockNum = std::min((int)pool.getThreadNum() * 4, (length + 4095) / 4096);
+		blockNum = std::max(blockNum, 1);
+		int blockSize = (length + blockNum - 1) / blockNum;
+
+		//Sum of each block, then the offsets of the blocks, then the scan inside each block
+		std::vector<int> blockSum(blockNum, 0);
+		pool.parallelFor(0, blockNum, [&](int bBegin, int bEnd) {
+			for (int b = bBegin; b < bEnd; b++)
+			{
+				int end = std::min(length, (b + 1) * blockSize);
+				int sum = 0;
+				for (int i = b * blockSize; i < end; i++)
+					sum += data[i];
+				blockSum[b] = sum;
+			}
+		}, 1);
+
+		int total = 0;
+		for (int b = 0; b < blockNum; b++)
+		{
+			int sum = blockSum[b];
+			blockSum[b] = total;
+			total += sum;
+		}
+
+		pool.parallelFor(0, blockNum, [&](int bBegin, int bEnd) {
+			for (int b = bBegin; b < bEnd; b++)
+			{
+				int end = std::min(length, (b + 1) * blockSize);
+				int sum = blockSum[b];
+				for (int i = b * blockSize; i < end; i++)
+				{
+					int val = data[i];
+					data[i] = sum;
+					sum += val;
+				}
+			}
+		}, 1);
+
+		return total;
+	}
+}
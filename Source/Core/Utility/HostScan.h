@@ -0,0 +1,19 @@
+#pragma once
+
+namespace PhysIKA {
+
+	/*!
+	*	\class	HostScan
+	*	\brief	Prefix sums of host arrays computed on the ThreadPool.
+	*/
+	class HostScan
+	{
+	public:
+		/**
+		 * @brief In-place exclusive scan
+		 *
+		 * @return the sum of all input elements
+		 */
+		static int exclusive(int* data, int length);
+	};
+}
@@ -0,0 +1,51 @@
+#include "HostSort.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <algorithm>
+
+namespace PhysIKA {
+
+	void HostSort::sort(unsigned long long* data, int length)
+	{
+		if (length <= 1)
+			return;
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		int blockNum = std::min((int)pool.getThreadNum(), (length + 65535) / 65536);
+		blockNum = std::max(blockNum, 1);
+		int blockSize = (length + blockNum - 1) / blockNum;
+
+		pool.parallelFor(0, blockNum, [&](int bBegin, int bEnd) {
+			for (int b = bBegin; b < bEnd; b++)
+			{
+				int begin = std::min(length, b * blockSize);
+				int end = std::min(length, (b + 1) * blockSize);
+				std::sort(data + begin, data + end);
+			}
+		}, 1);
+
+		//Merge runs of width sorted elements into runs of 2 * width, alternating between data and the buffer
+		std::vector<unsigned long long> buffer(length);
+		unsigned long long* src = data;
+		unsigned long long* dst = buffer.data();
+		for (int width = blockSize; width < length; width *= 2)
+		{
+			int pairNum = (length + 2 * width - 1) / (2 * width);
+			pool.parallelFor(0, pairNum, [&](int pBegin, int pEnd) {
+				for (int p = pBegin; p < pEnd; p++)
+				{
+					int begin = p * 2 * width;
+					int mid = std::min(length, begin + width);
+					int end = std::min(length, begin + 2 * width);
+					std::merge(src + begin, src + mid, src + mid, src + end, dst + begin);
+				}
+			}, 1);
+			std::swap(src, dst);
+		}
+
+		if (src != data)
+		{
+			std::copy(src, src + length, data);
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace PhysIKA {
+
+	/*!
+	*	\class	HostSort
+	*	\brief	Sorting of host arrays on the ThreadPool.
+	*/
+	class HostSort
+	{
+	public:
+		/**
+		 * @brief Sort ascending, blocks are sorted in parallel and merged pairwise in parallel rounds
+		 */
+		static void sort(unsigned long long* data, int length);
+	};
+}
@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace PhysIKA {
+
+	static thread_local bool s_isWorker = false;
+
+	ThreadPool::ThreadPool(unsigned int threadNum)
+		: m_stop(false)
+	{
+		if (threadNum == 0)
+		{
+			threadNum = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (unsigned int i = 0; i < threadNum; i++)
+		{
+			m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+	}
+
+	ThreadPool& ThreadPool::getInstance()
+	{
+		static ThreadPool m_instance;
+		return m_instance;
+	}
+
+	bool ThreadPool::isWorkerThread()
+	{
+		return s_isWorker;
+	}
+
+	void ThreadPool::parallelFor(int begin, int end, std::function<void(int, int)> func, int grain)
+	{
+		int total = end - begin;
+		if (total <= 0)
+		{
+			return;
+		}
+
+		int chunkNum = (int)getThreadNum() * 4;
+		int chunkSize = std::max(std::max(grain, 1), (total + chunkNum - 1) / chunkNum);
+
+		if (s_isWorker || m_workers.size() <= 1 || chunkSize >= total)
+		{
+			func(begin, end);
+			return;
+		}
+
+		std::vector<std::future<void>> results;
+		for (int i = begin; i < end; i += chunkSize)
+		{
+			int chunkEnd = std::min(i + chunkSize, end);
+			results.push_back(submit([=]() { func(i, chunkEnd); }));
+		}
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			results[i].get();
+		}
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		s_isWorker = true;
+
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+
+				if (m_stop && m_tasks.empty())
+				{
+					return;
+				}
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop();
+			}
+			task();
+		}
+	}
+}
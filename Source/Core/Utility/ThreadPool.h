@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace PhysIKA {
+
+	/*!
+	*	\class	ThreadPool
+	*	\brief	A fixed number of worker threads consuming a shared task queue.
+	*
+	*	Tasks submitted from inside a worker are still queued, but parallelFor() called from a worker
+	*	runs inline so that nested parallel regions can not dead-lock the pool.
+	*/
+	class ThreadPool
+	{
+	public:
+		/**
+		 * @param threadNum number of workers, 0 means std::thread::hardware_concurrency()
+		 */
+		explicit ThreadPool(unsigned int threadNum = 0);
+		~ThreadPool();
+
+		/**
+		 * @brief The process-wide pool shared by all CPU code paths
+		 */
+		static ThreadPool& getInstance();
+
+		unsigned int getThreadNum() { return (unsigned int)m_workers.size(); }
+
+		/**
+		 * @brief Check whether the calling thread is a worker of any ThreadPool
+		 */
+		static bool isWorkerThread();
+
+		template<class F>
+		std::future<typename std::result_of<F()>::type> submit(F func)
+		{
+			typedef typename std::result_of<F()>::type RetType;
+
+			auto task = std::make_shared<std::packaged_task<RetType()>>(func);
+			std::future<RetType> ret = task->get_future();
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_tasks.push([task]() { (*task)(); });
+			}
+			m_condition.notify_one();
+			return ret;
+		}
+
+		/**
+		 * @brief Split [begin, end) into contiguous chunks and call func(chunkBegin, chunkEnd) on each of them
+		 *
+		 * @param grain minimum number of elements per chunk, 0 lets the pool decide
+		 */
+		void parallelFor(int begin, int end, std::function<void(int, int)> func, int grain = 0);
+
+	private:
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void workerLoop();
+
+		std::vector<std::thread> m_workers;
+		std::queue<std::function<void()>> m_tasks;
+
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		bool m_stop;
+	};
+}
@@ -15,7 +15,7 @@ namespace PhysIKA
 	{
 		Coord lo(0.0f);
 		Coord hi(1.0f);
-		m_cSDF = std::make_shared<DistanceField3D<DataType3f>>();
+		m_cSDF = DistanceField3D<TDataType>::createShared();
 		m_cSDF->setSpace(lo - 0.025f, hi + 0.025f, 105, 105, 105);
 		m_cSDF->loadBox(lo, hi, true);
 	}
@@ -23,7 +23,30 @@ namespace PhysIKA
 	template<typename TDataType>
 	BoundaryConstraint<TDataType>::~BoundaryConstraint()
 	{
-		m_cSDF->release();
+	}
+
+	template<typename TDataType>
+	void BoundaryConstraint<TDataType>::setSDF(std::shared_ptr<DistanceField3D<TDataType>> sdf)
+	{
+		m_cSDF = sdf;
+	}
+
+	template<typename TDataType>
+	void BoundaryConstraint<TDataType>::detachSDF()
+	{
+		if (m_cSDF.use_count() > 1)
+		{
+			m_cSDF = DistanceField3D<TDataType>::createShared();
+		}
+	}
+
+	template<typename TDataType>
+	void BoundaryConstraint<TDataType>::compressSDF()
+	{
+		if (m_compressionBand > 0)
+		{
+			m_cSDF->compress(m_compressionBand);
+		}
 	}
 
 	template<typename Real, typename Coord, typename TDataType>
@@ -101,28 +124,36 @@ namespace PhysIKA
 	template<typename TDataType>
 	void BoundaryConstraint<TDataType>::load(std::string filename, bool inverted)
 	{
+		detachSDF();
 		m_cSDF->loadSDF(filename, inverted);
+		compressSDF();
 	}
 
 
 	template<typename TDataType>
 	void BoundaryConstraint<TDataType>::setCube(Coord lo, Coord hi, Real distance, bool inverted)
 	{
+		detachSDF();
+
 		int nx = floor((hi[0] - lo[0]) / distance);
 		int ny = floor((hi[1] - lo[1]) / distance);
 		int nz = floor((hi[2] - lo[2]) / distance);
 
 		m_cSDF->setSpace(lo - 5 *distance, hi + 5 * distance, nx + 10, ny + 10, nz + 10);
 		m_cSDF->loadBox(lo, hi, inverted);
+		compressSDF();
 	}
 
 	template<typename TDataType>
 	void BoundaryConstraint<TDataType>::setSphere(Coord center, Real r, Real distance, bool inverted)
 	{
+		detachSDF();
+
 		int nx = floor(2 * r / distance);
 
 		m_cSDF->setSpace(center - r - 5 * distance, center + r + 5 * distance, nx + 10, nx + 10, nx + 10);
 		m_cSDF->loadSphere(center, r, inverted);
+		compressSDF();
 	}
 
 }
\ No newline at end of file
@@ -25,6 +25,29 @@ namespace PhysIKA {
 		void setCube(Coord lo, Coord hi, Real distance, bool inverted = false);
 		void setSphere(Coord center, Real r, Real distance, bool inverted = false);
 
+		/**
+		 * @brief Use a distance field owned by someone else, e.g., shared by several scenes
+		 * 
+		 * The field is treated as read-only, load(), setCube() and setSphere() allocate a new one instead of overwriting it.
+		 * Its device memory is released by the deleter of the shared pointer, so it should come from
+		 * DistanceField3D::createShared(). Fields allocated by the constraint itself are created that way.
+		 */
+		void setSDF(std::shared_ptr<DistanceField3D<TDataType>> sdf);
+
+		/**
+		 * @brief Store the fields allocated by load(), setCube() and setSphere() as narrow bands, 0 keeps them dense
+		 *
+		 * See DistanceField3D::compress(), penetrations deeper than about bandWidth - 2 cells are not resolved.
+		 * Shared fields passed to setSDF() are left as they are.
+		 */
+		void setCompression(int bandWidth) { m_compressionBand = bandWidth; }
+
+	private:
+		void detachSDF();
+		void compressSDF();
+
+		int m_compressionBand = 0;
+
 	public:
 		DeviceArrayField<Coord> m_position;
 		DeviceArrayField<Coord> m_velocity;
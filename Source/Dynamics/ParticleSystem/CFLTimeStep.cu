@@ -0,0 +1,144 @@
+#include <cuda_runtime.h>
+#include "CFLTimeStep.h"
+#include "Framework/Framework/Node.h"
+#include "Framework/Framework/SceneGraph.h"
+#include "Core/Utility.h"
+#include <algorithm>
+
+namespace PhysIKA
+{
+	IMPLEMENT_CLASS_1(CFLTimeStep, TDataType)
+
+	//Upper bound of the number of blocks, each block writes its maxima to the host
+#define CFL_MAX_BLOCKS 256
+
+	template<typename TDataType>
+	CFLTimeStep<TDataType>::CFLTimeStep()
+		: TimeStepController()
+		, m_cfl(Real(0.4))
+		, m_forceFactor(Real(0.25))
+		, m_maxVelocity(Real(0))
+		, m_maxAcceleration(Real(0))
+	{
+		m_smoothingLength.setValue(Real(0.006));
+
+		attachField(&m_smoothingLength, "smoothing_length", "The smoothing length in SPH!", false);
+		attachField(&m_velocity, "velocity", "Storing the particle velocities!", false);
+		attachField(&m_forceDensity, "force_density", "Storing the particle force densities!", false);
+	}
+
+	template<typename TDataType>
+	CFLTimeStep<TDataType>::~CFLTimeStep()
+	{
+		m_blockMax.release();
+		m_hostBlockMax.release();
+	}
+
+	template<typename TDataType>
+	bool CFLTimeStep<TDataType>::initializeImpl()
+	{
+		if (m_velocity.isEmpty())
+		{
+			std::cout << "Exception: " << std::string("CFLTimeStep's fields are not fully initialized!") << "\n";
+			return false;
+		}
+
+		m_blockMax.resize(2 * CFL_MAX_BLOCKS);
+		m_hostBlockMax.resize(2 * CFL_MAX_BLOCKS);
+
+		return true;
+	}
+
+	template<typename Real, typename Coord>
+	__global__ void K_MaxVelocityAcceleration(
+		DeviceArray<Real> blockMax,
+		DeviceArray<Coord> velocity,
+		DeviceArray<Coord> forceDensity,
+		Coord gravity)
+	{
+		__shared__ Real vMax[BLOCK_SIZE];
+		__shared__ Real aMax[BLOCK_SIZE];
+
+		int tId = threadIdx.x;
+
+		Real v = Real(0);
+		Real a = Real(0);
+		bool hasForce = forceDensity.size() == velocity.size();
+		for (int pId = threadIdx.x + (blockIdx.x * blockDim.x); pId < velocity.size(); pId += blockDim.x * gridDim.x)
+		{
+			v = max(v, velocity[pId].norm());
+			a = max(a, hasForce ? (forceDensity[pId] + gravity).norm() : gravity.norm());
+		}
+
+		vMax[tId] = v;
+		aMax[tId] = a;
+		__syncthreads();
+
+		for (int s = blockDim.x / 2; s > 0; s >>= 1)
+		{
+			if (tId < s)
+			{
+				vMax[tId] = max(vMax[tId], vMax[tId + s]);
+				aMax[tId] = max(aMax[tId], aMax[tId + s]);
+			}
+			__syncthreads();
+		}
+
+		if (tId == 0)
+		{
+			blockMax[2 * blockIdx.x] = vMax[0];
+			blockMax[2 * blockIdx.x + 1] = aMax[0];
+		}
+	}
+
+	template<typename TDataType>
+	typename TDataType::Real CFLTimeStep<TDataType>::computeTimeStep()
+	{
+		int num = m_velocity.getElementCount();
+		if (num <= 0)
+		{
+			return m_maxDt;
+		}
+
+		Vector3f g = this->getSceneGraph()->getGravity();
+		Coord gravity(g[0], g[1], g[2]);
+
+		//Only gravity is taken into account if no force density is connected
+		DeviceArray<Coord> force;
+		if (!m_forceDensity.isEmpty())
+		{
+			force = m_forceDensity.getValue();
+		}
+
+		cuint pDims = std::min(cudaGridSize(num, BLOCK_SIZE), (cuint)CFL_MAX_BLOCKS);
+		K_MaxVelocityAcceleration << <pDims, BLOCK_SIZE >> > (
+			m_blockMax,
+			m_velocity.getValue(),
+			force,
+			gravity);
+		cuSynchronize();
+
+		Function1Pt::copy(m_hostBlockMax, m_blockMax);
+
+		m_maxVelocity = Real(0);
+		m_maxAcceleration = Real(0);
+		for (cuint i = 0; i < pDims; i++)
+		{
+			m_maxVelocity = std::max(m_maxVelocity, m_hostBlockMax[2 * i]);
+			m_maxAcceleration = std::max(m_maxAcceleration, m_hostBlockMax[2 * i + 1]);
+		}
+
+		Real h = m_smoothingLength.getValue();
+		Real dt = m_maxDt;
+		if (m_maxVelocity > EPSILON)
+		{
+			dt = std::min(dt, m_cfl * h / m_maxVelocity);
+		}
+		if (m_maxAcceleration > EPSILON)
+		{
+			dt = std::min(dt, m_forceFactor * sqrt(h / m_maxAcceleration));
+		}
+
+		return this->clampTimeStep(dt);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "Framework/Framework/TimeStepController.h"
+#include "Framework/Framework/FieldVar.h"
+#include "Framework/Framework/FieldArray.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	CFLTimeStep
+	*	\brief	Time step restricted by the CFL condition and the force condition.
+	*
+	*	dt = min(cfl * h / max|v|, f * sqrt(h / max|a|)), where h is the smoothing length and a = force density + gravity.
+	*	Both maxima are evaluated in a single pass over the particles.
+	*/
+	template<typename TDataType>
+	class CFLTimeStep : public TimeStepController
+	{
+		DECLARE_CLASS_1(CFLTimeStep, TDataType)
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		CFLTimeStep();
+		~CFLTimeStep() override;
+
+		Real computeTimeStep() override;
+
+		void setCFLNumber(Real cfl) { m_cfl = cfl; }
+		void setForceFactor(Real factor) { m_forceFactor = factor; }
+
+		Real getMaxVelocity() { return m_maxVelocity; }
+		Real getMaxAcceleration() { return m_maxAcceleration; }
+
+	protected:
+		bool initializeImpl() override;
+
+	public:
+		VarField<Real> m_smoothingLength;
+
+		DeviceArrayField<Coord> m_velocity;
+		DeviceArrayField<Coord> m_forceDensity;
+
+	private:
+		Real m_cfl;
+		Real m_forceFactor;
+
+		Real m_maxVelocity;
+		Real m_maxAcceleration;
+
+		DeviceArray<Real> m_blockMax;
+		HostArray<Real> m_hostBlockMax;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class CFLTimeStep<DataType3f>;
+#else
+	template class CFLTimeStep<DataType3d>;
+#endif
+}
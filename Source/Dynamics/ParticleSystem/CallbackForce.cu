@@ -0,0 +1,87 @@
+#include <cuda_runtime.h>
+#include "CallbackForce.h"
+#include "Framework/Framework/Node.h"
+#include "Core/Utility.h"
+
+namespace PhysIKA
+{
+	IMPLEMENT_CLASS_1(CallbackForce, TDataType)
+
+	template<typename TDataType>
+	CallbackForce<TDataType>::CallbackForce()
+		: ForceModule()
+	{
+		attachField(&m_position, "position", "Storing the particle positions!", false);
+		attachField(&m_velocity, "velocity", "Storing the particle velocities!", false);
+		attachField(&m_forceDensity, "force_density", "Storing the particle force densities!", false);
+	}
+
+	template<typename TDataType>
+	CallbackForce<TDataType>::~CallbackForce()
+	{
+		m_hostPosition.release();
+		m_hostVelocity.release();
+		m_hostForce.release();
+		m_force.release();
+	}
+
+	template<typename TDataType>
+	bool CallbackForce<TDataType>::initializeImpl()
+	{
+		if (m_position.isEmpty() || m_velocity.isEmpty() || m_forceDensity.isEmpty())
+		{
+			std::cout << "Exception: " << std::string("CallbackForce's fields are not fully initialized!") << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	template <typename Coord>
+	__global__ void K_AddForce(
+		DeviceArray<Coord> forceDensity,
+		DeviceArray<Coord> force)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= forceDensity.size()) return;
+
+		forceDensity[pId] += force[pId];
+	}
+
+	template<typename TDataType>
+	bool CallbackForce<TDataType>::applyForce()
+	{
+		if (!m_function)
+			return true;
+
+		int num = m_position.getElementCount();
+		if (num == 0)
+			return true;
+
+		if (m_force.size() != num)
+		{
+			m_hostPosition.resize(num);
+			m_hostVelocity.resize(num);
+			m_hostForce.resize(num);
+			m_force.resize(num);
+		}
+
+		Function1Pt::copy(m_hostPosition, m_position.getValue());
+		Function1Pt::copy(m_hostVelocity, m_velocity.getValue());
+		m_hostForce.reset();
+
+		if (!m_function(m_hostPosition, m_hostVelocity, getParent()->getDt(), m_hostForce))
+		{
+			Log::sendMessage(Log::Error, "CallbackForce: the force function failed!");
+			return false;
+		}
+
+		Function1Pt::copy(m_force, m_hostForce);
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_AddForce << <pDims, BLOCK_SIZE >> > (m_forceDensity.getValue(), m_force);
+		cuSynchronize();
+
+		return true;
+	}
+}
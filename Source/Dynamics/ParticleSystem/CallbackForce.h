@@ -0,0 +1,57 @@
+#pragma once
+#include "Framework/Framework/ModuleForce.h"
+#include "Framework/Framework/FieldArray.h"
+#include <functional>
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	CallbackForce
+	*	\brief	Force density computed on the host by a user function over whole particle arrays.
+	*
+	*	Positions and velocities are downloaded once per step, the function fills the force array for all particles
+	*	which is uploaded and added to the force density before the integrator updates the velocities.
+	*/
+	template<typename TDataType>
+	class CallbackForce : public ForceModule
+	{
+		DECLARE_CLASS_1(CallbackForce, TDataType)
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		/**
+		 * @brief Arguments: position, velocity, time step and the zero-initialized force to fill, returns false on failure
+		 */
+		typedef std::function<bool(HostArray<Coord>&, HostArray<Coord>&, Real, HostArray<Coord>&)> ForceFunction;
+
+		CallbackForce();
+		~CallbackForce() override;
+
+		void setForceFunction(ForceFunction func) { m_function = func; }
+
+		bool applyForce() override;
+
+	protected:
+		bool initializeImpl() override;
+
+	public:
+		DeviceArrayField<Coord> m_position;
+		DeviceArrayField<Coord> m_velocity;
+		DeviceArrayField<Coord> m_forceDensity;
+
+	private:
+		ForceFunction m_function;
+
+		HostArray<Coord> m_hostPosition;
+		HostArray<Coord> m_hostVelocity;
+		HostArray<Coord> m_hostForce;
+		DeviceArray<Coord> m_force;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class CallbackForce<DataType3f>;
+#else
+	template class CallbackForce<DataType3d>;
+#endif
+}
@@ -4,6 +4,7 @@
 #include "DensityPBD.h"
 #include "Framework/Framework/Node.h"
 #include <string>
+#include <sstream>
 #include "DensitySummation.h"
 #include "Framework/Topology/FieldNeighbor.h"
 
@@ -32,7 +33,7 @@ namespace PhysIKA
 			int j = neighbors.getElement(pId, ne);
 			Real r = (pos_i - posArr[j]).norm();
 
-			if (r > EPSILON)
+			if (r > EPSILON && r < smoothingLength)
 			{
 				total_weight += kernel.Weight(r, smoothingLength);
 			}
@@ -42,12 +43,12 @@ namespace PhysIKA
 	}
 
 
-	template <typename Real, typename Coord>
+	template <typename Real, typename Coord, typename NeighborListType>
 	__global__ void K_ComputeLambdas(
 		DeviceArray<Real> lambdaArr,
 		DeviceArray<Real> rhoArr,
 		DeviceArray<Coord> posArr,
-		NeighborList<int> neighbors,
+		NeighborListType neighbors,
 		SpikyKernel<Real> kern,
 		Real smoothingLength)
 	{
@@ -59,13 +60,13 @@ namespace PhysIKA
 		Real lamda_i = Real(0);
 		Coord grad_ci(0);
 
-		int nbSize = neighbors.getNeighborSize(pId);
-		for (int ne = 0; ne < nbSize; ne++)
+		int j;
+		NeighborCursor<NeighborListType> it(neighbors, pId);
+		while (it.next(j))
 		{
-			int j = neighbors.getElement(pId, ne);
 			Real r = (pos_i - posArr[j]).norm();
 
-			if (r > EPSILON)
+			if (r > EPSILON && r < smoothingLength)
 			{
 				Coord g = kern.Gradient(r, smoothingLength)*(pos_i - posArr[j]) * (1.0f / r);
 				grad_ci += g;
@@ -87,13 +88,13 @@ namespace PhysIKA
 		lambdaArr[pId] = lamda_i > 0.0f ? 0.0f : lamda_i;
 	}
 
-	template <typename Real, typename Coord>
+	template <typename Real, typename Coord, typename NeighborListType>
 	__global__ void K_ComputeLambdas(
 		DeviceArray<Real> lambdaArr,
 		DeviceArray<Real> rhoArr,
 		DeviceArray<Coord> posArr,
 		DeviceArray<Real> massInvArr,
-		NeighborList<int> neighbors,
+		NeighborListType neighbors,
 		SpikyKernel<Real> kern,
 		Real smoothingLength)
 	{
@@ -105,13 +106,13 @@ namespace PhysIKA
 		Real lamda_i = Real(0);
 		Coord grad_ci(0);
 
-		int nbSize = neighbors.getNeighborSize(pId);
-		for (int ne = 0; ne < nbSize; ne++)
+		int j;
+		NeighborCursor<NeighborListType> it(neighbors, pId);
+		while (it.next(j))
 		{
-			int j = neighbors.getElement(pId, ne);
 			Real r = (pos_i - posArr[j]).norm();
 
-			if (r > EPSILON)
+			if (r > EPSILON && r < smoothingLength)
 			{
 				Coord g = kern.Gradient(r, smoothingLength)*(pos_i - posArr[j]) * (1.0f / r);
 				grad_ci += g;
@@ -129,12 +130,12 @@ namespace PhysIKA
 	}
 
 
-	template <typename Real, typename Coord>
+	template <typename Real, typename Coord, typename NeighborListType>
 	__global__ void K_ComputeDisplacement(
 		DeviceArray<Coord> dPos, 
 		DeviceArray<Real> lambdas, 
 		DeviceArray<Coord> posArr, 
-		NeighborList<int> neighbors, 
+		NeighborListType neighbors, 
 		SpikyKernel<Real> kern,
 		Real smoothingLength,
 		Real dt)
@@ -146,12 +147,12 @@ namespace PhysIKA
 		Real lamda_i = lambdas[pId];
 
 		Coord dP_i(0);
-		int nbSize = neighbors.getNeighborSize(pId);
-		for (int ne = 0; ne < nbSize; ne++)
+		int j;
+		NeighborCursor<NeighborListType> it(neighbors, pId);
+		while (it.next(j))
 		{
-			int j = neighbors.getElement(pId, ne);
 			Real r = (pos_i - posArr[j]).norm();
-			if (r > EPSILON)
+			if (r > EPSILON && r < smoothingLength)
 			{
 				Coord dp_ij = 10.0f*(pos_i - posArr[j])*(lamda_i + lambdas[j])*kern.Gradient(r, smoothingLength)* (1.0 / r);
 				dP_i += dp_ij;
@@ -176,13 +177,13 @@ namespace PhysIKA
 //		dPos[pId] = dP_i;
 	}
 
-	template <typename Real, typename Coord>
+	template <typename Real, typename Coord, typename NeighborListType>
 	__global__ void K_ComputeDisplacement(
 		DeviceArray<Coord> dPos,
 		DeviceArray<Real> lambdas,
 		DeviceArray<Coord> posArr,
 		DeviceArray<Real> massInvArr,
-		NeighborList<int> neighbors,
+		NeighborListType neighbors,
 		SpikyKernel<Real> kern,
 		Real smoothingLength,
 		Real dt)
@@ -193,12 +194,12 @@ namespace PhysIKA
 		Coord pos_i = posArr[pId];
 		Real lamda_i = lambdas[pId];
 
-		int nbSize = neighbors.getNeighborSize(pId);
-		for (int ne = 0; ne < nbSize; ne++)
+		int j;
+		NeighborCursor<NeighborListType> it(neighbors, pId);
+		while (it.next(j))
 		{
-			int j = neighbors.getElement(pId, ne);
 			Real r = (pos_i - posArr[j]).norm();
-			if (r > EPSILON)
+			if (r > EPSILON && r < smoothingLength)
 			{
 				Coord dp_ij = 10.0f*(pos_i - posArr[j])*(lamda_i + lambdas[j])*kern.Gradient(r, smoothingLength)* (1.0 / r);
 				Coord dp_ji = -dp_ij * massInvArr[j];
@@ -221,6 +222,40 @@ namespace PhysIKA
 		}
 	}
 
+	/**
+	 * @brief Displacement of a pair (i, j) of a half list, applies what both K_ComputeDisplacement threads of the pair add
+	 */
+	template <typename Real, typename Coord>
+	struct PairDisplacement
+	{
+		DeviceArray<Real> lambdas;
+		DeviceArray<Coord> posArr;
+		DeviceArray<Real> massInvArr;
+		bool hasMassInv;
+		SpikyKernel<Real> kern;
+		Real smoothingLength;
+
+		GPU_FUNC void operator()(int i, int j, Coord& dP_i, Coord& dP_j)
+		{
+			Coord x_ij = posArr[i] - posArr[j];
+			Real r = x_ij.norm();
+			if (r > EPSILON && r < smoothingLength)
+			{
+				Coord dp_ij = 20.0f*x_ij*(lambdas[i] + lambdas[j])*kern.Gradient(r, smoothingLength)* (1.0 / r);
+				if (hasMassInv)
+				{
+					dP_i += dp_ij * massInvArr[i];
+					dP_j -= dp_ij * massInvArr[j];
+				}
+				else
+				{
+					dP_i += dp_ij;
+					dP_j -= dp_ij;
+				}
+			}
+		}
+	};
+
 	template <typename Real, typename Coord>
 	__global__ void K_UpdatePosition(
 		DeviceArray<Coord> posArr, 
@@ -239,9 +274,16 @@ namespace PhysIKA
 	DensityPBD<TDataType>::DensityPBD()
 		: ConstraintModule()
 		, m_maxIteration(3)
+		, m_neighborCompression(false)
+		, m_compressionReported(false)
+		, m_symmetricPairs(false)
+		, m_cellWalkEnabled(false)
+		, m_hybridList(false)
 	{
 		m_restDensity.setValue(Real(1000));
 		m_smoothingLength.setValue(Real(0.011));
+		m_cellWalk.setValue(CellWalkNeighbors<TDataType>());
+		m_hybridNeighborhood.setValue(HybridNeighborList());
 
 		attachField(&m_restDensity, "rest_density", "Reference density", false);
 		attachField(&m_smoothingLength, "smoothing_length", "The smoothing length in SPH!", false);
@@ -249,6 +291,8 @@ namespace PhysIKA
 		attachField(&m_velocity, "velocity", "Storing the particle velocities!", false);
 		attachField(&m_density, "density", "Storing the particle densities!", false);
 		attachField(&m_neighborhood, "neighborhood", "Storing neighboring particles' ids!", false);
+		attachField(&m_cellWalk, "cell_walk", "Grid walked instead of the neighborhood!", false);
+		attachField(&m_hybridNeighborhood, "hybrid_neighborhood", "Neighbors read instead of the neighborhood!", false);
 	}
 
 	template<typename TDataType>
@@ -257,6 +301,9 @@ namespace PhysIKA
 		m_lamda.release();
 		m_deltaPos.release();
 		m_position_old.release();
+		m_compressedNeighbors.release();
+		m_halfNeighbors.release();
+		m_pairSchedule.release();
 	}
 
 	template<typename TDataType>
@@ -280,6 +327,10 @@ namespace PhysIKA
 		m_position.connect(m_densitySum->m_position);
 		m_density.connect(m_densitySum->m_density);
 		m_neighborhood.connect(m_densitySum->m_neighborhood);
+		m_cellWalk.connect(m_densitySum->m_cellWalk);
+		m_hybridNeighborhood.connect(m_densitySum->m_hybridNeighborhood);
+		m_densitySum->setCellWalk(m_cellWalkEnabled);
+		m_densitySum->setHybridList(m_hybridList);
 
 		m_densitySum->initialize();
 
@@ -310,8 +361,23 @@ namespace PhysIKA
 	template<typename TDataType>
 	bool DensityPBD<TDataType>::constrain()
 	{
+		ModuleTimer timer(this, m_position.getElementCount());
+
 		Function1Pt::copy(m_position_old, m_position.getValue());
 
+		//The neighborhood is fixed during the iterations, it is encoded once and read by every pass
+		if (m_neighborCompression && readsNeighborField())
+		{
+			m_compressedNeighbors.encode(m_neighborhood.getValue());
+			reportCompression();
+		}
+
+		if (isPairScheduled())
+		{
+			PairSchedule<TDataType>::extractHalfList(m_neighborhood.getValue(), m_halfNeighbors);
+			m_pairSchedule.build(m_position.getValue(), m_halfNeighbors);
+		}
+
 		int it = 0;
 		while (it < m_maxIteration)
 		{
@@ -319,6 +385,7 @@ namespace PhysIKA
 
 			it++;
 		}
+		this->recordIterations(it);
 
 		updateVelocity();
 
@@ -326,8 +393,74 @@ namespace PhysIKA
 	}
 
 
+	template<typename TDataType>
+	void DensityPBD<TDataType>::setCellWalk(bool walk)
+	{
+		m_cellWalkEnabled = walk;
+		if (m_densitySum != nullptr)
+		{
+			m_densitySum->setCellWalk(walk);
+		}
+	}
+
+	template<typename TDataType>
+	void DensityPBD<TDataType>::setHybridList(bool hybrid)
+	{
+		m_hybridList = hybrid;
+		if (m_densitySum != nullptr)
+		{
+			m_densitySum->setHybridList(hybrid);
+		}
+	}
+
 	template<typename TDataType>
 	void DensityPBD<TDataType>::takeOneIteration()
+	{
+		if (m_cellWalkEnabled)
+		{
+			takeOneIteration(m_cellWalk.getValue());
+		}
+		else if (m_hybridList)
+		{
+			takeOneIteration(m_hybridNeighborhood.getValue());
+		}
+		else if (m_neighborCompression)
+		{
+			takeOneIteration(m_compressedNeighbors);
+		}
+		else
+		{
+			takeOneIteration(m_neighborhood.getValue());
+		}
+	}
+
+	template<typename TDataType>
+	void DensityPBD<TDataType>::computeDensity(NeighborList<int>& neighbors)
+	{
+		m_densitySum->compute();
+	}
+
+	template<typename TDataType>
+	void DensityPBD<TDataType>::computeDensity(CompressedNeighborList& neighbors)
+	{
+		m_densitySum->compute(neighbors);
+	}
+
+	template<typename TDataType>
+	void DensityPBD<TDataType>::computeDensity(CellWalkNeighbors<TDataType>& neighbors)
+	{
+		m_densitySum->compute();
+	}
+
+	template<typename TDataType>
+	void DensityPBD<TDataType>::computeDensity(HybridNeighborList& neighbors)
+	{
+		m_densitySum->compute();
+	}
+
+	template<typename TDataType>
+	template<typename NeighborListType>
+	void DensityPBD<TDataType>::takeOneIteration(NeighborListType& neighbors)
 	{
 		Real dt = this->getParent()->getDt();
 
@@ -335,7 +468,7 @@ namespace PhysIKA
 		uint pDims = cudaGridSize(num, BLOCK_SIZE);
 
 		m_deltaPos.reset();
-		m_densitySum->compute();
+		computeDensity(neighbors);
 
 
 		if (m_massInv.isEmpty())
@@ -344,20 +477,10 @@ namespace PhysIKA
 				m_lamda,
 				m_density.getValue(),
 				m_position.getValue(),
-				m_neighborhood.getValue(),
+				neighbors,
 				m_kernel,
 				m_smoothingLength.getValue());
 			cuSynchronize();
-
-			K_ComputeDisplacement <Real, Coord> << <pDims, BLOCK_SIZE >> > (
-				m_deltaPos,
-				m_lamda,
-				m_position.getValue(),
-				m_neighborhood.getValue(),
-				m_kernel,
-				m_smoothingLength.getValue(),
-				dt);
-			cuSynchronize();
 		}
 		else
 		{
@@ -366,17 +489,45 @@ namespace PhysIKA
 				m_density.getValue(),
 				m_position.getValue(),
 				m_massInv.getValue(),
-				m_neighborhood.getValue(),
+				neighbors,
 				m_kernel,
 				m_smoothingLength.getValue());
 			cuSynchronize();
+		}
 
+		if (isPairScheduled())
+		{
+			PairDisplacement<Real, Coord> displacement;
+			displacement.lambdas = m_lamda;
+			displacement.posArr = m_position.getValue();
+			displacement.hasMassInv = !m_massInv.isEmpty();
+			if (displacement.hasMassInv)
+				displacement.massInvArr = m_massInv.getValue();
+			displacement.kern = m_kernel;
+			displacement.smoothingLength = m_smoothingLength.getValue();
+
+			m_pairSchedule.apply(m_halfNeighbors, m_deltaPos, displacement);
+		}
+		else if (m_massInv.isEmpty())
+		{
+			K_ComputeDisplacement <Real, Coord> << <pDims, BLOCK_SIZE >> > (
+				m_deltaPos,
+				m_lamda,
+				m_position.getValue(),
+				neighbors,
+				m_kernel,
+				m_smoothingLength.getValue(),
+				dt);
+			cuSynchronize();
+		}
+		else
+		{
 			K_ComputeDisplacement <Real, Coord> << <pDims, BLOCK_SIZE >> > (
 				m_deltaPos,
 				m_lamda,
 				m_position.getValue(),
 				m_massInv.getValue(),
-				m_neighborhood.getValue(),
+				neighbors,
 				m_kernel,
 				m_smoothingLength.getValue(),
 				dt);
@@ -391,6 +542,28 @@ namespace PhysIKA
 		cuSynchronize();
 	}
 
+	template<typename TDataType>
+	void DensityPBD<TDataType>::reportCompression()
+	{
+		if (m_compressionReported)
+		{
+			return;
+		}
+		m_compressionReported = true;
+
+		NeighborList<int>& nbr = m_neighborhood.getValue();
+		size_t rawSize = nbr.getElements().size() * sizeof(int) + nbr.getIndex().size() * sizeof(int);
+		size_t encodedSize = m_compressedNeighbors.getMemorySize();
+		int nearNum = m_compressedNeighbors.getNearElementCount();
+		int farNum = m_compressedNeighbors.getFarElementCount();
+		Real farRatio = nearNum + farNum > 0 ? Real(farNum) / Real(nearNum + farNum) : Real(0);
+
+		std::ostringstream ss;
+		ss << this->getName() << ": neighbor list " << rawSize / 1024 << " KB, compressed " << encodedSize / 1024
+			<< " KB (" << Real(100) * farRatio << "% far neighbors)";
+		Log::sendMessage(Log::Info, ss.str());
+	}
+
 	template <typename Real, typename Coord>
 	__global__ void DP_UpdateVelocity(
 		DeviceArray<Coord> velArr,
@@ -4,6 +4,10 @@
 #include "Framework/Framework/FieldVar.h"
 #include "Framework/Framework/FieldArray.h"
 #include "Framework/Topology/FieldNeighbor.h"
+#include "Framework/Topology/CompressedNeighborList.h"
+#include "Framework/Topology/CellWalkNeighbors.h"
+#include "Framework/Topology/HybridNeighborList.h"
+#include "Framework/Topology/PairKernel.h"
 #include "Kernel.h"
 
 namespace PhysIKA {
@@ -33,11 +37,56 @@ namespace PhysIKA {
 
 		void setIterationNumber(int n) { m_maxIteration = n; }
 
+		/**
+		 * @brief Read the neighbors from a 16-bit offset encoding during the iterations, see CompressedNeighborList
+		 *
+		 * Most effective once the particles are spatially ordered, the sizes of both lists are logged on first use.
+		 */
+		void setNeighborCompression(bool compression) { m_neighborCompression = compression; }
+
+		/**
+		 * @brief Evaluate each pair once when accumulating the displacements, see PairSchedule
+		 *
+		 * A half list (j > i) is extracted from the neighborhood once per call to constrain(), the displacement of a pair
+		 * is then applied to both particles by one thread, without atomics.
+		 */
+		void setSymmetricPairs(bool symmetric) { m_symmetricPairs = symmetric; }
+
+		/**
+		 * @brief Walk the grid of the cell_walk field instead of reading the neighborhood, see NeighborQuery::setCellWalk()
+		 *
+		 * No neighbor ids are stored at the cost of visiting the 27 cells in every pass.
+		 * Neighbor compression and symmetric pairs need the lists and are ignored.
+		 */
+		void setCellWalk(bool walk);
+
+		/**
+		 * @brief Read the hybrid_neighborhood field instead of the neighborhood, see NeighborQuery::setHybridList()
+		 *
+		 * Neighbor compression and symmetric pairs need the neighborhood field and are ignored.
+		 */
+		void setHybridList(bool hybrid);
+
 		DeviceArray<Real>& getDensity() { return m_density.getValue(); }
 
 	protected:
 		bool initializeImpl() override;
 
+	private:
+		template<typename NeighborListType>
+		void takeOneIteration(NeighborListType& neighbors);
+
+		void computeDensity(NeighborList<int>& neighbors);
+		void computeDensity(CompressedNeighborList& neighbors);
+		void computeDensity(CellWalkNeighbors<TDataType>& neighbors);
+		void computeDensity(HybridNeighborList& neighbors);
+
+		/// Whether the solver reads the neighborhood field, compression and symmetric pairs are built from it
+		bool readsNeighborField() { return !m_cellWalkEnabled && !m_hybridList; }
+		bool isPairScheduled() { return m_symmetricPairs && readsNeighborField(); }
+
+		void reportCompression();
+
 	public:
 		VarField<Real> m_restDensity;
 		VarField<Real> m_smoothingLength;
@@ -47,6 +96,8 @@ namespace PhysIKA {
 		DeviceArrayField<Real> m_massInv; // mass^-1 as described in unified particle physics
 
 		NeighborField<int> m_neighborhood;
+		VarField<CellWalkNeighbors<TDataType>> m_cellWalk;
+		VarField<HybridNeighborList> m_hybridNeighborhood;
 
 		DeviceArrayField<Real> m_density;
 	private:
@@ -54,6 +105,17 @@ namespace PhysIKA {
 
 		SpikyKernel<Real> m_kernel;
 
+		bool m_neighborCompression;
+		bool m_compressionReported;
+		CompressedNeighborList m_compressedNeighbors;
+
+		bool m_symmetricPairs;
+		NeighborList<int> m_halfNeighbors;
+		PairSchedule<TDataType> m_pairSchedule;
+
+		bool m_cellWalkEnabled;
+		bool m_hybridList;
+
 		DeviceArray<Real> m_lamda;
 		DeviceArray<Coord> m_deltaPos;
 		DeviceArray<Coord> m_position_old;
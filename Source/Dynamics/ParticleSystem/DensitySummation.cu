@@ -9,11 +9,11 @@ namespace PhysIKA
 {
 	IMPLEMENT_CLASS_1(DensitySummation, TDataType)
 
-	template<typename Real, typename Coord>
+	template<typename Real, typename Coord, typename NeighborListType>
 	__global__ void K_ComputeDensity(
 		DeviceArray<Real> rhoArr,
 		DeviceArray<Coord> posArr,
-		NeighborList<int> neighbors,
+		NeighborListType neighbors,
 		Real smoothingLength,
 		Real mass
 	)
@@ -25,12 +25,15 @@ namespace PhysIKA
 		Real r;
 		Real rho_i = Real(0);
 		Coord pos_i = posArr[pId];
-		int nbSize = neighbors.getNeighborSize(pId);
-		for (int ne = 0; ne < nbSize; ne++)
+		int j;
+		NeighborCursor<NeighborListType> it(neighbors, pId);
+		while (it.next(j))
 		{
-			int j = neighbors.getElement(pId, ne);
 			r = (pos_i - posArr[j]).norm();
-			rho_i += mass*kern.Weight(r, smoothingLength);
+			if (r < smoothingLength)
+			{
+				rho_i += mass*kern.Weight(r, smoothingLength);
+			}
 		}
 		rhoArr[pId] = rho_i;
 	}
@@ -39,10 +42,14 @@ namespace PhysIKA
 	DensitySummation<TDataType>::DensitySummation()
 		: ComputeModule()
 		, m_factor(Real(1))
+		, m_cellWalkEnabled(false)
+		, m_hybridList(false)
 	{
 		m_mass.setValue(Real(1));
 		m_restDensity.setValue(Real(1000));
 		m_smoothingLength.setValue(Real(0.011));
+		m_cellWalk.setValue(CellWalkNeighbors<TDataType>());
+		m_hybridNeighborhood.setValue(HybridNeighborList());
 
 		attachField(&m_mass, "mass", "particle mass", false);
 		attachField(&m_restDensity, "rest_density", "Reference density", false);
@@ -51,29 +58,55 @@ namespace PhysIKA
 		attachField(&m_position, "position", "Storing the particle positions!", false);
 		attachField(&m_density, "density", "Storing the particle densities!", false);
 		attachField(&m_neighborhood, "neighborhood", "Storing neighboring particles' ids!", false);
+		attachField(&m_cellWalk, "cell_walk", "Grid walked instead of the neighborhood!", false);
+		attachField(&m_hybridNeighborhood, "hybrid_neighborhood", "Neighbors read instead of the neighborhood!", false);
 	}
 
 	template<typename TDataType>
 	void DensitySummation<TDataType>::compute()
 	{
-		compute(
-			m_density.getValue(),
-			m_position.getValue(),
-			m_neighborhood.getValue(),
-			m_smoothingLength.getValue(),
-			m_mass.getValue());
+		ModuleTimer timer(this, m_position.getElementCount());
+
+		computeSelected(m_density.getValue(), m_mass.getValue());
 	}
 
 
 	template<typename TDataType>
 	void DensitySummation<TDataType>::compute(DeviceArray<Real>& rho)
 	{
-		compute(
-			rho,
-			m_position.getValue(),
-			m_neighborhood.getValue(),
-			m_smoothingLength.getValue(),
-			m_mass.getValue());
+		computeSelected(rho, m_mass.getValue());
+	}
+
+	template<typename TDataType>
+	void DensitySummation<TDataType>::computeSelected(DeviceArray<Real>& rho, Real mass)
+	{
+		if (m_cellWalkEnabled)
+		{
+			compute(
+				rho,
+				m_position.getValue(),
+				m_cellWalk.getValue(),
+				m_smoothingLength.getValue(),
+				mass);
+		}
+		else if (m_hybridList)
+		{
+			compute(
+				rho,
+				m_position.getValue(),
+				m_hybridNeighborhood.getValue(),
+				m_smoothingLength.getValue(),
+				mass);
+		}
+		else
+		{
+			compute(
+				rho,
+				m_position.getValue(),
+				m_neighborhood.getValue(),
+				m_smoothingLength.getValue(),
+				mass);
+		}
 	}
 
 	template<typename TDataType>
@@ -88,6 +121,45 @@ namespace PhysIKA
 		K_ComputeDensity <Real, Coord> << <pDims, BLOCK_SIZE >> > (rho, pos, neighbors, smoothingLength, m_factor*mass);
 	}
 
+	template<typename TDataType>
+	void DensitySummation<TDataType>::compute(
+		DeviceArray<Real>& rho,
+		DeviceArray<Coord>& pos,
+		CellWalkNeighbors<TDataType>& neighbors,
+		Real smoothingLength,
+		Real mass)
+	{
+		cuint pDims = cudaGridSize(rho.size(), BLOCK_SIZE);
+		K_ComputeDensity <Real, Coord> << <pDims, BLOCK_SIZE >> > (rho, pos, neighbors, smoothingLength, m_factor*mass);
+	}
+
+	template<typename TDataType>
+	void DensitySummation<TDataType>::compute(
+		DeviceArray<Real>& rho,
+		DeviceArray<Coord>& pos,
+		HybridNeighborList& neighbors,
+		Real smoothingLength,
+		Real mass)
+	{
+		cuint pDims = cudaGridSize(rho.size(), BLOCK_SIZE);
+		K_ComputeDensity <Real, Coord> << <pDims, BLOCK_SIZE >> > (rho, pos, neighbors, smoothingLength, m_factor*mass);
+	}
+
+	template<typename TDataType>
+	void DensitySummation<TDataType>::compute(CompressedNeighborList& neighbors)
+	{
+		ModuleTimer timer(this, m_position.getElementCount());
+
+		DeviceArray<Real>& rho = m_density.getValue();
+		cuint pDims = cudaGridSize(rho.size(), BLOCK_SIZE);
+		K_ComputeDensity <Real, Coord> << <pDims, BLOCK_SIZE >> > (
+			rho,
+			m_position.getValue(),
+			neighbors,
+			m_smoothingLength.getValue(),
+			m_factor*m_mass.getValue());
+	}
+
 	template<typename TDataType>
 	bool DensitySummation<TDataType>::initializeImpl()
 	{
@@ -102,12 +174,7 @@ namespace PhysIKA
 			return false;
 		}
 
-		compute(
-			m_density.getValue(),
-			m_position.getValue(),
-			m_neighborhood.getValue(),
-			m_smoothingLength.getValue(),
-			m_mass.getValue());
+		computeSelected(m_density.getValue(), m_mass.getValue());
 
 		auto rho = m_density.getReference();
 
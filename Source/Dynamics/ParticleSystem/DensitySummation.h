@@ -3,11 +3,12 @@
 #include "Framework/Framework/FieldVar.h"
 #include "Framework/Framework/FieldArray.h"
 #include "Framework/Topology/FieldNeighbor.h"
+#include "Framework/Topology/CompressedNeighborList.h"
+#include "Framework/Topology/CellWalkNeighbors.h"
+#include "Framework/Topology/HybridNeighborList.h"
 
 namespace PhysIKA {
 
-	template<typename TDataType> class NeighborList;
-
 	template<typename TDataType>
 	class DensitySummation : public ComputeModule
 	{
@@ -31,6 +32,37 @@ namespace PhysIKA {
 			Real smoothingLength,
 			Real mass);
 
+		/**
+		 * @brief Same as compute(), reads the neighbors from an encoded copy of the neighborhood
+		 */
+		void compute(CompressedNeighborList& neighbors);
+
+		void compute(
+			DeviceArray<Real>& rho,
+			DeviceArray<Coord>& pos,
+			CellWalkNeighbors<TDataType>& neighbors,
+			Real smoothingLength,
+			Real mass);
+
+		void compute(
+			DeviceArray<Real>& rho,
+			DeviceArray<Coord>& pos,
+			HybridNeighborList& neighbors,
+			Real smoothingLength,
+			Real mass);
+
+		/**
+		 * @brief Walk the grid of the cell_walk field instead of reading the neighborhood, see NeighborQuery::setCellWalk()
+		 */
+		void setCellWalk(bool walk) { m_cellWalkEnabled = walk; }
+		bool isCellWalk() { return m_cellWalkEnabled; }
+
+		/**
+		 * @brief Read the hybrid_neighborhood field instead of the neighborhood, see NeighborQuery::setHybridList()
+		 */
+		void setHybridList(bool hybrid) { m_hybridList = hybrid; }
+		bool isHybridList() { return m_hybridList; }
+
 		void setCorrection(Real factor) { m_factor = factor; }
 		void setSmoothingLength(Real length) { m_smoothingLength.setValue(length); }
 	
@@ -46,9 +78,16 @@ namespace PhysIKA {
 		DeviceArrayField<Real> m_density;
 
 		NeighborField<int> m_neighborhood;
+		VarField<CellWalkNeighbors<TDataType>> m_cellWalk;
+		VarField<HybridNeighborList> m_hybridNeighborhood;
 
 	private:
+		/// Density with the neighborhood representation currently selected
+		void computeSelected(DeviceArray<Real>& rho, Real mass);
+
 		Real m_factor;
+		bool m_cellWalkEnabled;
+		bool m_hybridList;
 	};
 
 #ifdef PRECISION_FLOAT
@@ -412,6 +412,7 @@ namespace PhysIKA
 
 			itor++;
 		}
+		this->recordIterations(itor);
 
 		this->updateVelocity();
 	}
@@ -436,6 +437,8 @@ namespace PhysIKA
 	template<typename TDataType>
 	bool ElasticityModule<TDataType>::constrain()
 	{
+		ModuleTimer timer(this, m_position.getElementCount());
+
 		this->solveElasticity();
 
 		return true;
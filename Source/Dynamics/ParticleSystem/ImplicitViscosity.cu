@@ -17,11 +17,11 @@ namespace PhysIKA
 		}
 	}
 
-	template<typename Real, typename Coord>
+	template<typename Real, typename Coord, typename NeighborListType>
 	__global__ void K_ApplyViscosity(
 		DeviceArray<Coord> velNew,
 		DeviceArray<Coord> posArr,
-		NeighborList<int> neighbors,
+		NeighborListType neighbors,
 		DeviceArray<Coord> velOld,
 		DeviceArray<Coord> velArr,
 		Real viscosity,
@@ -36,13 +36,13 @@ namespace PhysIKA
 		Coord pos_i = posArr[pId];
 		Coord vel_i = velArr[pId];
 		Real totalWeight = 0.0f;
-		int nbSize = neighbors.getNeighborSize(pId);
-		for (int ne = 0; ne < nbSize; ne++)
+		int j;
+		NeighborCursor<NeighborListType> it(neighbors, pId);
+		while (it.next(j))
 		{
-			int j = neighbors.getElement(pId, ne);
 			r = (pos_i - posArr[j]).norm();
 
-			if (r > EPSILON)
+			if (r > EPSILON && r < smoothingLength)
 			{
 				Real weight = VB_VisWeight(r, smoothingLength);
 				totalWeight += weight;
@@ -77,15 +77,21 @@ namespace PhysIKA
 		:ConstraintModule()
 		, m_smoothingLength(0.0125)
 		, m_maxInteration(5)
+		, m_cellWalkEnabled(false)
+		, m_hybridList(false)
 	{
 		m_viscosity.setValue(Real(0.05));
 		m_smoothingLength.setValue(Real(0.011));
+		m_cellWalk.setValue(CellWalkNeighbors<TDataType>());
+		m_hybridNeighborhood.setValue(HybridNeighborList());
 
 		attachField(&m_viscosity, "viscosity", "The viscosity of the fluid!", false);
 		attachField(&m_smoothingLength, "smoothing_length", "The smoothing length in SPH!", false);
 		attachField(&m_position, "position", "Storing the particle positions!", false);
 		attachField(&m_velocity, "velocity", "Storing the particle velocities!", false);
 		attachField(&m_neighborhood, "neighborhood", "Storing neighboring particles' ids!", false);
+		attachField(&m_cellWalk, "cell_walk", "Grid walked instead of the neighborhood!", false);
+		attachField(&m_hybridNeighborhood, "hybrid_neighborhood", "Neighbors read instead of the neighborhood!", false);
 	}
 
 	template<typename TDataType>
@@ -97,12 +103,36 @@ namespace PhysIKA
 
 	template<typename TDataType>
 	bool ImplicitViscosity<TDataType>::constrain()
+	{
+		int num = m_position.getElementCount();
+		ModuleTimer timer(this, num);
+
+		Real dt = getParent()->getDt();
+		if (m_cellWalkEnabled)
+		{
+			applyViscosity(m_cellWalk.getValue(), dt);
+		}
+		else if (m_hybridList)
+		{
+			applyViscosity(m_hybridNeighborhood.getValue(), dt);
+		}
+		else
+		{
+			applyViscosity(m_neighborhood.getValue(), dt);
+		}
+		this->recordIterations(m_maxInteration);
+
+		return true;
+	}
+
+	template<typename TDataType>
+	template<typename NeighborListType>
+	void ImplicitViscosity<TDataType>::applyViscosity(NeighborListType& neighbors, Real dt)
 	{
 		int num = m_position.getElementCount();
 		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
 
 		Real vis = m_viscosity.getValue();
-		Real dt = getParent()->getDt();
 		Function1Pt::copy(m_velOld, m_velocity.getValue());
 		for (int t = 0; t < m_maxInteration; t++)
 		{
@@ -110,15 +140,13 @@ namespace PhysIKA
 			K_ApplyViscosity << < pDims, BLOCK_SIZE >> > (
 				m_velocity.getValue(),
 				m_position.getValue(),
-				m_neighborhood.getValue(),
+				neighbors,
 				m_velOld, 
 				m_velBuf, 
 				vis,
 				m_smoothingLength.getValue(), 
 				dt);
 		}
-
-		return true;
 	}
 
 	template<typename TDataType>
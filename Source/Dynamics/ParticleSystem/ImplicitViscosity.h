@@ -3,6 +3,8 @@
 #include "Framework/Framework/FieldVar.h"
 #include "Framework/Framework/FieldArray.h"
 #include "Framework/Topology/FieldNeighbor.h"
+#include "Framework/Topology/CellWalkNeighbors.h"
+#include "Framework/Topology/HybridNeighborList.h"
 
 namespace PhysIKA {
 	template<typename TDataType>
@@ -21,6 +23,18 @@ namespace PhysIKA {
 
 		void setViscosity(Real mu);
 
+		/**
+		 * @brief Walk the grid of the cell_walk field instead of reading the neighborhood, see NeighborQuery::setCellWalk()
+		 */
+		void setCellWalk(bool walk) { m_cellWalkEnabled = walk; }
+		bool isCellWalk() { return m_cellWalkEnabled; }
+
+		/**
+		 * @brief Read the hybrid_neighborhood field instead of the neighborhood, see NeighborQuery::setHybridList()
+		 */
+		void setHybridList(bool hybrid) { m_hybridList = hybrid; }
+		bool isHybridList() { return m_hybridList; }
+
 
 	protected:
 		bool initializeImpl() override;
@@ -33,9 +47,16 @@ namespace PhysIKA {
 		DeviceArrayField<Coord> m_position;
 
 		NeighborField<int> m_neighborhood;
+		VarField<CellWalkNeighbors<TDataType>> m_cellWalk;
+		VarField<HybridNeighborList> m_hybridNeighborhood;
 
 	private:
+		template<typename NeighborListType>
+		void applyViscosity(NeighborListType& neighbors, Real dt);
+
 		int m_maxInteration;
+		bool m_cellWalkEnabled;
+		bool m_hybridList;
 
 		DeviceArray<Coord> m_velOld;
 		DeviceArray<Coord> m_velBuf;
@@ -125,7 +125,11 @@ namespace PhysIKA
 
 		m_nbrQuery->compute();
 
-		m_integrator->integrate();
+		if (!m_integrator->integrate())
+		{
+			m_integrator->end();
+			return;
+		}
 
 		m_phaseSolver->integrate();
 		
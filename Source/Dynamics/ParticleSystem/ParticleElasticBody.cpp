@@ -82,7 +82,11 @@ namespace PhysIKA
 
 		integrator->begin();
 
-		integrator->integrate();
+		if (!integrator->integrate())
+		{
+			integrator->end();
+			return;
+		}
 
 		if (module != nullptr)
 			module->constrain();
@@ -75,7 +75,11 @@ namespace PhysIKA
 
 		m_integrator->begin();
 
-		m_integrator->integrate();
+		if (!m_integrator->integrate())
+		{
+			m_integrator->end();
+			return;
+		}
 
 		m_nbrQuery->compute();
 		module->solveElasticity();
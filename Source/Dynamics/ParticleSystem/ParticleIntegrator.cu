@@ -5,6 +5,7 @@
 #include "Framework/Framework/Node.h"
 #include "Core/Utility.h"
 #include "Framework/Framework/SceneGraph.h"
+#include "CallbackForce.h"
 
 namespace PhysIKA
 {
@@ -80,7 +81,7 @@ namespace PhysIKA
 	bool ParticleIntegrator<TDataType>::updateVelocity()
 	{
 		Real dt = getParent()->getDt();
-		Coord gravity = SceneGraph::getInstance().getGravity();
+		Coord gravity = getSceneGraph()->getGravity();
 		cuint pDims = cudaGridSize(m_position.getReference()->size(), BLOCK_SIZE);
 
 		K_UpdateVelocity << <pDims, BLOCK_SIZE >> > (
@@ -118,9 +119,32 @@ namespace PhysIKA
 		return true;
 	}
 
+	template<typename TDataType>
+	bool ParticleIntegrator<TDataType>::applyForces()
+	{
+		//Callback forces add to the force density after it is cleared in begin(),
+		//the other force modules are still applied by the nodes that own them
+		auto& forces = getParent()->getForceModuleList();
+		for (auto iter = forces.begin(); iter != forces.end(); iter++)
+		{
+			auto callback = TypeInfo::CastPointerDown<CallbackForce<TDataType>>(*iter);
+			if (callback != nullptr && !callback->applyForce())
+				return false;
+		}
+
+		return true;
+	}
+
 	template<typename TDataType>
 	bool ParticleIntegrator<TDataType>::integrate()
 	{
+		if (!applyForces())
+		{
+			return false;
+		}
+
+		ModuleTimer timer(this, m_position.getElementCount());
+
 		updateVelocity();
 		updatePosition();
 
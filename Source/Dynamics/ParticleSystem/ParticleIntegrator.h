@@ -19,6 +19,10 @@ namespace PhysIKA {
 
 		bool integrate() override;
 
+		/**
+		 * @brief Apply the callback forces of the parent node, returns false if one of them fails
+		 */
+		bool applyForces();
 		bool updateVelocity();
 		bool updatePosition();
 
@@ -0,0 +1,484 @@
+#include <cuda_runtime.h>
+#include "ParticleReordering.h"
+#include "ParticleSystem.h"
+#include "Attribute.h"
+#include "Framework/Framework/Node.h"
+#include "Framework/Framework/Log.h"
+#include "Framework/Topology/NeighborQuery.h"
+#include "Core/Utility.h"
+#include <thrust/sort.h>
+#include <thrust/scan.h>
+#include <thrust/reduce.h>
+#include <thrust/sequence.h>
+#include <thrust/execution_policy.h>
+#include <algorithm>
+#include <cfloat>
+
+namespace PhysIKA
+{
+	IMPLEMENT_CLASS_1(ParticleReordering, TDataType)
+
+	//Number of cells along each axis that are distinguished by a 30-bit Morton key
+#define MORTON_RESOLUTION 1024
+
+	template<typename TDataType>
+	ParticleReordering<TDataType>::ParticleReordering()
+		: ComputeModule()
+		, m_counter(0)
+	{
+		m_interval.setValue(20);
+		m_cellSize.setValue(Real(0.006));
+
+		attachField(&m_interval, "interval", "Number of steps between two reorderings!", false);
+		attachField(&m_cellSize, "cell_size", "Size of the grid cells used to build the Morton keys!", false);
+		attachField(&m_position, "position", "Storing the particle positions!", false);
+		attachField(&m_originalId, "original_id", "Initial index of each particle!", false);
+	}
+
+	template<typename TDataType>
+	ParticleReordering<TDataType>::~ParticleReordering()
+	{
+		m_keys.release();
+		m_permutation.release();
+		m_inverse.release();
+		m_counts.release();
+	}
+
+	template<typename TDataType>
+	bool ParticleReordering<TDataType>::initializeImpl()
+	{
+		if (m_position.isEmpty())
+		{
+			std::cout << "Exception: " << std::string("ParticleReordering's fields are not fully initialized!") << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	template<typename Coord>
+	struct CoordMinimum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.minimum(b); }
+	};
+
+	template<typename Coord>
+	struct CoordMaximum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.maximum(b); }
+	};
+
+	//Spread the lower 10 bits of v so that two zero bits separate each of them
+	COMM_FUNC inline unsigned int expandBits(unsigned int v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	COMM_FUNC inline unsigned int clampCell(int i)
+	{
+		return (unsigned int)(i < 0 ? 0 : (i >= MORTON_RESOLUTION ? MORTON_RESOLUTION - 1 : i));
+	}
+
+	template<typename Real, typename Coord>
+	__global__ void K_ComputeMortonKeys(
+		DeviceArray<unsigned int> keys,
+		DeviceArray<Coord> pos,
+		Coord lo,
+		Real ds)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		//Same cell layout as GridHash::getIndex3()
+		Coord p = pos[pId];
+		unsigned int i = clampCell((int)floor((p[0] - lo[0]) / ds));
+		unsigned int j = clampCell((int)floor((p[1] - lo[1]) / ds));
+		unsigned int k = clampCell((int)floor((p[2] - lo[2]) / ds));
+
+		keys[pId] = (expandBits(i) << 2) | (expandBits(j) << 1) | expandBits(k);
+	}
+
+	__global__ void K_InversePermutation(
+		DeviceArray<int> inverse,
+		DeviceArray<int> permutation)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= permutation.size()) return;
+
+		inverse[permutation[pId]] = pId;
+	}
+
+	template<typename T>
+	__global__ void K_GatherArray(
+		DeviceArray<T> dst,
+		DeviceArray<T> src,
+		DeviceArray<int> permutation)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= permutation.size()) return;
+
+		dst[pId] = src[permutation[pId]];
+	}
+
+	//Indices outside of the particle range refer to another set and are kept as they are
+	COMM_FUNC inline void remapNeighbor(int& id, DeviceArray<int>& inverse)
+	{
+		if (id >= 0 && id < inverse.size())
+			id = inverse[id];
+	}
+
+	template<typename TDataType>
+	COMM_FUNC inline void remapNeighbor(TPair<TDataType>& pair, DeviceArray<int>& inverse)
+	{
+		remapNeighbor(pair.index, inverse);
+	}
+
+	template<typename T>
+	__global__ void K_CountNeighbors(
+		DeviceArray<int> counts,
+		NeighborList<T> neighbors,
+		DeviceArray<int> permutation)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= permutation.size()) return;
+
+		counts[pId] = neighbors.getNeighborSize(permutation[pId]);
+	}
+
+	template<typename T>
+	__global__ void K_GatherNeighbors(
+		NeighborList<T> dst,
+		NeighborList<T> src,
+		DeviceArray<int> permutation,
+		DeviceArray<int> inverse)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= permutation.size()) return;
+
+		int oldId = permutation[pId];
+		int nbSize = src.getNeighborSize(oldId);
+		dst.setNeighborSize(pId, nbSize);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			T elem = src.getElement(oldId, ne);
+			remapNeighbor(elem, inverse);
+			dst.setElement(pId, ne, elem);
+		}
+	}
+
+	__global__ void K_GatherHybridNeighbors(
+		HybridNeighborList dst,
+		HybridNeighborList src,
+		DeviceArray<int> permutation,
+		DeviceArray<int> inverse)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= permutation.size()) return;
+
+		int oldId = permutation[pId];
+		int nbSize = src.getNeighborSize(oldId);
+		int inlineNum = dst.getInlineCapacity();
+		dst.setNeighborSize(pId, nbSize);
+
+		//The gather is repeated with a larger pool when the reserved range does not fit
+		if (nbSize > inlineNum && !dst.setOverflowStart(pId, atomicAdd(dst.getOverflowTop(), nbSize - inlineNum), nbSize - inlineNum))
+		{
+			return;
+		}
+
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			int elem = src.getElement(oldId, ne);
+			remapNeighbor(elem, inverse);
+			dst.setElement(pId, ne, elem);
+		}
+	}
+
+	__global__ void K_RemapIds(
+		int* ids,
+		int num,
+		DeviceArray<int> inverse)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= num) return;
+
+		remapNeighbor(ids[pId], inverse);
+	}
+
+	template<typename TDataType>
+	void ParticleReordering<TDataType>::compute()
+	{
+		int interval = m_interval.getValue();
+		if (interval <= 0)
+		{
+			return;
+		}
+
+		m_counter++;
+		if (m_counter >= interval)
+		{
+			m_counter = 0;
+			reorder();
+		}
+	}
+
+	template<typename TDataType>
+	void ParticleReordering<TDataType>::reorder()
+	{
+		int num = m_position.getElementCount();
+		if (num < 2)
+		{
+			return;
+		}
+
+		//Mappings or children may have been added after the reordering was enabled
+		Node* parent = this->getParent();
+		ParticleSystem<TDataType>* pSystem = dynamic_cast<ParticleSystem<TDataType>*>(parent);
+		if (pSystem != nullptr && !pSystem->isReorderingSupported())
+		{
+			Log::sendMessage(Log::Warning, "ParticleReordering: node " + parent->getName() + " does not support reordering, it is disabled!");
+			m_interval.setValue(0);
+			return;
+		}
+
+		if (m_originalId.isEmpty() || m_originalId.getElementCount() != num)
+		{
+			m_originalId.setElementCount(num);
+			thrust::sequence(thrust::device, m_originalId.getValue().getDataPtr(), m_originalId.getValue().getDataPtr() + num);
+		}
+
+		if (m_keys.size() != num)
+		{
+			m_keys.resize(num);
+			m_permutation.resize(num);
+			m_inverse.resize(num);
+			m_counts.resize(num);
+		}
+
+		DeviceArray<Coord>& pos = m_position.getValue();
+		Coord* pPtr = pos.getDataPtr();
+		Coord lo = thrust::reduce(thrust::device, pPtr, pPtr + num, Coord((Real)FLT_MAX), CoordMinimum<Coord>());
+		Coord hi = thrust::reduce(thrust::device, pPtr, pPtr + num, Coord((Real)-FLT_MAX), CoordMaximum<Coord>());
+
+		//Coarsen the cells if the domain does not fit into the key resolution
+		Coord extent = hi - lo;
+		Real maxExtent = std::max(extent[0], std::max(extent[1], extent[2]));
+		Real ds = std::max(m_cellSize.getValue(), maxExtent / Real(MORTON_RESOLUTION - 1));
+		if (ds <= Real(0))
+		{
+			return;
+		}
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_ComputeMortonKeys << <pDims, BLOCK_SIZE >> > (m_keys, pos, lo, ds);
+		cuSynchronize();
+
+		thrust::sequence(thrust::device, m_permutation.getDataPtr(), m_permutation.getDataPtr() + num);
+		thrust::stable_sort_by_key(thrust::device, m_keys.getDataPtr(), m_keys.getDataPtr() + num, m_permutation.getDataPtr());
+
+		K_InversePermutation << <pDims, BLOCK_SIZE >> > (m_inverse, m_permutation);
+		cuSynchronize();
+
+		std::set<void*> visited;
+		permuteFields(parent, visited);
+		for (auto module : parent->getModuleList())
+		{
+			permuteFields(module.get(), visited);
+
+			//Grids updated incrementally and the skin test compare particles by their index
+			NeighborQuery<TDataType>* query = dynamic_cast<NeighborQuery<TDataType>*>(module.get());
+			if (query != nullptr)
+			{
+				query->invalidate();
+			}
+		}
+	}
+
+	template<typename TDataType>
+	void ParticleReordering<TDataType>::permuteFields(Base* owner, std::set<void*>& visited)
+	{
+		int num = m_permutation.size();
+		for (auto field : owner->getAllFields())
+		{
+			//Connected fields share the storage of their source
+			if (field->isDerived() || field->isEmpty())
+			{
+				continue;
+			}
+
+			//Neighborhoods held by variables are matched by their own size
+			if (permuteHybridNeighbors(field, visited) || remapCellWalk(field, visited))
+			{
+				continue;
+			}
+
+			if (field->getElementCount() != num)
+			{
+				continue;
+			}
+
+			if (!permuteField(field, visited) && field->getClassName() != std::string("Variable"))
+			{
+				Log::sendMessage(Log::Warning, "ParticleReordering: field " + field->getObjectName() + " has an unsupported type and is not reordered!");
+			}
+		}
+	}
+
+	template<typename TDataType>
+	bool ParticleReordering<TDataType>::permuteField(Field* field, std::set<void*>& visited)
+	{
+		return permuteArray<Coord>(field, visited)
+			|| permuteArray<Real>(field, visited)
+			|| permuteArray<int>(field, visited)
+			|| permuteArray<Matrix>(field, visited)
+			|| permuteArray<Attribute>(field, visited)
+			|| permuteNeighbors<int>(field, visited)
+			|| permuteNeighbors<NPair>(field, visited);
+	}
+
+	template<typename TDataType>
+	template<typename T>
+	bool ParticleReordering<TDataType>::permuteArray(Field* field, std::set<void*>& visited)
+	{
+		DeviceArrayField<T>* arrayField = dynamic_cast<DeviceArrayField<T>*>(field);
+		if (arrayField == nullptr)
+		{
+			return false;
+		}
+
+		DeviceArray<T>& data = arrayField->getValue();
+		if (!visited.insert(data.getDataPtr()).second)
+		{
+			return true;
+		}
+
+		int num = data.size();
+		DeviceArray<T> sorted(num);
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_GatherArray << <pDims, BLOCK_SIZE >> > (sorted, data, m_permutation);
+		cuSynchronize();
+
+		Function1Pt::copy(data, sorted);
+		sorted.release();
+
+		return true;
+	}
+
+	template<typename TDataType>
+	template<typename T>
+	bool ParticleReordering<TDataType>::permuteNeighbors(Field* field, std::set<void*>& visited)
+	{
+		NeighborField<T>* nbrField = dynamic_cast<NeighborField<T>*>(field);
+		if (nbrField == nullptr)
+		{
+			return false;
+		}
+
+		NeighborList<T>& nbr = nbrField->getValue();
+		if (!visited.insert(nbr.getIndex().getDataPtr()).second)
+		{
+			return true;
+		}
+
+		int num = nbr.size();
+		int elementNum = nbr.getElements().size();
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+
+		NeighborList<T> sorted;
+		if (nbr.isLimited())
+		{
+			sorted.resize(num, nbr.getNeighborLimit());
+		}
+		else
+		{
+			K_CountNeighbors << <pDims, BLOCK_SIZE >> > (m_counts, nbr, m_permutation);
+			cuSynchronize();
+
+			sorted.resize(num);
+			thrust::exclusive_scan(thrust::device, m_counts.getDataPtr(), m_counts.getDataPtr() + num, sorted.getIndex().getDataPtr());
+			if (elementNum > 0)
+			{
+				sorted.getElements().resize(elementNum);
+			}
+		}
+
+		if (elementNum > 0)
+		{
+			K_GatherNeighbors << <pDims, BLOCK_SIZE >> > (sorted, nbr, m_permutation, m_inverse);
+			cuSynchronize();
+		}
+
+		nbr.copyFrom(sorted);
+		sorted.release();
+
+		return true;
+	}
+
+	template<typename TDataType>
+	bool ParticleReordering<TDataType>::permuteHybridNeighbors(Field* field, std::set<void*>& visited)
+	{
+		VarField<HybridNeighborList>* nbrField = dynamic_cast<VarField<HybridNeighborList>*>(field);
+		if (nbrField == nullptr)
+		{
+			return false;
+		}
+
+		HybridNeighborList& nbr = nbrField->getValue();
+		int num = m_permutation.size();
+		if (nbr.size() != num || !visited.insert(&nbr).second)
+		{
+			return true;
+		}
+
+		HybridNeighborList sorted;
+		sorted.resize(num, nbr.getInlineCapacity());
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		do
+		{
+			sorted.beginFill();
+			K_GatherHybridNeighbors << <pDims, BLOCK_SIZE >> > (sorted, nbr, m_permutation, m_inverse);
+			cuSynchronize();
+		} while (!sorted.endFill());
+
+		nbr.release();
+		nbr = sorted;
+
+		return true;
+	}
+
+	template<typename TDataType>
+	bool ParticleReordering<TDataType>::remapCellWalk(Field* field, std::set<void*>& visited)
+	{
+		VarField<CellWalkNeighbors<TDataType>>* walkField = dynamic_cast<VarField<CellWalkNeighbors<TDataType>>*>(field);
+		if (walkField == nullptr)
+		{
+			return false;
+		}
+
+		//The cells keep their particles, only the ids of the cell-sorted particles change
+		CellWalkNeighbors<TDataType>& walk = walkField->getValue();
+		GridHash<TDataType>& hash = walk.hash;
+		if (!walk.isValid() || walk.position.size() != m_permutation.size() || !visited.insert(hash.ids).second)
+		{
+			return true;
+		}
+
+		int num = hash.particle_num;
+		if (num <= 0)
+		{
+			return true;
+		}
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_RemapIds << <pDims, BLOCK_SIZE >> > (hash.ids, num, m_inverse);
+		cuSynchronize();
+
+		return true;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "Framework/Framework/ModuleCompute.h"
+#include "Framework/Framework/FieldVar.h"
+#include "Framework/Framework/FieldArray.h"
+#include "Framework/Topology/FieldNeighbor.h"
+#include "Framework/Topology/HybridNeighborList.h"
+#include "Framework/Topology/CellWalkNeighbors.h"
+#include "NeighborData.h"
+#include <set>
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	ParticleReordering
+	*	\brief	Sorts the particles of a node along a Z-order (Morton) curve every few steps.
+	*
+	*	Keys are built from the grid cells (cell size m_cellSize) the particles fall into, so neighboring particles end up
+	*	close in memory. The permutation is applied to every per-particle device ArrayField owned by the node or its modules,
+	*	indices stored in NeighborFields, hybrid neighbor lists and cell walks are remapped as well.
+	*	Fields connected to another field are skipped since they share their storage with the source.
+	*	Neighbor queries of the node are invalidated, so their next compute() rebuilds the lists despite a skin.
+	*	Topology mappings and child nodes are not remapped, nodes using them do not support reordering.
+	*/
+	template<typename TDataType>
+	class ParticleReordering : public ComputeModule
+	{
+		DECLARE_CLASS_1(ParticleReordering, TDataType)
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+		typedef typename TDataType::Matrix Matrix;
+		typedef TPair<TDataType> NPair;
+
+		ParticleReordering();
+		~ParticleReordering() override;
+
+		/**
+		 * @brief Reorder once every interval calls to compute()
+		 */
+		void compute() override;
+
+		/**
+		 * @brief Reorder immediately
+		 */
+		void reorder();
+
+		void setInterval(int interval) { m_interval.setValue(interval); }
+		int getInterval() { return m_interval.getValue(); }
+
+		/**
+		 * @brief Permutation of the last reordering, particle i was at index getPermutation()[i] before
+		 */
+		DeviceArray<int>& getPermutation() { return m_permutation; }
+
+		/**
+		 * @brief Index each particle had when the reordering was enabled, maps current indices back to the initial ones
+		 */
+		DeviceArray<int>& getOriginalIds() { return m_originalId.getValue(); }
+
+	protected:
+		bool initializeImpl() override;
+
+	private:
+		void permuteFields(Base* owner, std::set<void*>& visited);
+		bool permuteField(Field* field, std::set<void*>& visited);
+
+		template<typename T>
+		bool permuteArray(Field* field, std::set<void*>& visited);
+
+		template<typename T>
+		bool permuteNeighbors(Field* field, std::set<void*>& visited);
+
+		bool permuteHybridNeighbors(Field* field, std::set<void*>& visited);
+		bool remapCellWalk(Field* field, std::set<void*>& visited);
+
+	public:
+		VarField<int> m_interval;
+		VarField<Real> m_cellSize;
+
+		DeviceArrayField<Coord> m_position;
+
+	private:
+		int m_counter;
+
+		DeviceArrayField<int> m_originalId;
+
+		DeviceArray<unsigned int> m_keys;
+		DeviceArray<int> m_permutation;
+		DeviceArray<int> m_inverse;
+		DeviceArray<int> m_counts;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class ParticleReordering<DataType3f>;
+#else
+	template class ParticleReordering<DataType3d>;
+#endif
+}
@@ -134,7 +134,11 @@ namespace PhysIKA
 		if (m_integrator != nullptr)
 			m_integrator->begin();
 
-		m_integrator->integrate();
+		if (!m_integrator->integrate())
+		{
+			m_integrator->end();
+			return;
+		}
  	
 		for (int it = 0; it < 10; it++)
 		{
@@ -26,6 +26,11 @@ namespace PhysIKA
 		void advance(Real dt) override;
 		void updateTopology() override;
 
+		/**
+		 * @brief Fixed particles are stored by their index
+		 */
+		bool isReorderingSupported() override { return false; }
+
 		void setParticles(std::vector<Coord> particles);
 
 		void setLength(Real length);
@@ -1,7 +1,10 @@
 #include "ParticleSystem.h"
 #include "PositionBasedFluidModel.h"
+#include "CFLTimeStep.h"
+#include "ParticleReordering.h"
 
 #include "Framework/Topology/PointSet.h"
+#include "Framework/Framework/Log.h"
 #include "Core/Utility.h"
 
 
@@ -37,6 +40,48 @@ namespace PhysIKA
 		m_pSet->loadObjFile(filename);
 	}
 
+	template<typename TDataType>
+	std::shared_ptr<CFLTimeStep<TDataType>> ParticleSystem<TDataType>::enableAdaptiveTimeStep(Real smoothingLength)
+	{
+		auto controller = std::make_shared<CFLTimeStep<TDataType>>();
+		controller->setName("time_step");
+		controller->m_smoothingLength.setValue(smoothingLength);
+
+		m_velocity.connect(controller->m_velocity);
+		m_force.connect(controller->m_forceDensity);
+
+		this->setTimeStepController(controller);
+
+		return controller;
+	}
+
+	template<typename TDataType>
+	std::shared_ptr<ParticleReordering<TDataType>> ParticleSystem<TDataType>::enableReordering(int interval, Real cellSize)
+	{
+		if (!isReorderingSupported())
+		{
+			Log::sendMessage(Log::Warning, "ParticleSystem: node " + this->getName() + " does not support reordering!");
+			return nullptr;
+		}
+
+		if (m_reordering == nullptr)
+		{
+			m_reordering = this->template addComputeModule<ParticleReordering<TDataType>>("reordering");
+			m_position.connect(m_reordering->m_position);
+		}
+
+		m_reordering->setInterval(interval);
+		m_reordering->m_cellSize.setValue(cellSize);
+
+		return m_reordering;
+	}
+
+	template<typename TDataType>
+	bool ParticleSystem<TDataType>::isReorderingSupported()
+	{
+		return this->getTopologyMappingList().empty() && this->getChildren().empty();
+	}
+
 	template<typename TDataType>
 	void ParticleSystem<TDataType>::loadParticles(Coord center, Real r, Real distance)
 	{
@@ -135,6 +180,12 @@ namespace PhysIKA
 	template<typename TDataType>
 	void ParticleSystem<TDataType>::updateTopology()
 	{
+		//Reorder between two steps, neighbor lists are rebuilt at the beginning of the next one
+		if (m_reordering != nullptr)
+		{
+			m_reordering->compute();
+		}
+
 		auto pts = m_pSet->getPoints();
 		Function1Pt::copy(pts, getPosition()->getValue());
 	}
@@ -5,6 +5,8 @@
 namespace PhysIKA
 {
 	template <typename TDataType> class PointSet;
+	template <typename TDataType> class CFLTimeStep;
+	template <typename TDataType> class ParticleReordering;
 	/*!
 	*	\class	ParticleSystem
 	*	\brief	Position-based fluids.
@@ -28,6 +30,28 @@ namespace PhysIKA
 		void loadParticles(Coord center, Real r, Real distance);
 		void loadParticles(std::string filename);
 
+		/**
+		 * @brief Let the scene choose the time step from the particle velocities and forces
+		 * 
+		 * @param smoothingLength 	length used in the CFL and force conditions
+		 */
+		std::shared_ptr<CFLTimeStep<TDataType>> enableAdaptiveTimeStep(Real smoothingLength);
+
+		/**
+		 * @brief Sort the particles along a Morton curve every interval steps to keep neighbors close in memory
+		 * 
+		 * @param interval 	number of steps between two reorderings
+		 * @param cellSize 	grid cell size used to build the sort keys, typically the smoothing length
+		 * @return nullptr if the node does not support reordering, see isReorderingSupported()
+		 */
+		std::shared_ptr<ParticleReordering<TDataType>> enableReordering(int interval, Real cellSize);
+		std::shared_ptr<ParticleReordering<TDataType>> getReordering() { return m_reordering; }
+
+		/**
+		 * @brief Topology mappings and child nodes refer to the particles by their index, nodes using them keep their order
+		 */
+		virtual bool isReorderingSupported();
+
 		virtual bool translate(Coord t);
 		virtual bool scale(Real s);
 
@@ -60,6 +84,7 @@ namespace PhysIKA
 		DeviceArrayField<Coord> m_force;
 
 		std::shared_ptr<PointSet<TDataType>> m_pSet;
+		std::shared_ptr<ParticleReordering<TDataType>> m_reordering;
 //		std::shared_ptr<PointRenderModule> m_pointsRender;
 	};
 
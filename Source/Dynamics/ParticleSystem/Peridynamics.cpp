@@ -15,6 +15,7 @@ namespace PhysIKA
 	template<typename TDataType>
 	Peridynamics<TDataType>::Peridynamics()
 		: NumericalModel()
+		, m_neighborLimit(0)
 	{
 		attachField(&m_horizon, "horizon", "Supporting radius", false);
 
@@ -43,6 +44,7 @@ namespace PhysIKA
 		m_nbrQuery = std::make_shared<NeighborQuery<TDataType>>();
 		m_horizon.connect(m_nbrQuery->m_radius);
 		m_position.connect(m_nbrQuery->m_position);
+		m_nbrQuery->setNeighborSizeLimit(m_neighborLimit);
 		m_nbrQuery->initialize();
 		m_nbrQuery->compute();
 
@@ -69,10 +71,15 @@ namespace PhysIKA
 			Log::sendMessage(Log::Error, "Parent not set for ParticleSystem!");
 			return;
 		}
+		ModuleTimer timer(this, m_position.getElementCount());
 
 		m_integrator->begin();
 
-		m_integrator->integrate();
+		if (!m_integrator->integrate())
+		{
+			m_integrator->end();
+			return;
+		}
 
 		m_elasticity->constrain();
 
@@ -39,6 +39,11 @@ namespace PhysIKA
 
 		void step(Real dt) override;
 
+		/**
+		 * @brief Bond each particle to at most num closest particles within the horizon, 0 keeps all of them
+		 */
+		void setNeighborLimit(int num) { m_neighborLimit = num; }
+
 
 	public:
 		VarField<Real> m_horizon;
@@ -48,6 +53,8 @@ namespace PhysIKA
 		DeviceArrayField<Coord> m_forceDensity;
 
 	private:
+		int m_neighborLimit;
+
 		HostVarField<int>* m_num;
 		HostVarField<Real>* m_mass;
 		
@@ -21,6 +21,11 @@ namespace PhysIKA
 		: NumericalModel()
 		, m_restRho(Real(1000))
 		, m_pNum(0)
+		, m_neighborSkin(Real(0))
+		, m_neighborCompression(false)
+		, m_symmetricPairs(false)
+		, m_cellWalk(false)
+		, m_hybridCapacity(0)
 	{
 		m_smoothingLength.setValue(Real(0.006));
 
@@ -43,6 +48,9 @@ namespace PhysIKA
 		m_nbrQuery = this->getParent()->addComputeModule<NeighborQuery<TDataType>>("neighborhood");
 		m_smoothingLength.connect(m_nbrQuery->m_radius);
 		m_position.connect(m_nbrQuery->m_position);
+		m_nbrQuery->setSkin(m_neighborSkin);
+		m_nbrQuery->setCellWalk(m_cellWalk);
+		m_nbrQuery->setHybridList(m_hybridCapacity);
 		m_nbrQuery->initialize();
 
 		m_pbdModule = this->getParent()->addConstraintModule<DensityPBD<TDataType>>("density_constraint");
@@ -50,6 +58,12 @@ namespace PhysIKA
 		m_position.connect(m_pbdModule->m_position);
 		m_velocity.connect(m_pbdModule->m_velocity);
 		m_nbrQuery->m_neighborhood.connect(m_pbdModule->m_neighborhood);
+		m_pbdModule->setNeighborCompression(m_neighborCompression);
+		m_nbrQuery->m_cellWalk.connect(m_pbdModule->m_cellWalk);
+		m_pbdModule->setSymmetricPairs(m_symmetricPairs);
+		m_nbrQuery->m_hybridNeighborhood.connect(m_pbdModule->m_hybridNeighborhood);
+		m_pbdModule->setCellWalk(m_cellWalk);
+		m_pbdModule->setHybridList(m_hybridCapacity > 0);
 		m_pbdModule->initialize();
 
 		m_integrator = this->getParent()->setNumericalIntegrator<ParticleIntegrator<TDataType>>("integrator");
@@ -64,6 +78,10 @@ namespace PhysIKA
 		m_position.connect(m_visModule->m_position);
 		m_velocity.connect(m_visModule->m_velocity);
 		m_nbrQuery->m_neighborhood.connect(m_visModule->m_neighborhood);
+		m_nbrQuery->m_cellWalk.connect(m_visModule->m_cellWalk);
+		m_nbrQuery->m_hybridNeighborhood.connect(m_visModule->m_hybridNeighborhood);
+		m_visModule->setCellWalk(m_cellWalk);
+		m_visModule->setHybridList(m_hybridCapacity > 0);
 		m_visModule->initialize();
 
 		return true;
@@ -78,10 +96,16 @@ namespace PhysIKA
 			Log::sendMessage(Log::Error, "Parent not set for ParticleSystem!");
 			return;
 		}
+		ModuleTimer timer(this, m_position.getElementCount());
+
 		m_integrator->begin();
 
 		m_nbrQuery->compute();
-		m_integrator->integrate();
+		if (!m_integrator->integrate())
+		{
+			m_integrator->end();
+			return;
+		}
 		
 		m_pbdModule->constrain();
 
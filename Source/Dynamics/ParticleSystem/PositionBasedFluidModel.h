@@ -37,6 +37,32 @@ namespace PhysIKA
 		void setSmoothingLength(Real len) { m_smoothingLength.setValue(len); }
 		void setRestDensity(Real rho) { m_restRho = rho; }
 
+		/**
+		 * @brief Reuse the neighbor lists until a particle moved farther than skin / 2, see NeighborQuery::setSkin()
+		 */
+		void setNeighborSkin(Real skin) { m_neighborSkin = skin; }
+
+		/**
+		 * @brief Let the density solver iterate over an encoded copy of the neighbor lists, see DensityPBD::setNeighborCompression()
+		 */
+		void setNeighborCompression(bool compression) { m_neighborCompression = compression; }
+
+		/**
+		 * @brief Accumulate the density corrections pair by pair, see DensityPBD::setSymmetricPairs()
+		 */
+		void setSymmetricPairs(bool symmetric) { m_symmetricPairs = symmetric; }
+
+		/**
+		 * @brief Let the solvers walk the grid cells instead of storing neighbor lists, see NeighborQuery::setCellWalk()
+		 */
+		void setCellWalk(bool walk) { m_cellWalk = walk; }
+
+		/**
+		 * @brief Build hybrid neighbor lists with inlineCapacity inline neighbors per particle, 0 keeps the neighborhood field,
+		 * see NeighborQuery::setHybridList()
+		 */
+		void setHybridNeighborList(int inlineCapacity) { m_hybridCapacity = inlineCapacity; }
+
 		void setIncompressibilitySolver(std::shared_ptr<ConstraintModule> solver);
 		void setViscositySolver(std::shared_ptr<ConstraintModule> solver);
 		void setSurfaceTensionSolver(std::shared_ptr<ForceModule> solver);
@@ -59,6 +85,11 @@ namespace PhysIKA
 	private:
 		int m_pNum;
 		Real m_restRho;
+		Real m_neighborSkin;
+		bool m_neighborCompression;
+		bool m_symmetricPairs;
+		bool m_cellWalk;
+		int m_hybridCapacity;
 
 		std::shared_ptr<ForceModule> m_surfaceTensionSolver;
 		std::shared_ptr<ConstraintModule> m_viscositySolver;
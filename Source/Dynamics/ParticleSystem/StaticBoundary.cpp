@@ -56,14 +56,24 @@ namespace PhysIKA
 	}
 
 	template<typename TDataType>
-	void StaticBoundary<TDataType>::loadSDF(std::string filename, bool bOutBoundary)
+	void StaticBoundary<TDataType>::loadSDF(std::string filename, bool bOutBoundary, int bandWidth)
 	{
 		auto boundary = std::make_shared<BoundaryConstraint<TDataType>>();
+		boundary->setCompression(bandWidth);
 		boundary->load(filename, bOutBoundary);
 
 		m_obstacles.push_back(boundary);
 	}
 
+	template<typename TDataType>
+	void StaticBoundary<TDataType>::loadSDF(std::shared_ptr<DistanceField3D<TDataType>> sdf)
+	{
+		auto boundary = std::make_shared<BoundaryConstraint<TDataType>>();
+		boundary->setSDF(sdf);
+
+		m_obstacles.push_back(boundary);
+	}
+
 
 	template<typename TDataType>
 	void StaticBoundary<TDataType>::loadCube(Coord lo, Coord hi, Real distance, bool bOutBoundary /*= false*/, bool bVisible)
@@ -24,7 +24,10 @@ namespace PhysIKA {
 
 		void advance(Real dt) override;
 
-		void loadSDF(std::string filename, bool bOutBoundary = false);
+		/// bandWidth > 0 keeps only a narrow band of the field, see BoundaryConstraint::setCompression()
+		void loadSDF(std::string filename, bool bOutBoundary = false, int bandWidth = 0);
+		/// Add an obstacle sharing an already loaded distance field, the field is not copied
+		void loadSDF(std::shared_ptr<DistanceField3D<TDataType>> sdf);
 		void loadCube(Coord lo, Coord hi, Real distance = 0.005f, bool bOutBoundary = false, bool bVisible = false);
 		void loadShpere(Coord center, Real r, Real distance = 0.005f, bool bOutBoundary = false, bool bVisible = false);
 
@@ -10,6 +10,13 @@ namespace PhysIKA
 {
 	
 	AnimateAct::AnimateAct()
+		: m_dt(0)
+	{
+
+	}
+
+	AnimateAct::AnimateAct(Real dt)
+		: m_dt(dt)
 	{
 
 	}
@@ -28,8 +35,15 @@ namespace PhysIKA
 		}
 		if (node->isActive())
 		{
+			//Modules read the time step from their node, the own one is restored after the step
+			Real nodeDt = node->getDt();
+			if (m_dt > 0)
+			{
+				node->setDt(m_dt);
+			}
 			node->advance(node->getDt());
 			node->updateTopology();
+			node->setDt(nodeDt);
 
 			/*if (node->getAnimationController() != nullptr)
 			{
@@ -9,10 +9,14 @@ namespace PhysIKA
 	{
 	public:
 		AnimateAct();
+		/// Advance every node with the given time step instead of its own one, which is left unchanged
+		AnimateAct(Real dt);
 		virtual ~AnimateAct();
 
 	private:
 		void process(Node* node) override;
+
+		Real m_dt;
 	};
 }
 
@@ -0,0 +1,36 @@
+#include "ActTimeStep.h"
+#include "Framework/Framework/TimeStepController.h"
+#include <algorithm>
+
+namespace PhysIKA
+{
+	TimeStepAct::TimeStepAct()
+		: m_adaptive(false)
+		, m_dt(0)
+	{
+
+	}
+
+	TimeStepAct::~TimeStepAct()
+	{
+
+	}
+
+	void TimeStepAct::process(Node* node)
+	{
+		if (node == NULL || !node->isActive())
+		{
+			return;
+		}
+
+		auto controller = node->getTimeStepController();
+		if (controller == nullptr)
+		{
+			return;
+		}
+
+		Real dt = controller->computeTimeStep();
+		m_dt = m_adaptive ? std::min(m_dt, dt) : dt;
+		m_adaptive = true;
+	}
+}
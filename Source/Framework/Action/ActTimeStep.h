@@ -0,0 +1,26 @@
+#pragma once
+#include "Action.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	TimeStepAct
+	*	\brief	Collect the smallest time step suggested by the time step controllers of a scene.
+	*/
+	class TimeStepAct : public Action
+	{
+	public:
+		TimeStepAct();
+		virtual ~TimeStepAct();
+
+		/// Return true if at least one active node owns a time step controller
+		bool isAdaptive() { return m_adaptive; }
+		Real getTimeStep() { return m_dt; }
+
+	private:
+		void process(Node* node) override;
+
+		bool m_adaptive;
+		Real m_dt;
+	};
+}
@@ -3,7 +3,7 @@
 #include "Framework/Framework/Node.h"
 #include "Framework/Framework/CollidableObject.h"
 #include "Framework/Collision/CollidablePoints.h"
-#include "Framework/Topology/NeighborQuery.h"
+#include "Framework/Topology/PointIndex.h"
 
 namespace PhysIKA
 {
@@ -153,10 +153,6 @@ namespace PhysIKA
 			start += num;
 		}
 
-		if (m_nbrQuery == nullptr)
-		{
-			m_nbrQuery = std::make_shared<NeighborQuery<TDataType>>();
-		}
 		if (m_nList == nullptr)
 		{
 			m_nList = std::make_shared<NeighborList<int>>();
@@ -166,7 +162,18 @@ namespace PhysIKA
 		
 
 		Real radius = 0.005;
-		m_nbrQuery->queryParticleNeighbors(*m_nList, m_points, radius);
+
+		//The grid is kept across steps, it only re-bins the points once built
+		if (m_pointIndex == nullptr)
+		{
+			m_pointIndex = std::make_shared<PointIndex<TDataType>>();
+			m_pointIndex->build(m_points, radius);
+		}
+		else
+		{
+			m_pointIndex->refit(m_points);
+		}
+		m_pointIndex->queryRadius(*m_nList, m_points, radius);
 
 		DeviceArray<Coord> posBuf;
 		posBuf.resize(m_points.size());
@@ -1,12 +1,12 @@
 #pragma once
 #include "Core/Array/Array.h"
 #include "Framework/Framework/CollisionModel.h"
+#include "Framework/Topology/NeighborList.h"
 
 namespace PhysIKA
 {
 template <typename> class CollidablePoints;
-template <typename> class NeighborQuery;
-template <typename> class NeighborList;
+template <typename> class PointIndex;
 template <typename> class GridHash;
 
 template<typename TDataType>
@@ -33,7 +33,7 @@ protected:
 	DeviceArray<Coord> m_points;
 	DeviceArray<Coord> m_vels;
 
-	std::shared_ptr<NeighborQuery<TDataType>> m_nbrQuery;
+	std::shared_ptr<PointIndex<TDataType>> m_pointIndex;
 	std::shared_ptr<NeighborList<int>> m_nList;
 
 	std::vector<std::shared_ptr<CollidablePoints<TDataType>>> m_collidableObjects;
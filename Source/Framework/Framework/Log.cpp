@@ -1,81 +1,392 @@
 #include "Log.h"
 #include <iostream>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
 
 namespace PhysIKA
 {
 	std::string Log::outputFile;
-	std::ofstream Log::outputStream;
-	std::list<Log::Message> Log::messages;
-	void(*Log::receiver)(const Message&) = NULL;
-	Log::MessageType Log::logLevel = Log::DebugInfo;
 
-	void Log::sendMessage(MessageType type, const std::string& text)
+	static std::atomic<int> s_logLevel(Log::DebugInfo);
+	static std::atomic<bool> s_shutdown(false);
+
+	/*!
+	 *	\brief	Queue and consumer thread behind Log.
+	 *
+	 *	The queue is a bounded multi-producer single-consumer ring buffer, each slot carries a sequence number
+	 *	telling whether it is free for the producer of a given round or ready for the consumer.
+	 */
+	class LogBackend
 	{
-		// Skip logging to file if minimum level is higher
-		if ((int)type < (int)logLevel)
-			return;
+	public:
+		static const size_t QueueCapacity = 4096;
+
+		LogBackend()
+			: m_enqueuePos(0)
+			, m_dequeuePos(0)
+			, m_dropped(0)
+			, m_reportedDropped(0)
+			, m_waiting(false)
+			, m_stop(false)
+			, m_historySize(1000)
+			, m_receiver(NULL)
+			, m_slots(QueueCapacity)
+		{
+			for (size_t i = 0; i < QueueCapacity; i++)
+			{
+				m_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			m_flusher = std::thread(&LogBackend::run, this);
+		}
+
+		~LogBackend()
+		{
+			m_stop.store(true);
+			m_wakeup.notify_one();
+			m_flusher.join();
+
+			s_shutdown.store(true);
+
+			drain();
+			if (m_stream.is_open())
+				m_stream.close();
+		}
+
+		bool push(Log::MessageType type, const std::string& text)
+		{
+			size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+			Slot* slot;
+			while (true)
+			{
+				slot = &m_slots[pos & (QueueCapacity - 1)];
+				size_t seq = slot->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+				if (diff == 0)
+				{
+					if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					m_dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				else
+				{
+					pos = m_enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			slot->type = type;
+			slot->time = time(NULL);
+			slot->text = text;
+			slot->sequence.store(pos + 1, std::memory_order_release);
+
+			if (m_waiting.load(std::memory_order_relaxed))
+				m_wakeup.notify_one();
+
+			return true;
+		}
+
+		/**
+		 * @brief Consume all published messages, only one thread drains at a time
+		 */
+		void drain()
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_consumerMutex);
+
+			Log::Message m;
+			while (pop(m))
+			{
+				consume(m);
+			}
+
+			size_t dropped = m_dropped.load(std::memory_order_relaxed);
+			if (dropped != m_reportedDropped)
+			{
+				m.type = Log::Warning;
+				m.text = std::to_string(dropped - m_reportedDropped) + " log messages dropped, the queue was full";
+				time_t t = time(NULL);
+				toLocalTime(t, m.when);
+				consume(m);
+
+				m_reportedDropped = dropped;
+			}
+
+			if (m_stream.is_open())
+				m_stream.flush();
+		}
+
+		void setOutput(const std::string& filename)
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_consumerMutex);
+
+			// close old one
+			if (m_stream.is_open())
+				m_stream.close();
+
+			// create file
+			m_stream.open(filename.c_str());
+		}
+
+		bool isOutputOpen()
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_consumerMutex);
+			return m_stream.is_open();
+		}
+
+		void setReceiver(void(*userFunc)(const Log::Message&))
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_consumerMutex);
+			m_receiver = userFunc;
+		}
+
+		std::list<Log::Message> getHistory()
+		{
+			std::lock_guard<std::mutex> lock(m_historyMutex);
+			return std::list<Log::Message>(m_history.begin(), m_history.end());
+		}
+
+		bool getLast(Log::Message& m)
+		{
+			std::lock_guard<std::mutex> lock(m_historyMutex);
+			if (m_history.empty())
+				return false;
+
+			m = m_history.back();
+			return true;
+		}
+
+		void setHistorySize(size_t size)
+		{
+			std::lock_guard<std::mutex> lock(m_historyMutex);
+			m_historySize = size;
+			while (m_history.size() > m_historySize)
+				m_history.pop_front();
+		}
+
+		size_t getHistorySize()
+		{
+			std::lock_guard<std::mutex> lock(m_historyMutex);
+			return m_historySize;
+		}
+
+		size_t getDropped() { return m_dropped.load(std::memory_order_relaxed); }
+
+		static void toLocalTime(time_t t, tm& when)
+		{
+#if (defined _WIN32)
+			localtime_s(&when, &t);
+#else
+			localtime_r(&t, &when);
+#endif
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			Log::MessageType type;
+			time_t time;
+			std::string text;
+		};
+
+		bool pop(Log::Message& m)
+		{
+			Slot& slot = m_slots[m_dequeuePos & (QueueCapacity - 1)];
+			size_t seq = slot.sequence.load(std::memory_order_acquire);
+			if (seq != m_dequeuePos + 1)
+				return false;
+
+			m.type = slot.type;
+			m.text.swap(slot.text);
+			toLocalTime(slot.time, m.when);
 
-		// log message
-		Log::Message m;
-		m.type = type;
-		m.text = text;
-		time_t t = time(NULL);
-		m.when = localtime(&t);
-		messages.push_back(m);
+			slot.sequence.store(m_dequeuePos + QueueCapacity, std::memory_order_release);
+			m_dequeuePos++;
 
-		// if user wants to catch messages, send it to him
-		if (receiver)
-			receiver(m);
+			return true;
+		}
 
-		// if enabled logging to file
-		if (outputStream.is_open())
+		void consume(const Log::Message& m)
 		{
-			// print time
-			char buffer[9];
-			strftime(buffer, 9, "%X", m.when);
-			outputStream << buffer;
+			{
+				std::lock_guard<std::mutex> lock(m_historyMutex);
+				if (m_historySize > 0)
+				{
+					if (m_history.size() >= m_historySize)
+						m_history.pop_front();
+					m_history.push_back(m);
+				}
+			}
+
+			// if user wants to catch messages, send it to him
+			if (m_receiver)
+				m_receiver(m);
 
-			// print type
-			switch (type)
+			// if enabled logging to file
+			if (m_stream.is_open())
 			{
-			case DebugInfo: outputStream << " | debug   | "; break;
-			case Info:		outputStream << " | info    | "; break;
-			case Warning:	outputStream << " | warning | "; break;
-			case Error:		outputStream << " | ERROR   | "; break;
-			default:		outputStream << " | user    | ";
+				// print time
+				char buffer[9];
+				strftime(buffer, 9, "%X", &m.when);
+				m_stream << buffer;
+
+				// print type
+				switch (m.type)
+				{
+				case Log::DebugInfo:	m_stream << " | debug   | "; break;
+				case Log::Info:			m_stream << " | info    | "; break;
+				case Log::Warning:		m_stream << " | warning | "; break;
+				case Log::Error:		m_stream << " | ERROR   | "; break;
+				default:				m_stream << " | user    | ";
+				}
+
+				// print description
+				m_stream << m.text << "\n";
 			}
+		}
+
+		void run()
+		{
+			while (!m_stop.load())
+			{
+				drain();
 
-			// print description
-			outputStream << text << std::endl;
+				std::unique_lock<std::mutex> lock(m_wakeupMutex);
+				m_waiting.store(true);
+				//A producer may miss the waiting flag, the timeout bounds the latency in that case
+				m_wakeup.wait_for(lock, std::chrono::milliseconds(50));
+				m_waiting.store(false);
+			}
 		}
+
+		std::atomic<size_t> m_enqueuePos;
+		size_t m_dequeuePos;
+
+		std::atomic<size_t> m_dropped;
+		size_t m_reportedDropped;
+
+		std::atomic<bool> m_waiting;
+		std::atomic<bool> m_stop;
+
+		std::recursive_mutex m_consumerMutex;
+		std::mutex m_wakeupMutex;
+		std::condition_variable m_wakeup;
+
+		std::mutex m_historyMutex;
+		std::deque<Log::Message> m_history;
+		size_t m_historySize;
+
+		std::ofstream m_stream;
+		void(*m_receiver)(const Log::Message&);
+
+		std::vector<Slot> m_slots;
+		std::thread m_flusher;
+	};
+
+	static LogBackend& backend()
+	{
+		static LogBackend m_instance;
+		return m_instance;
 	}
 
+	void Log::sendMessage(MessageType type, const std::string& text)
+	{
+		// Skip logging to file if minimum level is higher
+		if (!isEnabled(type))
+			return;
+
+		// The backend is gone during static destruction
+		if (s_shutdown.load())
+		{
+			std::cerr << text << std::endl;
+			return;
+		}
+
+		backend().push(type, text);
+	}
+
+	bool Log::isEnabled(MessageType type)
+	{
+		return (int)type >= s_logLevel.load(std::memory_order_relaxed);
+	}
+
+	std::list<Log::Message> Log::getMessages()
+	{
+		flush();
+		return backend().getHistory();
+	}
+
+	Log::Message Log::getLastMessage()
+	{
+		flush();
+
+		Message m;
+		if (!backend().getLast(m))
+		{
+			m.type = Info;
+			time_t t = time(NULL);
+			LogBackend::toLocalTime(t, m.when);
+		}
+		return m;
+	}
+
+	void Log::setHistorySize(size_t size)
+	{
+		backend().setHistorySize(size);
+	}
+
+	size_t Log::getHistorySize()
+	{
+		return backend().getHistorySize();
+	}
+
+	void Log::flush()
+	{
+		if (s_shutdown.load())
+			return;
+
+		backend().drain();
+	}
+
+	size_t Log::getDroppedCount()
+	{
+		return backend().getDropped();
+	}
+
+	void Log::setUserReceiver(void(*userFunc)(const Message&))
+	{
+		backend().setReceiver(userFunc);
+	}
 
 	void Log::setOutput(const std::string& filename)
 	{
 		LogDebug("Setting output log file: " + filename);
 		outputFile = filename;
 
-		// close old one
-		if (outputStream.is_open())
-			outputStream.close();
+		flush();
+		backend().setOutput(filename);
 
-		// create file
-		outputStream.open(filename.c_str());
-		if (!outputStream.is_open())
+		if (!backend().isOutputOpen())
 			sendMessage(Error, "Cannot create/open '" + filename + "' for logging");
 	}
 
 	void Log::setLevel(MessageType level)
 	{
-		logLevel = level;
+		s_logLevel.store((int)level);
 	}
 
 
 	Log::~Log()
 	{
-		if (outputStream.is_open())
-			outputStream.close();
+		flush();
 	}
 
 }
@@ -12,6 +12,9 @@ namespace PhysIKA {
 	 *	This is the class that catches every (debug) info, warning, error, or user message and
 	 *	processes it. Messages can be written to files and/or forwarded to user function for
 	 *	processing messages.
+	 *
+	 *	sendMessage() only pushes the message into a fixed-capacity lock-free queue, formatting, writing
+	 *	and forwarding happen on a background thread. Messages are dropped (and counted) when the queue is full.
 	 */
 	class Log
 	{
@@ -38,7 +41,7 @@ namespace PhysIKA {
 		{
 			MessageType type;
 			std::string text;
-			tm* when;
+			tm when;
 		};
 
 		/*!
@@ -55,24 +58,49 @@ namespace PhysIKA {
 		 *	\brief	Add a new message to log.
 		 *	\param	type	Type of the new message.
 		 *	\param	text	Message.
-		 *	\remarks Message is directly passes to user receiver if one is set.
+		 *	\remarks Safe to call from any thread, the message is passed to the user receiver on the logging thread.
 		 */
 		static void sendMessage(MessageType type, const std::string& text);
 
 		/*!
-		 *	\brief	Get the list of all of the logged messages.
+		 *	\brief	Check the level before building expensive message strings.
+		 */
+		static bool isEnabled(MessageType type);
+
+		/*!
+		 *	\brief	Get the most recent messages, at most getHistorySize() of them.
+		 *	\remarks Returns a copy, older messages are discarded. Callers that kept the reference to the
+		 *			complete message list must call this again or collect the messages with a user receiver.
 		 */
-		static std::list<Message>& getMessages() { return messages; }
+		static std::list<Message> getMessages();
 
 		/*!
 		 *	\brief	Get the last logged message.
 		 */
-		static const Message& getLastMessage() { return messages.back(); }
+		static Message getLastMessage();
+
+		/*!
+		 *	\brief	Set the number of messages kept for getMessages().
+		 */
+		static void setHistorySize(size_t size);
+		static size_t getHistorySize();
+
+		/*!
+		 *	\brief	Write out all messages sent so far.
+		 */
+		static void flush();
+
+		/*!
+		 *	\brief	Number of messages lost because the queue was full.
+		 */
+		static size_t getDroppedCount();
 
 		/*!
 		 *	\brief	Set user function to receive newly sent messages to logger.
+		 *	\remarks The function is called on the logging thread, or on the thread calling flush(), never on the
+		 *			sender's thread. Receivers that touch a GUI must forward the message, e.g. with a queued signal.
 		 */
-		static void setUserReceiver(void (*userFunc)(const Message&)) { receiver = userFunc; }
+		static void setUserReceiver(void (*userFunc)(const Message&));
 
 		/*!
 		 *	\brief	Set minimum level of message to be logged to file.
@@ -82,17 +110,13 @@ namespace PhysIKA {
 	private:
 
 		static std::string outputFile;
-		static std::ofstream outputStream;
-		static std::list<Message> messages;
-		static MessageType logLevel;
-		static void (*receiver)(const Message&);
 	};
 
 	// simple debug macro
 #ifdef NDEBUG
 	#define LogDebug(DESC)
 #else
-	#define LogDebug(DESC) Log::sendMessage(Log::DebugInfo, DESC)
+	#define LogDebug(DESC) do { if (Log::isEnabled(Log::DebugInfo)) Log::sendMessage(Log::DebugInfo, DESC); } while (0)
 #endif
 
 }
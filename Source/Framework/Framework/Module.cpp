@@ -1,8 +1,11 @@
 #include "Module.h"
 #include "Framework/Framework/Node.h"
+#include "Framework/Framework/SceneGraph.h"
+#include <atomic>
 
 namespace PhysIKA
 {
+static std::atomic<bool> s_statisticsEnabled(false);
 
 Module::Module(std::string name)
 	: m_node(nullptr)
@@ -46,6 +49,36 @@ std::string Module::getName()
 	return m_module_name;
 }
 
+SceneGraph* Module::getSceneGraph()
+{
+	return m_node == nullptr ? &SceneGraph::getInstance() : m_node->getSceneGraph();
+}
+
+void Module::recordCall(double seconds, int elements)
+{
+	m_statistics.totalTime += seconds;
+	m_statistics.frameTime += seconds;
+	m_statistics.calls++;
+	m_statistics.frameCalls++;
+	m_statistics.elements = elements;
+}
+
+void Module::recordIterations(int num)
+{
+	m_statistics.iterations += num;
+	m_statistics.frameIterations += num;
+}
+
+void Module::setStatisticsEnabled(bool enabled)
+{
+	s_statisticsEnabled.store(enabled);
+}
+
+bool Module::isStatisticsEnabled()
+{
+	return s_statisticsEnabled.load();
+}
+
 bool Module::isInitialized()
 {
 	return m_initialized;
@@ -6,6 +6,7 @@
 #include <iostream>
 #include "Base.h"
 #include "Log.h"
+#include "ModuleStatistics.h"
 #include "Core/Typedef.h"
 #include "Core/DataTypes.h"
 #include "../FieldTypes.h"
@@ -13,6 +14,7 @@
 namespace PhysIKA
 {
 class Node;
+class SceneGraph;
 
 class Module : public Base
 {
@@ -43,8 +45,29 @@ public:
 		return m_node;
 	}
 
+	/**
+	 * @brief Scene of the parent node, SceneGraph::getInstance() if the module is not attached to a node
+	 */
+	SceneGraph* getSceneGraph();
+
 	bool isInitialized();
 
+	ModuleStatistics& getStatistics() { return m_statistics; }
+
+	/**
+	 * @brief Add one call taking the given wall time, usually done by a ModuleTimer
+	 */
+	void recordCall(double seconds, int elements);
+	void recordIterations(int num);
+
+	/**
+	 * @brief Turn the collection of module statistics on/off for the whole process, off by default
+	 *
+	 * Timed calls synchronize the device while the statistics are enabled.
+	 */
+	static void setStatisticsEnabled(bool enabled);
+	static bool isStatisticsEnabled();
+
 	virtual std::string getModuleType() { return "Module"; }
 
 protected:
@@ -58,5 +81,7 @@ private:
 	Node* m_node;
 	std::string m_module_name;
 	bool m_initialized;
+
+	ModuleStatistics m_statistics;
 };
 }
\ No newline at end of file
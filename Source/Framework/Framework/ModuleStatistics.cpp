@@ -0,0 +1,75 @@
+#include "ModuleStatistics.h"
+#include "Module.h"
+#include <sstream>
+#include <cuda_runtime.h>
+
+namespace PhysIKA
+{
+	static std::string escapeJSON(const std::string& str)
+	{
+		std::string ret;
+		for (size_t i = 0; i < str.size(); i++)
+		{
+			char c = str[i];
+			if (c == '"' || c == '\\')
+				ret.push_back('\\');
+			ret.push_back(c);
+		}
+		return ret;
+	}
+
+	static void writeJSON(std::ostringstream& os, const StatisticsNode& node)
+	{
+		os << "{\"name\":\"" << escapeJSON(node.name) << "\",\"type\":\"" << escapeJSON(node.type) << "\",\"modules\":[";
+		for (size_t i = 0; i < node.modules.size(); i++)
+		{
+			const StatisticsNode::ModuleEntry& m = node.modules[i];
+			os << (i == 0 ? "" : ",")
+				<< "{\"name\":\"" << escapeJSON(m.name)
+				<< "\",\"type\":\"" << escapeJSON(m.type)
+				<< "\",\"total_time\":" << m.stats.totalTime
+				<< ",\"frame_time\":" << m.stats.frameTime
+				<< ",\"calls\":" << m.stats.calls
+				<< ",\"frame_calls\":" << m.stats.frameCalls
+				<< ",\"iterations\":" << m.stats.iterations
+				<< ",\"frame_iterations\":" << m.stats.frameIterations
+				<< ",\"elements\":" << m.stats.elements << "}";
+		}
+		os << "],\"children\":[";
+		for (size_t i = 0; i < node.children.size(); i++)
+		{
+			os << (i == 0 ? "" : ",");
+			writeJSON(os, node.children[i]);
+		}
+		os << "]}";
+	}
+
+	std::string StatisticsNode::toJSON() const
+	{
+		std::ostringstream os;
+		writeJSON(os, *this);
+		return os.str();
+	}
+
+	ModuleTimer::ModuleTimer(Module* module, int elements)
+		: m_module(module)
+		, m_elements(elements)
+		, m_started(Module::isStatisticsEnabled())
+	{
+		if (m_started)
+		{
+			m_timer.start();
+		}
+	}
+
+	ModuleTimer::~ModuleTimer()
+	{
+		//Statistics toggled inside of the scope leave an incomplete measurement
+		if (m_started && Module::isStatisticsEnabled())
+		{
+			cudaDeviceSynchronize();
+			m_timer.stop();
+			m_module->recordCall(m_timer.getElapsedTime(), m_elements);
+		}
+	}
+}
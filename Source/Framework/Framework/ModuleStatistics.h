@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Core/Utility/CTimer.h"
+
+namespace PhysIKA
+{
+	class Module;
+
+	/*!
+	*	\struct	ModuleStatistics
+	*	\brief	Runtime counters of a module.
+	*
+	*	Times are wall-clock seconds including the GPU work launched by the module.
+	*	"Frame" counters are reset at the beginning of every SceneGraph::takeOneFrame().
+	*/
+	struct ModuleStatistics
+	{
+		double totalTime = 0;
+		double frameTime = 0;
+
+		long long calls = 0;
+		long long frameCalls = 0;
+
+		/// Solver iterations, only recorded by iterative modules
+		long long iterations = 0;
+		long long frameIterations = 0;
+
+		/// Number of elements (e.g., particles) processed by the last call
+		long long elements = 0;
+
+		void reset() { *this = ModuleStatistics(); }
+
+		void beginFrame()
+		{
+			frameTime = 0;
+			frameCalls = 0;
+			frameIterations = 0;
+		}
+	};
+
+	/*!
+	*	\struct	StatisticsNode
+	*	\brief	Snapshot of the statistics of a node, its modules and its children.
+	*/
+	struct StatisticsNode
+	{
+		struct ModuleEntry
+		{
+			std::string name;
+			std::string type;
+			ModuleStatistics stats;
+		};
+
+		std::string name;
+		std::string type;
+
+		std::vector<ModuleEntry> modules;
+		std::vector<StatisticsNode> children;
+
+		std::string toJSON() const;
+	};
+
+	/*!
+	*	\class	ModuleTimer
+	*	\brief	Scoped timer adding one call to the statistics of a module.
+	*
+	*	The device is synchronized before the timer stops so that asynchronous kernels are accounted for,
+	*	which is why the statistics have to be turned on with Module::setStatisticsEnabled(true).
+	*	A call is only recorded when the statistics were enabled for the whole scope of the timer.
+	*/
+	class ModuleTimer
+	{
+	public:
+		ModuleTimer(Module* module, int elements = 0);
+		~ModuleTimer();
+
+	private:
+		Module* m_module;
+		int m_elements;
+		bool m_started;
+		CTimer m_timer;
+	};
+}
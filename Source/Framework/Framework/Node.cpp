@@ -1,5 +1,6 @@
 #include "Node.h"
 #include "Framework/Action/Action.h"
+#include "Framework/Framework/SceneGraph.h"
 
 namespace PhysIKA
 {
@@ -8,6 +9,7 @@ IMPLEMENT_CLASS(Node)
 Node::Node(std::string name)
 	: Base()
 	, m_parent(NULL)
+	, m_scene(NULL)
 {
 	attachField(&m_active, "active", "this is a variable!", false);
 	attachField(&m_visible, "visible", "this is a variable!", false);
@@ -68,6 +70,12 @@ Node* Node::getRoot()
 	return root;
 }
 
+SceneGraph* Node::getSceneGraph()
+{
+	SceneGraph* scene = getRoot()->m_scene;
+	return scene == NULL ? &SceneGraph::getInstance() : scene;
+}
+
 bool Node::isActive()
 {
 	return m_active.getValue();
@@ -243,6 +251,11 @@ bool Node::addModule(std::shared_ptr<Module> module)
 		auto downModule = TypeInfo::CastPointerDown<NumericalIntegrator>(module);
 		m_numerical_integrator = downModule;
 	}
+	else if (std::string("TimeStepController").compare(mType) == 0)
+	{
+		auto downModule = TypeInfo::CastPointerDown<TimeStepController>(module);
+		m_time_step_controller = downModule;
+	}
 	else if (std::string("ForceModule").compare(mType) == 0)
 	{
 		auto downModule = TypeInfo::CastPointerDown<ForceModule>(module);
@@ -297,6 +310,10 @@ bool Node::deleteModule(std::shared_ptr<Module> module)
 	{
 		m_numerical_integrator = nullptr;
 	}
+	else if (std::string("TimeStepController").compare(mType) == 0)
+	{
+		m_time_step_controller = nullptr;
+	}
 	else if (std::string("ForceModule").compare(mType) == 0)
 	{
 		auto downModule = TypeInfo::CastPointerDown<ForceModule>(module);
@@ -331,6 +348,46 @@ bool Node::deleteModule(std::shared_ptr<Module> module)
 	return ret;
 }
 
+StatisticsNode Node::getStatistics()
+{
+	StatisticsNode ret;
+	ret.name = getName();
+	ret.type = getClassInfo()->getClassName();
+
+	std::list<std::shared_ptr<Module>>::iterator iter = m_module_list.begin();
+	for (; iter != m_module_list.end(); iter++)
+	{
+		StatisticsNode::ModuleEntry entry;
+		entry.name = (*iter)->getName();
+		entry.type = (*iter)->getModuleType();
+		entry.stats = (*iter)->getStatistics();
+		ret.modules.push_back(entry);
+	}
+
+	ListPtr<Node>::iterator cIter = m_children.begin();
+	for (; cIter != m_children.end(); cIter++)
+	{
+		ret.children.push_back((*cIter)->getStatistics());
+	}
+
+	return ret;
+}
+
+void Node::beginStatisticsFrame()
+{
+	std::list<std::shared_ptr<Module>>::iterator iter = m_module_list.begin();
+	for (; iter != m_module_list.end(); iter++)
+	{
+		(*iter)->getStatistics().beginFrame();
+	}
+
+	ListPtr<Node>::iterator cIter = m_children.begin();
+	for (; cIter != m_children.end(); cIter++)
+	{
+		(*cIter)->beginStatisticsFrame();
+	}
+}
+
 void Node::doTraverseBottomUp(Action* act)
 {
 	act->start(this);
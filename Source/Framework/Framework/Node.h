@@ -27,9 +27,11 @@
 #include "TopologyMapping.h"
 #include "NumericalIntegrator.h"
 #include "ModuleCompute.h"
+#include "TimeStepController.h"
 
 namespace PhysIKA {
 class Action;
+class SceneGraph;
 
 class Node : public Base
 {
@@ -49,6 +51,14 @@ public:
 	Node* getParent();
 	Node* getRoot();
 
+	/**
+	 * @brief Return the scene this node belongs to
+	 * 
+	 * @return SceneGraph*	the scene set on the root node, SceneGraph::getInstance() if the tree is not attached to any scene
+	 */
+	SceneGraph* getSceneGraph();
+	void setSceneGraph(SceneGraph* scene) { m_scene = scene; }
+
 	/// Check the state of dynamics
 	virtual bool isActive();
 
@@ -209,6 +219,7 @@ public:
 	NODE_SET_SPECIAL_MODULE(NumericalModel)
 	NODE_SET_SPECIAL_MODULE(CollidableObject)
 	NODE_SET_SPECIAL_MODULE(NumericalIntegrator)
+	NODE_SET_SPECIAL_MODULE(TimeStepController)
 
 #define NODE_SET_SPECIAL_MODULE( CLASSNAME, MODULENAME )						\
 	virtual void set##CLASSNAME( std::shared_ptr<CLASSNAME> module) {			\
@@ -221,12 +232,14 @@ public:
 	NODE_SET_SPECIAL_MODULE(NumericalModel, m_numerical_model)
 	NODE_SET_SPECIAL_MODULE(CollidableObject, m_collidable_object)
 	NODE_SET_SPECIAL_MODULE(NumericalIntegrator, m_numerical_integrator)
+	NODE_SET_SPECIAL_MODULE(TimeStepController, m_time_step_controller)
 
 
 	std::shared_ptr<CollidableObject>		getCollidableObject() { return m_collidable_object; }
 	std::shared_ptr<NumericalModel>			getNumericalModel() { return m_numerical_model; }
 	std::shared_ptr<TopologyModule>			getTopologyModule() { return m_topology; }
 	std::shared_ptr<NumericalIntegrator>	getNumericalIntegrator() { return m_numerical_integrator; }
+	std::shared_ptr<TimeStepController>		getTimeStepController() { return m_time_step_controller; }
 
 
 	template<class TModule>
@@ -287,6 +300,16 @@ public:
 	virtual void updateTopology() {};
 	virtual bool resetStatus() { return true; }
 
+	/**
+	 * @brief Snapshot of the module statistics of this node and its descendants
+	 */
+	StatisticsNode getStatistics();
+
+	/**
+	 * @brief Reset the per-frame counters of all modules in this subtree
+	 */
+	void beginStatisticsFrame();
+
 	/**
 	 * @brief Depth-first tree traversal 
 	 * 
@@ -372,6 +395,7 @@ private:
 	std::shared_ptr<MechanicalState> m_mechanical_state;
 	std::shared_ptr<CollidableObject> m_collidable_object;
 	std::shared_ptr<NumericalIntegrator> m_numerical_integrator;
+	std::shared_ptr<TimeStepController> m_time_step_controller;
 
 	/**
 	 * @brief A module list containg specific modules
@@ -393,5 +417,11 @@ private:
 	 * 
 	 */
 	Node* m_parent;
+
+	/**
+	 * @brief Scene owning the tree, only set on the root node
+	 * 
+	 */
+	SceneGraph* m_scene;
 };
 }
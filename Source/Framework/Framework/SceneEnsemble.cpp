@@ -0,0 +1,74 @@
+#include "SceneEnsemble.h"
+#include "Core/Utility/ThreadPool.h"
+
+namespace PhysIKA
+{
+	SceneEnsemble::SceneEnsemble(ThreadPool* pool)
+		: m_pool(pool)
+	{
+		if (m_pool == nullptr)
+		{
+			m_pool = &ThreadPool::getInstance();
+		}
+	}
+
+	SceneEnsemble::~SceneEnsemble()
+	{
+		m_scenes.clear();
+	}
+
+	std::shared_ptr<SceneGraph> SceneEnsemble::createScene()
+	{
+		std::shared_ptr<SceneGraph> scene = std::make_shared<SceneGraph>();
+		m_scenes.push_back(scene);
+		return scene;
+	}
+
+	void SceneEnsemble::addScene(std::shared_ptr<SceneGraph> scene)
+	{
+		m_scenes.push_back(scene);
+	}
+
+	bool SceneEnsemble::initialize()
+	{
+		std::vector<std::future<bool>> results;
+		for (size_t i = 0; i < m_scenes.size(); i++)
+		{
+			SceneGraph* scene = m_scenes[i].get();
+			results.push_back(m_pool->submit([scene]() { return scene->initialize(); }));
+		}
+
+		bool ret = true;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			ret &= results[i].get();
+		}
+
+		return ret;
+	}
+
+	void SceneEnsemble::takeOneFrame()
+	{
+		run(1);
+	}
+
+	void SceneEnsemble::run(int frameNum)
+	{
+		std::vector<std::future<void>> results;
+		for (size_t i = 0; i < m_scenes.size(); i++)
+		{
+			SceneGraph* scene = m_scenes[i].get();
+			results.push_back(m_pool->submit([scene, frameNum]() {
+				for (int f = 0; f < frameNum; f++)
+				{
+					scene->takeOneFrame();
+				}
+			}));
+		}
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			results[i].get();
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Framework/Framework/SceneGraph.h"
+
+namespace PhysIKA {
+	class ThreadPool;
+
+	/*!
+	*	\class	SceneEnsemble
+	*	\brief	A set of independent scenes advanced concurrently, e.g., for parameter sweeps.
+	*
+	*	Each scene is stepped by one task of a shared thread pool per frame, scenes never share mutable state.
+	*	Read-only assets (e.g., distance fields passed to StaticBoundary::loadSDF) can be shared among scenes.
+	*/
+	class SceneEnsemble
+	{
+	public:
+		/**
+		 * @param pool thread pool used to step the scenes, ThreadPool::getInstance() if not specified
+		 */
+		SceneEnsemble(ThreadPool* pool = nullptr);
+		~SceneEnsemble();
+
+		std::shared_ptr<SceneGraph> createScene();
+		void addScene(std::shared_ptr<SceneGraph> scene);
+
+		int getSceneNum() { return (int)m_scenes.size(); }
+		std::shared_ptr<SceneGraph> getScene(int i) { return m_scenes[i]; }
+
+		bool initialize();
+
+		/**
+		 * @brief Advance every scene by one frame, returns after all scenes are done
+		 */
+		void takeOneFrame();
+
+		/**
+		 * @brief Advance every scene by frameNum frames
+		 */
+		void run(int frameNum);
+
+	private:
+		ThreadPool* m_pool;
+		std::vector<std::shared_ptr<SceneGraph>> m_scenes;
+	};
+}
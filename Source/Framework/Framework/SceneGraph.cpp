@@ -2,7 +2,11 @@
 #include "Framework/Action/ActAnimate.h"
 #include "Framework/Action/ActDraw.h"
 #include "Framework/Action/ActInit.h"
+#include "Framework/Action/ActTimeStep.h"
 #include "Framework/Framework/SceneLoaderFactory.h"
+#include "Core/Utility/CTimer.h"
+#include <algorithm>
+#include <sstream>
 
 namespace PhysIKA
 {
@@ -12,6 +16,15 @@ SceneGraph& SceneGraph::getInstance()
 	return m_instance;
 }
 
+void SceneGraph::setRootNode(std::shared_ptr<Node> root)
+{
+	m_root = root;
+	if (m_root != nullptr)
+	{
+		m_root->setSceneGraph(this);
+	}
+}
+
 void SceneGraph::setGravity(Vector3f g)
 {
 	m_gravity = g;
@@ -63,7 +76,72 @@ void SceneGraph::takeOneFrame()
 		return;
 	}
 
-	m_root->traverseTopDown<AnimateAct>();
+	CTimer timer;
+	timer.start();
+
+	m_root->beginStatisticsFrame();
+
+	float interval = getFrameInterval();
+
+	TimeStepAct query;
+	m_root->traverseTopDown(&query);
+
+	//Time actually simulated during this frame
+	float advanced = 0;
+	if (!query.isAdaptive())
+	{
+		//Every node advances by its own time step, the root's is the one reported
+		m_root->traverseTopDown<AnimateAct>();
+
+		m_substepNum = 1;
+		m_minTimeStep = m_maxTimeStep = m_root->getDt();
+		advanced = m_root->getDt();
+	}
+	else
+	{
+		m_substepNum = 0;
+		m_minTimeStep = interval;
+		m_maxTimeStep = 0;
+
+		float t = 0;
+		while (interval - t > 1e-6f * interval)
+		{
+			//The first query is done before the loop, later ones measure the state left by the previous substep
+			if (m_substepNum > 0)
+			{
+				query = TimeStepAct();
+				m_root->traverseTopDown(&query);
+			}
+
+			float remaining = interval - t;
+			float dt = query.getTimeStep();
+
+			//Split the rest of the frame evenly instead of leaving a tiny last substep
+			if (dt >= remaining)
+				dt = remaining;
+			else if (2 * dt > remaining)
+				dt = 0.5f * remaining;
+
+			m_root->traverseTopDown<AnimateAct>(dt);
+
+			t += dt;
+			m_substepNum++;
+			m_minTimeStep = std::min(m_minTimeStep, dt);
+			m_maxTimeStep = std::max(m_maxTimeStep, dt);
+		}
+		advanced = t;
+	}
+
+	timer.stop();
+	m_frameCost = timer.getElapsedTime();
+	m_elapsedTime += advanced;
+	m_frameNumber++;
+
+	if (query.isAdaptive())
+	{
+		Log::sendMessage(Log::Info, "Frame " + std::to_string(m_frameNumber) + ": "
+			+ std::to_string(m_substepNum) + " substeps, dt in [" + std::to_string(m_minTimeStep) + ", " + std::to_string(m_maxTimeStep) + "]");
+	}
 }
 
 void SceneGraph::run()
@@ -76,13 +154,36 @@ bool SceneGraph::load(std::string name)
 	SceneLoader* loader = SceneLoaderFactory::getInstance().getEntryByFileName(name);
 	if (loader)
 	{
-		m_root = loader->load(name);
+		setRootNode(loader->load(name));
 		return true;
 	}
 
 	return false;
 }
 
+StatisticsNode SceneGraph::getStatistics()
+{
+	if (m_root == nullptr)
+	{
+		return StatisticsNode();
+	}
+
+	return m_root->getStatistics();
+}
+
+std::string SceneGraph::getStatisticsJSON()
+{
+	std::ostringstream os;
+	os << "{\"frame\":" << m_frameNumber
+		<< ",\"frame_cost\":" << m_frameCost
+		<< ",\"substeps\":" << m_substepNum
+		<< ",\"min_dt\":" << m_minTimeStep
+		<< ",\"max_dt\":" << m_maxTimeStep
+		<< ",\"root\":" << (m_root == nullptr ? std::string("null") : m_root->getStatistics().toJSON())
+		<< "}";
+	return os.str();
+}
+
 Vector3f SceneGraph::getLowerBound()
 {
 	return m_lowerBound;
@@ -3,12 +3,35 @@
 #include "Framework/Framework/Node.h"
 
 namespace PhysIKA {
+/*!
+*	\class	SceneGraph
+*	\brief	A simulation scene owning a node tree together with its global settings (gravity, bounds, frame rate).
+*
+*	Scenes are independent of each other, several of them can be created and advanced concurrently within one process.
+*	getInstance() returns a default scene kept for applications that only need one.
+*/
 class SceneGraph : public Base
 {
 public:
+	SceneGraph()
+		: m_elapsedTime(0)
+		, m_maxTime(0)
+		, m_frameRate(25)
+		, m_frameNumber(0)
+		, m_frameCost(0)
+		, m_substepNum(0)
+		, m_minTimeStep(0)
+		, m_maxTimeStep(0)
+		, m_initialized(false)
+		, m_lowerBound(0, 0, 0)
+		, m_upperBound(1, 1, 1)
+	{
+		m_gravity = Vector3f(0.0f, -9.8f, 0.0f);
+	};
+
 	~SceneGraph() {};
 
-	void setRootNode(std::shared_ptr<Node> root) { m_root = root; }
+	void setRootNode(std::shared_ptr<Node> root);
 	std::shared_ptr<Node> getRootNode() { return m_root; }
 
 	virtual bool initialize();
@@ -27,11 +50,14 @@ public:
 	std::shared_ptr<TNode> createNewScene(Args&& ... args)
 	{
 		std::shared_ptr<TNode> root = TypeInfo::New<TNode>(std::forward<Args>(args)...);
-		m_root = root;
+		setRootNode(root);
 		return root;
 	}
 
 public:
+	/**
+	 * @brief The default scene, used by nodes that are not attached to any other scene
+	 */
 	static SceneGraph& getInstance();
 
 	inline void setTotalTime(float t) { m_maxTime = t; }
@@ -42,6 +68,12 @@ public:
 	inline float getTimeCostPerFrame() { return m_frameCost; }
 	inline float getFrameInterval() { return 1.0f / m_frameRate; }
 	inline int getFrameNumber() { return m_frameNumber; }
+	inline float getElapsedTime() { return m_elapsedTime; }
+
+	/// Number of substeps and range of the time steps taken in the last frame
+	inline int getSubstepNumber() { return m_substepNum; }
+	inline float getMinTimeStep() { return m_minTimeStep; }
+	inline float getMaxTimeStep() { return m_maxTimeStep; }
 
 	void setGravity(Vector3f g);
 	Vector3f getGravity();
@@ -52,20 +84,17 @@ public:
 	void setLowerBound(Vector3f lowerBound);
 	void setUpperBound(Vector3f upperBound);
 
-private:
-	SceneGraph()
-		: m_elapsedTime(0)
-		, m_maxTime(0)
-		, m_frameRate(25)
-		, m_frameNumber(0)
-		, m_frameCost(0)
-		, m_initialized(false)
-		, m_lowerBound(0, 0, 0)
-		, m_upperBound(1, 1, 1)
-	{
-		m_gravity = Vector3f(0.0f, -9.8f, 0.0f);
-	};
+	/**
+	 * @brief Module statistics of the whole tree, the times stay zero unless Module::setStatisticsEnabled(true) was called
+	 */
+	StatisticsNode getStatistics();
 
+	/**
+	 * @brief Frame information and module statistics of the whole tree in JSON
+	 */
+	std::string getStatisticsJSON();
+
+private:
 	/**
 	* To avoid erroneous operations
 	*/
@@ -82,6 +111,10 @@ private:
 
 	int m_frameNumber;
 
+	int m_substepNum;
+	float m_minTimeStep;
+	float m_maxTimeStep;
+
 	Vector3f m_gravity;
 
 	Vector3f m_lowerBound;
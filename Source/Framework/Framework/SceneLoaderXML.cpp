@@ -1,6 +1,7 @@
 #include "SceneLoaderXML.h"
 #include <algorithm>
 #include "Framework/ModuleTypes.h"
+#include "IO/Asset_Cache/AssetCache.h"
 
 namespace PhysIKA
 {
@@ -16,9 +17,37 @@ namespace PhysIKA
 		tinyxml2::XMLElement* scenegraph = doc.RootElement();
 		tinyxml2::XMLElement* rootXML  = scenegraph->FirstChildElement("Node");
 
+		//Parse all referenced assets concurrently before the nodes request them one by one
+		std::vector<std::string> assets;
+		collectAssets(scenegraph, assets);
+		AssetCache::getInstance().prefetch(assets);
+
 		return processNode(rootXML);
 	}
 
+	void SceneLoaderXML::collectAssets(tinyxml2::XMLElement* elementXML, std::vector<std::string>& files)
+	{
+		for (const tinyxml2::XMLAttribute* attr = elementXML->FirstAttribute(); attr != nullptr; attr = attr->Next())
+		{
+			std::string value = attr->Value();
+			if (value.size() < 5)
+				continue;
+
+			std::string ext = value.substr(value.size() - 5);
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			bool asset = ext.substr(1) == ".obj" || ext.substr(1) == ".sdf" || ext == ".sdfb";
+			if (asset && std::find(files.begin(), files.end(), value) == files.end())
+			{
+				files.push_back(value);
+			}
+		}
+
+		for (tinyxml2::XMLElement* child = elementXML->FirstChildElement(); child != nullptr; child = child->NextSiblingElement())
+		{
+			collectAssets(child, files);
+		}
+	}
+
 	std::shared_ptr<Node> SceneLoaderXML::processNode(tinyxml2::XMLElement* nodeXML)
 	{
 		const char* name = nodeXML->Attribute("class");
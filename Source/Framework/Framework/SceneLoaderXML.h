@@ -15,6 +15,11 @@ namespace PhysIKA {
 		std::shared_ptr<Module> processModule(tinyxml2::XMLElement* moduleXML);
 		bool addModule(std::shared_ptr<Node> node, std::shared_ptr<Module> module);
 
+		/**
+		 * @brief Collect attribute values that refer to .obj or .sdf files
+		 */
+		void collectAssets(tinyxml2::XMLElement* elementXML, std::vector<std::string>& files);
+
 		std::vector<std::string> split(std::string str, std::string pattern);
 
 		virtual bool canLoadFileByExtension(const std::string extension);
@@ -0,0 +1,27 @@
+#include "TimeStepController.h"
+#include <algorithm>
+
+namespace PhysIKA
+{
+	TimeStepController::TimeStepController()
+		: Module()
+		, m_minDt(Real(1e-5))
+		, m_maxDt(Real(0.005))
+	{
+	}
+
+	TimeStepController::~TimeStepController()
+	{
+	}
+
+	void TimeStepController::setTimeStepRange(Real minDt, Real maxDt)
+	{
+		m_minDt = minDt;
+		m_maxDt = std::max(minDt, maxDt);
+	}
+
+	Real TimeStepController::clampTimeStep(Real dt)
+	{
+		return std::min(std::max(dt, m_minDt), m_maxDt);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Framework/Framework/Module.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	TimeStepController
+	*	\brief	Suggests the time step of its parent node.
+	*
+	*	If any node of a scene owns a controller, SceneGraph::takeOneFrame() divides the frame interval into substeps
+	*	no larger than the smallest suggestion.
+	*/
+	class TimeStepController : public Module
+	{
+	public:
+		TimeStepController();
+		~TimeStepController() override;
+
+		/**
+		 * @brief Largest stable time step for the current state of the parent node
+		 */
+		virtual Real computeTimeStep() { return m_maxDt; }
+
+		void setTimeStepRange(Real minDt, Real maxDt);
+
+		Real getMinTimeStep() { return m_minDt; }
+		Real getMaxTimeStep() { return m_maxDt; }
+
+		std::string getModuleType() override { return "TimeStepController"; }
+
+	protected:
+		Real clampTimeStep(Real dt);
+
+		Real m_minDt;
+		Real m_maxDt;
+	};
+}
@@ -1,7 +1,6 @@
 #pragma once
 #include "PointSetToPointSet.h"
 #include "Core/Utility.h"
-#include "Framework/Topology/NeighborQuery.h"
 
 namespace PhysIKA
 {
@@ -105,11 +104,16 @@ namespace PhysIKA
 		m_initFrom->copyFrom(*from);
 		m_initTo->copyFrom(*to);
 
-		NeighborQuery<TDataType>* nbQuery = new NeighborQuery<TDataType>(m_initFrom->getPoints());
+		m_pointIndex.build(m_initFrom->getPoints(), m_radius);
 
-		m_neighborhood.resize(m_initTo->getPoints().size());
-		nbQuery->queryParticleNeighbors(m_neighborhood, m_initTo->getPoints(), m_radius);
-
-		delete nbQuery;
+		if (m_neighborNumber > 0)
+		{
+			m_pointIndex.queryKNearest(m_neighborhood, m_initTo->getPoints(), m_neighborNumber, m_radius);
+		}
+		else
+		{
+			m_neighborhood.resize(m_initTo->getPoints().size());
+			m_pointIndex.queryRadius(m_neighborhood, m_initTo->getPoints(), m_radius);
+		}
 	}
 }
\ No newline at end of file
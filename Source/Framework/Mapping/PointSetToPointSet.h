@@ -2,6 +2,7 @@
 #include "Framework/Framework/TopologyMapping.h"
 #include "Core/Array/Array.h"
 #include "Framework/Topology/PointSet.h"
+#include "Framework/Topology/PointIndex.h"
 
 namespace PhysIKA
 {
@@ -20,6 +21,11 @@ public:
 
 	void setSearchingRadius(Real r) { m_radius = r; }
 
+	/**
+	 * @brief Interpolate from the num closest points within the searching radius only, 0 uses all of them
+	 */
+	void setNeighborNumber(int num) { m_neighborNumber = num; }
+
 	void setFrom(std::shared_ptr<PointSet<TDataType>> from) { m_from = from; }
 	void setTo(std::shared_ptr<PointSet<TDataType>> to) { m_to = to; }
 
@@ -34,7 +40,12 @@ private:
 	//Searching radius
 	Real m_radius = 0.0125;
 
+	int m_neighborNumber = 0;
+
 	NeighborList<int> m_neighborhood;
+
+	//Grid over the initial source points
+	PointIndex<TDataType> m_pointIndex;
 	
 	std::shared_ptr<PointSet<TDataType>> m_from = nullptr;
 	std::shared_ptr<PointSet<TDataType>> m_to = nullptr;
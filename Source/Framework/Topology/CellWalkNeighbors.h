@@ -0,0 +1,130 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/GridHash.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	CellWalkNeighbors
+	*	\brief	Neighborhood given by the grid hash only, the candidates of a particle are the particles of its 27 surrounding cells.
+	*
+	*	No neighbor ids are stored, solvers walk the cells on every access and test the actual distance themselves.
+	*	Cells adjacent along x are consecutive in the cell-sorted ids, so the stencil is read as 9 contiguous runs.
+	*	The cell size of the hash must not be smaller than the support radius of the solver.
+	*/
+	template<typename TDataType>
+	class CellWalkNeighbors
+	{
+	public:
+		typedef typename TDataType::Coord Coord;
+
+		CellWalkNeighbors() {};
+
+		CellWalkNeighbors(GridHash<TDataType>& grid, DeviceArray<Coord>& pos)
+			: hash(grid)
+			, position(pos)
+		{
+		}
+
+		/// Whether a grid was assigned
+		bool isValid() { return hash.index != nullptr; }
+
+	public:
+		GridHash<TDataType> hash;
+
+		/// Positions the particles are looked up with, usually the hashed ones
+		DeviceArray<Coord> position;
+	};
+
+	/*!
+	*	\class	NeighborCursor
+	*	\brief	Visits the neighbors of one particle, the same loop serves every neighborhood representation.
+	*
+	*	int j;
+	*	NeighborCursor<NeighborListType> it(neighbors, pId);
+	*	while (it.next(j)) { ... }
+	*/
+	template<typename NeighborListType>
+	class NeighborCursor
+	{
+	public:
+		COMM_FUNC NeighborCursor(NeighborListType& list, int pId)
+			: m_list(list)
+			, m_pId(pId)
+			, m_ne(0)
+			, m_size(list.getNeighborSize(pId))
+		{
+		}
+
+		COMM_FUNC bool next(int& j)
+		{
+			if (m_ne >= m_size) return false;
+
+			j = m_list.getElement(m_pId, m_ne++);
+			return true;
+		}
+
+	private:
+		NeighborListType& m_list;
+		int m_pId;
+		int m_ne;
+		int m_size;
+	};
+
+	template<typename TDataType>
+	class NeighborCursor<CellWalkNeighbors<TDataType>>
+	{
+	public:
+		GPU_FUNC NeighborCursor(CellWalkNeighbors<TDataType>& walk, int pId)
+			: m_hash(walk.hash)
+			, m_row(0)
+			, m_cur(0)
+			, m_end(0)
+		{
+			m_cell = m_hash.getIndex3(walk.position[pId]);
+			m_iLo = m_cell.x - 1 > 0 ? m_cell.x - 1 : 0;
+			m_iHi = m_cell.x + 1 < m_hash.nx - 1 ? m_cell.x + 1 : m_hash.nx - 1;
+		}
+
+		GPU_FUNC bool next(int& j)
+		{
+			while (m_cur >= m_end)
+			{
+				if (!nextRow()) return false;
+			}
+
+			j = m_hash.ids[m_cur++];
+			return true;
+		}
+
+	private:
+		/// Move to the next of the 9 runs of cells along x, returns false when all were visited
+		GPU_FUNC bool nextRow()
+		{
+			while (m_row < 9)
+			{
+				int y = m_cell.y + m_row % 3 - 1;
+				int z = m_cell.z + m_row / 3 - 1;
+				m_row++;
+
+				if (m_iLo > m_iHi || y < 0 || y >= m_hash.ny || z < 0 || z >= m_hash.nz) continue;
+
+				int first = m_hash.getIndex(m_iLo, y, z);
+				int last = m_hash.getIndex(m_iHi, y, z);
+				m_cur = m_hash.index[first];
+				m_end = m_hash.index[last] + m_hash.getCounter(last);
+				return true;
+			}
+			return false;
+		}
+
+		GridHash<TDataType>& m_hash;
+		int3 m_cell;
+		int m_iLo;
+		int m_iHi;
+		int m_row;
+		int m_cur;
+		int m_end;
+	};
+}
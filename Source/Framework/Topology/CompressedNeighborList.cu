@@ -0,0 +1,174 @@
+#include <cuda_runtime.h>
+#include "CompressedNeighborList.h"
+#include "Core/Utility.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/execution_policy.h>
+
+namespace PhysIKA
+{
+	//Largest distance between a neighbor id and its owner that is stored as an offset
+#define MAX_NEIGHBOR_OFFSET 32767
+
+	__global__ void K_CountCompressedNeighbors(
+		DeviceArray<int> nearCount,
+		DeviceArray<int> farCount,
+		NeighborList<int> nbr)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= nearCount.size()) return;
+
+		int nbSize = nbr.getNeighborSize(pId);
+		int nearNum = 0;
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			int d = nbr.getElement(pId, ne) - pId;
+			if (d >= -MAX_NEIGHBOR_OFFSET && d <= MAX_NEIGHBOR_OFFSET)
+				nearNum++;
+		}
+
+		nearCount[pId] = nearNum;
+		farCount[pId] = nbSize - nearNum;
+	}
+
+	__global__ void K_EncodeNeighbors(
+		DeviceArray<short> offsets,
+		DeviceArray<int> index,
+		DeviceArray<int> far,
+		DeviceArray<int> farIndex,
+		NeighborList<int> nbr)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= index.size()) return;
+
+		int nearId = index[pId];
+		int farId = farIndex[pId];
+		int nbSize = nbr.getNeighborSize(pId);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			int j = nbr.getElement(pId, ne);
+			int d = j - pId;
+			if (d >= -MAX_NEIGHBOR_OFFSET && d <= MAX_NEIGHBOR_OFFSET)
+			{
+				offsets[nearId] = (short)d;
+				nearId++;
+			}
+			else
+			{
+				far[farId] = j;
+				farId++;
+			}
+		}
+	}
+
+	__global__ void K_CompressedNeighborSize(
+		DeviceArray<int> count,
+		CompressedNeighborList nbr)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= count.size()) return;
+
+		count[pId] = nbr.getNeighborSize(pId);
+	}
+
+	__global__ void K_DecodeNeighbors(
+		NeighborList<int> dst,
+		CompressedNeighborList src)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= src.size()) return;
+
+		int nbSize = src.getNeighborSize(pId);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			dst.setElement(pId, ne, src.getElement(pId, ne));
+		}
+	}
+
+	//Turn counts into offsets and return their sum
+	static int exclusiveScan(DeviceArray<int>& data)
+	{
+		int total = thrust::reduce(thrust::device, data.getDataPtr(), data.getDataPtr() + data.size(), (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, data.getDataPtr(), data.getDataPtr() + data.size(), data.getDataPtr());
+		return total;
+	}
+
+	void CompressedNeighborList::encode(NeighborList<int>& nbr)
+	{
+		int num = nbr.size();
+		if (num <= 0)
+		{
+			release();
+			return;
+		}
+
+		if (m_index.size() != num)
+		{
+			m_index.resize(num);
+			m_farIndex.resize(num);
+		}
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_CountCompressedNeighbors << <pDims, BLOCK_SIZE >> > (m_index, m_farIndex, nbr);
+		cuSynchronize();
+
+		int nearNum = exclusiveScan(m_index);
+		int farNum = exclusiveScan(m_farIndex);
+
+		if (nearNum == 0)
+			m_offsets.release();
+		else if (m_offsets.size() != nearNum)
+			m_offsets.resize(nearNum);
+
+		if (farNum == 0)
+			m_far.release();
+		else if (m_far.size() != farNum)
+			m_far.resize(farNum);
+
+		K_EncodeNeighbors << <pDims, BLOCK_SIZE >> > (m_offsets, m_index, m_far, m_farIndex, nbr);
+		cuSynchronize();
+	}
+
+	void CompressedNeighborList::decode(NeighborList<int>& nbr)
+	{
+		int num = size();
+		if (num <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		nbr.resize(num);
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_CompressedNeighborSize << <pDims, BLOCK_SIZE >> > (nbr.getIndex(), *this);
+		cuSynchronize();
+
+		int total = exclusiveScan(nbr.getIndex());
+		if (total == 0)
+		{
+			nbr.getElements().release();
+			return;
+		}
+
+		nbr.getElements().resize(total);
+		K_DecodeNeighbors << <pDims, BLOCK_SIZE >> > (nbr, *this);
+		cuSynchronize();
+	}
+
+	void CompressedNeighborList::release()
+	{
+		m_offsets.release();
+		m_index.release();
+		m_far.release();
+		m_farIndex.release();
+	}
+
+	size_t CompressedNeighborList::getMemorySize()
+	{
+		return m_offsets.size() * sizeof(short)
+			+ m_index.size() * sizeof(int)
+			+ m_far.size() * sizeof(int)
+			+ m_farIndex.size() * sizeof(int);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/NeighborList.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	CompressedNeighborList
+	*	\brief	Read-only encoding of a NeighborList<int> that stores neighbor ids as 16-bit offsets to the owner.
+	*
+	*	After spatial ordering most neighbors are stored close to their owner, their id fits into a signed 16-bit offset.
+	*	The remaining far neighbors are kept as full ids in a separate array and follow the near ones,
+	*	so getElement() decodes any entry in constant time. The order of the neighbors is not preserved.
+	*/
+	class CompressedNeighborList
+	{
+	public:
+		CompressedNeighborList() {};
+		~CompressedNeighborList() {};
+
+		COMM_FUNC int size() { return m_index.size(); }
+
+		COMM_FUNC int getNeighborSize(int i)
+		{
+			return getNearSize(i) + getFarSize(i);
+		}
+
+		COMM_FUNC int getElement(int i, int j)
+		{
+			int nearSize = getNearSize(i);
+			if (j < nearSize)
+				return i + m_offsets[m_index[i] + j];
+			else
+				return m_far[m_farIndex[i] + j - nearSize];
+		}
+
+		/**
+		 * @brief Encode a dynamic or fixed-capacity neighbor list
+		 */
+		void encode(NeighborList<int>& nbr);
+
+		/**
+		 * @brief Expand the encoded ids into a dynamic neighbor list
+		 */
+		void decode(NeighborList<int>& nbr);
+
+		void release();
+
+		int getNearElementCount() { return m_offsets.size(); }
+		int getFarElementCount() { return m_far.size(); }
+
+		/// Bytes used by the encoded list
+		size_t getMemorySize();
+
+	private:
+		COMM_FUNC int getNearSize(int i)
+		{
+			if (i >= m_index.size() - 1)
+				return m_offsets.size() - m_index[i];
+			return m_index[i + 1] - m_index[i];
+		}
+
+		COMM_FUNC int getFarSize(int i)
+		{
+			if (i >= m_farIndex.size() - 1)
+				return m_far.size() - m_farIndex[i];
+			return m_farIndex[i + 1] - m_farIndex[i];
+		}
+
+		DeviceArray<short> m_offsets;
+		DeviceArray<int> m_index;
+
+		DeviceArray<int> m_far;
+		DeviceArray<int> m_farIndex;
+	};
+}
@@ -1,8 +1,22 @@
 #include <fstream>
+#include <vector>
 #include "DistanceField3D.h"
 #include "Core/Utility.h"
 #include "Core/Vector.h"
 #include "Core/DataTypes.h"
+#include "Core/Utility/ThreadPool.h"
+#include "IO/Asset_Cache/AssetCache.h"
+#include "Framework/Topology/TriangleSet.h"
+#include "Framework/Topology/LinearBVH.h"
+#include "Framework/Framework/Log.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/count.h>
+#include <thrust/fill.h>
+#include <thrust/execution_policy.h>
+#include <atomic>
+#include <memory>
+#include <algorithm>
 
 namespace PhysIKA{
 
@@ -193,6 +207,7 @@ namespace PhysIKA{
 	template<typename TDataType>
 	void DistanceField3D<TDataType>::setSpace(const Coord p0, const Coord p1, int nbx, int nby, int nbz)
 	{
+		releaseBlocks();
 		m_left = p0;
 
 		m_h = (p1 - p0)*Coord(1.0 / Real(nbx+1), 1.0 / Real(nby+1), 1.0 / Real(nbz+1));
@@ -205,6 +220,15 @@ namespace PhysIKA{
 	{
 	}
 
+	template<typename TDataType>
+	std::shared_ptr<DistanceField3D<TDataType>> DistanceField3D<TDataType>::createShared()
+	{
+		return std::shared_ptr<DistanceField3D<TDataType>>(new DistanceField3D<TDataType>(), [](DistanceField3D<TDataType>* sdf) {
+			sdf->release();
+			delete sdf;
+		});
+	}
+
 	template<typename TDataType>
 	void DistanceField3D<TDataType>::translate(const Coord &t) {
 		m_left += t;
@@ -224,6 +248,25 @@ namespace PhysIKA{
 		distance(i, j, k) = s*distance(i, j, k);
 	}
 
+	template <typename Real>
+	__global__ void K_ScaleBlockValues(DeviceArray<Real> values, Real s)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= values.size()) return;
+
+		values[pId] = s*values[pId];
+	}
+
+	template <typename Real>
+	static void scaleBlockValues(DeviceArray<Real>& values, Real s)
+	{
+		if (values.size() == 0) return;
+
+		cuint pDims = cudaGridSize(values.size(), BLOCK_SIZE);
+		K_ScaleBlockValues << <pDims, BLOCK_SIZE >> > (values, s);
+		cuSynchronize();
+	}
+
 	template<typename TDataType>
 	void DistanceField3D<TDataType>::scale(const Real s) {
 		m_left[0] *= s;
@@ -233,6 +276,13 @@ namespace PhysIKA{
 		m_h[1] *= s;
 		m_h[2] *= s;
 
+		if (m_sparse)
+		{
+			m_background *= s;
+			scaleBlockValues(m_blockValues, s);
+			return;
+		}
+
 		dim3 blockSize = make_uint3(8, 8, 8);
 		dim3 gridDims = cudaGridSize3D(make_uint3(m_distance.Nx(), m_distance.Ny(), m_distance.Nz()), blockSize);
 
@@ -256,6 +306,13 @@ namespace PhysIKA{
 	template<typename TDataType>
 	void DistanceField3D<TDataType>::invertSDF()
 	{
+		if (m_sparse)
+		{
+			m_background = -m_background;
+			scaleBlockValues(m_blockValues, Real(-1));
+			return;
+		}
+
 		dim3 blockSize = make_uint3(8, 8, 8);
 		dim3 gridDims = cudaGridSize3D(make_uint3(m_distance.Nx(), m_distance.Ny(), m_distance.Nz()), blockSize);
 
@@ -350,56 +407,283 @@ namespace PhysIKA{
 		K_DistanceFieldToSphere << <gridDims, blockSize >> >(m_distance, m_left, m_h, center, radius, inverted);
 	}
 
+	/**
+	 * @brief Sign of twice the signed area of the triangle (origin, a, b)
+	 *
+	 * Zero areas are resolved by comparing the coordinates, so a point on an edge shared by two triangles is
+	 * inside exactly one of them and a grid line through a mesh edge is crossed once.
+	 */
+	static int orientation2D(double ax, double ay, double bx, double by, double& area)
+	{
+		area = ay * bx - ax * by;
+		if (area > 0) return 1;
+		if (area < 0) return -1;
+		if (by > ay) return 1;
+		if (by < ay) return -1;
+		if (ax > bx) return 1;
+		if (ax < bx) return -1;
+		return 0;
+	}
+
+	/**
+	 * @brief Whether (px, py) lies inside the triangle (x0, y0), (x1, y1), (x2, y2), returns its barycentric coordinates if so
+	 */
+	static bool pointInTriangle2D(double px, double py, double x0, double y0, double x1, double y1, double x2, double y2, double& b0, double& b1, double& b2)
+	{
+		x0 -= px; x1 -= px; x2 -= px;
+		y0 -= py; y1 -= py; y2 -= py;
+
+		int s0 = orientation2D(x1, y1, x2, y2, b0);
+		if (s0 == 0) return false;
+		int s1 = orientation2D(x2, y2, x0, y0, b1);
+		if (s1 != s0) return false;
+		int s2 = orientation2D(x0, y0, x1, y1, b2);
+		if (s2 != s0) return false;
+
+		double sum = b0 + b1 + b2;
+		if (sum == 0) return false;
+
+		b0 /= sum;
+		b1 /= sum;
+		b2 /= sum;
+		return true;
+	}
+
+	/**
+	 * @brief Godunov upwind solution of |grad u| = 1 from the smallest neighbor of each axis, h is the grid spacing
+	 */
+	template<typename Real>
+	static Real solveEikonal(Real a, Real b, Real c, Real h)
+	{
+		//Sort ascending
+		if (a > b) std::swap(a, b);
+		if (b > c) std::swap(b, c);
+		if (a > b) std::swap(a, b);
+
+		Real u = a + h;
+		if (u <= b) return u;
+
+		Real sum = a + b;
+		Real disc = sum * sum - Real(2) * (a * a + b * b - h * h);
+		u = Real(0.5) * (sum + std::sqrt(std::max(disc, Real(0))));
+		if (u <= c) return u;
+
+		sum = a + b + c;
+		disc = sum * sum - Real(3) * (a * a + b * b + c * c - h * h);
+		if (disc < Real(0)) return u;
+		return (sum + std::sqrt(disc)) / Real(3);
+	}
+
+	template<typename TDataType>
+	void DistanceField3D<TDataType>::loadTriangleSet(TriangleSet<TDataType>& mesh, Real h, int padding, int bandWidth, bool inverted)
+	{
+		LinearBVH<TDataType> bvh;
+		bvh.setDeviceType(DeviceType::CPU);
+		bvh.build(mesh.getPoints(), *mesh.getTriangles());
+		if (bvh.getPrimitiveNum() == 0 || h <= Real(0))
+		{
+			Log::sendMessage(Log::Warning, "SDF: the triangle set is empty!");
+			bvh.release();
+			return;
+		}
+
+		BVHBox<TDataType> bounds = bvh.getBounds();
+		int nx = (int)std::ceil((bounds.hi[0] - bounds.lo[0]) / h) + 2 * padding + 1;
+		int ny = (int)std::ceil((bounds.hi[1] - bounds.lo[1]) / h) + 2 * padding + 1;
+		int nz = (int)std::ceil((bounds.hi[2] - bounds.lo[2]) / h) + 2 * padding + 1;
+		m_left = bounds.lo - Coord(Real(padding) * h);
+		m_h = Coord(h);
+
+		int nxy = nx * ny;
+		int total = nxy * nz;
+		Coord left = m_left;
+		BVHView<TDataType> view = bvh.getHostView();
+		ThreadPool& pool = ThreadPool::getInstance();
+
+		//0: far, 1: close to the box of a triangle, 2: exact distance known
+		std::unique_ptr<std::atomic<unsigned char>[]> state(new std::atomic<unsigned char>[total]);
+		//Parity of the mesh crossings along x in front of each node
+		std::unique_ptr<std::atomic<unsigned char>[]> crossing(new std::atomic<unsigned char>[total]);
+		std::vector<Real> phi(total);
+
+		Real farDistance = Real(nx + ny + nz) * h;
+		pool.parallelFor(0, total, [&](int begin, int end) {
+			for (int n = begin; n < end; n++)
+			{
+				state[n].store(0, std::memory_order_relaxed);
+				crossing[n].store(0, std::memory_order_relaxed);
+				phi[n] = farDistance;
+			}
+		}, 65536);
+
+		auto clampIndex = [](int i, int n) { return i < 0 ? 0 : (i > n - 1 ? n - 1 : i); };
+
+		//Mark the nodes around the triangles and flip the parity behind every crossing of a grid line in x
+		Real band = Real(bandWidth) * h;
+		pool.parallelFor(0, view.primitiveNum, [&](int begin, int end) {
+			for (int t = begin; t < end; t++)
+			{
+				BVHBox<TDataType> box = view.getPrimitiveBox(t);
+				int i0 = clampIndex((int)std::floor((box.lo[0] - band - left[0]) / h), nx);
+				int j0 = clampIndex((int)std::floor((box.lo[1] - band - left[1]) / h), ny);
+				int k0 = clampIndex((int)std::floor((box.lo[2] - band - left[2]) / h), nz);
+				int i1 = clampIndex((int)std::ceil((box.hi[0] + band - left[0]) / h), nx);
+				int j1 = clampIndex((int)std::ceil((box.hi[1] + band - left[1]) / h), ny);
+				int k1 = clampIndex((int)std::ceil((box.hi[2] + band - left[2]) / h), nz);
+				for (int k = k0; k <= k1; k++)
+					for (int j = j0; j <= j1; j++)
+						for (int i = i0; i <= i1; i++)
+							state[i + j * nx + k * nxy].store(1, std::memory_order_relaxed);
+
+				Coord v0 = view.getVertex(t, 0);
+				Coord v1 = view.getVertex(t, 1);
+				Coord v2 = view.getVertex(t, 2);
+				int jLo = clampIndex((int)std::ceil((box.lo[1] - left[1]) / h), ny);
+				int kLo = clampIndex((int)std::ceil((box.lo[2] - left[2]) / h), nz);
+				int jHi = clampIndex((int)std::floor((box.hi[1] - left[1]) / h), ny);
+				int kHi = clampIndex((int)std::floor((box.hi[2] - left[2]) / h), nz);
+				for (int k = kLo; k <= kHi; k++)
+				{
+					for (int j = jLo; j <= jHi; j++)
+					{
+						double py = left[1] + j * h;
+						double pz = left[2] + k * h;
+						double b0, b1, b2;
+						if (!pointInTriangle2D(py, pz, v0[1], v0[2], v1[1], v1[2], v2[1], v2[2], b0, b1, b2)) continue;
+
+						double x = b0 * v0[0] + b1 * v1[0] + b2 * v2[0];
+						int i = (int)std::ceil((x - left[0]) / h);
+						if (i >= nx) continue;
+						crossing[(i < 0 ? 0 : i) + j * nx + k * nxy].fetch_xor(1);
+					}
+				}
+			}
+		}, 256);
+
+		//Exact distances in the narrow band, one grid line in x per task
+		pool.parallelFor(0, ny * nz, [&](int begin, int end) {
+			for (int line = begin; line < end; line++)
+			{
+				int j = line % ny;
+				int k = line / ny;
+				for (int i = 0; i < nx; i++)
+				{
+					int n = i + j * nx + k * nxy;
+					if (state[n].load(std::memory_order_relaxed) == 0) continue;
+
+					Coord p = left + Coord(Real(i), Real(j), Real(k)) * h;
+					Coord closest;
+					Real d;
+					if (view.closestPoint(p, band, closest, d) >= 0)
+					{
+						phi[n] = d;
+						state[n].store(2, std::memory_order_relaxed);
+					}
+				}
+			}
+		}, 16);
+
+		//Fast sweeping in the 8 diagonal orders. Nodes with the same i + j + k along an order do not depend on each other,
+		//so each such plane is updated in parallel
+		auto value = [&](int i, int j, int k) {
+			return phi[i + j * nx + k * nxy];
+		};
+		for (int order = 0; order < 8; order++)
+		{
+			bool flipX = (order & 1) != 0;
+			bool flipY = (order & 2) != 0;
+			bool flipZ = (order & 4) != 0;
+			for (int level = 0; level <= nx + ny + nz - 3; level++)
+			{
+				int iBegin = std::max(0, level - (ny - 1) - (nz - 1));
+				int iEnd = std::min(nx - 1, level) + 1;
+				pool.parallelFor(iBegin, iEnd, [&](int begin, int end) {
+					for (int si = begin; si < end; si++)
+					{
+						int jBegin = std::max(0, level - si - (nz - 1));
+						int jEnd = std::min(ny - 1, level - si);
+						for (int sj = jBegin; sj <= jEnd; sj++)
+						{
+							int sk = level - si - sj;
+							int i = flipX ? nx - 1 - si : si;
+							int j = flipY ? ny - 1 - sj : sj;
+							int k = flipZ ? nz - 1 - sk : sk;
+
+							int n = i + j * nx + k * nxy;
+							if (state[n].load(std::memory_order_relaxed) == 2) continue;
+
+							Real a = std::min(i > 0 ? value(i - 1, j, k) : farDistance, i < nx - 1 ? value(i + 1, j, k) : farDistance);
+							Real b = std::min(j > 0 ? value(i, j - 1, k) : farDistance, j < ny - 1 ? value(i, j + 1, k) : farDistance);
+							Real c = std::min(k > 0 ? value(i, j, k - 1) : farDistance, k < nz - 1 ? value(i, j, k + 1) : farDistance);
+							phi[n] = std::min(phi[n], solveEikonal(a, b, c, h));
+						}
+					}
+				}, 8);
+			}
+		}
+
+		//Nodes behind an odd number of crossings are inside
+		Real sign = inverted ? Real(-1) : Real(1);
+		pool.parallelFor(0, ny * nz, [&](int begin, int end) {
+			for (int line = begin; line < end; line++)
+			{
+				int j = line % ny;
+				int k = line / ny;
+				unsigned char inside = 0;
+				for (int i = 0; i < nx; i++)
+				{
+					int n = i + j * nx + k * nxy;
+					inside ^= crossing[n].load(std::memory_order_relaxed);
+					phi[n] = inside ? -sign * phi[n] : sign * phi[n];
+				}
+			}
+		}, 16);
+
+		releaseBlocks();
+		m_distance.Resize(nx, ny, nz);
+		cuSafeCall(cudaMemcpy(m_distance.GetDataPtr(), phi.data(), total * sizeof(Real), cudaMemcpyHostToDevice));
+		m_bInverted = inverted;
+
+		Log::sendMessage(Log::Info, "SDF: " + std::to_string(nx) + ", " + std::to_string(ny) + ", " + std::to_string(nz)
+			+ " generated from " + std::to_string(view.primitiveNum) + " triangles");
+
+		bvh.release();
+	}
+
 	template<typename TDataType>
 	void DistanceField3D<TDataType>::loadSDF(std::string filename, bool inverted)
 	{
-		std::ifstream input(filename.c_str(), std::ios::in);
-		if (!input.is_open())
+		auto sdf = AssetCache::getInstance().getSDF(filename);
+		if (sdf == nullptr)
 		{
 			std::cout << "Reading file " << filename << " error!" << std::endl;
 			exit(0);
 		}
 
-		int nbx, nby, nbz;
-		int xx, yy, zz;
-
-		input >> xx;
-		input >> yy;
-		input >> zz;
+		int nbx = sdf->nx;
+		int nby = sdf->ny;
+		int nbz = sdf->nz;
 
-		input >> m_left[0];
-		input >> m_left[1];
-		input >> m_left[2];
+		m_left = Coord(sdf->origin[0], sdf->origin[1], sdf->origin[2]);
+		m_h = Coord(sdf->spacing[0], sdf->spacing[1], sdf->spacing[2]);
 
-		Real t_h;
-		input >> t_h;
-
-		std::cout << "SDF: " << xx << ", " << yy << ", " << zz << std::endl;
+		std::cout << "SDF: " << nbx << ", " << nby << ", " << nbz << std::endl;
 		std::cout << "SDF: " << m_left[0] << ", " << m_left[1] << ", " << m_left[2] << std::endl;
-		std::cout << "SDF: " << m_left[0] + t_h*xx << ", " << m_left[1] + t_h*yy << ", " << m_left[2] + t_h*zz << std::endl;
-
-		nbx = xx;
-		nby = yy;
-		nbz = zz;
-		m_h[0] = t_h;
-		m_h[1] = t_h;
-		m_h[2] = t_h;
-
-		int idd = 0;
-		Real* distances = new Real[(nbx)*(nby)*(nbz)];
-		for (int k = 0; k < zz; k++) {
-			for (int j = 0; j < yy; j++) {
-				for (int i = 0; i < xx; i++) {
-					float dist;
-					input >> dist;
-					distances[i + nbx*(j + nby*k)] = dist;
-				}
-			}
-		}
-		input.close();
+		std::cout << "SDF: " << m_left[0] + m_h[0]*nbx << ", " << m_left[1] + m_h[1]*nby << ", " << m_left[2] + m_h[2]*nbz << std::endl;
 
+		int total = nbx*nby*nbz;
+		releaseBlocks();
 		m_distance.Resize(nbx, nby, nbz);
-		cuSafeCall(cudaMemcpy(m_distance.GetDataPtr(), distances, (nbx)*(nby)*(nbz) * sizeof(Real), cudaMemcpyHostToDevice));
+		if (sizeof(Real) == sizeof(float))
+		{
+			//The cached data is uploaded directly, no intermediate host copy is needed
+			cuSafeCall(cudaMemcpy(m_distance.GetDataPtr(), sdf->distances, total * sizeof(Real), cudaMemcpyHostToDevice));
+		}
+		else
+		{
+			std::vector<Real> distances(sdf->distances, sdf->distances + total);
+			cuSafeCall(cudaMemcpy(m_distance.GetDataPtr(), distances.data(), total * sizeof(Real), cudaMemcpyHostToDevice));
+		}
 
 		m_bInverted = inverted;
 		if (inverted)
@@ -410,10 +694,265 @@ namespace PhysIKA{
 		std::cout << "read data successful" << std::endl;
 	}
 
+	template<typename TDataType>
+	bool DistanceField3D<TDataType>::saveSDF(std::string filename)
+	{
+		int nbx = nx();
+		int nby = ny();
+		int nbz = nz();
+		int total = nbx * nby * nbz;
+		if (total <= 0)
+		{
+			Log::sendMessage(Log::Error, "SDF: an empty field can not be saved to " + filename);
+			return false;
+		}
+
+		std::vector<Real> values(total);
+		if (!m_sparse)
+		{
+			cuSafeCall(cudaMemcpy(values.data(), m_distance.GetDataPtr(), total * sizeof(Real), cudaMemcpyDeviceToHost));
+		}
+		else
+		{
+			//Expand the blocks on the host, following sample()
+			std::vector<int> keys(m_blockKeys.size());
+			std::vector<int> slots(m_blockSlots.size());
+			std::vector<Real> blockValues(m_blockValues.size());
+			cuSafeCall(cudaMemcpy(keys.data(), m_blockKeys.getDataPtr(), keys.size() * sizeof(int), cudaMemcpyDeviceToHost));
+			cuSafeCall(cudaMemcpy(slots.data(), m_blockSlots.getDataPtr(), slots.size() * sizeof(int), cudaMemcpyDeviceToHost));
+			if (!blockValues.empty())
+				cuSafeCall(cudaMemcpy(blockValues.data(), m_blockValues.getDataPtr(), blockValues.size() * sizeof(Real), cudaMemcpyDeviceToHost));
+
+			const int blockNodes = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+			int mask = (int)keys.size() - 1;
+			for (int k = 0; k < nbz; k++)
+			{
+				for (int j = 0; j < nby; j++)
+				{
+					for (int i = 0; i < nbx; i++)
+					{
+						int key = i / SDF_BLOCK_SIZE + (j / SDF_BLOCK_SIZE + (k / SDF_BLOCK_SIZE) * m_blockDims.y) * m_blockDims.x;
+						int h = (int)(((unsigned int)key * 2654435761u) & (unsigned int)mask);
+						while (keys[h] != key && keys[h] != SDF_BLOCK_EMPTY)
+							h = (h + 1) & mask;
+
+						int slot = keys[h] == key ? slots[h] : SDF_BLOCK_EMPTY;
+						Real d = m_background;
+						if (slot == SDF_BLOCK_INSIDE)
+							d = -m_background;
+						else if (slot >= 0)
+							d = blockValues[slot * blockNodes + i % SDF_BLOCK_SIZE + (j % SDF_BLOCK_SIZE + (k % SDF_BLOCK_SIZE) * SDF_BLOCK_SIZE) * SDF_BLOCK_SIZE];
+
+						values[i + (j + k * nby) * nbx] = d;
+					}
+				}
+			}
+		}
+
+		Real sign = m_bInverted ? Real(-1) : Real(1);
+		std::vector<float> distances(total);
+		for (int n = 0; n < total; n++)
+			distances[n] = (float)(sign * values[n]);
+
+		SDFAsset sdf;
+		sdf.nx = nbx;
+		sdf.ny = nby;
+		sdf.nz = nbz;
+		for (int i = 0; i < 3; i++)
+		{
+			sdf.origin[i] = m_left[i];
+			sdf.spacing[i] = m_h[i];
+		}
+		sdf.h = m_h[0];
+		sdf.distances = distances.data();
+
+		if (!AssetCache::getInstance().writeSDF(filename, sdf))
+		{
+			Log::sendMessage(Log::Error, "SDF: failed to write " + filename);
+			return false;
+		}
+		return true;
+	}
+
 	template<typename TDataType>
 	void DistanceField3D<TDataType>::release()
 	{
 		m_distance.Release();
+		releaseBlocks();
+	}
+
+	template <typename Real>
+	__global__ void K_ClassifySDFBlocks(
+		DeviceArray<int> state,
+		DeviceArray3D<Real> distance,
+		int3 blockDims,
+		Real band)
+	{
+		int bId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (bId >= state.size()) return;
+
+		int i0 = (bId % blockDims.x) * SDF_BLOCK_SIZE;
+		int j0 = ((bId / blockDims.x) % blockDims.y) * SDF_BLOCK_SIZE;
+		int k0 = (bId / (blockDims.x * blockDims.y)) * SDF_BLOCK_SIZE;
+		int i1 = min(i0 + SDF_BLOCK_SIZE, distance.Nx());
+		int j1 = min(j0 + SDF_BLOCK_SIZE, distance.Ny());
+		int k1 = min(k0 + SDF_BLOCK_SIZE, distance.Nz());
+
+		Real minDist = band;
+		for (int k = k0; k < k1; k++)
+			for (int j = j0; j < j1; j++)
+				for (int i = i0; i < i1; i++)
+					minDist = min(minDist, abs(distance(i, j, k)));
+
+		//1: allocated, 2: dropped inside, 0: dropped outside
+		state[bId] = minDist < band ? 1 : (distance(i0, j0, k0) < Real(0) ? 2 : 0);
+	}
+
+	__global__ void K_MarkAllocatedSDFBlocks(
+		DeviceArray<int> slots,
+		DeviceArray<int> state)
+	{
+		int bId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (bId >= state.size()) return;
+
+		slots[bId] = state[bId] == 1 ? 1 : 0;
+	}
+
+	__global__ void K_InsertSDFBlocks(
+		DeviceArray<int> keys,
+		DeviceArray<int> tableSlots,
+		DeviceArray<int> state,
+		DeviceArray<int> slots)
+	{
+		int bId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (bId >= state.size()) return;
+		if (state[bId] == 0) return;
+
+		int mask = keys.size() - 1;
+		int h = (int)(((unsigned int)bId * 2654435761u) & (unsigned int)mask);
+		while (atomicCAS(&keys[h], SDF_BLOCK_EMPTY, bId) != SDF_BLOCK_EMPTY)
+		{
+			h = (h + 1) & mask;
+		}
+		tableSlots[h] = state[bId] == 1 ? slots[bId] : SDF_BLOCK_INSIDE;
+	}
+
+	template <typename Real>
+	__global__ void K_FillSDFBlocks(
+		DeviceArray<Real> values,
+		DeviceArray<int> state,
+		DeviceArray<int> slots,
+		DeviceArray3D<Real> distance,
+		int3 blockDims,
+		Real band)
+	{
+		const int blockNodes = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		int bId = pId / blockNodes;
+		if (bId >= state.size()) return;
+		if (state[bId] != 1) return;
+
+		int local = pId % blockNodes;
+		int i = (bId % blockDims.x) * SDF_BLOCK_SIZE + local % SDF_BLOCK_SIZE;
+		int j = ((bId / blockDims.x) % blockDims.y) * SDF_BLOCK_SIZE + (local / SDF_BLOCK_SIZE) % SDF_BLOCK_SIZE;
+		int k = (bId / (blockDims.x * blockDims.y)) * SDF_BLOCK_SIZE + local / (SDF_BLOCK_SIZE * SDF_BLOCK_SIZE);
+
+		//Nodes beyond the grid are never interpolated
+		Real d = band;
+		if (i < distance.Nx() && j < distance.Ny() && k < distance.Nz())
+			d = max(-band, min(band, distance(i, j, k)));
+
+		values[slots[bId] * blockNodes + local] = d;
+	}
+
+	template<typename TDataType>
+	void DistanceField3D<TDataType>::compress(int bandWidth)
+	{
+		if (m_sparse || m_distance.Size() == 0)
+		{
+			return;
+		}
+
+		int nx = m_distance.Nx();
+		int ny = m_distance.Ny();
+		int nz = m_distance.Nz();
+		m_blockDims = make_int3((nx + SDF_BLOCK_SIZE - 1) / SDF_BLOCK_SIZE, (ny + SDF_BLOCK_SIZE - 1) / SDF_BLOCK_SIZE, (nz + SDF_BLOCK_SIZE - 1) / SDF_BLOCK_SIZE);
+		int blockNum = m_blockDims.x * m_blockDims.y * m_blockDims.z;
+
+		Real hMax = std::max(m_h[0], std::max(m_h[1], m_h[2]));
+		Real band = Real(bandWidth) * hMax;
+
+		DeviceArray<int> state(blockNum);
+		DeviceArray<int> slots(blockNum);
+
+		cuint pDims = cudaGridSize(blockNum, BLOCK_SIZE);
+		K_ClassifySDFBlocks << <pDims, BLOCK_SIZE >> > (state, m_distance, m_blockDims, band);
+		cuSynchronize();
+
+		K_MarkAllocatedSDFBlocks << <pDims, BLOCK_SIZE >> > (slots, state);
+		cuSynchronize();
+
+		int allocated = thrust::reduce(thrust::device, slots.getDataPtr(), slots.getDataPtr() + blockNum, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, slots.getDataPtr(), slots.getDataPtr() + blockNum, slots.getDataPtr());
+		int entryNum = blockNum - (int)thrust::count(thrust::device, state.getDataPtr(), state.getDataPtr() + blockNum, 0);
+
+		//At most half of the table is used, so a probe always ends at an empty entry
+		int capacity = 1;
+		while (capacity < 2 * entryNum) capacity *= 2;
+		if (capacity < 2) capacity = 2;
+
+		m_blockKeys.resize(capacity);
+		m_blockSlots.resize(capacity);
+		thrust::fill(thrust::device, m_blockKeys.getDataPtr(), m_blockKeys.getDataPtr() + capacity, SDF_BLOCK_EMPTY);
+
+		K_InsertSDFBlocks << <pDims, BLOCK_SIZE >> > (m_blockKeys, m_blockSlots, state, slots);
+		cuSynchronize();
+
+		const int blockNodes = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+		if (allocated > 0)
+		{
+			m_blockValues.resize(allocated * blockNodes);
+
+			cuint fDims = cudaGridSize(blockNum * blockNodes, BLOCK_SIZE);
+			K_FillSDFBlocks << <fDims, BLOCK_SIZE >> > (m_blockValues, state, slots, m_distance, m_blockDims, band);
+			cuSynchronize();
+		}
+
+		size_t denseSize = m_distance.Size() * sizeof(Real);
+
+		m_dims = make_int3(nx, ny, nz);
+		m_background = band;
+		m_sparse = true;
+		m_distance.Release();
+
+		state.release();
+		slots.release();
+
+		Log::sendMessage(Log::Info, "SDF: " + std::to_string(allocated) + " of " + std::to_string(blockNum) + " blocks kept, "
+			+ std::to_string(getMemorySize() / 1024) + " KB instead of " + std::to_string(denseSize / 1024) + " KB");
+	}
+
+	template<typename TDataType>
+	void DistanceField3D<TDataType>::releaseBlocks()
+	{
+		m_blockKeys.release();
+		m_blockSlots.release();
+		m_blockValues.release();
+		m_sparse = false;
+	}
+
+	template<typename TDataType>
+	size_t DistanceField3D<TDataType>::getMemorySize()
+	{
+		if (!m_sparse)
+		{
+			return m_distance.Size() * sizeof(Real);
+		}
+
+		return m_blockKeys.size() * sizeof(int)
+			+ m_blockSlots.size() * sizeof(int)
+			+ m_blockValues.size() * sizeof(Real);
 	}
 
 	template class DistanceField3D<DataType3f>;
@@ -11,11 +11,20 @@
 #pragma once
 
 #include <string>
+#include <memory>
 #include "Core/Platform.h"
+#include "Core/Array/Array.h"
 #include "Core/Array/Array3D.h"
 
 namespace PhysIKA {
 
+	//Edge length of the blocks of a sparse distance field, in nodes
+#define SDF_BLOCK_SIZE 8
+#define SDF_BLOCK_EMPTY -1
+#define SDF_BLOCK_INSIDE -2
+
+	template<typename TDataType> class TriangleSet;
+
 	template<typename TDataType>
 	class DistanceField3D {
 	public:
@@ -37,6 +46,14 @@ namespace PhysIKA {
 		 */
 		void release();
 
+		/**
+		 * @brief Allocate a field whose device memory is released together with its last shared reference
+		 *
+		 * Kernels take the field by value, so only the owner may release it. Fields shared between modules should be
+		 * created here, whoever drops the last reference then releases the memory.
+		 */
+		static std::shared_ptr<DistanceField3D<TDataType>> createShared();
+
 		/**
 		 * @brief Translate the distance field with a displacement
 		 * 
@@ -64,24 +81,100 @@ namespace PhysIKA {
 		/**
 		 * @brief load signed distance field from a file
 		 * 
-		 * @param filename 
+		 * @param filename text .sdf or binary .sdfb, see AssetCache::convertSDF()
 		 * @param inverted indicated whether the signed distance field should be inverted after initialization
 		 */
 		void loadSDF(std::string filename, bool inverted = false);
 
+		/**
+		 * @brief Write the field as a binary .sdfb file through AssetCache::writeSDF(), returns false on failure
+		 *
+		 * Compressed fields are written with their saturated values. The file holds the field before inversion,
+		 * so it is reproduced by loadSDF() with the same inverted flag.
+		 */
+		bool saveSDF(std::string filename);
+
 		void loadBox(Coord& lo, Coord& hi, bool inverted = false);
 
 		void loadCylinder(Coord& center, Real radius, Real height, int axis, bool inverted = false);
 
 		void loadSphere(Coord& center, Real radius, bool inverted = false);
 
+		/**
+		 * @brief Generate the signed distance field of a closed triangle mesh on a grid of spacing h fitted around it
+		 *
+		 * Nodes within bandWidth cells of the surface get exact distances from a LinearBVH, the remaining nodes are
+		 * filled by fast sweeping. Inside is decided by the parity of the mesh crossings along the grid lines in x.
+		 * All steps run on the ThreadPool, the result is uploaded to m_distance once.
+		 *
+		 * @param padding number of cells between the mesh bounds and the grid boundary
+		 */
+		void loadTriangleSet(TriangleSet<TDataType>& mesh, Real h, int padding = 3, int bandWidth = 3, bool inverted = false);
+
 		void setSpace(const Coord p0, const Coord p1, int nbx, int nby, int nbz);
 
+		/**
+		 * @brief Keep only the 8^3 blocks within bandWidth cells of the zero level set and release m_distance
+		 *
+		 * The blocks are found through a hash table of their block coordinates. All distances saturate at
+		 * band = bandWidth * h: kept values are clamped to [-band, band] and nodes of dropped blocks read as band,
+		 * or -band for blocks inside the surface. The sign is kept everywhere, while the magnitude and the normal
+		 * are exact only where all corners of the cell lie within the band, i.e. closer than about
+		 * (bandWidth - 2) * h to the surface. Beyond that the normal vanishes, so a consumer pushing points out
+		 * along -d * normal needs a band wider than the deepest penetration it has to resolve.
+		 * Saturating instead of storing a far value keeps the interpolation continuous at the block borders.
+		 */
+		void compress(int bandWidth = 4);
+
+		bool isSparse() { return m_sparse; }
+
+		/// Bytes of device memory used by the distance values and the block table
+		size_t getMemorySize();
+
 	private:
 		GPU_FUNC inline Real lerp(Real a, Real b, Real alpha) const {
 			return (1.0f - alpha)*a + alpha *b;
 		}
 
+		COMM_FUNC inline int nx() { return m_sparse ? m_dims.x : m_distance.Nx(); }
+		COMM_FUNC inline int ny() { return m_sparse ? m_dims.y : m_distance.Ny(); }
+		COMM_FUNC inline int nz() { return m_sparse ? m_dims.z : m_distance.Nz(); }
+
+		/**
+		 * @brief Slot of the values of a block in the hash table, SDF_BLOCK_EMPTY or SDF_BLOCK_INSIDE for dropped blocks
+		 */
+		GPU_FUNC inline int findBlock(int bx, int by, int bz)
+		{
+			int key = bx + (by + bz * m_blockDims.y) * m_blockDims.x;
+			int mask = m_blockKeys.size() - 1;
+			int h = (int)(((unsigned int)key * 2654435761u) & (unsigned int)mask);
+			while (true)
+			{
+				int k = m_blockKeys[h];
+				if (k == key) return m_blockSlots[h];
+				if (k == SDF_BLOCK_EMPTY) return SDF_BLOCK_EMPTY;
+				h = (h + 1) & mask;
+			}
+		}
+
+		GPU_FUNC inline Real sample(int i, int j, int k)
+		{
+			int slot = findBlock(i / SDF_BLOCK_SIZE, j / SDF_BLOCK_SIZE, k / SDF_BLOCK_SIZE);
+			if (slot == SDF_BLOCK_EMPTY) return m_background;
+			if (slot == SDF_BLOCK_INSIDE) return -m_background;
+
+			int local = i % SDF_BLOCK_SIZE + (j % SDF_BLOCK_SIZE + (k % SDF_BLOCK_SIZE) * SDF_BLOCK_SIZE) * SDF_BLOCK_SIZE;
+			return m_blockValues[slot * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE + local];
+		}
+
+		/**
+		 * @brief The 8 corner values of cell (i, j, k), x varying fastest
+		 */
+		GPU_FUNC inline void fetchCell(int i, int j, int k, Real* d);
+
+		/// Free the blocks of a sparse field, the next load starts dense again
+		void releaseBlocks();
+
 		/**
 		 * @brief Invert the signed distance field
 		 * 
@@ -107,8 +200,77 @@ namespace PhysIKA {
 		 * 
 		 */
 		DeviceArray3D<Real> m_distance;
+
+		bool m_sparse = false;
+
+		/**
+		 * @brief Node and block counts of a sparse field, m_distance is empty then
+		 * 
+		 */
+		int3 m_dims;
+		int3 m_blockDims;
+
+		/**
+		 * @brief Distance of the nodes of dropped blocks outside the surface
+		 * 
+		 */
+		Real m_background = Real(0);
+
+		DeviceArray<int> m_blockKeys;		//!< hash table entries, block key or SDF_BLOCK_EMPTY
+		DeviceArray<int> m_blockSlots;		//!< hash table entries, values slot or SDF_BLOCK_INSIDE
+		DeviceArray<Real> m_blockValues;	//!< 8^3 values per allocated block
 	};
 
+	template<typename TDataType>
+	GPU_FUNC void DistanceField3D<TDataType>::fetchCell(int i, int j, int k, Real* d)
+	{
+		if (!m_sparse)
+		{
+			d[0] = m_distance(i, j, k);
+			d[1] = m_distance(i + 1, j, k);
+			d[2] = m_distance(i, j + 1, k);
+			d[3] = m_distance(i + 1, j + 1, k);
+			d[4] = m_distance(i, j, k + 1);
+			d[5] = m_distance(i + 1, j, k + 1);
+			d[6] = m_distance(i, j + 1, k + 1);
+			d[7] = m_distance(i + 1, j + 1, k + 1);
+			return;
+		}
+
+		int li = i % SDF_BLOCK_SIZE;
+		int lj = j % SDF_BLOCK_SIZE;
+		int lk = k % SDF_BLOCK_SIZE;
+		if (li < SDF_BLOCK_SIZE - 1 && lj < SDF_BLOCK_SIZE - 1 && lk < SDF_BLOCK_SIZE - 1)
+		{
+			//The cell lies within one block, which is looked up once
+			int slot = findBlock(i / SDF_BLOCK_SIZE, j / SDF_BLOCK_SIZE, k / SDF_BLOCK_SIZE);
+			if (slot < 0)
+			{
+				Real v = slot == SDF_BLOCK_INSIDE ? -m_background : m_background;
+				for (int n = 0; n < 8; n++) d[n] = v;
+				return;
+			}
+
+			const int sy = SDF_BLOCK_SIZE;
+			const int sz = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+			int base = slot * SDF_BLOCK_SIZE * sz + li + lj * sy + lk * sz;
+			d[0] = m_blockValues[base];
+			d[1] = m_blockValues[base + 1];
+			d[2] = m_blockValues[base + sy];
+			d[3] = m_blockValues[base + sy + 1];
+			d[4] = m_blockValues[base + sz];
+			d[5] = m_blockValues[base + sz + 1];
+			d[6] = m_blockValues[base + sz + sy];
+			d[7] = m_blockValues[base + sz + sy + 1];
+			return;
+		}
+
+		for (int n = 0; n < 8; n++)
+		{
+			d[n] = sample(i + (n & 1), j + ((n >> 1) & 1), k + ((n >> 2) & 1));
+		}
+	}
+
 	template<typename TDataType>
 	GPU_FUNC void DistanceField3D<TDataType>::getDistance(const Coord &p, Real &d, Coord &normal)
 	{
@@ -117,7 +279,7 @@ namespace PhysIKA {
 		const int i = (int)floor(fp[0]);
 		const int j = (int)floor(fp[1]);
 		const int k = (int)floor(fp[2]);
-		if (i < 0 || i >= m_distance.Nx() - 1 || j < 0 || j >= m_distance.Ny() - 1 || k < 0 || k >= m_distance.Nz() - 1) {
+		if (i < 0 || i >= nx() - 1 || j < 0 || j >= ny() - 1 || k < 0 || k >= nz() - 1) {
 			if (m_bInverted) d = -100000.0f;
 			else d = 100000.0f;
 			normal = Coord(0);
@@ -130,14 +292,16 @@ namespace PhysIKA {
 		Real beta = alphav[1];
 		Real gamma = alphav[2];
 
-		Real d000 = m_distance(i, j, k);
-		Real d100 = m_distance(i + 1, j, k);
-		Real d010 = m_distance(i, j + 1, k);
-		Real d110 = m_distance(i + 1, j + 1, k);
-		Real d001 = m_distance(i, j, k + 1);
-		Real d101 = m_distance(i + 1, j, k + 1);
-		Real d011 = m_distance(i, j + 1, k + 1);
-		Real d111 = m_distance(i + 1, j + 1, k + 1);
+		Real corners[8];
+		fetchCell(i, j, k, corners);
+		Real d000 = corners[0];
+		Real d100 = corners[1];
+		Real d010 = corners[2];
+		Real d110 = corners[3];
+		Real d001 = corners[4];
+		Real d101 = corners[5];
+		Real d011 = corners[6];
+		Real d111 = corners[7];
 
 		Real dx00 = lerp(d000, d100, alpha);
 		Real dx10 = lerp(d010, d110, alpha);
@@ -1,4 +1,5 @@
 #include "EdgeSet.h"
+#include "MeshAdjacency.h"
 #include "IO/Smesh_IO/smesh.h"
 #include <vector>
 #include <Core/Utility.h>
@@ -16,34 +17,24 @@ namespace PhysIKA
 		
 	}
 
-__global__ void K_updatePointNeighborsInEdges(NeighborList<int> nbl, DeviceArray<TopologyModule::Edge> edges){
-	int pId = threadIdx.x + (blockIdx.x * blockDim.x);
-	if (pId >= nbl.size()) return;
-
-	int neibor_num=0;
-
-	for(int i=0;i<edges.size();++i)
-	{
-		if(edges[i][0] == pId){
-			nbl.setElement(pId, neibor_num++, edges[i][1]);
-		}
-		if(edges[i][1] == pId){
-			nbl.setElement(pId, neibor_num++, edges[i][0]);
-		}
-		nbl.setNeighborSize(pId, neibor_num);
-	}
-}
-
 	template<typename TDataType>
 	void EdgeSet<TDataType>::updatePointNeighbors()
 	{
 		if (this->m_coords.isEmpty())
 			return;
 
-		auto nbr = m_edgeNeighbors.getValue();
-		uint pDims = cudaGridSize(nbr.size(), BLOCK_SIZE);
-		K_updatePointNeighborsInEdges<<< pDims, BLOCK_SIZE >>>(nbr, m_edges);
-		cuSynchronize();
+		if (m_edgeNeighbors.isEmpty())
+			m_edgeNeighbors.setElementCount(this->m_coords.size());
+		MeshAdjacency::buildVertexNeighbors(m_edgeNeighbors.getValue(), m_edges, this->m_coords.size(), m_adjacencyDevice);
+		m_adjacencyDirty = false;
+	}
+
+	template<typename TDataType>
+	NeighborList<int>& EdgeSet<TDataType>::getEdgeNeighbors()
+	{
+		if (m_adjacencyDirty)
+			this->updatePointNeighbors();
+		return m_edgeNeighbors.getValue();
 	}
 
 	template<typename TDataType>
@@ -63,8 +54,7 @@ __global__ void K_updatePointNeighborsInEdges(NeighborList<int> nbl, DeviceArray
 		m_edges.resize(mesh.m_edges.size());
 		Function1Pt::copy(m_edges, mesh.m_edges);
 
-		m_edgeNeighbors.setElementCount(vert_list.size(), 4);
-		this->updatePointNeighbors();
+		m_adjacencyDirty = true;
 	}
 
 #ifdef PRECISION_FLOAT
@@ -16,16 +16,29 @@ namespace PhysIKA
 		EdgeSet();
 		~EdgeSet() override;
 
+		/**
+		 * @brief Rebuild the vertex adjacency in m_edgeNeighbors by sorting the edges
+		 *
+		 * Loaders only mark the adjacency as outdated, it is rebuilt by the first getter asking for it.
+		 */
 		void updatePointNeighbors() override;
 
+		/**
+		 * @brief Build the adjacency on the GPU (default) or on the ThreadPool
+		 */
+		void setAdjacencyDeviceType(DeviceType type) { m_adjacencyDevice = type; }
+
 		void loadSmeshFile(std::string filename);
 
 		DeviceArray<Edge>* getEdges() {return &m_edges;}
-		NeighborList<int>& getEdgeNeighbors() { return m_edgeNeighbors.getValue(); }
+		NeighborList<int>& getEdgeNeighbors();
 
 		NeighborField<int> m_edgeNeighbors;
 
 	protected:
+		DeviceType m_adjacencyDevice = DeviceType::GPU;
+		bool m_adjacencyDirty = true;
+
 		DeviceArray<Edge> m_edges;
 	};
 
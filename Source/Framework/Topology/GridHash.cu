@@ -1,5 +1,16 @@
 #include "GridHash.h"
 #include "Core/Utility.h"
+#include <thrust/reduce.h>
+#include <thrust/remove.h>
+#include <thrust/copy.h>
+#include <thrust/gather.h>
+#include <thrust/sort.h>
+#include <thrust/merge.h>
+#include <thrust/functional.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/execution_policy.h>
+#include <algorithm>
 
 namespace PhysIKA{
 
@@ -80,6 +91,7 @@ namespace PhysIKA{
 		if (pId >= pos.size()) return;
 
 		int gId = hash.getIndex(pos[pId]);
+		hash.cellIds[pId] = gId;
 
 		if (gId != INVALID)
 			atomicAdd(&(hash.index[gId]), 1);
@@ -91,7 +103,7 @@ namespace PhysIKA{
 		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
 		if (pId >= pos.size()) return;
 
-		int gId = hash.getIndex(pos[pId]);
+		int gId = hash.cellIds[pId];
 
 		if (gId < 0) return;
 
@@ -99,12 +111,14 @@ namespace PhysIKA{
 // 		index = index < hash.npMax - 1 ? index : hash.npMax - 1;
 // 		hash.ids[gId * hash.npMax + index] = pId;
 		hash.ids[hash.index[gId] + index] = pId;
+		hash.sortedCells[hash.index[gId] + index] = gId;
 	}
 
 	template<typename TDataType>
 	void GridHash<TDataType>::construct(DeviceArray<Coord>& pos)
 	{
 		clear();
+		reserve(pos.size());
 
 		dim3 pDims = int(ceil(pos.size() / BLOCK_SIZE + 0.5f));
 
@@ -117,15 +131,170 @@ namespace PhysIKA{
 		}
 		m_scan->exclusive(index, num);
 
-		if (ids != nullptr)
+//		std::cout << "Particle number: " << particle_num << std::endl;
+
+		K_ConstructHashTable << <pDims, BLOCK_SIZE >> > (*this, pos);
+		cuSynchronize();
+
+		m_builtNum = pos.size();
+		m_movedNum = m_builtNum;
+	}
+
+	template<typename TDataType>
+	void GridHash<TDataType>::reserve(int pNum)
+	{
+		if (pNum <= m_capacity)
 		{
-			cuSafeCall(cudaFree(ids));
+			return;
 		}
-		cuSafeCall(cudaMalloc((void**)&ids, particle_num * sizeof(int)));
 
-//		std::cout << "Particle number: " << particle_num << std::endl;
+		int* buffers[] = { ids, cellIds, sortedCells, m_newCellIds, m_flags, m_stencil, m_movedIds, m_movedCells, m_mergedIds, m_mergedCells };
+		for (int i = 0; i < 10; i++)
+		{
+			if (buffers[i] != nullptr)
+				cuSafeCall(cudaFree(buffers[i]));
+		}
 
-		K_ConstructHashTable << <pDims, BLOCK_SIZE >> > (*this, pos);
+		m_capacity = pNum;
+		cuSafeCall(cudaMalloc((void**)&ids, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&cellIds, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&sortedCells, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_newCellIds, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_flags, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_stencil, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_movedIds, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_movedCells, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_mergedIds, m_capacity * sizeof(int)));
+		cuSafeCall(cudaMalloc((void**)&m_mergedCells, m_capacity * sizeof(int)));
+	}
+
+	template<typename TDataType>
+	__global__ void K_DetectCellChanges(
+		GridHash<TDataType> hash,
+		Array<typename TDataType::Coord> pos,
+		int* newCellIds,
+		int* flags)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		int gId = hash.getIndex(pos[pId]);
+		newCellIds[pId] = gId;
+		flags[pId] = gId != hash.cellIds[pId] ? 1 : 0;
+	}
+
+	template<typename TDataType>
+	__global__ void K_MoveParticleCounts(
+		GridHash<TDataType> hash,
+		int* newCellIds,
+		int* flags,
+		int pNum)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pNum) return;
+
+		if (flags[pId] == 0) return;
+
+		int oldId = hash.cellIds[pId];
+		int newId = newCellIds[pId];
+		if (oldId != INVALID)
+			atomicSub(&(hash.counter[oldId]), 1);
+		if (newId != INVALID)
+			atomicAdd(&(hash.counter[newId]), 1);
+
+		hash.cellIds[pId] = newId;
+	}
+
+	__global__ void K_GatherRemovalStencil(
+		int* stencil,
+		int* ids,
+		int* flags,
+		int num)
+	{
+		int tId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (tId >= num) return;
+
+		stencil[tId] = flags[ids[tId]];
+	}
+
+	__global__ void K_MarkInsertions(
+		int* stencil,
+		int* newCellIds,
+		int* flags,
+		int pNum)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pNum) return;
+
+		stencil[pId] = (flags[pId] != 0 && newCellIds[pId] != INVALID) ? 1 : 0;
+	}
+
+	template<typename TDataType>
+	void GridHash<TDataType>::update(DeviceArray<Coord>& pos)
+	{
+		int pNum = pos.size();
+		if (pNum != m_builtNum || pNum <= 0)
+		{
+			construct(pos);
+			return;
+		}
+
+		cuint pDims = cudaGridSize(pNum, BLOCK_SIZE);
+		K_DetectCellChanges << <pDims, BLOCK_SIZE >> > (*this, pos, m_newCellIds, m_flags);
+		cuSynchronize();
+
+		m_movedNum = thrust::reduce(thrust::device, m_flags, m_flags + pNum, (int)0, thrust::plus<int>());
+		if (m_movedNum == 0)
+		{
+			return;
+		}
+
+		if (m_movedNum > m_updateThreshold * pNum)
+		{
+			construct(pos);
+			return;
+		}
+
+		//Remove the moved particles from the cell-sorted ids, the remaining entries stay sorted
+		if (particle_num > 0)
+		{
+			cuint sDims = cudaGridSize(particle_num, BLOCK_SIZE);
+			K_GatherRemovalStencil << <sDims, BLOCK_SIZE >> > (m_stencil, ids, m_flags, particle_num);
+			cuSynchronize();
+		}
+
+		auto sorted = thrust::make_zip_iterator(thrust::make_tuple(sortedCells, ids));
+		auto sortedEnd = thrust::remove_if(thrust::device, sorted, sorted + particle_num, m_stencil, thrust::identity<int>());
+		int keptNum = sortedEnd - sorted;
+
+		//Sort the moved particles that are still inside the grid by their new cells
+		K_MarkInsertions << <pDims, BLOCK_SIZE >> > (m_stencil, m_newCellIds, m_flags, pNum);
+		cuSynchronize();
+
+		int* movedEnd = thrust::copy_if(thrust::device,
+			thrust::counting_iterator<int>(0), thrust::counting_iterator<int>(pNum),
+			m_stencil, m_movedIds, thrust::identity<int>());
+		int insertNum = movedEnd - m_movedIds;
+
+		thrust::gather(thrust::device, m_movedIds, m_movedIds + insertNum, m_newCellIds, m_movedCells);
+		thrust::sort_by_key(thrust::device, m_movedCells, m_movedCells + insertNum, m_movedIds);
+
+		thrust::merge_by_key(thrust::device,
+			sortedCells, sortedCells + keptNum,
+			m_movedCells, m_movedCells + insertNum,
+			ids, m_movedIds,
+			m_mergedCells, m_mergedIds);
+
+		std::swap(ids, m_mergedIds);
+		std::swap(sortedCells, m_mergedCells);
+		particle_num = keptNum + insertNum;
+
+		//Only the counts of the cells that were left or entered change, the offsets follow from a scan
+		K_MoveParticleCounts << <pDims, BLOCK_SIZE >> > (*this, m_newCellIds, m_flags, pNum);
+		cuSynchronize();
+
+		cuSafeCall(cudaMemcpy(index, counter, num * sizeof(int), cudaMemcpyDeviceToDevice));
+		m_scan->exclusive(index, num);
 		cuSynchronize();
 	}
 
@@ -148,6 +317,29 @@ namespace PhysIKA{
 		if (index != nullptr)
 			cuSafeCall(cudaFree(index));
 
+		int* buffers[] = { cellIds, sortedCells, m_newCellIds, m_flags, m_stencil, m_movedIds, m_movedCells, m_mergedIds, m_mergedCells };
+		for (int i = 0; i < 9; i++)
+		{
+			if (buffers[i] != nullptr)
+				cuSafeCall(cudaFree(buffers[i]));
+		}
+
+		counter = nullptr;
+		ids = nullptr;
+		index = nullptr;
+		cellIds = nullptr;
+		sortedCells = nullptr;
+		m_newCellIds = nullptr;
+		m_flags = nullptr;
+		m_stencil = nullptr;
+		m_movedIds = nullptr;
+		m_movedCells = nullptr;
+		m_mergedIds = nullptr;
+		m_mergedCells = nullptr;
+
+		m_capacity = 0;
+		m_builtNum = -1;
+
 // 		if (m_scan != nullptr)
 // 		{
 // 			delete m_scan;
@@ -25,6 +25,26 @@ namespace PhysIKA{
 
 		void construct(DeviceArray<Coord>& pos);
 
+		/**
+		 * @brief Re-bin only the particles whose cell changed since the last construct() or update()
+		 *
+		 * Moved particles are removed from the cell-sorted ids and merged back at their new cells, the cell counts are
+		 * adjusted for them only. Falls back to construct() when the particle number or the space changed,
+		 * or when more than the update threshold of the particles moved.
+		 */
+		void update(DeviceArray<Coord>& pos);
+
+		/**
+		 * @brief Fraction of moved particles above which update() rebuilds the whole grid
+		 */
+		void setUpdateThreshold(Real threshold) { m_updateThreshold = threshold; }
+
+		/// Number of particles that changed their cell during the last update()
+		int getMovedNum() { return m_movedNum; }
+
+		/// Make the next update() construct the grid from scratch, e.g. after the particles were permuted
+		void invalidate() { m_builtNum = -1; }
+
 		void clear();
 
 		void release();
@@ -83,11 +103,32 @@ namespace PhysIKA{
 		//int npMax;		//maximum particle number for each cell
 
 		int* ids = nullptr;
-		int* counter = nullptr;
+		int* counter = nullptr;		//!< number of particles per cell once constructed
 		int* index = nullptr;
 
+		int* cellIds = nullptr;		//!< cell of each particle at the last build, INVALID outside of the grid
+		int* sortedCells = nullptr;	//!< cell of each entry of ids
+
 		Scan* m_scan = nullptr;
 		Reduction<int>* m_reduce = nullptr;
+
+	private:
+		/// Make room for pNum particles in the per-particle arrays, they only grow
+		void reserve(int pNum);
+
+		int m_capacity = 0;
+		int m_builtNum = -1;		//!< particle number of the last build, -1 if the grid has to be constructed
+		int m_movedNum = 0;
+		Real m_updateThreshold = Real(0.1);
+
+		//Scratch of update()
+		int* m_newCellIds = nullptr;
+		int* m_flags = nullptr;
+		int* m_stencil = nullptr;
+		int* m_movedIds = nullptr;
+		int* m_movedCells = nullptr;
+		int* m_mergedIds = nullptr;
+		int* m_mergedCells = nullptr;
 	};
 
 #ifdef PRECISION_FLOAT
@@ -0,0 +1,119 @@
+#include "HostGridHash.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Core/Utility/HostScan.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+namespace PhysIKA{
+
+	template<typename TDataType>
+	HostGridHash<TDataType>::HostGridHash()
+	{
+	}
+
+	template<typename TDataType>
+	HostGridHash<TDataType>::~HostGridHash()
+	{
+	}
+
+	template<typename TDataType>
+	void HostGridHash<TDataType>::setSpace(Real _h, Coord _lo, Coord _hi)
+	{
+		release();
+
+		int padding = 2;
+		ds = _h;
+		lo = _lo - padding*ds;
+
+		Coord nSeg = (_hi - _lo) / ds;
+
+		nx = ceil(nSeg[0]) + 1 + 2 * padding;
+		ny = ceil(nSeg[1]) + 1 + 2 * padding;
+		nz = ceil(nSeg[2]) + 1 + 2 * padding;
+		hi = lo + Coord(nx, ny, nz)*ds;
+
+		num = nx*ny*nz;
+
+		index.assign(num + 1, 0);
+	}
+
+	template<typename TDataType>
+	void HostGridHash<TDataType>::construct(HostArray<Coord>& pos)
+	{
+		construct(pos.getDataPtr(), pos.size());
+	}
+
+	template<typename TDataType>
+	void HostGridHash<TDataType>::construct(const Coord* pos, int pNum)
+	{
+		ThreadPool& pool = ThreadPool::getInstance();
+
+		m_cellIds.resize(pNum);
+
+		std::unique_ptr<std::atomic<int>[]> counter(new std::atomic<int>[num]);
+		pool.parallelFor(0, num, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+				counter[i].store(0, std::memory_order_relaxed);
+		}, 4096);
+
+		pool.parallelFor(0, pNum, [&](int begin, int end) {
+			for (int pId = begin; pId < end; pId++)
+			{
+				int gId = getIndex(pos[pId]);
+				m_cellIds[pId] = gId;
+				if (gId != INVALID)
+					counter[gId].fetch_add(1, std::memory_order_relaxed);
+			}
+		}, 1024);
+
+		pool.parallelFor(0, num, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+				index[i] = counter[i].load(std::memory_order_relaxed);
+		}, 4096);
+		index[num] = 0;
+
+		particle_num = HostScan::exclusive(index.data(), num + 1);
+		ids.resize(particle_num);
+
+		//Reuse the counters as insertion cursors
+		pool.parallelFor(0, num, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+				counter[i].store(index[i], std::memory_order_relaxed);
+		}, 4096);
+
+		pool.parallelFor(0, pNum, [&](int begin, int end) {
+			for (int pId = begin; pId < end; pId++)
+			{
+				int gId = m_cellIds[pId];
+				if (gId != INVALID)
+					ids[counter[gId].fetch_add(1, std::memory_order_relaxed)] = pId;
+			}
+		}, 1024);
+
+		pool.parallelFor(0, num, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				if (index[i + 1] - index[i] > 1)
+					std::sort(ids.begin() + index[i], ids.begin() + index[i + 1]);
+			}
+		}, 4096);
+	}
+
+	template<typename TDataType>
+	void HostGridHash<TDataType>::clear()
+	{
+		std::fill(index.begin(), index.end(), 0);
+		particle_num = 0;
+	}
+
+	template<typename TDataType>
+	void HostGridHash<TDataType>::release()
+	{
+		ids.clear();
+		index.clear();
+		m_cellIds.clear();
+		particle_num = 0;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "Core/DataTypes.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/GridHash.h"
+#include <vector>
+
+namespace PhysIKA{
+
+	/*!
+	*	\class	HostGridHash
+	*	\brief	Host counterpart of GridHash with the same cell layout, built by a parallel counting sort.
+	*
+	*	Particles of a cell are stored in ascending order, so the result does not depend on the thread schedule.
+	*/
+	template<typename TDataType>
+	class HostGridHash
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		HostGridHash();
+		~HostGridHash();
+
+		void setSpace(Real _h, Coord _lo, Coord _hi);
+
+		void construct(HostArray<Coord>& pos);
+		void construct(const Coord* pos, int pNum);
+
+		void clear();
+
+		void release();
+
+		inline int getIndex(int i, int j, int k)
+		{
+			if (i < 0 || i >= nx) return INVALID;
+			if (j < 0 || j >= ny) return INVALID;
+			if (k < 0 || k >= nz) return INVALID;
+
+			return i + j*nx + k*nx*ny;
+		}
+
+		inline int getIndex(Coord pos)
+		{
+			int i = floor((pos[0] - lo[0]) / ds);
+			int j = floor((pos[1] - lo[1]) / ds);
+			int k = floor((pos[2] - lo[2]) / ds);
+
+			return getIndex(i, j, k);
+		}
+
+		inline int3 getIndex3(Coord pos)
+		{
+			int i = floor((pos[0] - lo[0]) / ds);
+			int j = floor((pos[1] - lo[1]) / ds);
+			int k = floor((pos[2] - lo[2]) / ds);
+
+			return make_int3(i, j, k);
+		}
+
+		inline int getCounter(int gId) { return index[gId + 1] - index[gId]; }
+
+		inline int getParticleId(int gId, int n) { return ids[index[gId] + n]; }
+
+	public:
+		int num = 0;
+		int nx = 0, ny = 0, nz = 0;
+
+		int particle_num = 0;
+
+		Real ds;
+
+		Coord lo;
+		Coord hi;
+
+		std::vector<int> ids;
+		std::vector<int> index;		//num + 1 entries, the last one equals particle_num
+
+	private:
+		std::vector<int> m_cellIds;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class HostGridHash<DataType3f>;
+#else
+	template class HostGridHash<DataType3d>;
+#endif
+}
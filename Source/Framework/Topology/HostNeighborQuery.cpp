@@ -0,0 +1,172 @@
+#include "HostNeighborQuery.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Core/Utility/HostScan.h"
+#include "Framework/Topology/KNearestHeap.h"
+#include <vector>
+
+namespace PhysIKA
+{
+	//Same visiting order of the cells as the CUDA kernels
+	static const int hostOffset[27][3] = { 0, 0, 0,
+		0, 0, 1,
+		0, 1, 0,
+		1, 0, 0,
+		0, 0, -1,
+		0, -1, 0,
+		-1, 0, 0,
+		0, 1, 1,
+		0, 1, -1,
+		0, -1, 1,
+		0, -1, -1,
+		1, 0, 1,
+		1, 0, -1,
+		-1, 0, 1,
+		-1, 0, -1,
+		1, 1, 0,
+		1, -1, 0,
+		-1, 1, 0,
+		-1, -1, 0,
+		1, 1, 1,
+		1, 1, -1,
+		1, -1, 1,
+		-1, 1, 1,
+		1, -1, -1,
+		-1, 1, -1,
+		-1, -1, 1,
+		-1, -1, -1
+	};
+
+	template<typename TDataType>
+	HostNeighborQuery<TDataType>::HostNeighborQuery()
+		: m_position(nullptr)
+		, m_half(false)
+	{
+	}
+
+	template<typename TDataType>
+	HostNeighborQuery<TDataType>::~HostNeighborQuery()
+	{
+		m_hash.release();
+	}
+
+	template<typename TDataType>
+	void HostNeighborQuery<TDataType>::setSpace(Real h, Coord lo, Coord hi)
+	{
+		m_hash.setSpace(h, lo, hi);
+	}
+
+	template<typename TDataType>
+	void HostNeighborQuery<TDataType>::construct(HostArray<Coord>& pos)
+	{
+		m_position = pos.getDataPtr();
+		m_hash.construct(pos);
+	}
+
+	template<typename TDataType>
+	template<typename Func>
+	void HostNeighborQuery<TDataType>::forEachNeighbor(const Coord& pos_i, Real h, Func func)
+	{
+		int3 gId3 = m_hash.getIndex3(pos_i);
+		for (int c = 0; c < 27; c++)
+		{
+			int cId = m_hash.getIndex(gId3.x + hostOffset[c][0], gId3.y + hostOffset[c][1], gId3.z + hostOffset[c][2]);
+			if (cId >= 0) {
+				int totalNum = m_hash.getCounter(cId);
+				for (int i = 0; i < totalNum; i++) {
+					int nbId = m_hash.getParticleId(cId, i);
+					Real d_ij = (pos_i - m_position[nbId]).norm();
+					if (d_ij < h)
+					{
+						func(nbId, d_ij);
+					}
+				}
+			}
+		}
+	}
+
+	template<typename TDataType>
+	void HostNeighborQuery<TDataType>::queryNeighbors(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, Real h)
+	{
+		if (nbrList.size() != queryPos.size())
+			nbrList.resize(queryPos.size(), nbrList.getNeighborLimit());
+
+		if (!nbrList.isLimited())
+		{
+			queryNeighborDynamic(nbrList, queryPos, h);
+		}
+		else
+		{
+			queryNeighborFixed(nbrList, queryPos, h);
+		}
+	}
+
+	template<typename TDataType>
+	void HostNeighborQuery<TDataType>::queryKNearest(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, int k, Real maxRadius)
+	{
+		if (nbrList.size() != queryPos.size() || nbrList.getNeighborLimit() != k)
+			nbrList.resize(queryPos.size(), k);
+
+		queryNeighborFixed(nbrList, queryPos, maxRadius);
+	}
+
+	template<typename TDataType>
+	void HostNeighborQuery<TDataType>::queryNeighborDynamic(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, Real h)
+	{
+		int num = queryPos.size();
+		HostArray<int>& index = nbrList.getIndex();
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		pool.parallelFor(0, num, [&](int begin, int end) {
+			for (int pId = begin; pId < end; pId++)
+			{
+				int counter = 0;
+				forEachNeighbor(queryPos[pId], h, [&](int nbId, Real d_ij) { if (!m_half || nbId > pId) counter++; });
+				index[pId] = counter;
+			}
+		}, 256);
+
+		int sum = HostScan::exclusive(index.getDataPtr(), num);
+
+		HostArray<int>& elements = nbrList.getElements();
+		if (sum > 0)
+		{
+			if (elements.size() != sum)
+				elements.resize(sum);
+
+			pool.parallelFor(0, num, [&](int begin, int end) {
+				for (int pId = begin; pId < end; pId++)
+				{
+					int* nbrs = elements.getDataPtr() + index[pId];
+					int j = 0;
+					forEachNeighbor(queryPos[pId], h, [&](int nbId, Real d_ij) { if (!m_half || nbId > pId) nbrs[j++] = nbId; });
+				}
+			}, 256);
+		}
+		else
+		{
+			elements.release();
+		}
+	}
+
+	template<typename TDataType>
+	void HostNeighborQuery<TDataType>::queryNeighborFixed(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, Real h)
+	{
+		int num = queryPos.size();
+		int nbrLimit = nbrList.getNeighborLimit();
+
+		//The heap of a query lives in the elements of its list, only the distances need scratch per chunk
+		ThreadPool::getInstance().parallelFor(0, num, [&](int begin, int end) {
+			std::vector<Real> distance(nbrLimit);
+			for (int pId = begin; pId < end; pId++)
+			{
+				int* ids = nbrList.getElements().getDataPtr() + pId * nbrLimit;
+
+				KNearestHeap<Real> heap(ids, distance.data(), nbrLimit);
+				searchKNearest(heap, m_hash, m_position, queryPos[pId], h, m_half ? pId : -1);
+				heap.sort();
+
+				nbrList.setNeighborSize(pId, heap.size());
+			}
+		}, 256);
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Framework/Topology/HostGridHash.h"
+#include "Framework/Topology/NeighborList.h"
+
+namespace PhysIKA {
+
+	/*!
+	*	\class	HostNeighborQuery
+	*	\brief	Multithreaded fixed-radius neighbor search on the host.
+	*
+	*	Produces the same NeighborList layout as the CUDA path of NeighborQuery:
+	*	prefix sums in the index for dynamic lists, neighbor counts for lists with a neighbor limit.
+	*/
+	template<typename TDataType>
+	class HostNeighborQuery
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		HostNeighborQuery();
+		~HostNeighborQuery();
+
+		void setSpace(Real h, Coord lo, Coord hi);
+
+		/**
+		 * @brief Hash the points that are searched, they must stay valid until the queries are done
+		 */
+		void construct(HostArray<Coord>& pos);
+
+		/**
+		 * @brief Find the hashed points within distance h of each query point
+		 */
+		void queryNeighbors(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, Real h);
+
+		/**
+		 * @brief Find the k closest hashed points within maxRadius of each query point, sorted by ascending distance
+		 *
+		 * The cells are searched in growing rings, so maxRadius may be larger than the cell size.
+		 */
+		void queryKNearest(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, int k, Real maxRadius);
+
+		/**
+		 * @brief Keep only neighbors with a larger id than the query point, each pair is then stored once.
+		 *	Only meaningful when the query points are the hashed points.
+		 */
+		void setHalfList(bool half) { m_half = half; }
+		bool isHalfList() { return m_half; }
+
+		HostGridHash<TDataType>& getHash() { return m_hash; }
+
+	private:
+		void queryNeighborDynamic(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, Real h);
+		void queryNeighborFixed(HostNeighborList<int>& nbrList, HostArray<Coord>& queryPos, Real h);
+
+		template<typename Func>
+		void forEachNeighbor(const Coord& pos_i, Real h, Func func);
+
+		HostGridHash<TDataType> m_hash;
+		Coord* m_position;
+		bool m_half;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class HostNeighborQuery<DataType3f>;
+#else
+	template class HostNeighborQuery<DataType3d>;
+#endif
+}
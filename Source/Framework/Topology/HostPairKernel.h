@@ -0,0 +1,55 @@
+#pragma once
+#include "Core/Array/Array.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Framework/Topology/NeighborList.h"
+#include <vector>
+#include <algorithm>
+
+namespace PhysIKA
+{
+	/**
+	 * @brief Call action(i, j, result_i, result_j) once for every pair (i, j) of a half neighbor list (j > i) on the ThreadPool
+	 *
+	 * Every chunk of owners accumulates into its own buffer initialized with zero, the buffers are summed into result
+	 * afterwards, so no two threads write the same entry. The buffers take one array per worker.
+	 */
+	template<typename T, typename Action>
+	void applyPairsOnHost(HostNeighborList<int>& halfList, HostArray<T>& result, Action action, T zero)
+	{
+		int num = halfList.size();
+		if (num <= 0) return;
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		int chunkNum = std::max(1, std::min((int)pool.getThreadNum(), num));
+
+		std::vector<std::vector<T>> buffers(chunkNum, std::vector<T>(result.size(), zero));
+
+		pool.parallelFor(0, chunkNum, [&](int begin, int end) {
+			for (int c = begin; c < end; c++)
+			{
+				std::vector<T>& buffer = buffers[c];
+				int first = (int)((long long)num * c / chunkNum);
+				int last = (int)((long long)num * (c + 1) / chunkNum);
+				for (int i = first; i < last; i++)
+				{
+					int nbSize = halfList.getNeighborSize(i);
+					for (int ne = 0; ne < nbSize; ne++)
+					{
+						int j = halfList.getElement(i, ne);
+						action(i, j, buffer[i], buffer[j]);
+					}
+				}
+			}
+		}, 1);
+
+		pool.parallelFor(0, result.size(), [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				for (int c = 0; c < chunkNum; c++)
+				{
+					result[i] += buffers[c][i];
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,126 @@
+#include <cuda_runtime.h>
+#include "HybridNeighborList.h"
+#include "Core/Utility.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/execution_policy.h>
+
+namespace PhysIKA
+{
+	//Initial overflow pool size per element, the pool only grows afterwards
+#define HYBRID_OVERFLOW_RESERVE 4
+
+	void HybridNeighborList::resize(int n, int inlineNum)
+	{
+		if (m_count.size() != n || m_inlineNum != inlineNum)
+		{
+			m_inlineNum = inlineNum;
+			m_count.resize(n);
+			m_overflowStart.resize(n);
+			m_inline.resize(n * inlineNum);
+		}
+
+		if (m_overflowTop.size() != 1)
+		{
+			m_overflowTop.resize(1);
+		}
+
+		if (m_overflow.size() < n * HYBRID_OVERFLOW_RESERVE)
+		{
+			m_overflow.resize(n * HYBRID_OVERFLOW_RESERVE);
+		}
+	}
+
+	void HybridNeighborList::beginFill()
+	{
+		m_overflowTop.reset();
+	}
+
+	bool HybridNeighborList::endFill()
+	{
+		int top = 0;
+		cuSafeCall(cudaMemcpy(&top, m_overflowTop.getDataPtr(), sizeof(int), cudaMemcpyDeviceToHost));
+		m_overflowNum = top;
+
+		if (top <= m_overflow.size())
+		{
+			return true;
+		}
+
+		m_overflow.resize(top + top / 2);
+		return false;
+	}
+
+	__global__ void K_HybridNeighborSize(
+		DeviceArray<int> count,
+		HybridNeighborList nbr)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= count.size()) return;
+
+		count[pId] = nbr.getNeighborSize(pId);
+	}
+
+	__global__ void K_DecodeHybridNeighbors(
+		NeighborList<int> dst,
+		HybridNeighborList src)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= src.size()) return;
+
+		int nbSize = src.getNeighborSize(pId);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			dst.setElement(pId, ne, src.getElement(pId, ne));
+		}
+	}
+
+	void HybridNeighborList::decode(NeighborList<int>& nbr)
+	{
+		int num = size();
+		if (num <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		nbr.resize(num);
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_HybridNeighborSize << <pDims, BLOCK_SIZE >> > (nbr.getIndex(), *this);
+		cuSynchronize();
+
+		DeviceArray<int>& index = nbr.getIndex();
+		int total = thrust::reduce(thrust::device, index.getDataPtr(), index.getDataPtr() + num, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + num, index.getDataPtr());
+		if (total == 0)
+		{
+			nbr.getElements().release();
+			return;
+		}
+
+		nbr.getElements().resize(total);
+		K_DecodeHybridNeighbors << <pDims, BLOCK_SIZE >> > (nbr, *this);
+		cuSynchronize();
+	}
+
+	void HybridNeighborList::release()
+	{
+		m_count.release();
+		m_inline.release();
+		m_overflowStart.release();
+		m_overflow.release();
+		m_overflowTop.release();
+		m_inlineNum = 0;
+		m_overflowNum = 0;
+	}
+
+	size_t HybridNeighborList::getMemorySize()
+	{
+		return m_count.size() * sizeof(int)
+			+ m_inline.size() * sizeof(int)
+			+ m_overflowStart.size() * sizeof(int)
+			+ m_overflow.size() * sizeof(int)
+			+ m_overflowTop.size() * sizeof(int);
+	}
+}
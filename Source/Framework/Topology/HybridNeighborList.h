@@ -0,0 +1,97 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/NeighborList.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	HybridNeighborList
+	*	\brief	Neighbor list with a small inline capacity per element and a shared overflow pool for dense regions.
+	*
+	*	The first getInlineCapacity() neighbors of an element are stored inline, the remaining ones in a contiguous
+	*	range of the pool reserved by the filling thread itself, so the list is filled in a single pass without counting
+	*	the neighbors first. Nothing is truncated: when the pool is exhausted, endFill() grows it and the fill is repeated.
+	*/
+	class HybridNeighborList
+	{
+	public:
+		HybridNeighborList() {};
+		~HybridNeighborList() {};
+
+		COMM_FUNC int size() { return m_count.size(); }
+
+		COMM_FUNC int getNeighborSize(int i) { return m_count[i]; }
+
+		COMM_FUNC int getInlineCapacity() { return m_inlineNum; }
+
+		COMM_FUNC int getElement(int i, int j)
+		{
+			if (j < m_inlineNum)
+				return m_inline[i * m_inlineNum + j];
+			return m_overflow[m_overflowStart[i] + j - m_inlineNum];
+		}
+
+		COMM_FUNC void setElement(int i, int j, int elem)
+		{
+			if (j < m_inlineNum)
+				m_inline[i * m_inlineNum + j] = elem;
+			else
+				m_overflow[m_overflowStart[i] + j - m_inlineNum] = elem;
+		}
+
+		COMM_FUNC void setNeighborSize(int i, int num) { m_count[i] = num; }
+
+		/**
+		 * @brief Assign the pool range reserved for the neighbors of element i beyond the inline capacity
+		 *
+		 * Returns false when the range exceeds the pool, the element must not store its overflow then.
+		 * Ranges are reserved by an atomic add of their length to getOverflowTop().
+		 */
+		COMM_FUNC bool setOverflowStart(int i, int start, int num)
+		{
+			m_overflowStart[i] = start;
+			return start + num <= m_overflow.size();
+		}
+
+		/// Device counter of the reserved pool entries
+		COMM_FUNC int* getOverflowTop() { return &m_overflowTop[0]; }
+
+		/**
+		 * @brief Allocate n elements with inlineNum inline slots each
+		 */
+		void resize(int n, int inlineNum);
+
+		/// Empty the overflow pool before filling the list
+		void beginFill();
+
+		/**
+		 * @brief Returns false when the pool was too small, it is grown and the list has to be filled again
+		 */
+		bool endFill();
+
+		/**
+		 * @brief Copy into a dynamic neighbor list
+		 */
+		void decode(NeighborList<int>& nbr);
+
+		void release();
+
+		/// Number of neighbors stored in the overflow pool by the last fill
+		int getOverflowElementCount() { return m_overflowNum; }
+
+		/// Bytes used by the list
+		size_t getMemorySize();
+
+	private:
+		int m_inlineNum = 0;
+		int m_overflowNum = 0;
+
+		DeviceArray<int> m_count;
+		DeviceArray<int> m_inline;
+
+		DeviceArray<int> m_overflowStart;
+		DeviceArray<int> m_overflow;
+		DeviceArray<int> m_overflowTop;
+	};
+}
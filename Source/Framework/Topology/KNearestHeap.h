@@ -0,0 +1,160 @@
+#pragma once
+#include "Core/Platform.h"
+#include <cmath>
+
+namespace PhysIKA
+{
+	//Neighbor limit up to which the heap of a GPU query is kept in local memory
+#define KNN_LOCAL_CAPACITY 64
+
+	/*!
+	*	\class	KNearestHeap
+	*	\brief	Bounded max-heap on distances keeping the k closest candidates of one query.
+	*
+	*	The storage is provided by the caller, on the GPU it usually lives in registers or local memory.
+	*	Insertion is O(log k), the farthest kept candidate is always at the root.
+	*/
+	template<typename Real>
+	class KNearestHeap
+	{
+	public:
+		COMM_FUNC KNearestHeap(int* ids, Real* distance, int capacity)
+			: m_ids(ids)
+			, m_distance(distance)
+			, m_capacity(capacity)
+			, m_size(0)
+		{
+		}
+
+		COMM_FUNC int size() { return m_size; }
+
+		COMM_FUNC bool isFull() { return m_size >= m_capacity; }
+
+		COMM_FUNC Real maxDistance() { return m_distance[0]; }
+
+		COMM_FUNC void insert(int id, Real d)
+		{
+			if (m_size < m_capacity)
+			{
+				int i = m_size++;
+				while (i > 0)
+				{
+					int parent = (i - 1) / 2;
+					if (m_distance[parent] >= d) break;
+
+					m_ids[i] = m_ids[parent];
+					m_distance[i] = m_distance[parent];
+					i = parent;
+				}
+				m_ids[i] = id;
+				m_distance[i] = d;
+			}
+			else if (m_capacity > 0 && d < m_distance[0])
+			{
+				siftDown(0, m_size, id, d);
+			}
+		}
+
+		/**
+		 * @brief Sort the kept candidates by ascending distance, the heap must not be used afterwards
+		 */
+		COMM_FUNC void sort()
+		{
+			for (int last = m_size - 1; last > 0; last--)
+			{
+				int id = m_ids[last];
+				Real d = m_distance[last];
+				m_ids[last] = m_ids[0];
+				m_distance[last] = m_distance[0];
+				siftDown(0, last, id, d);
+			}
+		}
+
+		COMM_FUNC int getId(int i) { return m_ids[i]; }
+		COMM_FUNC Real getDistance(int i) { return m_distance[i]; }
+
+	private:
+		/// Place (id, d) at slot i of a heap of n entries and move it down to its position
+		COMM_FUNC void siftDown(int i, int n, int id, Real d)
+		{
+			while (true)
+			{
+				int child = 2 * i + 1;
+				if (child >= n) break;
+				if (child + 1 < n && m_distance[child + 1] > m_distance[child]) child++;
+				if (m_distance[child] <= d) break;
+
+				m_ids[i] = m_ids[child];
+				m_distance[i] = m_distance[child];
+				i = child;
+			}
+			m_ids[i] = id;
+			m_distance[i] = d;
+		}
+
+		int* m_ids;
+		Real* m_distance;
+		int m_capacity;
+		int m_size;
+	};
+
+	/**
+	 * @brief Collect the points closer than maxRadius into heap, visiting the cells of hash in rings of growing size
+	 *
+	 * A ring is the shell of cells at a Chebyshev distance r from the cell of pos. Points beyond ring r are at least
+	 * r cells away, so the search stops as soon as the heap is full and its farthest candidate is within that distance.
+	 * Only points with an id larger than minId are considered.
+	 */
+	template<typename Real, typename Coord, typename Hash, typename Points>
+	COMM_FUNC void searchKNearest(KNearestHeap<Real>& heap, Hash& hash, Points& points, Coord pos, Real maxRadius, int minId = -1)
+	{
+		int3 c = hash.getIndex3(pos);
+
+		//The last ring that can contain a point within maxRadius or a cell of the grid
+		int ringNum = (int)ceil(maxRadius / hash.ds);
+		int extent = 0;
+		extent = c.x > extent ? c.x : extent;
+		extent = c.y > extent ? c.y : extent;
+		extent = c.z > extent ? c.z : extent;
+		extent = hash.nx - 1 - c.x > extent ? hash.nx - 1 - c.x : extent;
+		extent = hash.ny - 1 - c.y > extent ? hash.ny - 1 - c.y : extent;
+		extent = hash.nz - 1 - c.z > extent ? hash.nz - 1 - c.z : extent;
+		ringNum = ringNum < extent ? ringNum : extent;
+
+		for (int r = 0; r <= ringNum; r++)
+		{
+			for (int k = -r; k <= r; k++)
+			{
+				for (int j = -r; j <= r; j++)
+				{
+					//Inside the shell only the two faces along x belong to the ring
+					bool onShell = (k == -r || k == r || j == -r || j == r);
+					int step = (onShell || r == 0) ? 1 : 2 * r;
+					for (int i = -r; i <= r; i += step)
+					{
+						int cId = hash.getIndex(c.x + i, c.y + j, c.z + k);
+						if (cId < 0) continue;
+
+						int totalNum = hash.getCounter(cId);
+						for (int n = 0; n < totalNum; n++)
+						{
+							int nbId = hash.getParticleId(cId, n);
+							if (nbId <= minId) continue;
+
+							Real d = (pos - points[nbId]).norm();
+							if (d < maxRadius)
+							{
+								heap.insert(nbId, d);
+							}
+						}
+					}
+				}
+			}
+
+			if (heap.isFull() && heap.maxDistance() <= r * hash.ds)
+			{
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,902 @@
+#include <cuda_runtime.h>
+#include "LinearBVH.h"
+#include "Core/Utility.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Core/Utility/HostScan.h"
+#include "Core/Utility/HostSort.h"
+#include "Framework/Framework/Log.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/fill.h>
+#include <thrust/execution_policy.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cfloat>
+
+namespace PhysIKA
+{
+	template<typename Coord>
+	struct BVHCoordMinimum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.minimum(b); }
+	};
+
+	template<typename Coord>
+	struct BVHCoordMaximum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.maximum(b); }
+	};
+
+	COMM_FUNC inline int countLeadingZeros(unsigned long long x)
+	{
+#ifdef __CUDA_ARCH__
+		return __clzll(x);
+#else
+		if (x == 0) return 64;
+		int n = 0;
+		if ((x >> 32) == 0) { n += 32; x <<= 32; }
+		if ((x >> 48) == 0) { n += 16; x <<= 16; }
+		if ((x >> 56) == 0) { n += 8; x <<= 8; }
+		if ((x >> 60) == 0) { n += 4; x <<= 4; }
+		if ((x >> 62) == 0) { n += 2; x <<= 2; }
+		if ((x >> 63) == 0) { n += 1; }
+		return n;
+#endif
+	}
+
+	/// Spread the lower 10 bits of v so that two zero bits follow each of them
+	COMM_FUNC inline unsigned int expandBits(unsigned int v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	/**
+	 * @brief Morton code of the primitive center extended by the primitive id
+	 */
+	template<typename TDataType>
+	COMM_FUNC unsigned long long computeMortonKey(BVHView<TDataType>& view, int prim, typename TDataType::Coord lo, typename TDataType::Coord hi)
+	{
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		BVHBox<TDataType> box = view.getPrimitiveBox(prim);
+		Coord center = (box.lo + box.hi) * Real(0.5);
+
+		unsigned int code = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			Real extent = hi[i] - lo[i];
+			Real x = extent > Real(0) ? (center[i] - lo[i]) / extent : Real(0);
+			x = x * Real(1024);
+			x = x < Real(0) ? Real(0) : (x > Real(1023) ? Real(1023) : x);
+			code |= expandBits((unsigned int)x) << (2 - i);
+		}
+
+		return ((unsigned long long)code << 32) | (unsigned int)prim;
+	}
+
+	/// Length of the common prefix of keys i and j, -1 if j is out of range
+	COMM_FUNC inline int commonPrefix(const unsigned long long* keys, int n, int i, int j)
+	{
+		if (j < 0 || j >= n) return -1;
+		return countLeadingZeros(keys[i] ^ keys[j]);
+	}
+
+	/**
+	 * @brief Children of internal node i from the range of sorted keys it covers and the split position within it
+	 */
+	COMM_FUNC inline void buildInternalNode(int i, const unsigned long long* keys, int n, int* left, int* right, int* parent)
+	{
+		//Direction of the range
+		int d = commonPrefix(keys, n, i, i + 1) - commonPrefix(keys, n, i, i - 1) > 0 ? 1 : -1;
+
+		//Upper bound of the range length, then its exact end
+		int minPrefix = commonPrefix(keys, n, i, i - d);
+		int lMax = 2;
+		while (commonPrefix(keys, n, i, i + lMax * d) > minPrefix)
+		{
+			lMax *= 2;
+		}
+
+		int l = 0;
+		for (int t = lMax / 2; t >= 1; t /= 2)
+		{
+			if (commonPrefix(keys, n, i, i + (l + t) * d) > minPrefix)
+				l += t;
+		}
+		int j = i + l * d;
+
+		//Split position by binary search for the highest differing bit
+		int nodePrefix = commonPrefix(keys, n, i, j);
+		int s = 0;
+		for (int div = 2; ; div *= 2)
+		{
+			int t = (l + div - 1) / div;
+			if (commonPrefix(keys, n, i, i + (s + t) * d) > nodePrefix)
+				s += t;
+			if (t <= 1) break;
+		}
+		int gamma = i + s * d + (d < 0 ? d : 0);
+
+		int first = i < j ? i : j;
+		int last = i < j ? j : i;
+		int leafOffset = n - 1;
+		int l0 = first == gamma ? leafOffset + gamma : gamma;
+		int r0 = last == gamma + 1 ? leafOffset + gamma + 1 : gamma + 1;
+
+		left[i] = l0;
+		right[i] = r0;
+		parent[l0] = i;
+		parent[r0] = i;
+	}
+
+	template<typename TDataType>
+	LinearBVH<TDataType>::LinearBVH()
+		: m_deviceType(DeviceType::GPU)
+		, m_primitiveNum(0)
+		, m_vertexNum(1)
+	{
+	}
+
+	template<typename TDataType>
+	LinearBVH<TDataType>::~LinearBVH()
+	{
+	}
+
+	template<typename TDataType>
+	BVHView<TDataType> LinearBVH<TDataType>::getView()
+	{
+		BVHView<TDataType> view;
+		view.boxes = m_boxes.getDataPtr();
+		view.left = m_left.getDataPtr();
+		view.right = m_right.getDataPtr();
+		view.primitives = m_primitives.getDataPtr();
+		view.vertices = m_vertices.getDataPtr();
+		view.primitiveVertices = m_primitiveVertices.getDataPtr();
+		view.vertexNum = m_vertexNum;
+		view.primitiveNum = m_primitiveNum;
+		return view;
+	}
+
+	template<typename TDataType>
+	BVHView<TDataType> LinearBVH<TDataType>::getHostView()
+	{
+		BVHView<TDataType> view;
+		view.boxes = m_hostBoxes.getDataPtr();
+		view.left = m_hostLeft.getDataPtr();
+		view.right = m_hostRight.getDataPtr();
+		view.primitives = m_hostPrimitives.getDataPtr();
+		view.vertices = m_hostVertices.getDataPtr();
+		view.primitiveVertices = m_hostPrimitiveVertices.getDataPtr();
+		view.vertexNum = m_vertexNum;
+		view.primitiveNum = m_primitiveNum;
+		return view;
+	}
+
+	__global__ void K_SequencePrimitiveVertices(DeviceArray<int> ids)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= ids.size()) return;
+
+		ids[pId] = pId;
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::build(DeviceArray<Coord>& points)
+	{
+		build(points, nullptr, points.size(), 1);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::build(DeviceArray<Coord>& points, DeviceArray<Edge>& edges)
+	{
+		static_assert(sizeof(Edge) == 2 * sizeof(int), "Edges are read as pairs of vertex ids");
+		build(points, (int*)edges.getDataPtr(), edges.size(), 2);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::build(DeviceArray<Coord>& points, DeviceArray<Triangle>& triangles)
+	{
+		static_assert(sizeof(Triangle) == 3 * sizeof(int), "Triangles are read as triples of vertex ids");
+		build(points, (int*)triangles.getDataPtr(), triangles.size(), 3);
+	}
+
+	template<typename TDataType>
+	__global__ void K_ComputeMortonKeys(
+		DeviceArray<unsigned long long> keys,
+		BVHView<TDataType> view,
+		typename TDataType::Coord lo,
+		typename TDataType::Coord hi)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= keys.size()) return;
+
+		keys[pId] = computeMortonKey(view, pId, lo, hi);
+	}
+
+	__global__ void K_BuildInternalNodes(
+		DeviceArray<unsigned long long> keys,
+		DeviceArray<int> primitives,
+		DeviceArray<int> left,
+		DeviceArray<int> right,
+		DeviceArray<int> parent)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		int n = keys.size();
+		if (pId >= n) return;
+
+		primitives[pId] = (int)(keys[pId] & 0xFFFFFFFFull);
+		if (pId == 0) parent[0] = -1;
+
+		if (pId < n - 1)
+		{
+			buildInternalNode(pId, &keys[0], n, &left[0], &right[0], &parent[0]);
+		}
+	}
+
+	template<typename TDataType>
+	__global__ void K_ComputeLeafBoxes(BVHView<TDataType> view)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= view.primitiveNum) return;
+
+		view.boxes[view.primitiveNum - 1 + pId] = view.getPrimitiveBox(view.primitives[pId]);
+	}
+
+	/**
+	 * @brief Read a box written by another thread of the same launch, bypassing the non-coherent L1 cache
+	 */
+	template<typename TDataType>
+	__device__ BVHBox<TDataType> loadBoxVolatile(const BVHBox<TDataType>* boxes, int id)
+	{
+		typedef typename TDataType::Real Real;
+		static_assert(sizeof(BVHBox<TDataType>) == 6 * sizeof(Real), "Boxes are read as six scalars");
+
+		const volatile Real* v = reinterpret_cast<const volatile Real*>(boxes + id);
+		BVHBox<TDataType> box;
+		for (int i = 0; i < 3; i++)
+		{
+			box.lo[i] = v[i];
+			box.hi[i] = v[3 + i];
+		}
+		return box;
+	}
+
+	/**
+	 * @brief Walk up from each leaf, the second thread arriving at a node merges the boxes of its children
+	 *
+	 * The fence publishes the box written below before the flag is raised, the child boxes are then loaded
+	 * through volatile pointers as the one written by the other thread may not be in the L1 cache of this one.
+	 */
+	template<typename TDataType>
+	__global__ void K_RefitInternalNodes(
+		BVHView<TDataType> view,
+		DeviceArray<int> parent,
+		DeviceArray<int> flags)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= view.primitiveNum) return;
+
+		int node = view.primitiveNum - 1 + pId;
+		while (node != 0)
+		{
+			node = parent[node];
+
+			__threadfence();
+			if (atomicAdd(&flags[node], 1) == 0) return;
+
+			BVHBox<TDataType> box = loadBoxVolatile(view.boxes, view.left[node]);
+			box.merge(loadBoxVolatile(view.boxes, view.right[node]));
+			view.boxes[node] = box;
+		}
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::build(DeviceArray<Coord>& points, int* primitiveVertices, int primitiveNum, int vertexNum)
+	{
+		m_primitiveNum = primitiveNum;
+		m_vertexNum = vertexNum;
+		if (primitiveNum <= 0 || points.size() <= 0)
+		{
+			m_primitiveNum = 0;
+			return;
+		}
+
+		int n = primitiveNum;
+		int nodeNum = 2 * n - 1;
+		int internalNum = n > 1 ? n - 1 : 1;
+
+		if (m_vertices.size() != points.size())
+			m_vertices.resize(points.size());
+		Function1Pt::copy(m_vertices, points);
+
+		if (m_primitiveVertices.size() != n * vertexNum)
+			m_primitiveVertices.resize(n * vertexNum);
+		if (primitiveVertices == nullptr)
+		{
+			cuint pDims = cudaGridSize(n, BLOCK_SIZE);
+			K_SequencePrimitiveVertices << <pDims, BLOCK_SIZE >> > (m_primitiveVertices);
+			cuSynchronize();
+		}
+		else
+		{
+			cuSafeCall(cudaMemcpy(m_primitiveVertices.getDataPtr(), primitiveVertices, n * vertexNum * sizeof(int), cudaMemcpyDeviceToDevice));
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			buildOnHost();
+			return;
+		}
+
+		if (m_primitives.size() != n)
+		{
+			m_boxes.resize(nodeNum);
+			m_parent.resize(nodeNum);
+			m_primitives.resize(n);
+			m_keys.resize(n);
+			m_left.resize(internalNum);
+			m_right.resize(internalNum);
+			m_flags.resize(internalNum);
+		}
+
+		Coord* vPtr = m_vertices.getDataPtr();
+		Coord lo = thrust::reduce(thrust::device, vPtr, vPtr + m_vertices.size(), Coord((Real)FLT_MAX), BVHCoordMinimum<Coord>());
+		Coord hi = thrust::reduce(thrust::device, vPtr, vPtr + m_vertices.size(), Coord((Real)-FLT_MAX), BVHCoordMaximum<Coord>());
+
+		cuint pDims = cudaGridSize(n, BLOCK_SIZE);
+		K_ComputeMortonKeys << <pDims, BLOCK_SIZE >> > (m_keys, getView(), lo, hi);
+		cuSynchronize();
+
+		thrust::sort(thrust::device, m_keys.getDataPtr(), m_keys.getDataPtr() + n);
+
+		K_BuildInternalNodes << <pDims, BLOCK_SIZE >> > (m_keys, m_primitives, m_left, m_right, m_parent);
+		cuSynchronize();
+
+		refit(m_vertices);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::refit(DeviceArray<Coord>& points)
+	{
+		if (m_primitiveNum <= 0)
+		{
+			return;
+		}
+
+		if (points.size() != m_vertices.size())
+		{
+			Log::sendMessage(Log::Error, "LinearBVH: the vertex number changed, the tree has to be built again!");
+			return;
+		}
+
+		if (points.getDataPtr() != m_vertices.getDataPtr())
+			Function1Pt::copy(m_vertices, points);
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			Function1Pt::copy(m_hostVertices, m_vertices);
+			refitOnHost();
+			return;
+		}
+
+		cuint pDims = cudaGridSize(m_primitiveNum, BLOCK_SIZE);
+		K_ComputeLeafBoxes << <pDims, BLOCK_SIZE >> > (getView());
+		cuSynchronize();
+
+		if (m_primitiveNum > 1)
+		{
+			m_flags.reset();
+			K_RefitInternalNodes << <pDims, BLOCK_SIZE >> > (getView(), m_parent, m_flags);
+			cuSynchronize();
+		}
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::buildOnHost()
+	{
+		int n = m_primitiveNum;
+		int nodeNum = 2 * n - 1;
+		int internalNum = n > 1 ? n - 1 : 1;
+
+		if (m_hostVertices.size() != m_vertices.size())
+			m_hostVertices.resize(m_vertices.size());
+		Function1Pt::copy(m_hostVertices, m_vertices);
+
+		if (m_hostPrimitiveVertices.size() != m_primitiveVertices.size())
+			m_hostPrimitiveVertices.resize(m_primitiveVertices.size());
+		Function1Pt::copy(m_hostPrimitiveVertices, m_primitiveVertices);
+
+		if (m_hostPrimitives.size() != n)
+		{
+			m_hostBoxes.resize(nodeNum);
+			m_hostParent.resize(nodeNum);
+			m_hostPrimitives.resize(n);
+			m_hostKeys.resize(n);
+			m_hostLeft.resize(internalNum);
+			m_hostRight.resize(internalNum);
+		}
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		int threadNum = std::max((int)pool.getThreadNum(), 1);
+
+		//Bounds of the vertices, one partial result per chunk
+		int vNum = m_hostVertices.size();
+		int chunkNum = std::min(threadNum * 4, std::max(vNum / 4096, 1));
+		int chunkSize = (vNum + chunkNum - 1) / chunkNum;
+		std::vector<Coord> chunkLo(chunkNum, Coord((Real)FLT_MAX));
+		std::vector<Coord> chunkHi(chunkNum, Coord((Real)-FLT_MAX));
+		Coord* vertices = m_hostVertices.getDataPtr();
+		pool.parallelFor(0, chunkNum, [&](int cBegin, int cEnd) {
+			for (int c = cBegin; c < cEnd; c++)
+			{
+				int end = std::min(vNum, (c + 1) * chunkSize);
+				for (int v = c * chunkSize; v < end; v++)
+				{
+					chunkLo[c] = chunkLo[c].minimum(vertices[v]);
+					chunkHi[c] = chunkHi[c].maximum(vertices[v]);
+				}
+			}
+		}, 1);
+
+		Coord lo = chunkLo[0];
+		Coord hi = chunkHi[0];
+		for (int c = 1; c < chunkNum; c++)
+		{
+			lo = lo.minimum(chunkLo[c]);
+			hi = hi.maximum(chunkHi[c]);
+		}
+
+		BVHView<TDataType> view = getHostView();
+		unsigned long long* keys = m_hostKeys.getDataPtr();
+		pool.parallelFor(0, n, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+				keys[i] = computeMortonKey(view, i, lo, hi);
+		}, 4096);
+
+		HostSort::sort(keys, n);
+
+		int* primitives = m_hostPrimitives.getDataPtr();
+		int* left = m_hostLeft.getDataPtr();
+		int* right = m_hostRight.getDataPtr();
+		int* parent = m_hostParent.getDataPtr();
+		parent[0] = -1;
+		pool.parallelFor(0, n, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				primitives[i] = (int)(keys[i] & 0xFFFFFFFFull);
+				if (i < n - 1)
+					buildInternalNode(i, keys, n, left, right, parent);
+			}
+		}, 4096);
+
+		refitOnHost();
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::refitOnHost()
+	{
+		int n = m_primitiveNum;
+		BVHView<TDataType> view = getHostView();
+		int* parent = m_hostParent.getDataPtr();
+
+		std::unique_ptr<std::atomic<int>[]> flags(new std::atomic<int>[n > 1 ? n - 1 : 1]);
+		for (int i = 0; i < n - 1; i++)
+			flags[i].store(0, std::memory_order_relaxed);
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		pool.parallelFor(0, n, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				view.boxes[n - 1 + i] = view.getPrimitiveBox(view.primitives[i]);
+
+				//The second thread arriving at a node sees both child boxes
+				int node = n - 1 + i;
+				while (node != 0)
+				{
+					node = parent[node];
+					if (flags[node].fetch_add(1) == 0) break;
+
+					BVHBox<TDataType> box = view.boxes[view.left[node]];
+					box.merge(view.boxes[view.right[node]]);
+					view.boxes[node] = box;
+				}
+			}
+		}, 4096);
+	}
+
+	template<typename TDataType>
+	BVHBox<TDataType> LinearBVH<TDataType>::getBounds()
+	{
+		BVHBox<TDataType> box;
+		box.lo = Coord(Real(0));
+		box.hi = Coord(Real(0));
+		if (m_primitiveNum <= 0)
+		{
+			return box;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			return m_hostBoxes[0];
+		}
+
+		cuSafeCall(cudaMemcpy(&box, m_boxes.getDataPtr(), sizeof(BVHBox<TDataType>), cudaMemcpyDeviceToHost));
+		return box;
+	}
+
+	template<typename TDataType>
+	__global__ void K_ClosestPrimitive(
+		DeviceArray<int> ids,
+		DeviceArray<typename TDataType::Coord> closest,
+		DeviceArray<typename TDataType::Coord> points,
+		BVHView<TDataType> view,
+		typename TDataType::Real maxDistance)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= points.size()) return;
+
+		typename TDataType::Real d;
+		ids[pId] = view.closestPoint(points[pId], maxDistance, closest[pId], d);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::queryClosestPoint(DeviceArray<Coord>& points, DeviceArray<int>& ids, DeviceArray<Coord>& closest, Real maxDistance)
+	{
+		int num = points.size();
+		if (num <= 0)
+		{
+			return;
+		}
+
+		if (ids.size() != num)
+			ids.resize(num);
+		if (closest.size() != num)
+			closest.resize(num);
+
+		if (m_primitiveNum <= 0)
+		{
+			thrust::fill(thrust::device, ids.getDataPtr(), ids.getDataPtr() + num, -1);
+			return;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			HostArray<Coord> hostPoints(num);
+			HostArray<Coord> hostClosest(num);
+			HostArray<int> hostIds(num);
+			Function1Pt::copy(hostPoints, points);
+
+			BVHView<TDataType> view = getHostView();
+			ThreadPool::getInstance().parallelFor(0, num, [&](int begin, int end) {
+				for (int i = begin; i < end; i++)
+				{
+					Real d;
+					hostIds[i] = view.closestPoint(hostPoints[i], maxDistance, hostClosest[i], d);
+				}
+			}, 256);
+
+			Function1Pt::copy(ids, hostIds);
+			Function1Pt::copy(closest, hostClosest);
+			hostPoints.release();
+			hostClosest.release();
+			hostIds.release();
+			return;
+		}
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_ClosestPrimitive << <pDims, BLOCK_SIZE >> > (ids, closest, points, getView(), maxDistance);
+		cuSynchronize();
+	}
+
+	template<typename TDataType>
+	__global__ void K_RayCast(
+		DeviceArray<int> ids,
+		DeviceArray<typename TDataType::Real> distance,
+		DeviceArray<typename TDataType::Coord> origins,
+		DeviceArray<typename TDataType::Coord> directions,
+		BVHView<TDataType> view,
+		typename TDataType::Real maxDistance)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= origins.size()) return;
+
+		ids[pId] = view.rayCast(origins[pId], directions[pId], maxDistance, distance[pId]);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::queryRay(DeviceArray<Coord>& origins, DeviceArray<Coord>& directions, DeviceArray<int>& ids, DeviceArray<Real>& distance, Real maxDistance)
+	{
+		int num = origins.size();
+		if (num <= 0 || directions.size() != num)
+		{
+			if (num > 0)
+				Log::sendMessage(Log::Error, "LinearBVH: one direction per ray origin is required!");
+			return;
+		}
+
+		if (ids.size() != num)
+			ids.resize(num);
+		if (distance.size() != num)
+			distance.resize(num);
+
+		if (m_primitiveNum <= 0)
+		{
+			thrust::fill(thrust::device, ids.getDataPtr(), ids.getDataPtr() + num, -1);
+			thrust::fill(thrust::device, distance.getDataPtr(), distance.getDataPtr() + num, maxDistance);
+			return;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			HostArray<Coord> hostOrigins(num);
+			HostArray<Coord> hostDirections(num);
+			HostArray<int> hostIds(num);
+			HostArray<Real> hostDistance(num);
+			Function1Pt::copy(hostOrigins, origins);
+			Function1Pt::copy(hostDirections, directions);
+
+			BVHView<TDataType> view = getHostView();
+			ThreadPool::getInstance().parallelFor(0, num, [&](int begin, int end) {
+				for (int i = begin; i < end; i++)
+				{
+					hostIds[i] = view.rayCast(hostOrigins[i], hostDirections[i], maxDistance, hostDistance[i]);
+				}
+			}, 256);
+
+			Function1Pt::copy(ids, hostIds);
+			Function1Pt::copy(distance, hostDistance);
+			hostOrigins.release();
+			hostDirections.release();
+			hostIds.release();
+			hostDistance.release();
+			return;
+		}
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_RayCast << <pDims, BLOCK_SIZE >> > (ids, distance, origins, directions, getView(), maxDistance);
+		cuSynchronize();
+	}
+
+	struct BVHCounter
+	{
+		int num;
+		COMM_FUNC void operator()(int prim) { num++; }
+	};
+
+	template<typename NeighborListType>
+	struct BVHCollector
+	{
+		NeighborListType* nbr;
+		int pId;
+		int num;
+		COMM_FUNC void operator()(int prim) { nbr->setElement(pId, num++, prim); }
+	};
+
+	template<typename TDataType>
+	struct BVHOverlapQuery
+	{
+		typename TDataType::Coord* lo;
+		typename TDataType::Coord* hi;
+
+		template<typename Func>
+		COMM_FUNC void operator()(BVHView<TDataType>& view, int i, Func& func) { view.forEachOverlap(lo[i], hi[i], func); }
+	};
+
+	template<typename TDataType>
+	struct BVHRadiusQuery
+	{
+		typename TDataType::Coord* centers;
+		typename TDataType::Real radius;
+
+		template<typename Func>
+		COMM_FUNC void operator()(BVHView<TDataType>& view, int i, Func& func) { view.forEachInRadius(centers[i], radius, func); }
+	};
+
+	template<typename TDataType, typename Query>
+	__global__ void K_CountQueryPrimitives(
+		DeviceArray<int> count,
+		BVHView<TDataType> view,
+		Query query)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= count.size()) return;
+
+		BVHCounter counter;
+		counter.num = 0;
+		query(view, pId, counter);
+		count[pId] = counter.num;
+	}
+
+	template<typename TDataType, typename Query>
+	__global__ void K_CollectQueryPrimitives(
+		NeighborList<int> nbr,
+		BVHView<TDataType> view,
+		Query query)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= nbr.size()) return;
+
+		BVHCollector<NeighborList<int>> collector;
+		collector.nbr = &nbr;
+		collector.pId = pId;
+		collector.num = 0;
+		query(view, pId, collector);
+	}
+
+	/**
+	 * @brief Fill a dynamic list with the primitives reported by query for each of num inputs, counting them first
+	 */
+	template<typename TDataType, typename Query>
+	static void collectPrimitives(NeighborList<int>& nbr, int num, BVHView<TDataType> view, Query query)
+	{
+		nbr.resize(num);
+		DeviceArray<int>& index = nbr.getIndex();
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_CountQueryPrimitives << <pDims, BLOCK_SIZE >> > (index, view, query);
+		cuSynchronize();
+
+		int total = thrust::reduce(thrust::device, index.getDataPtr(), index.getDataPtr() + num, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + num, index.getDataPtr());
+		if (total == 0)
+		{
+			nbr.getElements().release();
+			return;
+		}
+
+		if (nbr.getElements().size() != total)
+			nbr.getElements().resize(total);
+
+		K_CollectQueryPrimitives << <pDims, BLOCK_SIZE >> > (nbr, view, query);
+		cuSynchronize();
+	}
+
+	template<typename TDataType, typename Query>
+	static void collectPrimitivesOnHost(NeighborList<int>& nbr, int num, BVHView<TDataType> view, Query query)
+	{
+		HostNeighborList<int> hostNbr;
+		hostNbr.resize(num);
+		HostArray<int>& index = hostNbr.getIndex();
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		pool.parallelFor(0, num, [&](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				BVHCounter counter;
+				counter.num = 0;
+				query(view, i, counter);
+				index[i] = counter.num;
+			}
+		}, 256);
+
+		int total = HostScan::exclusive(index.getDataPtr(), num);
+		if (total > 0)
+		{
+			hostNbr.getElements().resize(total);
+			pool.parallelFor(0, num, [&](int begin, int end) {
+				for (int i = begin; i < end; i++)
+				{
+					BVHCollector<HostNeighborList<int>> collector;
+					collector.nbr = &hostNbr;
+					collector.pId = i;
+					collector.num = 0;
+					query(view, i, collector);
+				}
+			}, 256);
+		}
+
+		nbr.copyFrom(hostNbr);
+		hostNbr.release();
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::queryOverlap(NeighborList<int>& nbr, DeviceArray<Coord>& lo, DeviceArray<Coord>& hi)
+	{
+		int num = lo.size();
+		if (num <= 0 || hi.size() != num)
+		{
+			if (num > 0)
+				Log::sendMessage(Log::Error, "LinearBVH: one upper corner per lower corner is required!");
+			nbr.release();
+			return;
+		}
+
+		if (m_primitiveNum <= 0)
+		{
+			nbr.resize(num);
+			nbr.getIndex().reset();
+			nbr.getElements().release();
+			return;
+		}
+
+		BVHOverlapQuery<TDataType> query;
+		if (m_deviceType == DeviceType::CPU)
+		{
+			HostArray<Coord> hostLo(num);
+			HostArray<Coord> hostHi(num);
+			Function1Pt::copy(hostLo, lo);
+			Function1Pt::copy(hostHi, hi);
+
+			query.lo = hostLo.getDataPtr();
+			query.hi = hostHi.getDataPtr();
+			collectPrimitivesOnHost(nbr, num, getHostView(), query);
+
+			hostLo.release();
+			hostHi.release();
+			return;
+		}
+
+		query.lo = lo.getDataPtr();
+		query.hi = hi.getDataPtr();
+		collectPrimitives(nbr, num, getView(), query);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::queryRadius(NeighborList<int>& nbr, DeviceArray<Coord>& centers, Real radius)
+	{
+		int num = centers.size();
+		if (num <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		if (m_primitiveNum <= 0)
+		{
+			nbr.resize(num);
+			nbr.getIndex().reset();
+			nbr.getElements().release();
+			return;
+		}
+
+		BVHRadiusQuery<TDataType> query;
+		query.radius = radius;
+		if (m_deviceType == DeviceType::CPU)
+		{
+			HostArray<Coord> hostCenters(num);
+			Function1Pt::copy(hostCenters, centers);
+
+			query.centers = hostCenters.getDataPtr();
+			collectPrimitivesOnHost(nbr, num, getHostView(), query);
+
+			hostCenters.release();
+			return;
+		}
+
+		query.centers = centers.getDataPtr();
+		collectPrimitives(nbr, num, getView(), query);
+	}
+
+	template<typename TDataType>
+	void LinearBVH<TDataType>::release()
+	{
+		m_vertices.release();
+		m_primitiveVertices.release();
+		m_boxes.release();
+		m_left.release();
+		m_right.release();
+		m_parent.release();
+		m_primitives.release();
+		m_flags.release();
+		m_keys.release();
+
+		m_hostVertices.release();
+		m_hostPrimitiveVertices.release();
+		m_hostBoxes.release();
+		m_hostLeft.release();
+		m_hostRight.release();
+		m_hostParent.release();
+		m_hostPrimitives.release();
+		m_hostKeys.release();
+
+		m_primitiveNum = 0;
+	}
+}
@@ -0,0 +1,456 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Array/Array.h"
+#include "Framework/Framework/ModuleTopology.h"
+#include "Framework/Topology/NeighborList.h"
+#include <cmath>
+#include <cassert>
+
+namespace PhysIKA
+{
+	//The 64-bit keys are unique, so the common prefix grows by at least one bit per level and no leaf is deeper than 64.
+	//A depth-first traversal holds at most one pending sibling per level plus the two children of the deepest node.
+#define BVH_MAX_DEPTH 64
+#define BVH_STACK_SIZE (BVH_MAX_DEPTH + 2)
+
+	template<typename TDataType>
+	struct BVHBox
+	{
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		Coord lo;
+		Coord hi;
+
+		COMM_FUNC void merge(const BVHBox<TDataType>& box)
+		{
+			lo = lo.minimum(box.lo);
+			hi = hi.maximum(box.hi);
+		}
+
+		COMM_FUNC bool overlaps(const Coord& boxLo, const Coord& boxHi) const
+		{
+			return lo[0] <= boxHi[0] && hi[0] >= boxLo[0]
+				&& lo[1] <= boxHi[1] && hi[1] >= boxLo[1]
+				&& lo[2] <= boxHi[2] && hi[2] >= boxLo[2];
+		}
+
+		/// Squared distance from p to the box, 0 inside
+		COMM_FUNC Real distanceSquared(const Coord& p) const
+		{
+			Real d2 = Real(0);
+			for (int i = 0; i < 3; i++)
+			{
+				Real d = p[i] < lo[i] ? lo[i] - p[i] : (p[i] > hi[i] ? p[i] - hi[i] : Real(0));
+				d2 += d * d;
+			}
+			return d2;
+		}
+
+		/// Slab test of the ray origin + t * dir, 0 <= t <= tMax, invDir holds the reciprocals of the direction
+		COMM_FUNC bool intersectRay(const Coord& origin, const Coord& invDir, Real tMax) const
+		{
+			Real tNear = Real(0);
+			Real tFar = tMax;
+			for (int i = 0; i < 3; i++)
+			{
+				Real t0 = (lo[i] - origin[i]) * invDir[i];
+				Real t1 = (hi[i] - origin[i]) * invDir[i];
+				if (t0 > t1) { Real t = t0; t0 = t1; t1 = t; }
+				tNear = t0 > tNear ? t0 : tNear;
+				tFar = t1 < tFar ? t1 : tFar;
+				if (tNear > tFar) return false;
+			}
+			return true;
+		}
+	};
+
+	/**
+	 * @brief Closest point to p on the segment ab
+	 */
+	template<typename Real, typename Coord>
+	COMM_FUNC Coord closestPointOnSegment(const Coord& p, const Coord& a, const Coord& b)
+	{
+		Coord ab = b - a;
+		Real len2 = ab.dot(ab);
+		if (len2 <= Real(0)) return a;
+
+		Real t = (p - a).dot(ab) / len2;
+		t = t < Real(0) ? Real(0) : (t > Real(1) ? Real(1) : t);
+		return a + ab * t;
+	}
+
+	/**
+	 * @brief Closest point to p on the triangle abc, by the Voronoi regions of its vertices and edges
+	 */
+	template<typename Real, typename Coord>
+	COMM_FUNC Coord closestPointOnTriangle(const Coord& p, const Coord& a, const Coord& b, const Coord& c)
+	{
+		Coord ab = b - a;
+		Coord ac = c - a;
+		Coord ap = p - a;
+		Real d1 = ab.dot(ap);
+		Real d2 = ac.dot(ap);
+		if (d1 <= Real(0) && d2 <= Real(0)) return a;
+
+		Coord bp = p - b;
+		Real d3 = ab.dot(bp);
+		Real d4 = ac.dot(bp);
+		if (d3 >= Real(0) && d4 <= d3) return b;
+
+		Real vc = d1 * d4 - d3 * d2;
+		if (vc <= Real(0) && d1 >= Real(0) && d3 <= Real(0))
+			return a + ab * (d1 / (d1 - d3));
+
+		Coord cp = p - c;
+		Real d5 = ab.dot(cp);
+		Real d6 = ac.dot(cp);
+		if (d6 >= Real(0) && d5 <= d6) return c;
+
+		Real vb = d5 * d2 - d1 * d6;
+		if (vb <= Real(0) && d2 >= Real(0) && d6 <= Real(0))
+			return a + ac * (d2 / (d2 - d6));
+
+		Real va = d3 * d6 - d5 * d4;
+		if (va <= Real(0) && (d4 - d3) >= Real(0) && (d5 - d6) >= Real(0))
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		//Inside the face
+		Real denom = Real(1) / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	/**
+	 * @brief Intersection of the ray origin + t * dir with the triangle abc, returns false if there is none with t in [0, tMax]
+	 */
+	template<typename Real, typename Coord>
+	COMM_FUNC bool intersectRayTriangle(const Coord& origin, const Coord& dir, const Coord& a, const Coord& b, const Coord& c, Real tMax, Real& t)
+	{
+		Coord e1 = b - a;
+		Coord e2 = c - a;
+		Coord pv = dir.cross(e2);
+		Real det = e1.dot(pv);
+		if (det == Real(0)) return false;
+
+		Real invDet = Real(1) / det;
+		Coord tv = origin - a;
+		Real u = tv.dot(pv) * invDet;
+		if (u < Real(0) || u > Real(1)) return false;
+
+		Coord qv = tv.cross(e1);
+		Real v = dir.dot(qv) * invDet;
+		if (v < Real(0) || u + v > Real(1)) return false;
+
+		t = e2.dot(qv) * invDet;
+		return t >= Real(0) && t <= tMax;
+	}
+
+	/*!
+	*	\class	BVHView
+	*	\brief	Raw pointers to the nodes of a LinearBVH, traversed in the same way on the host and on the GPU.
+	*
+	*	The n - 1 internal nodes come first with the root at 0, followed by the n leaves in Morton order.
+	*	A tree of a single primitive consists of its leaf only, which is then the root.
+	*/
+	template<typename TDataType>
+	struct BVHView
+	{
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		BVHBox<TDataType>* boxes;
+		int* left;
+		int* right;
+		int* primitives;			//!< primitive of each leaf
+
+		Coord* vertices;
+		int* primitiveVertices;		//!< vertexNum vertex ids per primitive
+		int vertexNum;				//!< 1 for points, 2 for edges, 3 for triangles
+		int primitiveNum;
+
+		COMM_FUNC bool isLeaf(int node) { return node >= primitiveNum - 1; }
+
+		COMM_FUNC int getPrimitive(int node) { return primitives[node - primitiveNum + 1]; }
+
+		COMM_FUNC Coord getVertex(int prim, int v) { return vertices[primitiveVertices[prim * vertexNum + v]]; }
+
+		COMM_FUNC BVHBox<TDataType> getPrimitiveBox(int prim)
+		{
+			BVHBox<TDataType> box;
+			box.lo = box.hi = getVertex(prim, 0);
+			for (int v = 1; v < vertexNum; v++)
+			{
+				Coord p = getVertex(prim, v);
+				box.lo = box.lo.minimum(p);
+				box.hi = box.hi.maximum(p);
+			}
+			return box;
+		}
+
+		COMM_FUNC Coord closestPointOnPrimitive(int prim, const Coord& p)
+		{
+			if (vertexNum == 3)
+				return closestPointOnTriangle<Real, Coord>(p, getVertex(prim, 0), getVertex(prim, 1), getVertex(prim, 2));
+			if (vertexNum == 2)
+				return closestPointOnSegment<Real, Coord>(p, getVertex(prim, 0), getVertex(prim, 1));
+			return getVertex(prim, 0);
+		}
+
+		/**
+		 * @brief Closest primitive to p within maxDistance, returns -1 if there is none
+		 */
+		COMM_FUNC int closestPoint(const Coord& p, Real maxDistance, Coord& closest, Real& distance)
+		{
+			int stack[BVH_STACK_SIZE];
+			int top = 0;
+			stack[top++] = 0;
+
+			int bestId = -1;
+			Real best2 = maxDistance * maxDistance;
+			while (top > 0)
+			{
+				int node = stack[--top];
+				if (boxes[node].distanceSquared(p) >= best2) continue;
+
+				if (isLeaf(node))
+				{
+					int prim = getPrimitive(node);
+					Coord q = closestPointOnPrimitive(prim, p);
+					Real d2 = (q - p).dot(q - p);
+					if (d2 < best2)
+					{
+						best2 = d2;
+						bestId = prim;
+						closest = q;
+					}
+					continue;
+				}
+
+				//The nearer child is visited first so that the bound shrinks early
+				int l = left[node];
+				int r = right[node];
+				Real dl = boxes[l].distanceSquared(p);
+				Real dr = boxes[r].distanceSquared(p);
+				int nearNode = dl <= dr ? l : r;
+				int farNode = dl <= dr ? r : l;
+				assert(top + 2 <= BVH_STACK_SIZE);
+				stack[top++] = farNode;
+				stack[top++] = nearNode;
+			}
+
+			distance = bestId >= 0 ? sqrt(best2) : maxDistance;
+			return bestId;
+		}
+
+		/**
+		 * @brief First triangle hit by the ray origin + t * dir within tMax, returns -1 if there is none
+		 */
+		COMM_FUNC int rayCast(const Coord& origin, const Coord& dir, Real tMax, Real& tHit)
+		{
+			tHit = tMax;
+			if (vertexNum != 3) return -1;
+
+			Coord invDir;
+			for (int i = 0; i < 3; i++)
+				invDir[i] = dir[i] != Real(0) ? Real(1) / dir[i] : Real(1e30);
+
+			int stack[BVH_STACK_SIZE];
+			int top = 0;
+			stack[top++] = 0;
+
+			int hitId = -1;
+			while (top > 0)
+			{
+				int node = stack[--top];
+				if (!boxes[node].intersectRay(origin, invDir, tHit)) continue;
+
+				if (isLeaf(node))
+				{
+					int prim = getPrimitive(node);
+					Real t;
+					if (intersectRayTriangle<Real, Coord>(origin, dir, getVertex(prim, 0), getVertex(prim, 1), getVertex(prim, 2), tHit, t))
+					{
+						tHit = t;
+						hitId = prim;
+					}
+					continue;
+				}
+
+				assert(top + 2 <= BVH_STACK_SIZE);
+				stack[top++] = left[node];
+				stack[top++] = right[node];
+			}
+			return hitId;
+		}
+
+		/**
+		 * @brief Call func(prim) for every primitive whose bounding box overlaps the box [lo, hi]
+		 */
+		template<typename Func>
+		COMM_FUNC void forEachOverlap(const Coord& lo, const Coord& hi, Func& func)
+		{
+			int stack[BVH_STACK_SIZE];
+			int top = 0;
+			stack[top++] = 0;
+
+			while (top > 0)
+			{
+				int node = stack[--top];
+				if (!boxes[node].overlaps(lo, hi)) continue;
+
+				if (isLeaf(node))
+				{
+					func(getPrimitive(node));
+					continue;
+				}
+
+				assert(top + 2 <= BVH_STACK_SIZE);
+				stack[top++] = right[node];
+				stack[top++] = left[node];
+			}
+		}
+
+		/**
+		 * @brief Call func(prim) for every primitive closer than radius to center
+		 */
+		template<typename Func>
+		COMM_FUNC void forEachInRadius(const Coord& center, Real radius, Func& func)
+		{
+			int stack[BVH_STACK_SIZE];
+			int top = 0;
+			stack[top++] = 0;
+
+			Real r2 = radius * radius;
+			while (top > 0)
+			{
+				int node = stack[--top];
+				if (boxes[node].distanceSquared(center) > r2) continue;
+
+				if (isLeaf(node))
+				{
+					int prim = getPrimitive(node);
+					Coord q = closestPointOnPrimitive(prim, center);
+					if ((q - center).dot(q - center) <= r2)
+						func(prim);
+					continue;
+				}
+
+				assert(top + 2 <= BVH_STACK_SIZE);
+				stack[top++] = right[node];
+				stack[top++] = left[node];
+			}
+		}
+	};
+
+	/*!
+	*	\class	LinearBVH
+	*	\brief	Bounding volume hierarchy over points, edges or triangles, built from the Morton codes of the primitive centers.
+	*
+	*	The primitives are sorted by their 30-bit Morton codes, extended by the primitive id to make them unique, and the
+	*	internal nodes are then emitted independently of each other (Karras 2012). Boxes are computed bottom-up,
+	*	refit() repeats only this step for deforming meshes that keep their connectivity, e.g. the surface of an elastic body.
+	*	Queries are batched, their inputs and results are always device arrays. With DeviceType::CPU the tree is kept on the
+	*	host and built and queried on the ThreadPool.
+	*/
+	template<typename TDataType>
+	class LinearBVH
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+		typedef typename TopologyModule::Edge Edge;
+		typedef typename TopologyModule::Triangle Triangle;
+
+		LinearBVH();
+		~LinearBVH();
+
+		/**
+		 * @brief Select where the tree is kept and the queries run, takes effect on the next build()
+		 */
+		void setDeviceType(DeviceType type) { m_deviceType = type; }
+		DeviceType getDeviceType() { return m_deviceType; }
+
+		/// One leaf per point
+		void build(DeviceArray<Coord>& points);
+		/// One leaf per edge
+		void build(DeviceArray<Coord>& points, DeviceArray<Edge>& edges);
+		/// One leaf per triangle
+		void build(DeviceArray<Coord>& points, DeviceArray<Triangle>& triangles);
+
+		/**
+		 * @brief Update the boxes for new vertex positions, the vertex number and the primitives must not change
+		 */
+		void refit(DeviceArray<Coord>& points);
+
+		/**
+		 * @brief Closest primitive to each point within maxDistance, ids are -1 where there is none
+		 */
+		void queryClosestPoint(DeviceArray<Coord>& points, DeviceArray<int>& ids, DeviceArray<Coord>& closest, Real maxDistance = Real(1e30));
+
+		/**
+		 * @brief First triangle hit by each ray within maxDistance, ids are -1 where there is none
+		 *
+		 * Points and edges are never hit. distance is in units of the direction length.
+		 */
+		void queryRay(DeviceArray<Coord>& origins, DeviceArray<Coord>& directions, DeviceArray<int>& ids, DeviceArray<Real>& distance, Real maxDistance = Real(1e30));
+
+		/**
+		 * @brief Primitives whose bounding boxes overlap the box [lo[i], hi[i]]
+		 */
+		void queryOverlap(NeighborList<int>& nbr, DeviceArray<Coord>& lo, DeviceArray<Coord>& hi);
+
+		/**
+		 * @brief Primitives closer than radius to each center
+		 */
+		void queryRadius(NeighborList<int>& nbr, DeviceArray<Coord>& centers, Real radius);
+
+		int getPrimitiveNum() { return m_primitiveNum; }
+
+		/// Bounds of all primitives, valid after build() or refit()
+		BVHBox<TDataType> getBounds();
+
+		/**
+		 * @brief Nodes of the tree kept on the host, only valid with DeviceType::CPU
+		 *
+		 * Lets host code traverse the tree from within its own parallel loops instead of batching its queries.
+		 */
+		BVHView<TDataType> getHostView();
+
+		void release();
+
+	private:
+		void build(DeviceArray<Coord>& points, int* primitiveVertices, int primitiveNum, int vertexNum);
+
+		void buildOnHost();
+		void refitOnHost();
+
+		BVHView<TDataType> getView();
+
+		DeviceType m_deviceType;
+		int m_primitiveNum;
+		int m_vertexNum;
+
+		DeviceArray<Coord> m_vertices;
+		DeviceArray<int> m_primitiveVertices;
+		DeviceArray<BVHBox<TDataType>> m_boxes;
+		DeviceArray<int> m_left;
+		DeviceArray<int> m_right;
+		DeviceArray<int> m_parent;
+		DeviceArray<int> m_primitives;
+		DeviceArray<int> m_flags;
+		DeviceArray<unsigned long long> m_keys;
+
+		HostArray<Coord> m_hostVertices;
+		HostArray<int> m_hostPrimitiveVertices;
+		HostArray<BVHBox<TDataType>> m_hostBoxes;
+		HostArray<int> m_hostLeft;
+		HostArray<int> m_hostRight;
+		HostArray<int> m_hostParent;
+		HostArray<int> m_hostPrimitives;
+		HostArray<unsigned long long> m_hostKeys;
+	};
+
+	//Both precisions, as DistanceField3D builds one for either
+	template class LinearBVH<DataType3f>;
+	template class LinearBVH<DataType3d>;
+}
@@ -0,0 +1,357 @@
+#include <cuda_runtime.h>
+#include "MeshAdjacency.h"
+#include "Core/Utility.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Core/Utility/HostScan.h"
+#include "Core/Utility/HostSort.h"
+#include <thrust/reduce.h>
+#include <thrust/sort.h>
+#include <thrust/unique.h>
+#include <thrust/scan.h>
+#include <thrust/execution_policy.h>
+#include <algorithm>
+#include <vector>
+
+namespace PhysIKA
+{
+	//Key of the pairs of a vertex with itself, sorted behind all valid pairs and dropped
+#define ADJACENCY_INVALID_KEY 0xFFFFFFFFFFFFFFFFull
+
+	COMM_FUNC inline int pairsPerPrimitive(int vertexNum, bool toPrimitive)
+	{
+		return toPrimitive ? vertexNum : vertexNum * (vertexNum - 1);
+	}
+
+	/**
+	 * @brief Write the (row, column) keys of primitive p, row in the upper and column in the lower 32 bits
+	 */
+	COMM_FUNC inline void emitPrimitivePairs(unsigned long long* keys, const int* ids, int p, int vertexNum, bool toPrimitive)
+	{
+		const int* v = ids + p * vertexNum;
+		unsigned long long* out = keys + p * pairsPerPrimitive(vertexNum, toPrimitive);
+
+		if (toPrimitive)
+		{
+			for (int i = 0; i < vertexNum; i++)
+				out[i] = ((unsigned long long)(unsigned int)v[i] << 32) | (unsigned int)p;
+			return;
+		}
+
+		int n = 0;
+		for (int i = 0; i < vertexNum; i++)
+		{
+			for (int j = 0; j < vertexNum; j++)
+			{
+				if (i == j) continue;
+				out[n++] = v[i] == v[j] ? ADJACENCY_INVALID_KEY : ((unsigned long long)(unsigned int)v[i] << 32) | (unsigned int)v[j];
+			}
+		}
+	}
+
+	/**
+	 * @brief Call func(s) for every triangle s != t sharing an edge with triangle t
+	 *
+	 * The triangle lists of the two vertices of an edge are sorted, so they are intersected by a merge.
+	 */
+	template<typename ListType, typename Func>
+	COMM_FUNC void forEachEdgeNeighbor(ListType& vertexTriangles, const int* ids, int t, Func& func)
+	{
+		const int* v = ids + 3 * t;
+		for (int e = 0; e < 3; e++)
+		{
+			int a = v[e];
+			int b = v[(e + 1) % 3];
+			if (a == b) continue;
+
+			int na = vertexTriangles.getNeighborSize(a);
+			int nb = vertexTriangles.getNeighborSize(b);
+			int i = 0;
+			int j = 0;
+			while (i < na && j < nb)
+			{
+				int sa = vertexTriangles.getElement(a, i);
+				int sb = vertexTriangles.getElement(b, j);
+				if (sa < sb) i++;
+				else if (sb < sa) j++;
+				else
+				{
+					if (sa != t) func(sa);
+					i++;
+					j++;
+				}
+			}
+		}
+	}
+
+	struct AdjacencyCounter
+	{
+		int num;
+		COMM_FUNC void operator()(int s) { num++; }
+	};
+
+	template<typename ListType>
+	struct AdjacencyCollector
+	{
+		ListType* nbr;
+		int pId;
+		int num;
+		COMM_FUNC void operator()(int s) { nbr->setElement(pId, num++, s); }
+	};
+
+	__global__ void K_EmitPrimitivePairs(
+		DeviceArray<unsigned long long> keys,
+		int* ids,
+		int primitiveNum,
+		int vertexNum,
+		bool toPrimitive)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= primitiveNum) return;
+
+		emitPrimitivePairs(&keys[0], ids, pId, vertexNum, toPrimitive);
+	}
+
+	__global__ void K_CountPairRows(
+		DeviceArray<int> index,
+		DeviceArray<unsigned long long> keys,
+		int pairNum)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pairNum) return;
+
+		atomicAdd(&index[(int)(keys[pId] >> 32)], 1);
+	}
+
+	__global__ void K_StorePairColumns(
+		DeviceArray<int> elements,
+		DeviceArray<unsigned long long> keys)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= elements.size()) return;
+
+		elements[pId] = (int)(keys[pId] & 0xFFFFFFFFull);
+	}
+
+	void MeshAdjacency::buildFromPrimitives(NeighborList<int>& nbr, int* ids, int primitiveNum, int vertexNum, int rowNum, bool toPrimitive, DeviceType type)
+	{
+		if (rowNum <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		nbr.resize(rowNum);
+		if (primitiveNum <= 0)
+		{
+			nbr.getIndex().reset();
+			nbr.getElements().release();
+			return;
+		}
+
+		int pairNum = primitiveNum * pairsPerPrimitive(vertexNum, toPrimitive);
+
+		if (type == DeviceType::CPU)
+		{
+			HostArray<int> hostIds(primitiveNum * vertexNum);
+			cuSafeCall(cudaMemcpy(hostIds.getDataPtr(), ids, primitiveNum * vertexNum * sizeof(int), cudaMemcpyDeviceToHost));
+
+			std::vector<unsigned long long> keys(pairNum);
+			ThreadPool& pool = ThreadPool::getInstance();
+			int* idPtr = hostIds.getDataPtr();
+			pool.parallelFor(0, primitiveNum, [&](int begin, int end) {
+				for (int p = begin; p < end; p++)
+					emitPrimitivePairs(keys.data(), idPtr, p, vertexNum, toPrimitive);
+			}, 4096);
+
+			HostSort::sort(keys.data(), pairNum);
+			int num = (int)(std::unique(keys.begin(), keys.end()) - keys.begin());
+			if (num > 0 && keys[num - 1] == ADJACENCY_INVALID_KEY)
+				num--;
+
+			HostNeighborList<int> hostNbr;
+			hostNbr.resize(rowNum);
+			HostArray<int>& index = hostNbr.getIndex();
+			for (int i = 0; i < num; i++)
+			{
+				index[(int)(keys[i] >> 32)]++;
+			}
+			HostScan::exclusive(index.getDataPtr(), rowNum);
+
+			if (num > 0)
+			{
+				HostArray<int>& elements = hostNbr.getElements();
+				elements.resize(num);
+				pool.parallelFor(0, num, [&](int begin, int end) {
+					for (int i = begin; i < end; i++)
+						elements[i] = (int)(keys[i] & 0xFFFFFFFFull);
+				}, 4096);
+			}
+
+			nbr.copyFrom(hostNbr);
+			hostNbr.release();
+			hostIds.release();
+			return;
+		}
+
+		DeviceArray<unsigned long long> keys(pairNum);
+
+		cuint pDims = cudaGridSize(primitiveNum, BLOCK_SIZE);
+		K_EmitPrimitivePairs << <pDims, BLOCK_SIZE >> > (keys, ids, primitiveNum, vertexNum, toPrimitive);
+		cuSynchronize();
+
+		unsigned long long* kPtr = keys.getDataPtr();
+		thrust::sort(thrust::device, kPtr, kPtr + pairNum);
+		int num = (int)(thrust::unique(thrust::device, kPtr, kPtr + pairNum) - kPtr);
+		if (num > 0)
+		{
+			unsigned long long last;
+			cuSafeCall(cudaMemcpy(&last, kPtr + num - 1, sizeof(unsigned long long), cudaMemcpyDeviceToHost));
+			if (last == ADJACENCY_INVALID_KEY)
+				num--;
+		}
+
+		DeviceArray<int>& index = nbr.getIndex();
+		index.reset();
+		if (num == 0)
+		{
+			nbr.getElements().release();
+			keys.release();
+			return;
+		}
+
+		cuint cDims = cudaGridSize(num, BLOCK_SIZE);
+		K_CountPairRows << <cDims, BLOCK_SIZE >> > (index, keys, num);
+		cuSynchronize();
+
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + rowNum, index.getDataPtr());
+
+		if (nbr.getElements().size() != num)
+			nbr.getElements().resize(num);
+		K_StorePairColumns << <cDims, BLOCK_SIZE >> > (nbr.getElements(), keys);
+		cuSynchronize();
+
+		keys.release();
+	}
+
+	void MeshAdjacency::buildVertexNeighbors(NeighborList<int>& nbr, DeviceArray<Edge>& edges, int vertexNum, DeviceType type)
+	{
+		static_assert(sizeof(Edge) == 2 * sizeof(int), "Edges are read as pairs of vertex ids");
+		buildFromPrimitives(nbr, (int*)edges.getDataPtr(), edges.size(), 2, vertexNum, false, type);
+	}
+
+	void MeshAdjacency::buildVertexNeighbors(NeighborList<int>& nbr, DeviceArray<Triangle>& triangles, int vertexNum, DeviceType type)
+	{
+		static_assert(sizeof(Triangle) == 3 * sizeof(int), "Triangles are read as triples of vertex ids");
+		buildFromPrimitives(nbr, (int*)triangles.getDataPtr(), triangles.size(), 3, vertexNum, false, type);
+	}
+
+	void MeshAdjacency::buildVertexTriangles(NeighborList<int>& nbr, DeviceArray<Triangle>& triangles, int vertexNum, DeviceType type)
+	{
+		buildFromPrimitives(nbr, (int*)triangles.getDataPtr(), triangles.size(), 3, vertexNum, true, type);
+	}
+
+	__global__ void K_CountTriangleNeighbors(
+		DeviceArray<int> count,
+		DeviceArray<TopologyModule::Triangle> triangles,
+		NeighborList<int> vertexTriangles)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= count.size()) return;
+
+		AdjacencyCounter counter;
+		counter.num = 0;
+		forEachEdgeNeighbor(vertexTriangles, (const int*)&triangles[0], pId, counter);
+		count[pId] = counter.num;
+	}
+
+	__global__ void K_StoreTriangleNeighbors(
+		NeighborList<int> nbr,
+		DeviceArray<TopologyModule::Triangle> triangles,
+		NeighborList<int> vertexTriangles)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= nbr.size()) return;
+
+		AdjacencyCollector<NeighborList<int>> collector;
+		collector.nbr = &nbr;
+		collector.pId = pId;
+		collector.num = 0;
+		forEachEdgeNeighbor(vertexTriangles, (const int*)&triangles[0], pId, collector);
+	}
+
+	void MeshAdjacency::buildTriangleNeighbors(NeighborList<int>& nbr, DeviceArray<Triangle>& triangles, NeighborList<int>& vertexTriangles, DeviceType type)
+	{
+		int num = triangles.size();
+		if (num <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		nbr.resize(num);
+
+		if (type == DeviceType::CPU)
+		{
+			HostArray<Triangle> hostTriangles(num);
+			HostNeighborList<int> hostVertexTriangles;
+			HostNeighborList<int> hostNbr;
+			Function1Pt::copy(hostTriangles, triangles);
+			hostVertexTriangles.copyFrom(vertexTriangles);
+			hostNbr.resize(num);
+
+			ThreadPool& pool = ThreadPool::getInstance();
+			const int* ids = (const int*)hostTriangles.getDataPtr();
+			HostArray<int>& index = hostNbr.getIndex();
+			pool.parallelFor(0, num, [&](int begin, int end) {
+				for (int t = begin; t < end; t++)
+				{
+					AdjacencyCounter counter;
+					counter.num = 0;
+					forEachEdgeNeighbor(hostVertexTriangles, ids, t, counter);
+					index[t] = counter.num;
+				}
+			}, 1024);
+
+			int total = HostScan::exclusive(index.getDataPtr(), num);
+			if (total > 0)
+			{
+				hostNbr.getElements().resize(total);
+				pool.parallelFor(0, num, [&](int begin, int end) {
+					for (int t = begin; t < end; t++)
+					{
+						AdjacencyCollector<HostNeighborList<int>> collector;
+						collector.nbr = &hostNbr;
+						collector.pId = t;
+						collector.num = 0;
+						forEachEdgeNeighbor(hostVertexTriangles, ids, t, collector);
+					}
+				}, 1024);
+			}
+
+			nbr.copyFrom(hostNbr);
+			hostNbr.release();
+			hostVertexTriangles.release();
+			hostTriangles.release();
+			return;
+		}
+
+		DeviceArray<int>& index = nbr.getIndex();
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_CountTriangleNeighbors << <pDims, BLOCK_SIZE >> > (index, triangles, vertexTriangles);
+		cuSynchronize();
+
+		int total = thrust::reduce(thrust::device, index.getDataPtr(), index.getDataPtr() + num, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + num, index.getDataPtr());
+		if (total == 0)
+		{
+			nbr.getElements().release();
+			return;
+		}
+
+		if (nbr.getElements().size() != total)
+			nbr.getElements().resize(total);
+		K_StoreTriangleNeighbors << <pDims, BLOCK_SIZE >> > (nbr, triangles, vertexTriangles);
+		cuSynchronize();
+	}
+}
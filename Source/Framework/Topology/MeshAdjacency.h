@@ -0,0 +1,55 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Array/Array.h"
+#include "Framework/Framework/ModuleTopology.h"
+#include "Framework/Topology/NeighborList.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	MeshAdjacency
+	*	\brief	Adjacency of mesh elements as compact neighbor lists, built by sorting element pairs instead of searching them.
+	*
+	*	Every primitive emits its (row, column) pairs as 64-bit keys, the keys are sorted and deduplicated and the rows
+	*	are counted and scanned into the index of a dynamic NeighborList, so construction takes O(E log E) for E pairs.
+	*	The neighbors of each row are sorted ascending. With DeviceType::CPU the lists are built on the ThreadPool and
+	*	copied to the device afterwards.
+	*/
+	class MeshAdjacency
+	{
+	public:
+		typedef TopologyModule::Edge Edge;
+		typedef TopologyModule::Triangle Triangle;
+
+		/**
+		 * @brief Vertices connected to each of vertexNum vertices by an edge
+		 */
+		static void buildVertexNeighbors(NeighborList<int>& nbr, DeviceArray<Edge>& edges, int vertexNum, DeviceType type = DeviceType::GPU);
+
+		/**
+		 * @brief Vertices sharing a triangle with each of vertexNum vertices
+		 */
+		static void buildVertexNeighbors(NeighborList<int>& nbr, DeviceArray<Triangle>& triangles, int vertexNum, DeviceType type = DeviceType::GPU);
+
+		/**
+		 * @brief Triangles incident to each of vertexNum vertices
+		 */
+		static void buildVertexTriangles(NeighborList<int>& nbr, DeviceArray<Triangle>& triangles, int vertexNum, DeviceType type = DeviceType::GPU);
+
+		/**
+		 * @brief Triangles sharing an edge with each triangle
+		 *
+		 * vertexTriangles must have been built by buildVertexTriangles() for the same triangles,
+		 * the triangles around an edge are found by intersecting the lists of its two vertices.
+		 */
+		static void buildTriangleNeighbors(NeighborList<int>& nbr, DeviceArray<Triangle>& triangles, NeighborList<int>& vertexTriangles, DeviceType type = DeviceType::GPU);
+
+	private:
+		/**
+		 * @brief Sort, deduplicate and scan the pairs of primitives with vertexNum vertex ids each
+		 *
+		 * @param toPrimitive	pair each vertex with its primitive instead of with the other vertices of the primitive
+		 */
+		static void buildFromPrimitives(NeighborList<int>& nbr, int* ids, int primitiveNum, int vertexNum, int rowNum, bool toPrimitive, DeviceType type);
+	};
+}
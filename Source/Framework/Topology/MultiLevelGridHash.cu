@@ -0,0 +1,411 @@
+#include <cuda_runtime.h>
+#include "MultiLevelGridHash.h"
+#include "Framework/Topology/KNearestHeap.h"
+#include "Framework/Framework/Log.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/sequence.h>
+#include <thrust/gather.h>
+#include <thrust/functional.h>
+#include <thrust/binary_search.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/execution_policy.h>
+#include <cfloat>
+
+namespace PhysIKA{
+
+	template<typename TDataType>
+	MultiLevelGridHash<TDataType>::MultiLevelGridHash()
+	{
+	}
+
+	template<typename TDataType>
+	MultiLevelGridHash<TDataType>::~MultiLevelGridHash()
+	{
+	}
+
+	template<typename Real>
+	__global__ void K_ComputeGridLevels(
+		DeviceArray<int> levels,
+		DeviceArray<Real> radii,
+		Real minRadius,
+		int levelNum)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= levels.size()) return;
+
+		//The finest level whose cells are not smaller than the radius
+		Real cellSize = minRadius;
+		int l = 0;
+		while (cellSize < radii[pId] && l < levelNum - 1)
+		{
+			cellSize *= Real(2);
+			l++;
+		}
+		levels[pId] = l;
+	}
+
+	template<typename TDataType>
+	void MultiLevelGridHash<TDataType>::construct(DeviceArray<Coord>& pos, DeviceArray<Real>& radii)
+	{
+		int pNum = pos.size();
+		if (pNum <= 0 || radii.size() != pNum)
+		{
+			if (pNum > 0)
+				Log::sendMessage(Log::Error, "MultiLevelGridHash: one radius per particle is required!");
+
+			for (int l = 0; l < m_levels.size(); l++)
+				m_levels[l].num = 0;
+			uploadLevels();
+			return;
+		}
+
+		Real* rPtr = radii.getDataPtr();
+		Real minRadius = thrust::reduce(thrust::device, rPtr, rPtr + pNum, Real(FLT_MAX), thrust::minimum<Real>());
+		Real maxRadius = thrust::reduce(thrust::device, rPtr, rPtr + pNum, Real(0), thrust::maximum<Real>());
+
+		//Radii that span more than the available levels are gathered at the coarsest one
+		Real lowest = maxRadius / Real(1 << (MAX_GRID_LEVEL - 1));
+		minRadius = minRadius > lowest ? minRadius : lowest;
+		if (maxRadius <= Real(0))
+		{
+			Log::sendMessage(Log::Warning, "MultiLevelGridHash: all radii are zero!");
+			minRadius = maxRadius = Real(1);
+		}
+
+		int levelNum = 1;
+		while (levelNum < MAX_GRID_LEVEL && minRadius * Real(1 << (levelNum - 1)) < maxRadius)
+		{
+			levelNum++;
+		}
+
+		for (int l = levelNum; l < m_levels.size(); l++)
+		{
+			m_levels[l].hash.release();
+			m_levelPosition[l].release();
+			m_levelRadius[l].release();
+			m_levelIds[l].release();
+		}
+		m_levels.resize(levelNum);
+		m_levelPosition.resize(levelNum);
+		m_levelRadius.resize(levelNum);
+		m_levelIds.resize(levelNum);
+
+		if (m_levelKeys.size() != pNum)
+		{
+			m_levelKeys.resize(pNum);
+			m_sortedIds.resize(pNum);
+		}
+
+		cuint pDims = cudaGridSize(pNum, BLOCK_SIZE);
+		K_ComputeGridLevels << <pDims, BLOCK_SIZE >> > (m_levelKeys, radii, minRadius, levelNum);
+		cuSynchronize();
+
+		thrust::sequence(thrust::device, m_sortedIds.getDataPtr(), m_sortedIds.getDataPtr() + pNum);
+		thrust::stable_sort_by_key(thrust::device, m_levelKeys.getDataPtr(), m_levelKeys.getDataPtr() + pNum, m_sortedIds.getDataPtr());
+
+		DeviceArray<int> offsets(levelNum + 1);
+		thrust::lower_bound(thrust::device,
+			m_levelKeys.getDataPtr(), m_levelKeys.getDataPtr() + pNum,
+			thrust::counting_iterator<int>(0), thrust::counting_iterator<int>(levelNum + 1),
+			offsets.getDataPtr());
+		std::vector<int> hostOffsets(levelNum + 1);
+		cuSafeCall(cudaMemcpy(&hostOffsets[0], offsets.getDataPtr(), (levelNum + 1) * sizeof(int), cudaMemcpyDeviceToHost));
+		offsets.release();
+
+		for (int l = 0; l < levelNum; l++)
+		{
+			GridLevel<TDataType>& level = m_levels[l];
+			level.num = hostOffsets[l + 1] - hostOffsets[l];
+
+			Real cellSize = minRadius * Real(1 << l);
+			if (l == levelNum - 1)
+				cellSize = cellSize > maxRadius ? cellSize : maxRadius;
+			level.hash.setSpace(cellSize);
+
+			if (level.num == 0)
+			{
+				continue;
+			}
+
+			if (m_levelIds[l].size() != level.num)
+			{
+				m_levelIds[l].resize(level.num);
+				m_levelPosition[l].resize(level.num);
+				m_levelRadius[l].resize(level.num);
+			}
+
+			int* ids = m_levelIds[l].getDataPtr();
+			cuSafeCall(cudaMemcpy(ids, m_sortedIds.getDataPtr() + hostOffsets[l], level.num * sizeof(int), cudaMemcpyDeviceToDevice));
+			thrust::gather(thrust::device, ids, ids + level.num, pos.getDataPtr(), m_levelPosition[l].getDataPtr());
+			thrust::gather(thrust::device, ids, ids + level.num, radii.getDataPtr(), m_levelRadius[l].getDataPtr());
+
+			if (!level.hash.construct(m_levelPosition[l]))
+			{
+				level.num = 0;
+				continue;
+			}
+			level.position = m_levelPosition[l].getDataPtr();
+			level.radius = m_levelRadius[l].getDataPtr();
+			level.ids = ids;
+		}
+
+		uploadLevels();
+	}
+
+	template<typename TDataType>
+	void MultiLevelGridHash<TDataType>::uploadLevels()
+	{
+		if (m_deviceLevels == nullptr)
+		{
+			cuSafeCall(cudaMalloc((void**)&m_deviceLevels, MAX_GRID_LEVEL * sizeof(GridLevel<TDataType>)));
+		}
+
+		m_deviceLevelNum = (int)m_levels.size();
+		if (m_deviceLevelNum > 0)
+		{
+			cuSafeCall(cudaMemcpy(m_deviceLevels, &m_levels[0], m_deviceLevelNum * sizeof(GridLevel<TDataType>), cudaMemcpyHostToDevice));
+		}
+	}
+
+	/**
+	 * @brief Call func(j, d) for every hashed particle j with a distance d < max(radius, r_j) + extra to pos
+	 */
+	template<typename TDataType, typename Func>
+	GPU_FUNC void forEachNeighborInLevels(
+		GridLevel<TDataType>* levels,
+		int levelNum,
+		typename TDataType::Coord pos,
+		typename TDataType::Real radius,
+		typename TDataType::Real extra,
+		Func& func)
+	{
+		typedef typename TDataType::Real Real;
+
+		for (int l = 0; l < levelNum; l++)
+		{
+			GridLevel<TDataType>& level = levels[l];
+			if (level.num == 0) continue;
+
+			//Particles of this level have radii up to the cell size
+			Real cellSize = level.hash.ds;
+			Real reach = (radius > cellSize ? radius : cellSize) + extra;
+			int range = (int)ceil(reach / cellSize);
+
+			//Cells outside of the extent of the level are empty, large radii only visit the occupied box
+			int3 c = level.hash.getIndex3(pos);
+			int3 cLo = make_int3(max(c.x - range, 0), max(c.y - range, 0), max(c.z - range, 0));
+			int3 cHi = make_int3(min(c.x + range, level.hash.nx - 1), min(c.y + range, level.hash.ny - 1), min(c.z + range, level.hash.nz - 1));
+			for (int k = cLo.z; k <= cHi.z; k++)
+			{
+				for (int j = cLo.y; j <= cHi.y; j++)
+				{
+					for (int i = cLo.x; i <= cHi.x; i++)
+					{
+						int cId = level.hash.getIndex(i, j, k);
+						if (cId == INVALID) continue;
+
+						int totalNum = level.hash.getCounter(cId);
+						for (int n = 0; n < totalNum; n++)
+						{
+							int lId = level.hash.getParticleId(cId, n);
+							Real r_j = level.radius[lId];
+							Real d = (pos - level.position[lId]).norm();
+							if (d < (radius > r_j ? radius : r_j) + extra)
+							{
+								func(level.ids[lId], d);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	struct LevelNeighborCounter
+	{
+		int num;
+		template<typename Real>
+		GPU_FUNC void operator()(int id, Real d) { num++; }
+	};
+
+	struct LevelNeighborCollector
+	{
+		NeighborList<int>* nbr;
+		int pId;
+		int num;
+		template<typename Real>
+		GPU_FUNC void operator()(int id, Real d) { nbr->setElement(pId, num++, id); }
+	};
+
+	template<typename Real>
+	struct LevelNeighborHeap
+	{
+		KNearestHeap<Real>* heap;
+		GPU_FUNC void operator()(int id, Real d) { heap->insert(id, d); }
+	};
+
+	template<typename TDataType>
+	__global__ void K_CountLevelNeighbors(
+		DeviceArray<int> count,
+		DeviceArray<typename TDataType::Coord> pos,
+		DeviceArray<typename TDataType::Real> radii,
+		GridLevel<TDataType>* levels,
+		int levelNum,
+		typename TDataType::Real extra)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		LevelNeighborCounter counter;
+		counter.num = 0;
+		forEachNeighborInLevels(levels, levelNum, pos[pId], radii[pId], extra, counter);
+		count[pId] = counter.num;
+	}
+
+	template<typename TDataType>
+	__global__ void K_CollectLevelNeighbors(
+		NeighborList<int> nbr,
+		DeviceArray<typename TDataType::Coord> pos,
+		DeviceArray<typename TDataType::Real> radii,
+		GridLevel<TDataType>* levels,
+		int levelNum,
+		typename TDataType::Real extra)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		LevelNeighborCollector collector;
+		collector.nbr = &nbr;
+		collector.pId = pId;
+		collector.num = 0;
+		forEachNeighborInLevels(levels, levelNum, pos[pId], radii[pId], extra, collector);
+	}
+
+	template<typename TDataType>
+	__global__ void K_CollectClosestLevelNeighbors(
+		NeighborList<int> nbr,
+		DeviceArray<typename TDataType::Coord> pos,
+		DeviceArray<typename TDataType::Real> radii,
+		GridLevel<TDataType>* levels,
+		int levelNum,
+		typename TDataType::Real extra,
+		int* heapIDs,
+		typename TDataType::Real* heapDistance)
+	{
+		typedef typename TDataType::Real Real;
+
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		int nbrLimit = nbr.getNeighborLimit();
+
+		int localIds[KNN_LOCAL_CAPACITY];
+		Real localDistance[KNN_LOCAL_CAPACITY];
+		int* ids = heapIDs == nullptr ? localIds : heapIDs + pId * nbrLimit;
+		Real* distance = heapDistance == nullptr ? localDistance : heapDistance + pId * nbrLimit;
+
+		KNearestHeap<Real> heap(ids, distance, nbrLimit);
+		LevelNeighborHeap<Real> collector;
+		collector.heap = &heap;
+		forEachNeighborInLevels(levels, levelNum, pos[pId], radii[pId], extra, collector);
+		heap.sort();
+
+		nbr.setNeighborSize(pId, heap.size());
+		for (int ne = 0; ne < heap.size(); ne++)
+		{
+			nbr.setElement(pId, ne, heap.getId(ne));
+		}
+	}
+
+	template<typename TDataType>
+	void MultiLevelGridHash<TDataType>::queryNeighbors(NeighborList<int>& nbr, DeviceArray<Coord>& pos, DeviceArray<Real>& radii, Real extra)
+	{
+		int num = pos.size();
+		if (num <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		if (radii.size() != num)
+		{
+			Log::sendMessage(Log::Error, "MultiLevelGridHash: one radius per query point is required!");
+			return;
+		}
+
+		int nbrLimit = nbr.getNeighborLimit();
+		if (nbr.size() != num)
+			nbr.resize(num, nbrLimit);
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		if (nbr.isLimited())
+		{
+			//Large limits do not fit into local memory, their heaps are kept in global scratch
+			int* ids = nullptr;
+			Real* distance = nullptr;
+			if (nbrLimit > KNN_LOCAL_CAPACITY)
+			{
+				if (m_heapIds.size() < num * nbrLimit)
+				{
+					m_heapIds.resize(num * nbrLimit);
+					m_heapDistance.resize(num * nbrLimit);
+				}
+				ids = m_heapIds.getDataPtr();
+				distance = m_heapDistance.getDataPtr();
+			}
+
+			K_CollectClosestLevelNeighbors << <pDims, BLOCK_SIZE >> > (nbr, pos, radii, m_deviceLevels, m_deviceLevelNum, extra, ids, distance);
+			cuSynchronize();
+			return;
+		}
+
+		DeviceArray<int>& index = nbr.getIndex();
+		K_CountLevelNeighbors << <pDims, BLOCK_SIZE >> > (index, pos, radii, m_deviceLevels, m_deviceLevelNum, extra);
+		cuSynchronize();
+
+		int total = thrust::reduce(thrust::device, index.getDataPtr(), index.getDataPtr() + num, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + num, index.getDataPtr());
+
+		if (total == 0)
+		{
+			nbr.getElements().release();
+			return;
+		}
+
+		if (nbr.getElements().size() != total)
+			nbr.getElements().resize(total);
+
+		K_CollectLevelNeighbors << <pDims, BLOCK_SIZE >> > (nbr, pos, radii, m_deviceLevels, m_deviceLevelNum, extra);
+		cuSynchronize();
+	}
+
+	template<typename TDataType>
+	void MultiLevelGridHash<TDataType>::release()
+	{
+		for (int l = 0; l < m_levels.size(); l++)
+		{
+			m_levels[l].hash.release();
+			m_levelPosition[l].release();
+			m_levelRadius[l].release();
+			m_levelIds[l].release();
+		}
+		m_levels.clear();
+		m_levelPosition.clear();
+		m_levelRadius.clear();
+		m_levelIds.clear();
+
+		m_levelKeys.release();
+		m_sortedIds.release();
+		m_heapIds.release();
+		m_heapDistance.release();
+
+		if (m_deviceLevels != nullptr)
+		{
+			cuSafeCall(cudaFree(m_deviceLevels));
+			m_deviceLevels = nullptr;
+		}
+		m_deviceLevelNum = 0;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "Core/DataTypes.h"
+#include "Core/Utility.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/SparseGridHash.h"
+#include "Framework/Topology/NeighborList.h"
+#include <vector>
+
+namespace PhysIKA{
+
+	#define MAX_GRID_LEVEL 16
+
+	/*!
+	*	\struct	GridLevel
+	*	\brief	One level of a MultiLevelGridHash as seen by the kernels.
+	*
+	*	The hash is built over the positions of the particles of this level only, ids maps them back to the particle ids.
+	*/
+	template<typename TDataType>
+	struct GridLevel
+	{
+		SparseGridHash<TDataType> hash;
+		typename TDataType::Coord* position;
+		typename TDataType::Real* radius;
+		int* ids;
+		int num;
+	};
+
+	/*!
+	*	\class	MultiLevelGridHash
+	*	\brief	Hierarchy of sparse grids for particles with individual search radii.
+	*
+	*	Level l has cells of size r_min * 2^l, each particle is inserted at the finest level whose cells are not smaller
+	*	than its radius. Particles i and j are neighbors when their distance is below max(r_i, r_j), so the lists are
+	*	symmetric. A query visits every non-empty level with the cells covering max(r_i, cell size) around the particle.
+	*/
+	template<typename TDataType>
+	class MultiLevelGridHash
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		MultiLevelGridHash();
+		~MultiLevelGridHash();
+
+		/**
+		 * @brief Distribute the particles over the levels by their radii and hash each level
+		 */
+		void construct(DeviceArray<Coord>& pos, DeviceArray<Real>& radii);
+
+		/**
+		 * @brief Find the hashed particles within max(radii[i], r_j) + extra of each point pos[i]
+		 *
+		 * nbr keeps its layout, lists with a neighbor limit keep the closest particles.
+		 */
+		void queryNeighbors(NeighborList<int>& nbr, DeviceArray<Coord>& pos, DeviceArray<Real>& radii, Real extra = Real(0));
+
+		int getLevelNum() { return (int)m_levels.size(); }
+
+		/// Number of particles inserted at level l
+		int getLevelSize(int l) { return m_levels[l].num; }
+
+		void release();
+
+	private:
+		void uploadLevels();
+
+		std::vector<GridLevel<TDataType>> m_levels;
+		GridLevel<TDataType>* m_deviceLevels = nullptr;
+		int m_deviceLevelNum = 0;
+
+		std::vector<DeviceArray<Coord>> m_levelPosition;
+		std::vector<DeviceArray<Real>> m_levelRadius;
+		std::vector<DeviceArray<int>> m_levelIds;
+
+		DeviceArray<int> m_levelKeys;
+		DeviceArray<int> m_sortedIds;
+
+		/// Heaps of limited lists above the local capacity, grown on demand and kept between queries
+		DeviceArray<int> m_heapIds;
+		DeviceArray<Real> m_heapDistance;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class MultiLevelGridHash<DataType3f>;
+#else
+	template class MultiLevelGridHash<DataType3d>;
+#endif
+}
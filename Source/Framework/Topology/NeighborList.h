@@ -5,7 +5,14 @@
 
 namespace PhysIKA
 {
-	template<typename ElementType>
+	/*!
+	*	\class	NeighborList
+	*	\brief	Neighbors of a set of elements, either in a compact layout (index holds prefix sums)
+	*			or with a fixed capacity per element (index holds the neighbor counts).
+	*
+	*	The layout is the same on both devices, so lists built on the host and on the GPU can be copied into each other.
+	*/
+	template<typename ElementType, DeviceType deviceType = DeviceType::GPU>
 	class NeighborList
 	{
 	public:
@@ -24,8 +31,8 @@ namespace PhysIKA
 
 		COMM_FUNC int size() { return m_index.size(); }
 
-		GPU_FUNC int getNeighborSize(int i)
-		{ 
+		COMM_FUNC int getNeighborSize(int i)
+		{
 			if (!isLimited())
 			{
 				if (i >= m_index.size() - 1)
@@ -45,20 +52,20 @@ namespace PhysIKA
 			return m_maxNum;
 		}
 
-		GPU_FUNC void setNeighborSize(int i, int num)
+		COMM_FUNC void setNeighborSize(int i, int num)
 		{
 			if (isLimited())
 				m_index[i] = num;
 		}
 
-		GPU_FUNC ElementType getElement(int i, int j) {
+		COMM_FUNC ElementType getElement(int i, int j) {
 			if (!isLimited())
 				return m_elements[m_index[i] + j];
 			else
 				return m_elements[m_maxNum*i + j];
 		};
 
-		GPU_FUNC void setElement(int i, int j, ElementType elem) {
+		COMM_FUNC void setElement(int i, int j, ElementType elem) {
 			if (!isLimited())
 				m_elements[m_index[i] + j] = elem;
 			else
@@ -81,7 +88,7 @@ namespace PhysIKA
 				setDynamic();
 			}
 		}
-		
+
 		void release()
 		{
 			m_elements.release();
@@ -99,28 +106,34 @@ namespace PhysIKA
 			m_maxNum = 0;
 		}
 
-		void copyFrom(NeighborList<ElementType>& neighborlist)
+		template<DeviceType srcType>
+		void copyFrom(NeighborList<ElementType, srcType>& neighborlist)
 		{
-			m_maxNum = neighborlist.m_maxNum;
-			if (m_elements.size() != neighborlist.m_elements.size())
-				m_elements.resize(neighborlist.m_elements.size());
+			m_maxNum = neighborlist.getNeighborLimit();
+			if (neighborlist.getElements().size() == 0)
+				m_elements.release();
+			else if (m_elements.size() != neighborlist.getElements().size())
+				m_elements.resize(neighborlist.getElements().size());
 
-			Function1Pt::copy(m_elements, neighborlist.m_elements);
+			Function1Pt::copy(m_elements, neighborlist.getElements());
 
-			if (m_index.size() != neighborlist.m_index.size())
-				m_index.resize(neighborlist.m_index.size());
+			if (m_index.size() != neighborlist.getIndex().size())
+				m_index.resize(neighborlist.getIndex().size());
+
+			Function1Pt::copy(m_index, neighborlist.getIndex());
 
-			Function1Pt::copy(m_index, neighborlist.m_index);
-			
 		}
 
-		DeviceArray<int>& getIndex() { return m_index; }
-		DeviceArray<ElementType>& getElements() { return m_elements; }
+		Array<int, deviceType>& getIndex() { return m_index; }
+		Array<ElementType, deviceType>& getElements() { return m_elements; }
 
 	private:
 
 		int m_maxNum;
-		DeviceArray<ElementType> m_elements;
-		DeviceArray<int> m_index;
+		Array<ElementType, deviceType> m_elements;
+		Array<int, deviceType> m_index;
 	};
-}
\ No newline at end of file
+
+	template<typename ElementType>
+	using HostNeighborList = NeighborList<ElementType, DeviceType::CPU>;
+}
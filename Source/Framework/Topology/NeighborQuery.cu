@@ -6,6 +6,11 @@
 #include "Framework/Topology/FieldNeighbor.h"
 #include "Framework/Framework/SceneGraph.h"
 #include "Core/Utility/Scan.h"
+#include "Framework/Framework/Log.h"
+#include "Framework/Topology/KNearestHeap.h"
+#include <algorithm>
+#include <thrust/fill.h>
+#include <thrust/execution_policy.h>
 
 namespace PhysIKA
 {
@@ -42,31 +47,53 @@ namespace PhysIKA
 	NeighborQuery<TDataType>::NeighborQuery()
 		: ComputeModule()
 		, m_maxNum(0)
+		, m_sparseGrid(false)
+		, m_halfList(false)
+		, m_variableRadius(false)
+		, m_cellWalkEnabled(false)
+		, m_hybridCapacity(0)
+		, m_skin(Real(0))
+		, m_spaceRadius(Real(0))
+		, m_adhocCellSize(Real(0))
+		, m_buildCount(0)
+		, m_invalidated(false)
+		, m_boundSet(false)
+		, m_deviceType(DeviceType::GPU)
 	{
-
-		Vector3f sceneLow = SceneGraph::getInstance().getLowerBound();
-		Vector3f sceneUp = SceneGraph::getInstance().getUpperBound();
-
-		m_lowBound = Coord(sceneLow[0], sceneLow[1], sceneLow[2]);
-		m_highBound = Coord(sceneUp[0], sceneUp[1], sceneUp[2]);
 		m_radius.setValue(Real(0.011));
+		m_cellWalk.setValue(CellWalkNeighbors<TDataType>());
+		m_hybridNeighborhood.setValue(HybridNeighborList());
 
 		attachField(&m_radius, "Radius", "Radius of the searching area", false);
 		attachField(&m_position, "position", "Storing the particle positions!", false);
 		attachField(&m_neighborhood, "ParticleNeighbor", "Storing particle neighbors!", false);
+		attachField(&m_referencePosition, "reference_position", "Particle positions at the last neighbor list build!", false);
+		attachField(&m_particleRadius, "particle_radius", "Search radius of each particle!", false);
+		attachField(&m_cellWalk, "cell_walk", "Grid walked by solvers instead of neighbor lists!", false);
+		attachField(&m_hybridNeighborhood, "hybrid_neighborhood", "Particle neighbors with an inline capacity and an overflow pool!", false);
 	}
 
 
 	template<typename TDataType>
 	NeighborQuery<TDataType>::NeighborQuery(DeviceArray<Coord>& position)
 		: ComputeModule()
+		, m_maxNum(0)
+		, m_sparseGrid(false)
+		, m_halfList(false)
+		, m_variableRadius(false)
+		, m_cellWalkEnabled(false)
+		, m_hybridCapacity(0)
+		, m_skin(Real(0))
+		, m_spaceRadius(Real(0))
+		, m_adhocCellSize(Real(0))
+		, m_buildCount(0)
+		, m_invalidated(false)
+		, m_boundSet(false)
+		, m_deviceType(DeviceType::GPU)
 	{
-		Vector3f sceneLow = SceneGraph::getInstance().getLowerBound();
-		Vector3f sceneUp = SceneGraph::getInstance().getUpperBound();
-
-		m_lowBound = Coord(sceneLow[0], sceneLow[1], sceneLow[2]);
-		m_highBound = Coord(sceneUp[0], sceneUp[1], sceneUp[2]);
 		m_radius.setValue(Real(0.011));
+		m_cellWalk.setValue(CellWalkNeighbors<TDataType>());
+		m_hybridNeighborhood.setValue(HybridNeighborList());
 
 		m_position.setElementCount(position.size());
 		Function1Pt::copy(m_position.getValue(), position);
@@ -74,20 +101,53 @@ namespace PhysIKA
 		attachField(&m_radius, "Radius", "Radius of the searching area", false);
 		attachField(&m_position, "position", "Storing the particle positions!", false);
 		attachField(&m_neighborhood, "ParticleNeighbor", "Storing particle neighbors!", false);
+		attachField(&m_referencePosition, "reference_position", "Particle positions at the last neighbor list build!", false);
+		attachField(&m_particleRadius, "particle_radius", "Search radius of each particle!", false);
+		attachField(&m_cellWalk, "cell_walk", "Grid walked by solvers instead of neighbor lists!", false);
+		attachField(&m_hybridNeighborhood, "hybrid_neighborhood", "Particle neighbors with an inline capacity and an overflow pool!", false);
 	}
 
 	template<typename TDataType>
 	NeighborQuery<TDataType>::~NeighborQuery()
 	{
 		m_hash.release();
+		m_sparseHash.release();
+		m_adhocHash.release();
+		m_adhocSparseHash.release();
+		m_multiHash.release();
+		m_hybridNeighborhood.getValue().release();
+
+		m_hostPosition.release();
+		m_hostQueryPosition.release();
+		m_hostNeighbors.release();
+
+		m_blockMax.release();
+		m_hostBlockMax.release();
+
+		m_heapIds.release();
+		m_heapDistance.release();
 	}
 
 	template<typename TDataType>
 	NeighborQuery<TDataType>::NeighborQuery(Real s, Coord lo, Coord hi)
 		: ComputeModule()
 		, m_maxNum(0)
+		, m_sparseGrid(false)
+		, m_halfList(false)
+		, m_variableRadius(false)
+		, m_cellWalkEnabled(false)
+		, m_hybridCapacity(0)
+		, m_skin(Real(0))
+		, m_spaceRadius(Real(0))
+		, m_adhocCellSize(Real(0))
+		, m_buildCount(0)
+		, m_invalidated(false)
+		, m_boundSet(true)
+		, m_deviceType(DeviceType::GPU)
 	{
 		m_radius.setValue(Real(s));
+		m_cellWalk.setValue(CellWalkNeighbors<TDataType>());
+		m_hybridNeighborhood.setValue(HybridNeighborList());
 
 		m_lowBound = lo;
 		m_highBound = hi;
@@ -95,6 +155,10 @@ namespace PhysIKA
 		attachField(&m_radius, "Radius", "Radius of the searching area", false);
 		attachField(&m_position, "position", "Storing the particle positions!", false);
 		attachField(&m_neighborhood, "ParticleNeighbor", "Storing particle neighbors!", false);
+		attachField(&m_referencePosition, "reference_position", "Particle positions at the last neighbor list build!", false);
+		attachField(&m_particleRadius, "particle_radius", "Search radius of each particle!", false);
+		attachField(&m_cellWalk, "cell_walk", "Grid walked by solvers instead of neighbor lists!", false);
+		attachField(&m_hybridNeighborhood, "hybrid_neighborhood", "Particle neighbors with an inline capacity and an overflow pool!", false);
 	}
 
 	template<typename TDataType>
@@ -105,6 +169,16 @@ namespace PhysIKA
 			m_neighborhood.setElementCount(m_position.getElementCount(), m_maxNum);
 		}
 
+		if (!m_position.isEmpty() && m_referencePosition.isEmpty())
+		{
+			m_referencePosition.setElementCount(m_position.getElementCount());
+		}
+
+		if (!m_position.isEmpty())
+		{
+			updateParticleRadius();
+		}
+
 		if (!isAllFieldsReady())
 		{
 			std::cout << "Exception: " << std::string("NeighborQuery's fields are not fully initialized!") << "\n";
@@ -132,7 +206,7 @@ namespace PhysIKA
 // 			m_highBound[2] = max(hostPos[i][2], m_highBound[2]);
 // 		}
 
-		m_hash.setSpace(m_radius.getValue(), m_lowBound, m_highBound);
+		updateSpace(m_radius.getValue() + m_skin);
 
 //		m_reduce = Reduction<int>::Create(m_position.getElementCount());
 
@@ -144,17 +218,206 @@ namespace PhysIKA
 	template<typename TDataType>
 	void NeighborQuery<TDataType>::compute()
 	{
-		m_hash.clear();
-		m_hash.construct(m_position.getValue());
+		ModuleTimer timer(this, m_position.getElementCount());
+
+		if (m_skin > Real(0) && !isRebuildRequired())
+		{
+			return;
+		}
+
+		Real h = m_radius.getValue() + m_skin;
+		updateSpace(h);
+
+		if (m_deviceType == DeviceType::GPU && m_sparseGrid && !m_cellWalkEnabled && !m_variableRadius
+			&& !m_sparseHash.construct(m_position.getValue()))
+		{
+			Log::sendMessage(Log::Warning, "NeighborQuery: falling back to the dense grid!");
+			setSparseGrid(false);
+			updateSpace(h);
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			queryNeighborsOnHost(m_hostQuery, m_neighborhood.getValue(), m_position.getValue(), h);
+		}
+		else if (m_cellWalkEnabled)
+		{
+			m_hash.update(m_position.getValue());
+			m_cellWalk.setValue(CellWalkNeighbors<TDataType>(m_hash, m_position.getValue()));
+		}
+		else if (m_variableRadius)
+		{
+			updateParticleRadius();
+			m_multiHash.construct(m_position.getValue(), m_particleRadius.getValue());
+			m_multiHash.queryNeighbors(m_neighborhood.getValue(), m_position.getValue(), m_particleRadius.getValue(), m_skin);
+		}
+		else if (m_sparseGrid)
+		{
+			if (m_hybridCapacity > 0)
+				queryNeighborHybrid(m_sparseHash, m_hybridNeighborhood.getValue(), m_position.getValue(), h);
+			else
+				queryNeighbors(m_sparseHash, m_neighborhood.getValue(), m_position.getValue(), h);
+		}
+		else
+		{
+			m_hash.update(m_position.getValue());
+			if (m_hybridCapacity > 0)
+				queryNeighborHybrid(m_hash, m_hybridNeighborhood.getValue(), m_position.getValue(), h);
+			else
+				queryNeighbors(m_hash, m_neighborhood.getValue(), m_position.getValue(), h);
+		}
+
+		if (m_skin > Real(0))
+		{
+			if (m_referencePosition.isEmpty() || m_referencePosition.getElementCount() != m_position.getElementCount())
+			{
+				m_referencePosition.setElementCount(m_position.getElementCount());
+			}
+			Function1Pt::copy(m_referencePosition.getValue(), m_position.getValue());
+		}
+
+		m_buildCount++;
+		m_invalidated = false;
+	}
+
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::invalidate()
+	{
+		m_invalidated = true;
+		m_hash.invalidate();
+		m_adhocHash.invalidate();
+	}
+
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::updateParticleRadius()
+	{
+		int pNum = m_position.getElementCount();
+		if (!m_particleRadius.isEmpty() && m_particleRadius.getElementCount() == pNum)
+		{
+			return;
+		}
+
+		m_particleRadius.setElementCount(pNum);
+		Real* radii = m_particleRadius.getValue().getDataPtr();
+		thrust::fill(thrust::device, radii, radii + pNum, m_radius.getValue());
+	}
+
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::updateSpace(Real h)
+	{
+		if (m_spaceRadius >= h)
+		{
+			return;
+		}
 
-		if (!m_neighborhood.getValue().isLimited())
+		if (m_deviceType == DeviceType::GPU && m_sparseGrid && !m_cellWalkEnabled)
 		{
-			queryNeighborDynamic(m_neighborhood.getValue(), m_position.getValue(), m_radius.getValue());
+			//The sparse grid takes its bounds from the particles
+			m_sparseHash.setSpace(h);
 		}
 		else
 		{
-			queryNeighborFixed(m_neighborhood.getValue(), m_position.getValue(), m_radius.getValue());
+			updateBoundingBox();
+			if (m_deviceType == DeviceType::CPU)
+				m_hostQuery.setSpace(h, m_lowBound, m_highBound);
+			else
+				m_hash.setSpace(h, m_lowBound, m_highBound);
 		}
+
+		m_spaceRadius = h;
+	}
+
+	template<typename TDataType>
+	template<typename Hash>
+	void NeighborQuery<TDataType>::queryNeighbors(Hash& hash, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h)
+	{
+		if (!nbrList.isLimited())
+		{
+			queryNeighborDynamic(hash, nbrList, pos, h);
+		}
+		else
+		{
+			queryNeighborFixed(hash, nbrList, pos, h);
+		}
+	}
+
+	template<typename TDataType>
+	bool NeighborQuery<TDataType>::isHalfQuery(DeviceArray<Coord>& pos)
+	{
+		//Pairs can only be split when the query points are the hashed points
+		return m_halfList && pos.getDataPtr() == m_position.getValue().getDataPtr();
+	}
+
+	//Upper bound of the number of blocks used to reduce the displacements
+#define DISPLACEMENT_MAX_BLOCKS 256
+
+	template<typename Real, typename Coord>
+	__global__ void K_MaxDisplacement(
+		DeviceArray<Real> blockMax,
+		DeviceArray<Coord> position,
+		DeviceArray<Coord> reference)
+	{
+		__shared__ Real dMax[BLOCK_SIZE];
+
+		int tId = threadIdx.x;
+
+		//Displacements are reduced on the fly instead of being stored
+		Real d = Real(0);
+		for (int pId = threadIdx.x + (blockIdx.x * blockDim.x); pId < position.size(); pId += blockDim.x * gridDim.x)
+		{
+			d = max(d, (position[pId] - reference[pId]).normSquared());
+		}
+
+		dMax[tId] = d;
+		__syncthreads();
+
+		for (int s = blockDim.x / 2; s > 0; s >>= 1)
+		{
+			if (tId < s)
+			{
+				dMax[tId] = max(dMax[tId], dMax[tId + s]);
+			}
+			__syncthreads();
+		}
+
+		if (tId == 0)
+		{
+			blockMax[blockIdx.x] = dMax[0];
+		}
+	}
+
+	template<typename TDataType>
+	bool NeighborQuery<TDataType>::isRebuildRequired()
+	{
+		int num = m_position.getElementCount();
+		if (m_invalidated || m_buildCount == 0 || m_referencePosition.isEmpty() || m_referencePosition.getElementCount() != num)
+		{
+			return true;
+		}
+
+		if (m_blockMax.size() != DISPLACEMENT_MAX_BLOCKS)
+		{
+			m_blockMax.resize(DISPLACEMENT_MAX_BLOCKS);
+			m_hostBlockMax.resize(DISPLACEMENT_MAX_BLOCKS);
+		}
+
+		cuint pDims = std::min(cudaGridSize(num, BLOCK_SIZE), (cuint)DISPLACEMENT_MAX_BLOCKS);
+		K_MaxDisplacement << <pDims, BLOCK_SIZE >> > (
+			m_blockMax,
+			m_position.getValue(),
+			m_referencePosition.getValue());
+		cuSynchronize();
+
+		Function1Pt::copy(m_hostBlockMax, m_blockMax);
+
+		Real maxDisp2 = Real(0);
+		for (cuint i = 0; i < pDims; i++)
+		{
+			maxDisp2 = std::max(maxDisp2, m_hostBlockMax[i]);
+		}
+
+		Real halfSkin = Real(0.5) * m_skin;
+		return maxDisp2 > halfSkin * halfSkin;
 	}
 
 
@@ -163,6 +426,23 @@ namespace PhysIKA
 	{
 		m_lowBound = lowerBound;
 		m_highBound = upperBound;
+		m_boundSet = true;
+	}
+
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::updateBoundingBox()
+	{
+		if (m_boundSet)
+		{
+			return;
+		}
+
+		SceneGraph* scene = this->getSceneGraph();
+		Vector3f sceneLow = scene->getLowerBound();
+		Vector3f sceneUp = scene->getUpperBound();
+
+		m_lowBound = Coord(sceneLow[0], sceneLow[1], sceneLow[2]);
+		m_highBound = Coord(sceneUp[0], sceneUp[1], sceneUp[2]);
 	}
 
 	template<typename TDataType>
@@ -187,29 +467,79 @@ namespace PhysIKA
 // 			m_highBound[2] = max(hostPos[i][2], m_highBound[2]);
 // 		}
 
-		m_hash.setSpace(radius, m_lowBound, m_highBound);
-		m_hash.construct(m_position.getValue());
+		queryNeighbors(nbr, pos, radius, radius);
+	}
 
-		if (!nbr.isLimited())
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::queryKNearest(NeighborList<int>& nbr, DeviceArray<Coord>& pos, int k, Real maxRadius)
+	{
+		if (k <= 0 || pos.size() <= 0)
 		{
-			queryNeighborDynamic(nbr, pos, radius);
+			nbr.release();
+			return;
 		}
-		else
+
+		if (nbr.size() != pos.size() || nbr.getNeighborLimit() != k)
 		{
-			queryNeighborFixed(nbr, pos, radius);
+			nbr.resize(pos.size(), k);
 		}
+
+		//Cells of the size of the radius setting keep the rings tight when maxRadius is only a loose bound
+		Real r = m_radius.getValue();
+		Real cellSize = (r > Real(0) && r < maxRadius) ? r : maxRadius;
+
+		queryNeighbors(nbr, pos, cellSize, maxRadius);
 	}
 
-	template<typename Real, typename Coord, typename TDataType>
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::queryNeighbors(NeighborList<int>& nbr, DeviceArray<Coord>& pos, Real cellSize, Real radius)
+	{
+		//The grids of compute() are left untouched, so its incremental updates and the skin stay valid
+		bool resized = m_adhocCellSize != cellSize;
+		m_adhocCellSize = cellSize;
+
+		if (m_deviceType == DeviceType::GPU && m_sparseGrid)
+		{
+			m_adhocSparseHash.setSpace(cellSize);
+			if (m_adhocSparseHash.construct(m_position.getValue()))
+			{
+				queryNeighbors(m_adhocSparseHash, nbr, pos, radius);
+				return;
+			}
+			resized = true;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			if (resized || m_adhocHostQuery.getHash().num == 0)
+			{
+				updateBoundingBox();
+				m_adhocHostQuery.setSpace(cellSize, m_lowBound, m_highBound);
+			}
+			queryNeighborsOnHost(m_adhocHostQuery, nbr, pos, radius);
+			return;
+		}
+
+		if (resized || m_adhocHash.counter == nullptr)
+		{
+			updateBoundingBox();
+			m_adhocHash.setSpace(cellSize, m_lowBound, m_highBound);
+		}
+		m_adhocHash.update(m_position.getValue());
+		queryNeighbors(m_adhocHash, nbr, pos, radius);
+	}
+
+	template<typename Real, typename Coord, typename Hash>
 	__global__ void K_CalNeighborSize(
 		DeviceArray<int> count,
 		DeviceArray<Coord> position_new,
 		DeviceArray<Coord> position, 
-		GridHash<TDataType> hash, 
-		Real h)
+		Hash hash, 
+		Real h,
+		bool half)
 	{
 		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
-		if (pId > position_new.size()) return;
+		if (pId >= position_new.size()) return;
 
 		Coord pos_ijk = position_new[pId];
 		int3 gId3 = hash.getIndex3(pos_ijk);
@@ -223,7 +553,7 @@ namespace PhysIKA
 				for (int i = 0; i < totalNum; i++) {
 					int nbId = hash.getParticleId(cId, i);
 					Real d_ij = (pos_ijk - position[nbId]).norm();
-					if (d_ij < h)
+					if (d_ij < h && (!half || nbId > pId))
 					{
 						counter++;
 					}
@@ -234,16 +564,17 @@ namespace PhysIKA
 		count[pId] = counter;
 	}
 
-	template<typename Real, typename Coord, typename TDataType>
+	template<typename Real, typename Coord, typename Hash>
 	__global__ void K_GetNeighborElements(
 		NeighborList<int> nbr,
 		DeviceArray<Coord> position_new,
 		DeviceArray<Coord> position, 
-		GridHash<TDataType> hash, 
-		Real h)
+		Hash hash, 
+		Real h,
+		bool half)
 	{
 		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
-		if (pId > position_new.size()) return;
+		if (pId >= position_new.size()) return;
 
 		Coord pos_ijk = position_new[pId];
 		int3 gId3 = hash.getIndex3(pos_ijk);
@@ -257,7 +588,7 @@ namespace PhysIKA
 				for (int i = 0; i < totalNum; i++) {
 					int nbId = hash.getParticleId(cId, i);
 					Real d_ij = (pos_ijk - position[nbId]).norm();
-					if (d_ij < h)
+					if (d_ij < h && (!half || nbId > pId))
 					{
 						nbr.setElement(pId, j, nbId);
 						j++;
@@ -268,19 +599,21 @@ namespace PhysIKA
 	}
 
 	template<typename TDataType>
-	void NeighborQuery<TDataType>::queryNeighborSize(DeviceArray<int>& num, DeviceArray<Coord>& pos, Real h)
+	template<typename Hash>
+	void NeighborQuery<TDataType>::queryNeighborSize(Hash& hash, DeviceArray<int>& num, DeviceArray<Coord>& pos, Real h)
 	{
 		uint pDims = cudaGridSize(num.size(), BLOCK_SIZE);
-		K_CalNeighborSize << <pDims, BLOCK_SIZE >> > (num, pos, m_position.getValue(), m_hash, h);
+		K_CalNeighborSize << <pDims, BLOCK_SIZE >> > (num, pos, m_position.getValue(), hash, h, isHalfQuery(pos));
 		cuSynchronize();
 	}
 
 	template<typename TDataType>
-	void NeighborQuery<TDataType>::queryNeighborDynamic(NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h)
+	template<typename Hash>
+	void NeighborQuery<TDataType>::queryNeighborDynamic(Hash& hash, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h)
 	{
 		DeviceArray<int>& nbrNum = nbrList.getIndex();
 
-		queryNeighborSize(nbrNum, pos, h);
+		queryNeighborSize(hash, nbrNum, pos, h);
 
 		int sum = m_reduce.accumulate(nbrNum.getDataPtr(), nbrNum.size());
 
@@ -294,30 +627,26 @@ namespace PhysIKA
 			elements.resize(sum);
 
 			uint pDims = cudaGridSize(pos.size(), BLOCK_SIZE);
-			K_GetNeighborElements << <pDims, BLOCK_SIZE >> > (nbrList, pos, m_position.getValue(), m_hash, h);
+			K_GetNeighborElements << <pDims, BLOCK_SIZE >> > (nbrList, pos, m_position.getValue(), hash, h, isHalfQuery(pos));
 			cuSynchronize();
 		}
 	}
 
-	template<typename Real, typename Coord, typename TDataType>
-	__global__ void K_ComputeNeighborFixed(
-		NeighborList<int> neighbors, 
-		DeviceArray<Coord> position_new,
-		DeviceArray<Coord> position, 
-		GridHash<TDataType> hash, 
+	/**
+	 * @brief Store the neighbors of pId whose rank in the stencil walk lies in [from, to), returns the neighbor count
+	 */
+	template<typename Real, typename Coord, typename Hash>
+	GPU_FUNC int fillNeighborRange(
+		HybridNeighborList& nbr,
+		int pId,
+		Coord pos_ijk,
+		DeviceArray<Coord>& position,
+		Hash& hash,
 		Real h,
-		int* heapIDs,
-		Real* heapDistance)
+		bool half,
+		int from,
+		int to)
 	{
-		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
-		if (pId > position_new.size()) return;
-
-		int nbrLimit = neighbors.getNeighborLimit();
-
-		int* ids(heapIDs + pId * nbrLimit);// = new int[nbrLimit];
-		Real* distance(heapDistance + pId * nbrLimit);// = new Real[nbrLimit];
-
-		Coord pos_ijk = position_new[pId];
 		int3 gId3 = hash.getIndex3(pos_ijk);
 
 		int counter = 0;
@@ -325,71 +654,168 @@ namespace PhysIKA
 		{
 			int cId = hash.getIndex(gId3.x + offset1[c][0], gId3.y + offset1[c][1], gId3.z + offset1[c][2]);
 			if (cId >= 0) {
-				int totalNum = hash.getCounter(cId);// min(hash.getCounter(cId), hash.npMax);
+				int totalNum = hash.getCounter(cId);
 				for (int i = 0; i < totalNum; i++) {
 					int nbId = hash.getParticleId(cId, i);
-					float d_ij = (pos_ijk - position[nbId]).norm();
-					if (d_ij < h)
+					Real d_ij = (pos_ijk - position[nbId]).norm();
+					if (d_ij < h && (!half || nbId > pId))
 					{
-						if (counter < nbrLimit)
-						{
-							ids[counter] = nbId;
-							distance[counter] = d_ij;
-							counter++;
-						}
-						else
-						{
-							int maxId = 0;
-							float maxDist = distance[0];
-							for (int ne = 1; ne < nbrLimit; ne++)
-							{
-								if (maxDist < distance[ne])
-								{
-									maxDist = distance[ne];
-									maxId = ne;
-								}
-							}
-							if (d_ij < distance[maxId])
-							{
-								distance[maxId] = d_ij;
-								ids[maxId] = nbId;
-							}
-						}
+						if (counter >= from && counter < to)
+							nbr.setElement(pId, counter, nbId);
+						counter++;
 					}
 				}
 			}
 		}
+		return counter;
+	}
 
-		neighbors.setNeighborSize(pId, counter);
+	template<typename Real, typename Coord, typename Hash>
+	__global__ void K_GetNeighborHybrid(
+		HybridNeighborList nbr,
+		DeviceArray<Coord> position_new,
+		DeviceArray<Coord> position,
+		Hash hash,
+		Real h,
+		bool half)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= position_new.size()) return;
+
+		Coord pos_ijk = position_new[pId];
+		int inlineNum = nbr.getInlineCapacity();
+
+		int counter = fillNeighborRange(nbr, pId, pos_ijk, position, hash, h, half, 0, inlineNum);
+
+		//Only particles of dense regions walk their cells a second time to store the rest
+		if (counter > inlineNum && nbr.setOverflowStart(pId, atomicAdd(nbr.getOverflowTop(), counter - inlineNum), counter - inlineNum))
+		{
+			fillNeighborRange(nbr, pId, pos_ijk, position, hash, h, half, inlineNum, counter);
+		}
+
+		nbr.setNeighborSize(pId, counter);
+	}
+
+	template<typename TDataType>
+	template<typename Hash>
+	void NeighborQuery<TDataType>::queryNeighborHybrid(Hash& hash, HybridNeighborList& nbrList, DeviceArray<Coord>& pos, Real h)
+	{
+		int num = pos.size();
+		if (num <= 0)
+		{
+			return;
+		}
+
+		nbrList.resize(num, m_hybridCapacity);
+
+		uint pDims = cudaGridSize(num, BLOCK_SIZE);
+		do
+		{
+			nbrList.beginFill();
+			K_GetNeighborHybrid << <pDims, BLOCK_SIZE >> > (nbrList, pos, m_position.getValue(), hash, h, isHalfQuery(pos));
+			cuSynchronize();
+		} while (!nbrList.endFill());
+	}
+
+	template<typename Real, typename Coord, typename Hash>
+	__global__ void K_ComputeNeighborFixed(
+		NeighborList<int> neighbors, 
+		DeviceArray<Coord> position_new,
+		DeviceArray<Coord> position, 
+		Hash hash, 
+		Real h,
+		bool half,
+		int* heapIDs,
+		Real* heapDistance)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= position_new.size()) return;
+
+		int nbrLimit = neighbors.getNeighborLimit();
 
-		int bId;
-		for (bId = 0; bId < counter; bId++)
+		int localIds[KNN_LOCAL_CAPACITY];
+		Real localDistance[KNN_LOCAL_CAPACITY];
+		int* ids = heapIDs == nullptr ? localIds : heapIDs + pId * nbrLimit;
+		Real* distance = heapDistance == nullptr ? localDistance : heapDistance + pId * nbrLimit;
+
+		//Keep the nbrLimit closest neighbors within h
+		KNearestHeap<Real> heap(ids, distance, nbrLimit);
+		searchKNearest(heap, hash, position, position_new[pId], h, half ? pId : -1);
+		heap.sort();
+
+		int counter = heap.size();
+		neighbors.setNeighborSize(pId, counter);
+		for (int bId = 0; bId < counter; bId++)
 		{
-			neighbors.setElement(pId, bId, ids[bId]);
+			neighbors.setElement(pId, bId, heap.getId(bId));
 		}
 	}
 
 	template<typename TDataType>
-	void NeighborQuery<TDataType>::queryNeighborFixed(NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h)
+	template<typename Hash>
+	void NeighborQuery<TDataType>::queryNeighborFixed(Hash& hash, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h)
 	{
 		int num = pos.size();
-		int* ids;
-		Real* distance;
-		cuSafeCall(cudaMalloc((void**)&ids, num * sizeof(int) * nbrList.getNeighborLimit()));
-		cuSafeCall(cudaMalloc((void**)&distance, num * sizeof(int) * nbrList.getNeighborLimit()));
+		int nbrLimit = nbrList.getNeighborLimit();
+
+		//Large limits do not fit into local memory, their heaps are kept in global scratch
+		int* ids = nullptr;
+		Real* distance = nullptr;
+		if (nbrLimit > KNN_LOCAL_CAPACITY)
+		{
+			if (m_heapIds.size() < num * nbrLimit)
+			{
+				m_heapIds.resize(num * nbrLimit);
+				m_heapDistance.resize(num * nbrLimit);
+			}
+			ids = m_heapIds.getDataPtr();
+			distance = m_heapDistance.getDataPtr();
+		}
 
 		uint pDims = cudaGridSize(num, BLOCK_SIZE);
 		K_ComputeNeighborFixed << <pDims, BLOCK_SIZE >> > (
 			nbrList, 
 			pos, 
 			m_position.getValue(), 
-			m_hash, 
+			hash, 
 			h, 
+			isHalfQuery(pos),
 			ids, 
 			distance);
 		cuSynchronize();
+	}
+
+	template<typename TDataType>
+	void NeighborQuery<TDataType>::queryNeighborsOnHost(HostNeighborQuery<TDataType>& query, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h)
+	{
+		DeviceArray<Coord>& points = m_position.getValue();
+		if (m_hostPosition.size() != points.size())
+			m_hostPosition.resize(points.size());
+		Function1Pt::copy(m_hostPosition, points);
+
+		HostArray<Coord>* queryPos = &m_hostPosition;
+		if (pos.getDataPtr() != points.getDataPtr())
+		{
+			if (m_hostQueryPosition.size() != pos.size())
+				m_hostQueryPosition.resize(pos.size());
+			Function1Pt::copy(m_hostQueryPosition, pos);
+			queryPos = &m_hostQueryPosition;
+		}
+
+		if (m_hostNeighbors.size() != pos.size() || m_hostNeighbors.getNeighborLimit() != nbrList.getNeighborLimit())
+			m_hostNeighbors.resize(pos.size(), nbrList.getNeighborLimit());
+
+		//The device may have been switched after initialization
+		if (query.getHash().num == 0)
+		{
+			updateBoundingBox();
+			query.setSpace(h, m_lowBound, m_highBound);
+		}
+
+		query.setHalfList(isHalfQuery(pos));
+		query.construct(m_hostPosition);
+		query.queryNeighbors(m_hostNeighbors, *queryPos, h);
 
-		cuSafeCall(cudaFree(ids));
-		cuSafeCall(cudaFree(distance));
+		nbrList.copyFrom(m_hostNeighbors);
 	}
-}
\ No newline at end of file
+}
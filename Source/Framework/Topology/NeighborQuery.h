@@ -4,11 +4,14 @@
 #include "Framework/Framework/FieldArray.h"
 #include "Framework/Topology/FieldNeighbor.h"
 #include "Framework/Topology/GridHash.h"
+#include "Framework/Topology/SparseGridHash.h"
+#include "Framework/Topology/MultiLevelGridHash.h"
+#include "Framework/Topology/CellWalkNeighbors.h"
+#include "Framework/Topology/HybridNeighborList.h"
+#include "Framework/Topology/HostNeighborQuery.h"
 #include "Core/Utility.h"
 
 namespace PhysIKA {
-	template<typename ElementType> class NeighborList;
-
 	template<typename TDataType>
 	class NeighborQuery : public ComputeModule
 	{
@@ -28,18 +31,128 @@ namespace PhysIKA {
 
 		void queryParticleNeighbors(NeighborList<int>& nbr, DeviceArray<Coord>& pos, Real radius);
 
+		/**
+		 * @brief Find the k closest points within maxRadius of each point in pos, sorted by ascending distance
+		 *
+		 * nbr becomes a list with a neighbor limit of k. The cells are searched in growing rings until the k closest points
+		 * are known, so maxRadius may be a loose bound. The cell size is the radius setting when it is smaller than maxRadius.
+		 */
+		void queryKNearest(NeighborList<int>& nbr, DeviceArray<Coord>& pos, int k, Real maxRadius);
+
 		void setNeighborSizeLimit(int num) { m_maxNum = num; }
 
+		/**
+		 * @brief Select where the grid hash and the neighbor lists are built, the result is always stored in the neighbor field
+		 */
+		void setDeviceType(DeviceType type) { m_deviceType = type; m_spaceRadius = Real(0); }
+		DeviceType getDeviceType() { return m_deviceType; }
+
+		/**
+		 * @brief Store only the occupied cells in a hash table sized by the particle number, bounds are taken from the particles
+		 *
+		 * Suited to large sparse domains, particles outside of the scene bounds keep their neighbors. Only used on the GPU.
+		 * Switches back to the dense grid for good when the particles span more cells than the sparse keys can encode.
+		 */
+		void setSparseGrid(bool sparse) { m_sparseGrid = sparse; m_spaceRadius = Real(0); }
+		bool isSparseGrid() { return m_sparseGrid; }
+
+		/**
+		 * @brief Only hash the particles, no neighbor lists are built
+		 *
+		 * Solvers connected to the cell_walk field visit the 27 cells around each particle themselves, see CellWalkNeighbors.
+		 * The neighborhood field keeps its index but no elements. Only used on the GPU, takes precedence over the sparse grid
+		 * and variable radii.
+		 */
+		void setCellWalk(bool walk) { m_cellWalkEnabled = walk; m_spaceRadius = Real(0); }
+		bool isCellWalk() { return m_cellWalkEnabled; }
+
+		/**
+		 * @brief Build the lists into the hybrid_neighborhood field with inlineCapacity inline neighbors per particle
+		 *
+		 * Dense regions spill into a shared overflow pool, the lists are filled in one pass without counting the neighbors
+		 * first and are never truncated, see HybridNeighborList. The neighborhood field keeps its index but no elements.
+		 * A capacity of 0 switches back to the neighborhood field. Only used on the GPU.
+		 */
+		void setHybridList(int inlineCapacity) { m_hybridCapacity = inlineCapacity; }
+		int getHybridCapacity() { return m_hybridCapacity; }
+
+		/**
+		 * @brief Search each particle within its own radius taken from the particle_radius field
+		 *
+		 * Particles i and j are neighbors when they are closer than max(r_i, r_j), the grid keeps one level per
+		 * power-of-two radius class. The radius setting fills particle_radius when it is not provided. Only used on the GPU.
+		 */
+		void setVariableRadius(bool variable) { m_variableRadius = variable; }
+		bool isVariableRadius() { return m_variableRadius; }
+
+		/**
+		 * @brief Store each pair once, point i only lists neighbors j > i
+		 *
+		 * Halves the distance tests and the list size. Only applies when the query points are the hashed points,
+		 * consumers have to apply the interaction to both particles, see PairSchedule.
+		 */
+		void setHalfList(bool half) { m_halfList = half; }
+		bool isHalfList() { return m_halfList; }
+
+		/**
+		 * @brief Verlet skin, lists are built with radius + skin and reused until a particle moved farther than skin / 2
+		 *
+		 * Lists may then contain particles up to radius + skin apart, consumers have to check the actual distance.
+		 * A skin of 0 rebuilds the lists on every call to compute().
+		 */
+		void setSkin(Real skin) { m_skin = skin; }
+		Real getSkin() { return m_skin; }
+
+		/// Number of times compute() actually rebuilt the lists
+		int getBuildCount() { return m_buildCount; }
+
+		/**
+		 * @brief Rebuild the grids and the lists from scratch at the next compute(), regardless of the skin
+		 *
+		 * Required whenever the particles were permuted, the incremental grid updates and the skin test compare
+		 * particles by their index.
+		 */
+		void invalidate();
+
 		NeighborList<int>& getNeighborList() { return m_neighborhood.getValue(); }
 
 	protected:
 		bool initializeImpl() override;
 
 	private:
-		void queryNeighborSize(DeviceArray<int>& num, DeviceArray<Coord>& pos, Real h);
-		void queryNeighborDynamic(NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h);
+		/// Take the bounds from the owning scene unless they are given explicitly
+		void updateBoundingBox();
+
+		/// Hash the points into the ad-hoc grid with the given cell size and search each point in pos within radius
+		void queryNeighbors(NeighborList<int>& nbr, DeviceArray<Coord>& pos, Real cellSize, Real radius);
+
+		template<typename Hash>
+		void queryNeighbors(Hash& hash, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h);
+
+		template<typename Hash>
+		void queryNeighborSize(Hash& hash, DeviceArray<int>& num, DeviceArray<Coord>& pos, Real h);
+		template<typename Hash>
+		void queryNeighborDynamic(Hash& hash, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h);
+
+		template<typename Hash>
+		void queryNeighborFixed(Hash& hash, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h);
+
+		template<typename Hash>
+		void queryNeighborHybrid(Hash& hash, HybridNeighborList& nbrList, DeviceArray<Coord>& pos, Real h);
+
+		void queryNeighborsOnHost(HostNeighborQuery<TDataType>& query, NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h);
+
+		/// Whether the list built for pos keeps only j > i
+		bool isHalfQuery(DeviceArray<Coord>& pos);
+
+		/// Make sure the grid cells are not smaller than the search radius
+		void updateSpace(Real h);
 
-		void queryNeighborFixed(NeighborList<int>& nbrList, DeviceArray<Coord>& pos, Real h);
+		/// Whether a particle moved farther than skin / 2 since the last build
+		bool isRebuildRequired();
+
+		/// Give every particle the radius setting when no radii are provided
+		void updateParticleRadius();
 
 	public:
 		VarField<Real> m_radius;
@@ -47,16 +160,59 @@ namespace PhysIKA {
 		DeviceArrayField<Coord> m_position;
 		NeighborField<int> m_neighborhood;
 
+		/// Search radius of each particle, only read when the radius is variable
+		DeviceArrayField<Real> m_particleRadius;
+
+		/// Grid of the last build, only assigned when lists are replaced by the cell walk
+		VarField<CellWalkNeighbors<TDataType>> m_cellWalk;
+
+		/// Lists of the last build, only filled when the hybrid layout is selected
+		VarField<HybridNeighborList> m_hybridNeighborhood;
+
 	private:
 		int m_maxNum;
 
+		Real m_skin;
+		Real m_spaceRadius;
+		int m_buildCount;
+		bool m_invalidated;
+
+		/// Positions at the last build, a field so that particle reordering keeps it consistent
+		DeviceArrayField<Coord> m_referencePosition;
+		DeviceArray<Real> m_blockMax;
+		HostArray<Real> m_hostBlockMax;
+
+		bool m_boundSet;
 		Coord m_lowBound;
 		Coord m_highBound;
 
 		GridHash<TDataType> m_hash;
 
-		int* m_ids;
-		Real* m_distance;
+		bool m_sparseGrid;
+		SparseGridHash<TDataType> m_sparseHash;
+
+		bool m_halfList;
+
+		bool m_variableRadius;
+		bool m_cellWalkEnabled;
+		int m_hybridCapacity;
+		MultiLevelGridHash<TDataType> m_multiHash;
+
+		/// Grids of queryParticleNeighbors() and queryKNearest(), separate from the grids of compute()
+		Real m_adhocCellSize;
+		GridHash<TDataType> m_adhocHash;
+		SparseGridHash<TDataType> m_adhocSparseHash;
+		HostNeighborQuery<TDataType> m_adhocHostQuery;
+
+		DeviceType m_deviceType;
+		HostNeighborQuery<TDataType> m_hostQuery;
+		HostArray<Coord> m_hostPosition;
+		HostArray<Coord> m_hostQueryPosition;
+		HostNeighborList<int> m_hostNeighbors;
+
+		/// Heaps of limited lists above the local capacity, grown on demand and kept between calls
+		DeviceArray<int> m_heapIds;
+		DeviceArray<Real> m_heapDistance;
 
 		Reduction<int> m_reduce;
 		Scan m_scan;
@@ -0,0 +1,260 @@
+#include <cuda_runtime.h>
+#include "PairKernel.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/sequence.h>
+#include <thrust/binary_search.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/execution_policy.h>
+#include <cfloat>
+
+namespace PhysIKA
+{
+	template<typename Coord>
+	struct PairCoordMinimum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.minimum(b); }
+	};
+
+	template<typename Coord>
+	struct PairCoordMaximum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.maximum(b); }
+	};
+
+	template<typename Real>
+	struct PairLengthMaximum
+	{
+		COMM_FUNC Real operator()(const Real& a, const Real& b) const { return a > b ? a : b; }
+	};
+
+	template<typename Real, typename Coord>
+	__global__ void K_PairLength(
+		DeviceArray<Real> length,
+		DeviceArray<Coord> pos,
+		NeighborList<int> nbr)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= length.size()) return;
+
+		Real maxLength = Real(0);
+		int nbSize = nbr.getNeighborSize(pId);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			int j = nbr.getElement(pId, ne);
+			Real r = (pos[pId] - pos[j]).norm();
+			maxLength = r > maxLength ? r : maxLength;
+		}
+		length[pId] = maxLength;
+	}
+
+	template<typename Real, typename Coord>
+	__global__ void K_ComputePairKeys(
+		DeviceArray<unsigned long long> keys,
+		DeviceArray<Coord> pos,
+		Coord lo,
+		Real ds,
+		int nx,
+		int ny,
+		int nz)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= keys.size()) return;
+
+		int i = (int)floor((pos[pId][0] - lo[0]) / ds);
+		int j = (int)floor((pos[pId][1] - lo[1]) / ds);
+		int k = (int)floor((pos[pId][2] - lo[2]) / ds);
+		i = i < 0 ? 0 : (i >= nx ? nx - 1 : i);
+		j = j < 0 ? 0 : (j >= ny ? ny - 1 : j);
+		k = k < 0 ? 0 : (k >= nz ? nz - 1 : k);
+
+		unsigned long long cellNum = (unsigned long long)nx * ny * nz;
+		unsigned long long cell = (unsigned long long)i + (unsigned long long)nx * (j + (unsigned long long)ny * k);
+		unsigned long long color = (i % 3) + 3 * (j % 3) + 9 * (k % 3);
+
+		keys[pId] = color * cellNum + cell;
+	}
+
+	__global__ void K_MarkCellStarts(
+		DeviceArray<int> flags,
+		DeviceArray<unsigned long long> keys)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= keys.size()) return;
+
+		flags[pId] = (pId == 0 || keys[pId] != keys[pId - 1]) ? 1 : 0;
+	}
+
+	__global__ void K_ScatterCellStarts(
+		DeviceArray<int> cellStart,
+		DeviceArray<int> cellColor,
+		DeviceArray<int> flags,
+		DeviceArray<unsigned long long> keys,
+		unsigned long long cellNum)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= keys.size()) return;
+
+		if (pId == 0 || keys[pId] != keys[pId - 1])
+		{
+			//flags hold the inclusive scan of the start marks
+			int cId = flags[pId] - 1;
+			cellStart[cId] = pId;
+			cellColor[cId] = (int)(keys[pId] / cellNum);
+		}
+	}
+
+	template<typename TDataType>
+	void PairSchedule<TDataType>::build(DeviceArray<Coord>& pos, NeighborList<int>& halfList)
+	{
+		m_batchOffset.assign(PAIR_COLOR_NUM + 1, 0);
+
+		int num = pos.size();
+		if (num <= 0)
+		{
+			m_cellStart.release();
+			return;
+		}
+
+		if (m_keys.size() != num)
+		{
+			m_keys.resize(num);
+			m_order.resize(num);
+			m_flags.resize(num);
+			m_pairLength.resize(num);
+		}
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+
+		//Cells must not be smaller than the longest pair so that both particles are at most one cell apart
+		K_PairLength << <pDims, BLOCK_SIZE >> > (m_pairLength, pos, halfList);
+		cuSynchronize();
+		Real ds = thrust::reduce(thrust::device, m_pairLength.getDataPtr(), m_pairLength.getDataPtr() + num, Real(0), PairLengthMaximum<Real>());
+		ds = ds > Real(0) ? Real(1.001) * ds : Real(1);
+
+		Coord* pPtr = pos.getDataPtr();
+		Coord lo = thrust::reduce(thrust::device, pPtr, pPtr + num, Coord((Real)FLT_MAX), PairCoordMinimum<Coord>());
+		Coord hi = thrust::reduce(thrust::device, pPtr, pPtr + num, Coord((Real)-FLT_MAX), PairCoordMaximum<Coord>());
+		Coord nSeg = (hi - lo) / ds;
+		int nx = (int)floor(nSeg[0]) + 1;
+		int ny = (int)floor(nSeg[1]) + 1;
+		int nz = (int)floor(nSeg[2]) + 1;
+		unsigned long long cellNum = (unsigned long long)nx * ny * nz;
+
+		K_ComputePairKeys << <pDims, BLOCK_SIZE >> > (m_keys, pos, lo, ds, nx, ny, nz);
+		cuSynchronize();
+
+		thrust::sequence(thrust::device, m_order.getDataPtr(), m_order.getDataPtr() + num);
+		thrust::sort_by_key(thrust::device, m_keys.getDataPtr(), m_keys.getDataPtr() + num, m_order.getDataPtr());
+
+		K_MarkCellStarts << <pDims, BLOCK_SIZE >> > (m_flags, m_keys);
+		cuSynchronize();
+		thrust::inclusive_scan(thrust::device, m_flags.getDataPtr(), m_flags.getDataPtr() + num, m_flags.getDataPtr());
+
+		int cellCount = 0;
+		cuSafeCall(cudaMemcpy(&cellCount, m_flags.getDataPtr() + num - 1, sizeof(int), cudaMemcpyDeviceToHost));
+
+		if (m_cellStart.size() != cellCount)
+			m_cellStart.resize(cellCount);
+
+		DeviceArray<int> cellColor(cellCount);
+		K_ScatterCellStarts << <pDims, BLOCK_SIZE >> > (m_cellStart, cellColor, m_flags, m_keys, cellNum);
+		cuSynchronize();
+
+		//Cells are sorted by color, the batches are the runs of equal colors
+		DeviceArray<int> batchOffset(PAIR_COLOR_NUM + 1);
+		thrust::lower_bound(thrust::device,
+			cellColor.getDataPtr(), cellColor.getDataPtr() + cellCount,
+			thrust::counting_iterator<int>(0), thrust::counting_iterator<int>(PAIR_COLOR_NUM + 1),
+			batchOffset.getDataPtr());
+		cuSafeCall(cudaMemcpy(&m_batchOffset[0], batchOffset.getDataPtr(), (PAIR_COLOR_NUM + 1) * sizeof(int), cudaMemcpyDeviceToHost));
+
+		cellColor.release();
+		batchOffset.release();
+	}
+
+	__global__ void K_CountHalfNeighbors(
+		DeviceArray<int> count,
+		NeighborList<int> full)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= count.size()) return;
+
+		int num = 0;
+		int nbSize = full.getNeighborSize(pId);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			if (full.getElement(pId, ne) > pId)
+				num++;
+		}
+		count[pId] = num;
+	}
+
+	__global__ void K_FillHalfNeighbors(
+		NeighborList<int> half,
+		NeighborList<int> full)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= half.size()) return;
+
+		int n = 0;
+		int nbSize = full.getNeighborSize(pId);
+		for (int ne = 0; ne < nbSize; ne++)
+		{
+			int j = full.getElement(pId, ne);
+			if (j > pId)
+			{
+				half.setElement(pId, n, j);
+				n++;
+			}
+		}
+	}
+
+	template<typename TDataType>
+	void PairSchedule<TDataType>::extractHalfList(NeighborList<int>& full, NeighborList<int>& half)
+	{
+		int num = full.size();
+		if (num <= 0)
+		{
+			half.release();
+			return;
+		}
+
+		if (half.size() != num)
+			half.resize(num);
+		half.setDynamic();
+
+		DeviceArray<int>& index = half.getIndex();
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		K_CountHalfNeighbors << <pDims, BLOCK_SIZE >> > (index, full);
+		cuSynchronize();
+
+		int total = thrust::reduce(thrust::device, index.getDataPtr(), index.getDataPtr() + num, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + num, index.getDataPtr());
+
+		if (total == 0)
+		{
+			half.getElements().release();
+			return;
+		}
+
+		if (half.getElements().size() != total)
+			half.getElements().resize(total);
+
+		K_FillHalfNeighbors << <pDims, BLOCK_SIZE >> > (half, full);
+		cuSynchronize();
+	}
+
+	template<typename TDataType>
+	void PairSchedule<TDataType>::release()
+	{
+		m_keys.release();
+		m_order.release();
+		m_flags.release();
+		m_cellStart.release();
+		m_pairLength.release();
+		m_batchOffset.clear();
+	}
+}
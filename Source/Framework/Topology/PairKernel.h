@@ -0,0 +1,113 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Utility.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/NeighborList.h"
+#include <vector>
+
+namespace PhysIKA
+{
+	/**
+	 * @brief Run action on every pair of one batch of cells, a thread owns one cell and all pairs of its particles
+	 */
+	template<typename T, typename Action>
+	__global__ void K_ApplyPairs(
+		DeviceArray<int> order,
+		DeviceArray<int> cellStart,
+		int batchBegin,
+		int batchEnd,
+		NeighborList<int> nbr,
+		DeviceArray<T> result,
+		Action action)
+	{
+		int cId = batchBegin + threadIdx.x + (blockIdx.x * blockDim.x);
+		if (cId >= batchEnd) return;
+
+		int begin = cellStart[cId];
+		int end = cId + 1 < cellStart.size() ? cellStart[cId + 1] : order.size();
+		for (int n = begin; n < end; n++)
+		{
+			int i = order[n];
+			int nbSize = nbr.getNeighborSize(i);
+			for (int ne = 0; ne < nbSize; ne++)
+			{
+				int j = nbr.getElement(i, ne);
+				action(i, j, result[i], result[j]);
+			}
+		}
+	}
+
+	/*!
+	*	\class	PairSchedule
+	*	\brief	Applies a symmetric pair interaction stored in a half neighbor list (j > i) without atomics.
+	*
+	*	Particles are binned into cells no smaller than the longest pair, the cells are split into 27 colors
+	*	by their coordinates modulo 3. Two cells of the same color are at least two cells apart, so the particles
+	*	touched from one cell never overlap with those touched from another one and a color is processed in parallel.
+	*	The schedule stays valid as long as the positions and the list it was built from do not change.
+	*/
+	template<typename TDataType>
+	class PairSchedule
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		PairSchedule() {};
+		~PairSchedule() { release(); };
+
+		/**
+		 * @brief Bin the owners of the pairs in halfList into colored cells
+		 */
+		void build(DeviceArray<Coord>& pos, NeighborList<int>& halfList);
+
+		/**
+		 * @brief Call action(i, j, result[i], result[j]) once for every pair (i, j) of halfList
+		 *
+		 * action has to be a device functor and may update both results, one color is launched at a time.
+		 */
+		template<typename T, typename Action>
+		void apply(NeighborList<int>& halfList, DeviceArray<T>& result, Action action)
+		{
+			if (m_batchOffset.size() != PAIR_COLOR_NUM + 1) return;
+
+			for (int c = 0; c < PAIR_COLOR_NUM; c++)
+			{
+				int begin = m_batchOffset[c];
+				int end = m_batchOffset[c + 1];
+				if (end <= begin) continue;
+
+				cuint pDims = cudaGridSize(end - begin, BLOCK_SIZE);
+				K_ApplyPairs << <pDims, BLOCK_SIZE >> > (m_order, m_cellStart, begin, end, halfList, result, action);
+			}
+			cuSynchronize();
+		}
+
+		/**
+		 * @brief Keep the entries j > i of a full neighbor list
+		 */
+		static void extractHalfList(NeighborList<int>& full, NeighborList<int>& half);
+
+		void release();
+
+		int getCellNum() { return m_cellStart.size(); }
+
+	public:
+		static const int PAIR_COLOR_NUM = 27;
+
+	private:
+		DeviceArray<unsigned long long> m_keys;
+		DeviceArray<int> m_order;
+		DeviceArray<int> m_flags;
+		DeviceArray<int> m_cellStart;
+		DeviceArray<Real> m_pairLength;
+
+		std::vector<int> m_batchOffset;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class PairSchedule<DataType3f>;
+#else
+	template class PairSchedule<DataType3d>;
+#endif
+}
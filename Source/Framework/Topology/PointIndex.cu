@@ -0,0 +1,457 @@
+#include <cuda_runtime.h>
+#include "PointIndex.h"
+#include "Core/Utility.h"
+#include "Core/Utility/ThreadPool.h"
+#include "Core/Utility/HostScan.h"
+#include "Framework/Topology/KNearestHeap.h"
+#include "Framework/Framework/Log.h"
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/execution_policy.h>
+#include <algorithm>
+#include <vector>
+#include <cfloat>
+
+namespace PhysIKA
+{
+	/**
+	 * @brief Call func(id) for every point of hash closer than radius to pos, radius may span several cells
+	 */
+	template<typename Real, typename Coord, typename Hash, typename Points, typename Func>
+	COMM_FUNC void forEachPointInRadius(Hash& hash, Points& points, Coord pos, Real radius, Func& func)
+	{
+		int3 c = hash.getIndex3(pos);
+		int range = (int)ceil(radius / hash.ds);
+
+		//Cells outside of the grid are empty
+		int3 cLo = make_int3(c.x - range < 0 ? 0 : c.x - range, c.y - range < 0 ? 0 : c.y - range, c.z - range < 0 ? 0 : c.z - range);
+		int3 cHi = make_int3(c.x + range < hash.nx ? c.x + range : hash.nx - 1, c.y + range < hash.ny ? c.y + range : hash.ny - 1, c.z + range < hash.nz ? c.z + range : hash.nz - 1);
+		for (int k = cLo.z; k <= cHi.z; k++)
+		{
+			for (int j = cLo.y; j <= cHi.y; j++)
+			{
+				for (int i = cLo.x; i <= cHi.x; i++)
+				{
+					int cId = hash.getIndex(i, j, k);
+					if (cId < 0) continue;
+
+					int totalNum = hash.getCounter(cId);
+					for (int n = 0; n < totalNum; n++)
+					{
+						int nbId = hash.getParticleId(cId, n);
+						if ((pos - points[nbId]).norm() < radius)
+						{
+							func(nbId);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	struct PointCounter
+	{
+		int num = 0;
+		COMM_FUNC void operator()(int id) { num++; }
+	};
+
+	template<typename NeighborListType>
+	struct PointCollector
+	{
+		NeighborListType* nbr;
+		int pId;
+		int num;
+		COMM_FUNC void operator()(int id) { nbr->setElement(pId, num++, id); }
+	};
+
+	template<typename Coord>
+	struct IndexCoordMinimum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.minimum(b); }
+	};
+
+	template<typename Coord>
+	struct IndexCoordMaximum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.maximum(b); }
+	};
+
+	template<typename TDataType>
+	PointIndex<TDataType>::PointIndex()
+		: m_deviceType(DeviceType::GPU)
+		, m_cellSize(Real(0))
+		, m_pointNum(0)
+		, m_reallocationCount(0)
+	{
+	}
+
+	template<typename TDataType>
+	PointIndex<TDataType>::~PointIndex()
+	{
+		release();
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::build(DeviceArray<Coord>& points, Real cellSize)
+	{
+		m_cellSize = cellSize;
+		m_pointNum = points.size();
+		if (m_pointNum <= 0)
+		{
+			return;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			if (m_hostPoints.size() != m_pointNum)
+				m_hostPoints.resize(m_pointNum);
+			Function1Pt::copy(m_hostPoints, points);
+
+			updateBounds(true);
+			m_hostHash.construct(m_hostPoints);
+		}
+		else
+		{
+			if (m_points.size() != m_pointNum)
+				m_points.resize(m_pointNum);
+			Function1Pt::copy(m_points, points);
+
+			updateBounds(true);
+			m_hash.construct(m_points);
+		}
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::refit(DeviceArray<Coord>& points)
+	{
+		if (points.size() != m_pointNum || m_pointNum <= 0)
+		{
+			build(points, m_cellSize);
+			return;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			Function1Pt::copy(m_hostPoints, points);
+			if (updateBounds(false))
+				m_reallocationCount++;
+			m_hostHash.construct(m_hostPoints);
+		}
+		else
+		{
+			Function1Pt::copy(m_points, points);
+			if (updateBounds(false))
+				m_reallocationCount++;
+			m_hash.update(m_points);
+		}
+	}
+
+	template<typename TDataType>
+	bool PointIndex<TDataType>::updateBounds(bool force)
+	{
+		Coord pLo((Real)FLT_MAX);
+		Coord pHi((Real)-FLT_MAX);
+		if (m_deviceType == DeviceType::CPU)
+		{
+			for (int i = 0; i < m_pointNum; i++)
+			{
+				pLo = pLo.minimum(m_hostPoints[i]);
+				pHi = pHi.maximum(m_hostPoints[i]);
+			}
+		}
+		else
+		{
+			Coord* pPtr = m_points.getDataPtr();
+			pLo = thrust::reduce(thrust::device, pPtr, pPtr + m_pointNum, pLo, IndexCoordMinimum<Coord>());
+			pHi = thrust::reduce(thrust::device, pPtr, pPtr + m_pointNum, pHi, IndexCoordMaximum<Coord>());
+		}
+
+		if (!force
+			&& pLo[0] >= m_lo[0] && pLo[1] >= m_lo[1] && pLo[2] >= m_lo[2]
+			&& pHi[0] <= m_hi[0] && pHi[1] <= m_hi[1] && pHi[2] <= m_hi[2])
+		{
+			return false;
+		}
+
+		//Leave room for the points to move before the grid has to be re-allocated
+		Coord extent = pHi - pLo;
+		Real margin = m_cellSize + Real(0.1) * std::max(extent[0], std::max(extent[1], extent[2]));
+		m_lo = pLo - margin;
+		m_hi = pHi + margin;
+
+		if (m_deviceType == DeviceType::CPU)
+			m_hostHash.setSpace(m_cellSize, m_lo, m_hi);
+		else
+			m_hash.setSpace(m_cellSize, m_lo, m_hi);
+
+		return true;
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::queryRadius(NeighborList<int>& nbr, DeviceArray<Coord>& targets, Real radius)
+	{
+		query(nbr, targets, radius, nullptr);
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::queryRadius(NeighborList<int>& nbr, DeviceArray<Coord>& targets, DeviceArray<Real>& radii)
+	{
+		query(nbr, targets, Real(0), &radii);
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::queryKNearest(NeighborList<int>& nbr, DeviceArray<Coord>& targets, int k, Real maxRadius)
+	{
+		if (k > 0 && (nbr.size() != targets.size() || nbr.getNeighborLimit() != k))
+			nbr.resize(targets.size(), k);
+		query(nbr, targets, maxRadius, nullptr);
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::queryKNearest(NeighborList<int>& nbr, DeviceArray<Coord>& targets, int k, DeviceArray<Real>& maxRadii)
+	{
+		if (k > 0 && (nbr.size() != targets.size() || nbr.getNeighborLimit() != k))
+			nbr.resize(targets.size(), k);
+		query(nbr, targets, Real(0), &maxRadii);
+	}
+
+	template<typename Real, typename Coord, typename Hash>
+	__global__ void K_CountPointsInRadius(
+		DeviceArray<int> count,
+		DeviceArray<Coord> targets,
+		DeviceArray<Coord> points,
+		Hash hash,
+		Real radius,
+		DeviceArray<Real> radii)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= targets.size()) return;
+
+		PointCounter counter;
+		forEachPointInRadius(hash, points, targets[pId], radii.size() > 0 ? radii[pId] : radius, counter);
+		count[pId] = counter.num;
+	}
+
+	template<typename Real, typename Coord, typename Hash>
+	__global__ void K_CollectPointsInRadius(
+		NeighborList<int> nbr,
+		DeviceArray<Coord> targets,
+		DeviceArray<Coord> points,
+		Hash hash,
+		Real radius,
+		DeviceArray<Real> radii)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= targets.size()) return;
+
+		PointCollector<NeighborList<int>> collector;
+		collector.nbr = &nbr;
+		collector.pId = pId;
+		collector.num = 0;
+		forEachPointInRadius(hash, points, targets[pId], radii.size() > 0 ? radii[pId] : radius, collector);
+	}
+
+	template<typename Real, typename Coord, typename Hash>
+	__global__ void K_KNearestPoints(
+		NeighborList<int> nbr,
+		DeviceArray<Coord> targets,
+		DeviceArray<Coord> points,
+		Hash hash,
+		Real radius,
+		DeviceArray<Real> radii,
+		int* heapIDs,
+		Real* heapDistance)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= targets.size()) return;
+
+		int nbrLimit = nbr.getNeighborLimit();
+
+		int localIds[KNN_LOCAL_CAPACITY];
+		Real localDistance[KNN_LOCAL_CAPACITY];
+		int* ids = heapIDs == nullptr ? localIds : heapIDs + pId * nbrLimit;
+		Real* distance = heapDistance == nullptr ? localDistance : heapDistance + pId * nbrLimit;
+
+		KNearestHeap<Real> heap(ids, distance, nbrLimit);
+		searchKNearest(heap, hash, points, targets[pId], radii.size() > 0 ? radii[pId] : radius);
+		heap.sort();
+
+		nbr.setNeighborSize(pId, heap.size());
+		for (int ne = 0; ne < heap.size(); ne++)
+		{
+			nbr.setElement(pId, ne, heap.getId(ne));
+		}
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::query(NeighborList<int>& nbr, DeviceArray<Coord>& targets, Real radius, DeviceArray<Real>* radii)
+	{
+		int num = targets.size();
+		if (num <= 0)
+		{
+			nbr.release();
+			return;
+		}
+
+		int nbrLimit = nbr.getNeighborLimit();
+		if (nbr.size() != num)
+			nbr.resize(num, nbrLimit);
+
+		if (m_pointNum <= 0)
+		{
+			nbr.getIndex().reset();
+			if (!nbr.isLimited())
+				nbr.getElements().release();
+			return;
+		}
+
+		if (radii != nullptr && radii->size() != num)
+		{
+			Log::sendMessage(Log::Error, "PointIndex: one radius per target is required!");
+			return;
+		}
+
+		if (m_deviceType == DeviceType::CPU)
+		{
+			queryOnHost(nbr, targets, radius, radii);
+			return;
+		}
+
+		DeviceArray<Real> noRadii;
+		DeviceArray<Real>& radiusArr = radii == nullptr ? noRadii : *radii;
+
+		cuint pDims = cudaGridSize(num, BLOCK_SIZE);
+		if (nbr.isLimited())
+		{
+			//Large limits do not fit into local memory, their heaps are kept in global scratch
+			int* ids = nullptr;
+			Real* distance = nullptr;
+			if (nbrLimit > KNN_LOCAL_CAPACITY)
+			{
+				if (m_heapIds.size() < num * nbrLimit)
+				{
+					m_heapIds.resize(num * nbrLimit);
+					m_heapDistance.resize(num * nbrLimit);
+				}
+				ids = m_heapIds.getDataPtr();
+				distance = m_heapDistance.getDataPtr();
+			}
+
+			K_KNearestPoints << <pDims, BLOCK_SIZE >> > (nbr, targets, m_points, m_hash, radius, radiusArr, ids, distance);
+			cuSynchronize();
+			return;
+		}
+
+		DeviceArray<int>& index = nbr.getIndex();
+		K_CountPointsInRadius << <pDims, BLOCK_SIZE >> > (index, targets, m_points, m_hash, radius, radiusArr);
+		cuSynchronize();
+
+		int total = thrust::reduce(thrust::device, index.getDataPtr(), index.getDataPtr() + num, (int)0, thrust::plus<int>());
+		thrust::exclusive_scan(thrust::device, index.getDataPtr(), index.getDataPtr() + num, index.getDataPtr());
+
+		if (total == 0)
+		{
+			nbr.getElements().release();
+			return;
+		}
+
+		if (nbr.getElements().size() != total)
+			nbr.getElements().resize(total);
+
+		K_CollectPointsInRadius << <pDims, BLOCK_SIZE >> > (nbr, targets, m_points, m_hash, radius, radiusArr);
+		cuSynchronize();
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::queryOnHost(NeighborList<int>& nbr, DeviceArray<Coord>& targets, Real radius, DeviceArray<Real>* radii)
+	{
+		int num = targets.size();
+		int nbrLimit = nbr.getNeighborLimit();
+
+		if (m_hostTargets.size() != num)
+			m_hostTargets.resize(num);
+		Function1Pt::copy(m_hostTargets, targets);
+
+		bool perQuery = radii != nullptr;
+		if (perQuery)
+		{
+			if (m_hostRadii.size() != num)
+				m_hostRadii.resize(num);
+			Function1Pt::copy(m_hostRadii, *radii);
+		}
+
+		if (m_hostNeighbors.size() != num || m_hostNeighbors.getNeighborLimit() != nbrLimit)
+			m_hostNeighbors.resize(num, nbrLimit);
+
+		ThreadPool& pool = ThreadPool::getInstance();
+		if (nbrLimit > 0)
+		{
+			pool.parallelFor(0, num, [&](int begin, int end) {
+				std::vector<Real> distance(nbrLimit);
+				for (int pId = begin; pId < end; pId++)
+				{
+					int* ids = m_hostNeighbors.getElements().getDataPtr() + pId * nbrLimit;
+
+					KNearestHeap<Real> heap(ids, distance.data(), nbrLimit);
+					searchKNearest(heap, m_hostHash, m_hostPoints, m_hostTargets[pId], perQuery ? m_hostRadii[pId] : radius);
+					heap.sort();
+
+					m_hostNeighbors.setNeighborSize(pId, heap.size());
+				}
+			}, 256);
+		}
+		else
+		{
+			HostArray<int>& index = m_hostNeighbors.getIndex();
+			pool.parallelFor(0, num, [&](int begin, int end) {
+				for (int pId = begin; pId < end; pId++)
+				{
+					PointCounter counter;
+					forEachPointInRadius(m_hostHash, m_hostPoints, m_hostTargets[pId], perQuery ? m_hostRadii[pId] : radius, counter);
+					index[pId] = counter.num;
+				}
+			}, 256);
+
+			int total = HostScan::exclusive(index.getDataPtr(), num);
+
+			HostArray<int>& elements = m_hostNeighbors.getElements();
+			if (total > 0)
+			{
+				if (elements.size() != total)
+					elements.resize(total);
+
+				pool.parallelFor(0, num, [&](int begin, int end) {
+					for (int pId = begin; pId < end; pId++)
+					{
+						PointCollector<HostNeighborList<int>> collector;
+						collector.nbr = &m_hostNeighbors;
+						collector.pId = pId;
+						collector.num = 0;
+						forEachPointInRadius(m_hostHash, m_hostPoints, m_hostTargets[pId], perQuery ? m_hostRadii[pId] : radius, collector);
+					}
+				}, 256);
+			}
+			else
+			{
+				elements.release();
+			}
+		}
+
+		nbr.copyFrom(m_hostNeighbors);
+	}
+
+	template<typename TDataType>
+	void PointIndex<TDataType>::release()
+	{
+		m_hash.release();
+		m_hostHash.release();
+		m_points.release();
+		m_heapIds.release();
+		m_heapDistance.release();
+		m_hostPoints.release();
+		m_hostTargets.release();
+		m_hostRadii.release();
+		m_hostNeighbors.release();
+		m_pointNum = 0;
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "Core/Platform.h"
+#include "Core/Array/Array.h"
+#include "Framework/Topology/GridHash.h"
+#include "Framework/Topology/HostGridHash.h"
+#include "Framework/Topology/NeighborList.h"
+
+namespace PhysIKA
+{
+	/*!
+	*	\class	PointIndex
+	*	\brief	Persistent uniform grid over a source point set answering radius and k-nearest queries of arbitrary targets.
+	*
+	*	build() hashes a copy of the source points once, later queries only walk the grid. When the source moves,
+	*	refit() re-bins the points into the existing grid and only re-allocates when they leave the padded bounds.
+	*	Query radii may exceed the cell size, the cells within the radius are visited.
+	*	Results are always returned in a device NeighborList, lists with a neighbor limit keep the closest points.
+	*/
+	template<typename TDataType>
+	class PointIndex
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		PointIndex();
+		~PointIndex();
+
+		/**
+		 * @brief Select where the grid is kept and the queries run, takes effect on the next build()
+		 */
+		void setDeviceType(DeviceType type) { m_deviceType = type; }
+		DeviceType getDeviceType() { return m_deviceType; }
+
+		/**
+		 * @brief Hash the source points into cells of size cellSize
+		 */
+		void build(DeviceArray<Coord>& points, Real cellSize);
+
+		/**
+		 * @brief Update the source positions, the point count must not change
+		 */
+		void refit(DeviceArray<Coord>& points);
+
+		/**
+		 * @brief Source points within radius of each target
+		 */
+		void queryRadius(NeighborList<int>& nbr, DeviceArray<Coord>& targets, Real radius);
+
+		/**
+		 * @brief Source points within radii[i] of target i
+		 */
+		void queryRadius(NeighborList<int>& nbr, DeviceArray<Coord>& targets, DeviceArray<Real>& radii);
+
+		/**
+		 * @brief The k closest source points within maxRadius of each target, sorted by ascending distance
+		 */
+		void queryKNearest(NeighborList<int>& nbr, DeviceArray<Coord>& targets, int k, Real maxRadius);
+
+		/**
+		 * @brief The k closest source points within maxRadii[i] of target i, sorted by ascending distance
+		 */
+		void queryKNearest(NeighborList<int>& nbr, DeviceArray<Coord>& targets, int k, DeviceArray<Real>& maxRadii);
+
+		int getPointCount() { return m_pointNum; }
+
+		/// Number of times the grid had to be re-allocated by refit()
+		int getReallocationCount() { return m_reallocationCount; }
+
+		void release();
+
+	private:
+		void query(NeighborList<int>& nbr, DeviceArray<Coord>& targets, Real radius, DeviceArray<Real>* radii);
+		void queryOnHost(NeighborList<int>& nbr, DeviceArray<Coord>& targets, Real radius, DeviceArray<Real>* radii);
+
+		/// Grid bounds enclosing the points with some room to move, returns false if the current ones still fit
+		bool updateBounds(bool force);
+
+		DeviceType m_deviceType;
+
+		Real m_cellSize;
+		Coord m_lo;
+		Coord m_hi;
+
+		int m_pointNum;
+		int m_reallocationCount;
+
+		DeviceArray<Coord> m_points;
+		GridHash<TDataType> m_hash;
+
+		/// Heaps of limited lists above the local capacity, grown on demand and kept between queries
+		DeviceArray<int> m_heapIds;
+		DeviceArray<Real> m_heapDistance;
+
+		HostArray<Coord> m_hostPoints;
+		HostGridHash<TDataType> m_hostHash;
+
+		HostArray<Coord> m_hostTargets;
+		HostArray<Real> m_hostRadii;
+		HostNeighborList<int> m_hostNeighbors;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class PointIndex<DataType3f>;
+#else
+	template class PointIndex<DataType3d>;
+#endif
+}
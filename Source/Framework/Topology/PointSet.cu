@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sstream>
 #include "Core/Utility.h"
+#include "IO/Asset_Cache/AssetCache.h"
 
 namespace PhysIKA
 {
@@ -47,39 +48,22 @@ namespace PhysIKA
 			exit(-1);
 		}
 
-		std::ifstream infile(filename);
-		if (!infile) {
+		auto mesh = AssetCache::getInstance().getMesh(filename);
+		if (mesh == nullptr) {
 			std::cerr << "Failed to open. Terminating.\n";
 			exit(-1);
 		}
 
-		int ignored_lines = 0;
-		std::string line;
-		std::vector<Coord> vertList;
-		std::vector<Coord> normalList;
-		while (!infile.eof()) {
-			std::getline(infile, line);
-
-			//.obj files sometimes contain vertex normals indicated by "vn"
-			if (line.substr(0, 1) == std::string("v") && line.substr(0, 2) != std::string("vn")) {
-				std::stringstream data(line);
-				char c;
-				Coord point;
-				data >> c >> point[0] >> point[1] >> point[2];
-				vertList.push_back(point);
-			}
-			else if (line.substr(0, 2) == std::string("vn")) {
-				std::stringstream data(line);
-				char c;
-				Coord normal;
-				data >> c >> normal[0] >> normal[1] >> normal[2];
-				normalList.push_back(normal);
-			}
-			else {
-				++ignored_lines;
-			}
+		std::vector<Coord> vertList(mesh->vertexNum);
+		std::vector<Coord> normalList(mesh->normalNum);
+		for (int i = 0; i < mesh->vertexNum; i++) {
+			const float* v = mesh->vertices + 3 * i;
+			vertList[i] = Coord(v[0], v[1], v[2]);
+		}
+		for (int i = 0; i < mesh->normalNum; i++) {
+			const float* n = mesh->normals + 3 * i;
+			normalList[i] = Coord(n[0], n[1], n[2]);
 		}
-		infile.close();
 
 		if (normalList.size() < vertList.size())
 		{
@@ -124,6 +108,21 @@ namespace PhysIKA
 		tagAsChanged();
 	}
 
+	template<typename TDataType>
+	void PointSet<TDataType>::setPoints(const Coord* pos, int num)
+	{
+		m_coords.resize(num);
+		cuSafeCall(cudaMemcpy(m_coords.getDataPtr(), pos, num * sizeof(Coord), cudaMemcpyHostToDevice));
+
+		if (m_normals.size() != num)
+		{
+			m_normals.resize(num);
+			m_normals.reset();
+		}
+
+		tagAsChanged();
+	}
+
 
 	template<typename TDataType>
 	void PointSet<TDataType>::setNormals(std::vector<Coord>& normals)
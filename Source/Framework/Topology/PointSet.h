@@ -20,6 +20,10 @@ namespace PhysIKA
 		void copyFrom(PointSet<TDataType>& pointSet);
 
 		void setPoints(std::vector<Coord>& pos);
+		/**
+		 * @brief Upload num points from host memory with a single copy
+		 */
+		void setPoints(const Coord* pos, int num);
 		void setNormals(std::vector<Coord>& normals);
 
 		DeviceArray<Coord>& getPoints() { return m_coords; }
@@ -0,0 +1,176 @@
+#include "SparseGridHash.h"
+#include "Core/Utility.h"
+#include "Framework/Framework/Log.h"
+#include <thrust/reduce.h>
+#include <thrust/execution_policy.h>
+#include <cfloat>
+
+namespace PhysIKA{
+
+	template<typename TDataType>
+	SparseGridHash<TDataType>::SparseGridHash()
+	{
+	}
+
+	template<typename TDataType>
+	SparseGridHash<TDataType>::~SparseGridHash()
+	{
+	}
+
+	template<typename TDataType>
+	void SparseGridHash<TDataType>::setSpace(Real _h)
+	{
+		ds = _h;
+	}
+
+	template<typename Coord>
+	struct SparseGridMinimum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.minimum(b); }
+	};
+
+	template<typename Coord>
+	struct SparseGridMaximum
+	{
+		COMM_FUNC Coord operator()(const Coord& a, const Coord& b) const { return a.maximum(b); }
+	};
+
+	template<typename TDataType>
+	__global__ void K_InsertCells(SparseGridHash<TDataType> hash, Array<typename TDataType::Coord> pos)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		int3 gId3 = hash.getIndex3(pos[pId]);
+		int gId = hash.insert(gId3.x, gId3.y, gId3.z);
+
+		if (gId != INVALID)
+			atomicAdd(&(hash.index[gId]), 1);
+	}
+
+	template<typename TDataType>
+	__global__ void K_ConstructSparseHashTable(SparseGridHash<TDataType> hash, Array<typename TDataType::Coord> pos)
+	{
+		int pId = threadIdx.x + (blockIdx.x * blockDim.x);
+		if (pId >= pos.size()) return;
+
+		int gId = hash.getIndex(pos[pId]);
+
+		if (gId < 0) return;
+
+		int index = atomicAdd(&(hash.counter[gId]), 1);
+		hash.ids[hash.index[gId] + index] = pId;
+	}
+
+	template<typename TDataType>
+	bool SparseGridHash<TDataType>::construct(DeviceArray<Coord>& pos)
+	{
+		int pNum = pos.size();
+		if (pNum <= 0)
+		{
+			particle_num = 0;
+			return true;
+		}
+
+		//Bounds of the particles, padded by two cells as in GridHash
+		int padding = 2;
+		Coord* pPtr = pos.getDataPtr();
+		Coord pLo = thrust::reduce(thrust::device, pPtr, pPtr + pNum, Coord((Real)FLT_MAX), SparseGridMinimum<Coord>());
+		Coord pHi = thrust::reduce(thrust::device, pPtr, pPtr + pNum, Coord((Real)-FLT_MAX), SparseGridMaximum<Coord>());
+
+		lo = pLo - padding*ds;
+		Coord nSeg = (pHi - pLo) / ds;
+		nx = ceil(nSeg[0]) + 1 + 2 * padding;
+		ny = ceil(nSeg[1]) + 1 + 2 * padding;
+		nz = ceil(nSeg[2]) + 1 + 2 * padding;
+		hi = lo + Coord(nx, ny, nz)*ds;
+
+		if (nx >= SPARSE_GRID_OFFSET || ny >= SPARSE_GRID_OFFSET || nz >= SPARSE_GRID_OFFSET)
+		{
+			//Cells would alias, an empty table finds no neighbors instead of wrong ones
+			Log::sendMessage(Log::Error, "SparseGridHash: the particles span more cells than the keys can distinguish!");
+			release();
+			return false;
+		}
+
+		//Keep the load factor below 0.5, the table only grows
+		int capacity = 64;
+		while (capacity < 2 * pNum)
+		{
+			capacity <<= 1;
+		}
+
+		if (capacity > num)
+		{
+			release();
+
+			num = capacity;
+			cuSafeCall(cudaMalloc((void**)&keys, num * sizeof(unsigned long long)));
+			cuSafeCall(cudaMalloc((void**)&counter, num * sizeof(int)));
+			cuSafeCall(cudaMalloc((void**)&index, num * sizeof(int)));
+		}
+
+		if (particle_num != pNum || ids == nullptr)
+		{
+			if (ids != nullptr)
+			{
+				cuSafeCall(cudaFree(ids));
+			}
+			cuSafeCall(cudaMalloc((void**)&ids, pNum * sizeof(int)));
+		}
+		particle_num = pNum;
+
+		clear();
+
+		cuint pDims = cudaGridSize(pNum, BLOCK_SIZE);
+		K_InsertCells << <pDims, BLOCK_SIZE >> > (*this, pos);
+
+		if (m_scan == nullptr)
+		{
+			m_scan = new Scan();
+		}
+		m_scan->exclusive(index, num);
+
+		K_ConstructSparseHashTable << <pDims, BLOCK_SIZE >> > (*this, pos);
+		cuSynchronize();
+
+		return true;
+	}
+
+	template<typename TDataType>
+	void SparseGridHash<TDataType>::clear()
+	{
+		if (num == 0) return;
+
+		cuSafeCall(cudaMemset(keys, 0xFF, num * sizeof(unsigned long long)));
+		cuSafeCall(cudaMemset(counter, 0, num * sizeof(int)));
+		cuSafeCall(cudaMemset(index, 0, num * sizeof(int)));
+	}
+
+	template<typename TDataType>
+	void SparseGridHash<TDataType>::release()
+	{
+		if (keys != nullptr)
+			cuSafeCall(cudaFree(keys));
+
+		if (counter != nullptr)
+			cuSafeCall(cudaFree(counter));
+
+		if (ids != nullptr)
+			cuSafeCall(cudaFree(ids));
+
+		if (index != nullptr)
+			cuSafeCall(cudaFree(index));
+
+		if (m_scan != nullptr)
+			delete m_scan;
+
+		keys = nullptr;
+		counter = nullptr;
+		ids = nullptr;
+		index = nullptr;
+		m_scan = nullptr;
+		num = 0;
+		particle_num = 0;
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "Core/DataTypes.h"
+#include "Core/Utility.h"
+#include "Core/Array/Array.h"
+#include "Core/Utility/Scan.h"
+#include "Framework/Topology/GridHash.h"
+
+namespace PhysIKA{
+
+	#define EMPTY_CELL 0xFFFFFFFFFFFFFFFFull
+
+	/*!
+	*	\class	SparseGridHash
+	*	\brief	Uniform grid whose occupied cells are stored in a hash table keyed on the integer cell coordinates.
+	*
+	*	The table is sized by the particle number instead of the domain, and the bounds are computed from the particles
+	*	on every construction, so no particle falls outside of the grid.
+	*	getIndex()/getCounter()/getParticleId() have the same meaning as in GridHash, a cell index is a slot in the table
+	*	and getIndex() returns INVALID for empty cells.
+	*/
+	template<typename TDataType>
+	class SparseGridHash
+	{
+	public:
+		typedef typename TDataType::Real Real;
+		typedef typename TDataType::Coord Coord;
+
+		SparseGridHash();
+		~SparseGridHash();
+
+		void setSpace(Real _h);
+
+		/**
+		 * @brief Hash the particles, returns false and leaves the table empty when they span more cells than the keys can encode
+		 */
+		bool construct(DeviceArray<Coord>& pos);
+
+		void clear();
+
+		void release();
+
+		GPU_FUNC inline unsigned long long getKey(int i, int j, int k)
+		{
+			//21 bits per axis, cells are counted from lo so that the coordinates stay small
+			return ((unsigned long long)(i + SPARSE_GRID_OFFSET) << 42)
+				| ((unsigned long long)(j + SPARSE_GRID_OFFSET) << 21)
+				| (unsigned long long)(k + SPARSE_GRID_OFFSET);
+		}
+
+		GPU_FUNC inline int getSlot(int i, int j, int k)
+		{
+			return (((unsigned int)i * 73856093u) ^ ((unsigned int)j * 19349663u) ^ ((unsigned int)k * 83492791u)) & (num - 1);
+		}
+
+		GPU_FUNC inline int getIndex(int i, int j, int k)
+		{
+			unsigned long long key = getKey(i, j, k);
+			int slot = getSlot(i, j, k);
+			for (int n = 0; n < num; n++)
+			{
+				unsigned long long stored = keys[slot];
+				if (stored == key) return slot;
+				if (stored == EMPTY_CELL) return INVALID;
+
+				slot = (slot + 1) & (num - 1);
+			}
+			return INVALID;
+		}
+
+		GPU_FUNC inline int getIndex(Coord pos)
+		{
+			int3 gId3 = getIndex3(pos);
+			return getIndex(gId3.x, gId3.y, gId3.z);
+		}
+
+		GPU_FUNC inline int3 getIndex3(Coord pos)
+		{
+			int i = floor((pos[0] - lo[0]) / ds);
+			int j = floor((pos[1] - lo[1]) / ds);
+			int k = floor((pos[2] - lo[2]) / ds);
+
+			return make_int3(i, j, k);
+		}
+
+		/**
+		 * @brief Return the slot of cell (i, j, k), inserting the cell if it is not in the table yet
+		 */
+		GPU_FUNC inline int insert(int i, int j, int k)
+		{
+			unsigned long long key = getKey(i, j, k);
+			int slot = getSlot(i, j, k);
+			for (int n = 0; n < num; n++)
+			{
+				unsigned long long stored = atomicCAS(&keys[slot], EMPTY_CELL, key);
+				if (stored == EMPTY_CELL || stored == key) return slot;
+
+				slot = (slot + 1) & (num - 1);
+			}
+			return INVALID;
+		}
+
+		GPU_FUNC inline int getCounter(int gId) {
+			if (gId >= num - 1)
+			{
+				return particle_num - index[gId];
+			}
+			return index[gId + 1] - index[gId];
+		}
+
+		GPU_FUNC inline int getParticleId(int gId, int n) {
+			return ids[index[gId] + n];
+		}
+
+	public:
+		static const int SPARSE_GRID_OFFSET = 1 << 20;
+
+		int num = 0;		//!< table capacity, a power of two
+		int nx, ny, nz;		//!< number of cells spanned by the particles
+
+		int particle_num = 0;
+
+		Real ds;
+
+		Coord lo;
+		Coord hi;
+
+		unsigned long long* keys = nullptr;
+		int* ids = nullptr;
+		int* counter = nullptr;
+		int* index = nullptr;
+
+		Scan* m_scan = nullptr;
+	};
+
+#ifdef PRECISION_FLOAT
+	template class SparseGridHash<DataType3f>;
+#else
+	template class SparseGridHash<DataType3d>;
+#endif
+}
@@ -1,8 +1,10 @@
 #include "TriangleSet.h"
+#include "MeshAdjacency.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include "Core/Utility.h"
+#include "IO/Asset_Cache/AssetCache.h"
 
 namespace PhysIKA
 {
@@ -38,12 +40,46 @@ namespace PhysIKA
 	template<typename TDataType>
 	TriangleSet<TDataType>::~TriangleSet()
 	{
+		m_triangleNeighbors.release();
+		m_vertexTriangles.release();
 	}
 
 	template<typename TDataType>
 	void TriangleSet<TDataType>::updatePointNeighbors()
 	{
+		if (this->m_coords.isEmpty())
+			return;
 
+		if (m_triangls.isEmpty())
+		{
+			EdgeSet<TDataType>::updatePointNeighbors();
+			return;
+		}
+
+		int vNum = this->m_coords.size();
+		if (this->m_edgeNeighbors.isEmpty())
+			this->m_edgeNeighbors.setElementCount(vNum);
+
+		MeshAdjacency::buildVertexNeighbors(this->m_edgeNeighbors.getValue(), m_triangls, vNum, this->m_adjacencyDevice);
+		MeshAdjacency::buildVertexTriangles(m_vertexTriangles, m_triangls, vNum, this->m_adjacencyDevice);
+		MeshAdjacency::buildTriangleNeighbors(m_triangleNeighbors, m_triangls, m_vertexTriangles, this->m_adjacencyDevice);
+		this->m_adjacencyDirty = false;
+	}
+
+	template<typename TDataType>
+	NeighborList<int>* TriangleSet<TDataType>::getTriangleNeighbors()
+	{
+		if (this->m_adjacencyDirty)
+			this->updatePointNeighbors();
+		return &m_triangleNeighbors;
+	}
+
+	template<typename TDataType>
+	NeighborList<int>* TriangleSet<TDataType>::getVertexTriangles()
+	{
+		if (this->m_adjacencyDirty)
+			this->updatePointNeighbors();
+		return &m_vertexTriangles;
 	}
 
 
@@ -60,6 +96,7 @@ namespace PhysIKA
 	{
 		m_triangls.resize(triangles.size());
 		Function1Pt::copy(m_triangls, triangles);
+		this->m_adjacencyDirty = true;
 	}
 
 	template<typename TDataType>
@@ -70,47 +107,27 @@ namespace PhysIKA
 			exit(-1);
 		}
 
-		std::ifstream infile(filename);
-		if (!infile) {
+		auto mesh = AssetCache::getInstance().getMesh(filename);
+		if (mesh == nullptr) {
 			std::cerr << "Failed to open. Terminating.\n";
 			exit(-1);
 		}
 
-		int ignored_lines = 0;
-		std::string line;
-		std::vector<Coord> vertList;
-		std::vector<Coord> normalList;
-		std::vector<Triangle> faceList;
-		while (!infile.eof()) {
-			std::getline(infile, line);
-
-			//.obj files sometimes contain vertex normals indicated by "vn"
-			if (line.substr(0, 1) == std::string("v") && line.substr(0, 2) != std::string("vn")) {
-				std::stringstream data(line);
-				char c;
-				Coord point;
-				data >> c >> point[0] >> point[1] >> point[2];
-				vertList.push_back(point);
-			}
-			else if (line.substr(0, 1) == std::string("f")) {
-				std::stringstream data(line);
-				char c;
-				int v0, v1, v2;
-				data >> c >> v0 >> v1 >> v2;
-				faceList.push_back(Triangle(v0 - 1, v1 - 1, v2 - 1));
-			}
-			else if (line.substr(0, 2) == std::string("vn")) {
-				std::stringstream data(line);
-				char c;
-				Coord normal;
-				data >> c >> normal[0] >> normal[1] >> normal[2];
-				normalList.push_back(normal);
-			}
-			else {
-				++ignored_lines;
-			}
+		std::vector<Coord> vertList(mesh->vertexNum);
+		std::vector<Coord> normalList(mesh->normalNum);
+		std::vector<Triangle> faceList(mesh->triangleNum);
+		for (int i = 0; i < mesh->vertexNum; i++) {
+			const float* v = mesh->vertices + 3 * i;
+			vertList[i] = Coord(v[0], v[1], v[2]);
+		}
+		for (int i = 0; i < mesh->normalNum; i++) {
+			const float* n = mesh->normals + 3 * i;
+			normalList[i] = Coord(n[0], n[1], n[2]);
+		}
+		for (int i = 0; i < mesh->triangleNum; i++) {
+			const int* t = mesh->triangles + 3 * i;
+			faceList[i] = Triangle(t[0], t[1], t[2]);
 		}
-		infile.close();
 
 		if (normalList.size() != vertList.size())
 		{
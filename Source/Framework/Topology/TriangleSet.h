@@ -19,8 +19,14 @@ namespace PhysIKA
 		DeviceArray<Triangle>* getTriangles() { return &m_triangls; }
 		void setTriangles(std::vector<Triangle>& triangles);
 
-		NeighborList<int>* getTriangleNeighbors() { return &m_triangleNeighbors; }
-
+		/// Triangles sharing an edge with each triangle, built on the first call after the triangles changed
+		NeighborList<int>* getTriangleNeighbors();
+		/// Triangles incident to each vertex, built on the first call after the triangles changed
+		NeighborList<int>* getVertexTriangles();
+
+		/**
+		 * @brief Rebuild the vertex adjacency from the triangles as well as the vertex-triangle and triangle-triangle lists
+		 */
 		void updatePointNeighbors() override;
 
 		void loadObjFile(std::string filename);
@@ -31,6 +37,7 @@ namespace PhysIKA
 	protected:
 		DeviceArray<Triangle> m_triangls;
 		NeighborList<int> m_triangleNeighbors;
+		NeighborList<int> m_vertexTriangles;
 	};
 
 #ifdef PRECISION_FLOAT
@@ -100,7 +100,9 @@ namespace PhysIKA
 
 		setAlternatingRowColors(true);
 
-		QObject::connect(&PLogWidget::logSignal, SIGNAL(sendMessage(const Log::Message&)), this, SLOT(OnLog(const Log::Message&)));
+		//The receiver runs on the logging thread, queued signals copy their arguments as registered meta types
+		qRegisterMetaType<Log::Message>("Log::Message");
+		QObject::connect(&PLogWidget::logSignal, SIGNAL(sendMessage(const Log::Message&)), this, SLOT(OnLog(const Log::Message&)), Qt::QueuedConnection);
 
 		Log::sendMessage(Log::Info, "Finished");
 	}
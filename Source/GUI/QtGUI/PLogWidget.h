@@ -15,12 +15,14 @@
 #include "Framework/Log.h"
 
 #include <QTableWidgetItem>
+#include <QMetaType>
 
 namespace PhysIKA
 {
 	/**
 	 * @brief QLogSignal is used to send message from Log to QT PLogWidget.
 	 * 
+	 * Messages arrive on the logging thread, the signal is queued to the thread of the widget.
 	 */
 	class PLogSignal : public QObject
 	{
@@ -80,4 +82,6 @@ namespace PhysIKA
 		void OnClearAll(void);
 	};
 
-}
\ No newline at end of file
+}
+
+Q_DECLARE_METATYPE(PhysIKA::Log::Message)
@@ -0,0 +1,642 @@
+#include "IO/Asset_Cache/AssetCache.h"
+#include "IO/Asset_Cache/MappedFile.h"
+#include "Core/Utility/ThreadPool.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+namespace PhysIKA {
+
+	namespace {
+
+		const char AssetMagic[8] = { 'P', 'K', 'A', 'S', 'S', 'E', 'T', '\0' };
+		const uint32_t AssetVersion = 3;
+
+		//Files modified more recently may still change without changing their stamp, FAT stores 2 second ticks
+		const long long RacyInterval = 2000000000LL;
+
+		//Distance fields are cached as .sdfb files, kind 2 was their former sidecar
+		enum AssetKind
+		{
+			MeshKind = 1
+		};
+
+		/**
+		 * Layout of a sidecar file, followed by
+		 * mesh:	float vertices[3 * counts[0]], float normals[3 * counts[1]], int triangles[3 * counts[2]]
+		 */
+		struct AssetHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t kind;
+			int64_t sourceMtime;
+			int64_t sourceSize;
+			int32_t counts[4];
+		};
+
+		const char SDFFileMagic[8] = { 'P', 'K', 'S', 'D', 'F', '\0', '\0', '\0' };
+		const uint32_t SDFFileVersion = 2;
+
+		/**
+		 * Layout of a binary .sdfb file, the distances start at dataOffset with x running fastest.
+		 * Readers accept any dataOffset so that later versions can extend the header.
+		 * sourceMtime and sourceSize are the stamp of the text file a cached field was converted from, 0 otherwise.
+		 */
+		struct SDFFileHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t valueSize;
+			int32_t dims[3];
+			int32_t reserved;
+			double origin[3];
+			double spacing[3];
+			uint64_t dataOffset;
+			int64_t sourceMtime;
+			int64_t sourceSize;
+			char padding[24];
+		};
+		static_assert(sizeof(SDFFileHeader) == 128, "The .sdfb header is 128 bytes");
+
+		/**
+		 * Header of version 1 files, still read
+		 */
+		struct SDFFileHeaderV1
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t valueSize;
+			int32_t dims[3];
+			int32_t reserved;
+			float origin[3];
+			float spacing[3];
+			uint64_t dataOffset;
+		};
+		static_assert(sizeof(SDFFileHeaderV1) == 64, "The version 1 .sdfb header is 64 bytes");
+
+		size_t payloadSize(const AssetHeader& header)
+		{
+			const int32_t* c = header.counts;
+			return sizeof(float) * 3 * ((size_t)c[0] + (size_t)c[1]) + sizeof(int32_t) * 3 * (size_t)c[2];
+		}
+
+		bool isValid(const char* data, size_t size, uint32_t kind, long long mtime, long long srcSize)
+		{
+			if (size < sizeof(AssetHeader))
+				return false;
+
+			const AssetHeader* header = (const AssetHeader*)data;
+			if (memcmp(header->magic, AssetMagic, sizeof(AssetMagic)) != 0 || header->version != AssetVersion || header->kind != kind)
+				return false;
+
+			if (header->sourceMtime != mtime || header->sourceSize != srcSize)
+				return false;
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (header->counts[i] < 0)
+					return false;
+			}
+
+			return size == sizeof(AssetHeader) + payloadSize(*header);
+		}
+
+		std::shared_ptr<const MeshAsset> viewMesh(const char* data, std::shared_ptr<const void> storage)
+		{
+			const AssetHeader* header = (const AssetHeader*)data;
+			auto mesh = std::make_shared<MeshAsset>();
+			mesh->vertexNum = header->counts[0];
+			mesh->normalNum = header->counts[1];
+			mesh->triangleNum = header->counts[2];
+
+			const char* ptr = data + sizeof(AssetHeader);
+			mesh->vertices = (const float*)ptr;
+			ptr += sizeof(float) * 3 * mesh->vertexNum;
+			mesh->normals = (const float*)ptr;
+			ptr += sizeof(float) * 3 * mesh->normalNum;
+			mesh->triangles = (const int*)ptr;
+
+			mesh->storage = storage;
+			return mesh;
+		}
+
+		bool readText(const std::string& filename, std::string& text)
+		{
+			std::ifstream input(filename.c_str(), std::ios::in | std::ios::binary);
+			if (!input.is_open())
+				return false;
+
+			std::ostringstream ss;
+			ss << input.rdbuf();
+			text = ss.str();
+			return true;
+		}
+
+		bool isBinarySDF(const std::string& filename)
+		{
+			std::string ext = filename.size() > 5 ? filename.substr(filename.size() - 5) : std::string();
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			return ext == ".sdfb";
+		}
+
+		/**
+		 * Write head followed by body to a temporary file first so that concurrent readers never see a partial file
+		 */
+		bool writeFile(const std::string& target, const char* head, size_t headSize, const char* body, size_t bodySize)
+		{
+			std::ostringstream tmpName;
+			tmpName << target << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+
+			{
+				std::ofstream output(tmpName.str().c_str(), std::ios::out | std::ios::binary);
+				if (!output.is_open())
+					return false;
+
+				output.write(head, headSize);
+				if (bodySize > 0)
+					output.write(body, bodySize);
+				if (!output.good())
+				{
+					output.close();
+					std::remove(tmpName.str().c_str());
+					return false;
+				}
+			}
+
+#if (defined _WIN32)
+			std::remove(target.c_str());
+#endif
+			if (std::rename(tmpName.str().c_str(), target.c_str()) != 0)
+			{
+				std::remove(tmpName.str().c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool writeSDFFile(const std::string& filename, const SDFAsset& sdf, long long sourceMtime, long long sourceSize)
+		{
+			if (sdf.nx <= 0 || sdf.ny <= 0 || sdf.nz <= 0 || sdf.distances == nullptr)
+				return false;
+
+			SDFFileHeader header;
+			memset(&header, 0, sizeof(SDFFileHeader));
+			memcpy(header.magic, SDFFileMagic, sizeof(SDFFileMagic));
+			header.version = SDFFileVersion;
+			header.valueSize = sizeof(float);
+			header.dims[0] = sdf.nx;
+			header.dims[1] = sdf.ny;
+			header.dims[2] = sdf.nz;
+			for (int i = 0; i < 3; i++)
+			{
+				header.origin[i] = sdf.origin[i];
+				header.spacing[i] = sdf.spacing[i] > 0 ? sdf.spacing[i] : sdf.h;
+			}
+			header.dataOffset = sizeof(SDFFileHeader);
+			header.sourceMtime = sourceMtime;
+			header.sourceSize = sourceSize;
+
+			size_t total = (size_t)sdf.nx * sdf.ny * sdf.nz;
+			return writeFile(filename, (const char*)&header, sizeof(SDFFileHeader), (const char*)sdf.distances, total * sizeof(float));
+		}
+
+		bool isRacy(long long mtime)
+		{
+			long long now = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			return now - mtime < RacyInterval;
+		}
+
+		std::vector<char> makeBlob(uint32_t kind, long long mtime, long long size, const int32_t counts[3])
+		{
+			AssetHeader header;
+			memset(&header, 0, sizeof(AssetHeader));
+			memcpy(header.magic, AssetMagic, sizeof(AssetMagic));
+			header.version = AssetVersion;
+			header.kind = kind;
+			header.sourceMtime = mtime;
+			header.sourceSize = size;
+			for (int i = 0; i < 3; i++)
+				header.counts[i] = counts[i];
+
+			std::vector<char> blob(sizeof(AssetHeader) + payloadSize(header));
+			memcpy(blob.data(), &header, sizeof(AssetHeader));
+			return blob;
+		}
+
+		const char* nextLine(const char* p, const char* end)
+		{
+			while (p < end && *p != '\n')
+				p++;
+			return p < end ? p + 1 : end;
+		}
+
+		bool parseObj(const std::string& text, std::vector<float>& vertices, std::vector<float>& normals, std::vector<int32_t>& triangles)
+		{
+			const char* p = text.c_str();
+			const char* end = p + text.size();
+
+			while (p < end)
+			{
+				const char* lineEnd = nextLine(p, end);
+				std::string line(p, lineEnd);
+				const char* s = line.c_str();
+				char* e;
+
+				if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t'))
+				{
+					s += 1;
+					for (int i = 0; i < 3; i++)
+					{
+						vertices.push_back(strtof(s, &e));
+						s = e;
+					}
+				}
+				else if (s[0] == 'v' && s[1] == 'n')
+				{
+					s += 2;
+					for (int i = 0; i < 3; i++)
+					{
+						normals.push_back(strtof(s, &e));
+						s = e;
+					}
+				}
+				else if (s[0] == 'f' && (s[1] == ' ' || s[1] == '\t'))
+				{
+					//Only the first three vertices are used, "v/vt/vn" entries are reduced to v
+					s += 1;
+					for (int i = 0; i < 3; i++)
+					{
+						long id = strtol(s, &e, 10);
+						if (e == s)
+							return false;
+
+						int vNum = (int)vertices.size() / 3;
+						triangles.push_back(id < 0 ? vNum + (int)id : (int)id - 1);
+
+						s = e;
+						while (*s != '\0' && *s != ' ' && *s != '\t')
+							s++;
+					}
+				}
+
+				p = lineEnd;
+			}
+
+			return true;
+		}
+
+		bool parseSDF(const std::string& text, int32_t counts[3], double params[4], std::vector<float>& distances)
+		{
+			//Values are read with strtol/strtof as istream extraction dominates the load time of large fields
+			const char* s = text.c_str();
+			char* e;
+			for (int i = 0; i < 3; i++)
+			{
+				counts[i] = (int32_t)strtol(s, &e, 10);
+				if (e == s || counts[i] <= 0)
+					return false;
+				s = e;
+			}
+
+			for (int i = 0; i < 4; i++)
+			{
+				params[i] = strtod(s, &e);
+				if (e == s)
+					return false;
+				s = e;
+			}
+
+			size_t total = (size_t)counts[0] * counts[1] * counts[2];
+			distances.resize(total);
+			for (size_t i = 0; i < total; i++)
+			{
+				distances[i] = strtof(s, &e);
+				if (e == s)
+					return false;
+				s = e;
+			}
+
+			return true;
+		}
+	}
+
+	AssetCache::AssetCache()
+		: m_sidecarEnabled(false)
+	{
+	}
+
+	AssetCache& AssetCache::getInstance()
+	{
+		static AssetCache m_instance;
+		return m_instance;
+	}
+
+	template<typename T, typename Loader>
+	std::shared_ptr<const T> AssetCache::acquire(std::map<std::string, Entry<T>>& entries, const std::string& filename, Loader loader)
+	{
+		long long mtime, size;
+		if (!getFileStamp(filename, mtime, size))
+			return nullptr;
+
+		std::shared_ptr<std::promise<std::shared_ptr<const T>>> promise;
+		std::shared_future<std::shared_ptr<const T>> future;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto found = entries.find(filename);
+			if (found != entries.end() && !found->second.racy && found->second.mtime == mtime && found->second.size == size)
+			{
+				future = found->second.asset;
+			}
+			else
+			{
+				promise = std::make_shared<std::promise<std::shared_ptr<const T>>>();
+
+				Entry<T> entry;
+				entry.mtime = mtime;
+				entry.size = size;
+				entry.racy = isRacy(mtime);
+				entry.asset = promise->get_future().share();
+				entries[filename] = entry;
+
+				future = entry.asset;
+			}
+		}
+
+		//The first requester loads the file, the others wait for it
+		if (promise != nullptr)
+		{
+			std::shared_ptr<const T> asset = loader(filename, mtime, size);
+			promise->set_value(asset);
+
+			if (asset == nullptr)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				entries.erase(filename);
+			}
+		}
+
+		return future.get();
+	}
+
+	std::shared_ptr<const MeshAsset> AssetCache::getMesh(const std::string& filename)
+	{
+		return acquire(m_meshes, filename,
+			[this](const std::string& f, long long mtime, long long size) { return this->loadMesh(f, mtime, size); });
+	}
+
+	std::shared_ptr<const SDFAsset> AssetCache::getSDF(const std::string& filename)
+	{
+		return acquire(m_sdfs, filename,
+			[this](const std::string& f, long long mtime, long long size) { return this->loadSDF(f, mtime, size); });
+	}
+
+	std::shared_ptr<const MeshAsset> AssetCache::loadMesh(const std::string& filename, long long mtime, long long size)
+	{
+		if (m_sidecarEnabled)
+		{
+			auto mapped = std::make_shared<MappedFile>();
+			if (mapped->open(sidecarName(filename, ".cache")) && isValid(mapped->data(), mapped->size(), MeshKind, mtime, size))
+			{
+				return viewMesh(mapped->data(), mapped);
+			}
+		}
+
+		std::string text;
+		if (!readText(filename, text))
+			return nullptr;
+
+		std::vector<float> vertices;
+		std::vector<float> normals;
+		std::vector<int32_t> triangles;
+		if (!parseObj(text, vertices, normals, triangles))
+		{
+			std::cerr << "Failed to parse " << filename << std::endl;
+			return nullptr;
+		}
+
+		int32_t counts[3] = { (int32_t)vertices.size() / 3, (int32_t)normals.size() / 3, (int32_t)triangles.size() / 3 };
+		auto blob = std::make_shared<std::vector<char>>(makeBlob(MeshKind, mtime, size, counts));
+
+		char* ptr = blob->data() + sizeof(AssetHeader);
+		memcpy(ptr, vertices.data(), sizeof(float) * vertices.size());
+		ptr += sizeof(float) * vertices.size();
+		memcpy(ptr, normals.data(), sizeof(float) * normals.size());
+		ptr += sizeof(float) * normals.size();
+		memcpy(ptr, triangles.data(), sizeof(int32_t) * triangles.size());
+
+		if (m_sidecarEnabled && !isRacy(mtime))
+			writeFile(sidecarName(filename, ".cache"), blob->data(), blob->size(), nullptr, 0);
+
+		return viewMesh(blob->data(), blob);
+	}
+
+	std::shared_ptr<const SDFAsset> AssetCache::loadSDF(const std::string& filename, long long mtime, long long size)
+	{
+		if (isBinarySDF(filename))
+			return loadBinarySDF(filename, false, 0, 0);
+
+		//The cache of a text file is an .sdfb file carrying the stamp of the text
+		if (m_sidecarEnabled)
+		{
+			auto cached = loadBinarySDF(sidecarName(filename, ".sdfb"), true, mtime, size);
+			if (cached != nullptr)
+				return cached;
+		}
+
+		std::string text;
+		if (!readText(filename, text))
+			return nullptr;
+
+		int32_t counts[3];
+		double params[4];
+		auto distances = std::make_shared<std::vector<float>>();
+		if (!parseSDF(text, counts, params, *distances))
+		{
+			std::cerr << "Failed to parse " << filename << std::endl;
+			return nullptr;
+		}
+
+		auto sdf = std::make_shared<SDFAsset>();
+		sdf->nx = counts[0];
+		sdf->ny = counts[1];
+		sdf->nz = counts[2];
+		for (int i = 0; i < 3; i++)
+		{
+			sdf->origin[i] = params[i];
+			sdf->spacing[i] = params[3];
+		}
+		sdf->h = params[3];
+		sdf->distances = distances->data();
+		sdf->storage = distances;
+
+		if (m_sidecarEnabled && !isRacy(mtime))
+			writeSDFFile(sidecarName(filename, ".sdfb"), *sdf, mtime, size);
+
+		return sdf;
+	}
+
+	std::shared_ptr<const SDFAsset> AssetCache::loadBinarySDF(const std::string& filename, bool cache, long long mtime, long long size)
+	{
+		//Missing or outdated caches are not reported
+		auto mapped = std::make_shared<MappedFile>();
+		if (!mapped->open(filename))
+			return nullptr;
+
+		const SDFFileHeader* header = (const SDFFileHeader*)mapped->data();
+		if (mapped->size() < sizeof(SDFFileHeaderV1) || memcmp(header->magic, SDFFileMagic, sizeof(SDFFileMagic)) != 0)
+		{
+			if (!cache)
+				std::cerr << filename << " is not a binary SDF file" << std::endl;
+			return nullptr;
+		}
+
+		if (header->version == 0 || header->version > SDFFileVersion || header->valueSize != sizeof(float)
+			|| (header->version >= 2 && mapped->size() < sizeof(SDFFileHeader)))
+		{
+			if (!cache)
+				std::cerr << filename << " has the unsupported SDF version " << header->version << std::endl;
+			return nullptr;
+		}
+
+		if (cache && (header->version < 2 || header->sourceMtime != mtime || header->sourceSize != size))
+			return nullptr;
+
+		auto sdf = std::make_shared<SDFAsset>();
+		uint64_t dataOffset;
+		if (header->version == 1)
+		{
+			const SDFFileHeaderV1* v1 = (const SDFFileHeaderV1*)mapped->data();
+			for (int i = 0; i < 3; i++)
+			{
+				sdf->origin[i] = v1->origin[i];
+				sdf->spacing[i] = v1->spacing[i];
+			}
+			dataOffset = v1->dataOffset;
+		}
+		else
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				sdf->origin[i] = header->origin[i];
+				sdf->spacing[i] = header->spacing[i];
+			}
+			dataOffset = header->dataOffset;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (header->dims[i] <= 0)
+			{
+				if (!cache)
+					std::cerr << filename << " has invalid dimensions" << std::endl;
+				return nullptr;
+			}
+		}
+
+		size_t total = (size_t)header->dims[0] * header->dims[1] * header->dims[2];
+		if (dataOffset < sizeof(SDFFileHeaderV1) || dataOffset % sizeof(float) != 0
+			|| mapped->size() < dataOffset + total * sizeof(float))
+		{
+			if (!cache)
+				std::cerr << filename << " is truncated" << std::endl;
+			return nullptr;
+		}
+
+		sdf->nx = header->dims[0];
+		sdf->ny = header->dims[1];
+		sdf->nz = header->dims[2];
+		sdf->h = sdf->spacing[0];
+		sdf->distances = (const float*)(mapped->data() + dataOffset);
+
+		sdf->storage = mapped;
+		return sdf;
+	}
+
+	bool AssetCache::writeSDF(const std::string& filename, const SDFAsset& sdf)
+	{
+		return writeSDFFile(filename, sdf, 0, 0);
+	}
+
+	bool AssetCache::convertSDF(const std::string& textFile, const std::string& binaryFile)
+	{
+		auto sdf = getSDF(textFile);
+		if (sdf == nullptr)
+		{
+			std::cerr << "Failed to read " << textFile << std::endl;
+			return false;
+		}
+
+		if (!writeSDF(binaryFile, *sdf))
+		{
+			std::cerr << "Failed to write " << binaryFile << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	void AssetCache::prefetch(const std::vector<std::string>& filenames)
+	{
+		//parallelFor runs inline on a worker, waiting for submitted tasks there could dead-lock the pool
+		ThreadPool::getInstance().parallelFor(0, (int)filenames.size(), [this, &filenames](int begin, int end) {
+			for (int i = begin; i < end; i++)
+			{
+				const std::string& filename = filenames[i];
+				std::string ext = filename.size() > 4 ? filename.substr(filename.size() - 4) : std::string();
+				std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+				if (ext == ".obj")
+					this->getMesh(filename);
+				else if (ext == ".sdf" || isBinarySDF(filename))
+					this->getSDF(filename);
+			}
+		}, 1);
+	}
+
+	void AssetCache::setSidecarDirectory(const std::string& directory)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_sidecarDirectory = directory;
+	}
+
+	std::string AssetCache::getSidecarDirectory()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_sidecarDirectory;
+	}
+
+	std::string AssetCache::sidecarName(const std::string& filename, const std::string& extension)
+	{
+		std::string directory = getSidecarDirectory();
+		if (directory.empty())
+			return filename + extension;
+
+		//Files of the same name in different folders get their own sidecar
+		size_t slash = filename.find_last_of("/\\");
+		std::string base = slash == std::string::npos ? filename : filename.substr(slash + 1);
+
+		std::ostringstream name;
+		name << directory;
+		if (directory.back() != '/' && directory.back() != '\\')
+			name << '/';
+		name << base << "." << std::hex << std::hash<std::string>()(filename) << extension;
+		return name.str();
+	}
+
+	void AssetCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_meshes.clear();
+		m_sdfs.clear();
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+
+namespace PhysIKA {
+
+	/*!
+	*	\struct	MeshAsset
+	*	\brief	Read-only view of the vertices, normals and triangles of an .obj file.
+	*/
+	struct MeshAsset
+	{
+		int vertexNum = 0;
+		int normalNum = 0;
+		int triangleNum = 0;
+
+		const float* vertices = nullptr;	//!< 3 * vertexNum
+		const float* normals = nullptr;		//!< 3 * normalNum
+		const int* triangles = nullptr;		//!< 3 * triangleNum, zero-based
+
+		std::shared_ptr<const void> storage;
+	};
+
+	/*!
+	*	\struct	SDFAsset
+	*	\brief	Read-only view of a signed distance field stored on a uniform grid.
+	*/
+	struct SDFAsset
+	{
+		int nx = 0;
+		int ny = 0;
+		int nz = 0;
+
+		double origin[3] = { 0, 0, 0 };
+		double h = 0;
+		double spacing[3] = { 0, 0, 0 };	//!< per axis, all equal to h for text files
+
+		const float* distances = nullptr;	//!< nx * ny * nz, x runs fastest
+
+		std::shared_ptr<const void> storage;
+	};
+
+	/*!
+	*	\class	AssetCache
+	*	\brief	Process-wide cache of file assets keyed by path and modification time.
+	*
+	*	A file is parsed once per process, concurrent requests for the same file wait for the same load.
+	*	With sidecars enabled, the parsed data is also written to a binary sidecar, next to the source or in the sidecar
+	*	directory, and later runs memory-map the sidecar instead of parsing the text file again. Meshes use "<file>.cache",
+	*	text distance fields are converted into "<file>.sdfb" with the stamp of the text in its header.
+	*	Stamps are compared with the resolution of the file system, files modified during the last two seconds are
+	*	neither reused from memory nor written to a sidecar, so edits within the same tick are never missed.
+	*
+	*	Binary .sdfb files are standalone and versioned: a 128-byte little-endian header with the dims, the origin and
+	*	the per-axis spacing in double precision is followed by the float distances. They are memory-mapped directly without a sidecar,
+	*	so processes loading the same field share its pages.
+	*/
+	class AssetCache
+	{
+	public:
+		static AssetCache& getInstance();
+
+		/**
+		 * @brief Return the mesh of an .obj file, nullptr if it can not be read
+		 */
+		std::shared_ptr<const MeshAsset> getMesh(const std::string& filename);
+
+		/**
+		 * @brief Return the distance field of a text .sdf or a binary .sdfb file, nullptr if it can not be read
+		 */
+		std::shared_ptr<const SDFAsset> getSDF(const std::string& filename);
+
+		/**
+		 * @brief Write a distance field as a binary .sdfb file, returns false on failure
+		 */
+		bool writeSDF(const std::string& filename, const SDFAsset& sdf);
+
+		/**
+		 * @brief Convert a text .sdf file into a binary .sdfb file, the text is read by the regular loader
+		 */
+		bool convertSDF(const std::string& textFile, const std::string& binaryFile);
+
+		/**
+		 * @brief Load the given files concurrently, the asset type is derived from the file extension
+		 *
+		 * Runs on the ThreadPool, called from a worker the files are loaded one after the other.
+		 */
+		void prefetch(const std::vector<std::string>& filenames);
+
+		/**
+		 * @brief Enable/disable reading and writing of binary sidecar files, disabled by default
+		 */
+		void setSidecarEnabled(bool enabled) { m_sidecarEnabled = enabled; }
+		bool isSidecarEnabled() { return m_sidecarEnabled; }
+
+		/**
+		 * @brief Write the sidecars into the given directory instead of next to the sources, e.g. for read-only trees
+		 *
+		 * The directory must exist, an empty name restores the default.
+		 */
+		void setSidecarDirectory(const std::string& directory);
+		std::string getSidecarDirectory();
+
+		/**
+		 * @brief Drop all cached assets, views handed out before stay valid
+		 */
+		void clear();
+
+	private:
+		AssetCache();
+
+		template<typename T>
+		struct Entry
+		{
+			long long mtime;
+			long long size;
+			bool racy;		//!< the file was modified too recently to tell later edits apart
+			std::shared_future<std::shared_ptr<const T>> asset;
+		};
+
+		template<typename T, typename Loader>
+		std::shared_ptr<const T> acquire(std::map<std::string, Entry<T>>& entries, const std::string& filename, Loader loader);
+
+		std::shared_ptr<const MeshAsset> loadMesh(const std::string& filename, long long mtime, long long size);
+		std::shared_ptr<const SDFAsset> loadSDF(const std::string& filename, long long mtime, long long size);
+		/**
+		 * @brief Map an .sdfb file, a cache is only accepted when it was converted from a text file with the given stamp
+		 */
+		std::shared_ptr<const SDFAsset> loadBinarySDF(const std::string& filename, bool cache, long long mtime, long long size);
+
+		std::string sidecarName(const std::string& filename, const std::string& extension);
+
+		std::map<std::string, Entry<MeshAsset>> m_meshes;
+		std::map<std::string, Entry<SDFAsset>> m_sdfs;
+
+		std::mutex m_mutex;
+		bool m_sidecarEnabled;
+		std::string m_sidecarDirectory;
+	};
+}
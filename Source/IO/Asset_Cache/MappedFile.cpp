@@ -0,0 +1,149 @@
+#include "IO/Asset_Cache/MappedFile.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if (defined _WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace PhysIKA {
+
+	MappedFile::MappedFile()
+		: m_data(nullptr)
+		, m_size(0)
+#if (defined _WIN32)
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(NULL)
+#endif
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#if (defined _WIN32)
+	bool MappedFile::open(const std::string& filename)
+	{
+		close();
+
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_file = file;
+		m_mapping = mapping;
+		m_data = (const char*)data;
+		m_size = (size_t)size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data != nullptr)
+			UnmapViewOfFile(m_data);
+		if (m_mapping != NULL)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_mapping = NULL;
+		m_file = INVALID_HANDLE_VALUE;
+	}
+
+	bool getFileStamp(const std::string& filename, long long& mtime, long long& size)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attr;
+		if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &attr))
+			return false;
+
+		//FILETIME counts 100 ns ticks since 1601
+		ULARGE_INTEGER ticks;
+		ticks.LowPart = attr.ftLastWriteTime.dwLowDateTime;
+		ticks.HighPart = attr.ftLastWriteTime.dwHighDateTime;
+		mtime = ((long long)ticks.QuadPart - 116444736000000000LL) * 100;
+		size = ((long long)attr.nFileSizeHigh << 32) | (long long)attr.nFileSizeLow;
+		return true;
+	}
+#else
+	bool MappedFile::open(const std::string& filename)
+	{
+		close();
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		//The mapping stays valid after the descriptor is closed
+		::close(fd);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_data = (const char*)data;
+		m_size = (size_t)st.st_size;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data != nullptr)
+			munmap((void*)m_data, m_size);
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	bool getFileStamp(const std::string& filename, long long& mtime, long long& size)
+	{
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0)
+			return false;
+
+#if (defined __APPLE__)
+		mtime = (long long)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+		mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+		size = (long long)st.st_size;
+		return true;
+	}
+#endif
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace PhysIKA {
+
+	/*!
+	*	\class	MappedFile
+	*	\brief	Read-only memory mapping of a whole file.
+	*/
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool open(const std::string& filename);
+		void close();
+
+		bool isOpen() const { return m_data != nullptr; }
+
+		const char* data() const { return m_data; }
+		size_t size() const { return m_size; }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* m_data;
+		size_t m_size;
+
+#if (defined _WIN32)
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+
+	/**
+	 * @brief Modification time in nanoseconds since the epoch and size of a file, returns false if the file does not exist
+	 *
+	 * The resolution is the one of the file system, e.g. 2 seconds on FAT.
+	 */
+	bool getFileStamp(const std::string& filename, long long& mtime, long long& size);
+}
@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+#include "IO/Asset_Cache/AssetCache.h"
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+using namespace PhysIKA;
+
+static void writeText(const std::string& filename, const std::string& text)
+{
+	std::ofstream file(filename, std::ios::binary);
+	file << text;
+}
+
+static bool fileExists(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	return file.good();
+}
+
+/// Files modified during the last seconds are never cached, the tests move their stamps into the past
+static void setModificationTime(const std::string& filename, time_t t)
+{
+#ifdef _WIN32
+	_utimbuf times;
+	times.actime = t;
+	times.modtime = t;
+	_utime(filename.c_str(), &times);
+#else
+	utimbuf times;
+	times.actime = t;
+	times.modtime = t;
+	utime(filename.c_str(), &times);
+#endif
+}
+
+TEST(AssetCache, parseMesh)
+{
+	const std::string obj = "Test_AssetCache_mesh.obj";
+	writeText(obj,
+		"# quad\n"
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vn 0 0 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\n"
+		"f 1/1/1 2/2/2 3/3/3\n"
+		"f -4 -2 -1\n");
+
+	AssetCache& cache = AssetCache::getInstance();
+	cache.clear();
+
+	auto mesh = cache.getMesh(obj);
+	ASSERT_TRUE(mesh != nullptr);
+	EXPECT_EQ(mesh->vertexNum, 4);
+	EXPECT_EQ(mesh->normalNum, 4);
+	EXPECT_EQ(mesh->triangleNum, 2);
+	EXPECT_EQ(mesh->vertices[3 * 2 + 1], 1.0f);
+	EXPECT_EQ(mesh->normals[3 * 3 + 2], 1.0f);
+
+	//"v/vt/vn" is reduced to v, negative ids count from the last vertex
+	int expected[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int i = 0; i < 6; i++)
+		EXPECT_EQ(mesh->triangles[i], expected[i]);
+
+	//A file modified just now is parsed again as a later edit could keep its stamp, older files are parsed once
+	EXPECT_NE(cache.getMesh(obj), mesh);
+	setModificationTime(obj, time(nullptr) - 3600);
+	mesh = cache.getMesh(obj);
+	EXPECT_EQ(cache.getMesh(obj), mesh);
+
+	EXPECT_TRUE(cache.getMesh("Test_AssetCache_missing.obj") == nullptr);
+
+	cache.clear();
+	std::remove(obj.c_str());
+}
+
+TEST(AssetCache, parseSDF)
+{
+	const std::string sdf = "Test_AssetCache_field.sdf";
+	writeText(sdf, "2 2 3\n0.5 1 2 0.25\n1 2 3 4 5 6 7 8 9 10 11 12\n");
+
+	AssetCache& cache = AssetCache::getInstance();
+	cache.clear();
+
+	auto field = cache.getSDF(sdf);
+	ASSERT_TRUE(field != nullptr);
+	EXPECT_EQ(field->nx, 2);
+	EXPECT_EQ(field->ny, 2);
+	EXPECT_EQ(field->nz, 3);
+	EXPECT_EQ(field->origin[0], 0.5);
+	EXPECT_EQ(field->origin[2], 2.0);
+	EXPECT_EQ(field->h, 0.25);
+	EXPECT_EQ(field->spacing[1], 0.25);
+	EXPECT_EQ(field->distances[0], 1.0f);
+	EXPECT_EQ(field->distances[11], 12.0f);
+
+	//Sidecars are disabled by default
+	EXPECT_FALSE(fileExists(sdf + ".sdfb"));
+
+	//A truncated field is rejected
+	const std::string truncated = "Test_AssetCache_truncated.sdf";
+	writeText(truncated, "2 2 3\n0.5 1 2 0.25\n1 2 3\n");
+	EXPECT_TRUE(cache.getSDF(truncated) == nullptr);
+
+	cache.clear();
+	std::remove(sdf.c_str());
+	std::remove(truncated.c_str());
+}
+
+TEST(AssetCache, sidecarInvalidation)
+{
+	const std::string obj = "Test_AssetCache_sidecar.obj";
+	const std::string sidecar = obj + ".cache";
+	const time_t past = time(nullptr) - 3600;
+
+	AssetCache& cache = AssetCache::getInstance();
+	cache.clear();
+	cache.setSidecarEnabled(true);
+
+	//A file modified just now is not written to a sidecar
+	writeText(obj, "v 1 0 0\nv 0 1 0\nv 0 0 1\nf 1 2 3\n");
+	ASSERT_TRUE(cache.getMesh(obj) != nullptr);
+	EXPECT_FALSE(fileExists(sidecar));
+
+	setModificationTime(obj, past);
+	ASSERT_TRUE(cache.getMesh(obj) != nullptr);
+	EXPECT_TRUE(fileExists(sidecar));
+
+	//Same size and stamp, the next process maps the sidecar instead of parsing the text
+	writeText(obj, "v 7 0 0\nv 0 1 0\nv 0 0 1\nf 1 2 3\n");
+	setModificationTime(obj, past);
+	cache.clear();
+	auto mesh = cache.getMesh(obj);
+	ASSERT_TRUE(mesh != nullptr);
+	EXPECT_EQ(mesh->vertices[0], 1.0f);
+
+	//A new stamp invalidates the sidecar
+	setModificationTime(obj, past + 1);
+	cache.clear();
+	mesh = cache.getMesh(obj);
+	ASSERT_TRUE(mesh != nullptr);
+	EXPECT_EQ(mesh->vertices[0], 7.0f);
+
+	//So does a new size with the same stamp
+	writeText(obj, "v 8 0 0\nv 0 1 0\nv 0 0 1\nv 1 1 1\nf 1 2 3\n");
+	setModificationTime(obj, past + 1);
+	cache.clear();
+	mesh = cache.getMesh(obj);
+	ASSERT_TRUE(mesh != nullptr);
+	EXPECT_EQ(mesh->vertexNum, 4);
+	EXPECT_EQ(mesh->vertices[0], 8.0f);
+
+	cache.setSidecarEnabled(false);
+	cache.clear();
+	std::remove(obj.c_str());
+	std::remove(sidecar.c_str());
+}
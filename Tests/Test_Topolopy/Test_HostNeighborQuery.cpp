@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+#include "Core/Utility/HostScan.h"
+#include "Core/Utility/HostSort.h"
+#include "Framework/Topology/HostGridHash.h"
+#include "Framework/Topology/HostNeighborQuery.h"
+#include <vector>
+#include <algorithm>
+#include <random>
+
+using namespace PhysIKA;
+
+static void randomPoints(HostArray<Vector3f>& points, int num, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+	points.resize(num);
+	for (int i = 0; i < num; i++)
+	{
+		points[i] = Vector3f(dist(gen), dist(gen), dist(gen));
+	}
+}
+
+TEST(HostScan, exclusive)
+{
+	std::vector<int> data(100000);
+	for (int i = 0; i < (int)data.size(); i++)
+		data[i] = i % 7;
+
+	std::vector<int> expected(data.size());
+	int sum = 0;
+	for (int i = 0; i < (int)data.size(); i++)
+	{
+		expected[i] = sum;
+		sum += data[i];
+	}
+
+	EXPECT_EQ(HostScan::exclusive(data.data(), (int)data.size()), sum);
+	EXPECT_EQ(data, expected);
+
+	int single = 5;
+	EXPECT_EQ(HostScan::exclusive(&single, 1), 5);
+	EXPECT_EQ(single, 0);
+}
+
+TEST(HostSort, sort)
+{
+	std::mt19937_64 gen(7);
+	std::vector<unsigned long long> data(100003);
+	for (auto& v : data)
+		v = gen() % 1000;
+
+	std::vector<unsigned long long> expected = data;
+	std::sort(expected.begin(), expected.end());
+
+	HostSort::sort(data.data(), (int)data.size());
+	EXPECT_EQ(data, expected);
+}
+
+TEST(HostGridHash, construct)
+{
+	HostArray<Vector3f> points;
+	randomPoints(points, 5000, 1);
+
+	HostGridHash<DataType3f> hash;
+	hash.setSpace(0.1f, Vector3f(0.0f), Vector3f(1.0f));
+	hash.construct(points);
+
+	EXPECT_EQ(hash.particle_num, 5000);
+	EXPECT_EQ(hash.index[hash.num], 5000);
+
+	//Every point is stored once, in its own cell and in ascending order within the cell
+	std::vector<int> visited(5000, 0);
+	for (int c = 0; c < hash.num; c++)
+	{
+		for (int n = 0; n < hash.getCounter(c); n++)
+		{
+			int pId = hash.getParticleId(c, n);
+			EXPECT_EQ(hash.getIndex(points[pId]), c);
+			if (n > 0)
+				EXPECT_LT(hash.getParticleId(c, n - 1), pId);
+			visited[pId]++;
+		}
+	}
+	EXPECT_EQ(std::count(visited.begin(), visited.end(), 1), 5000);
+
+	hash.release();
+	points.release();
+}
+
+TEST(HostNeighborQuery, bruteForce)
+{
+	const int num = 2000;
+	const float h = 0.08f;
+
+	HostArray<Vector3f> points;
+	randomPoints(points, num, 2);
+
+	HostNeighborQuery<DataType3f> query;
+	query.setSpace(h, Vector3f(0.0f), Vector3f(1.0f));
+	query.construct(points);
+
+	HostNeighborList<int> nbr;
+	query.queryNeighbors(nbr, points, h);
+	ASSERT_EQ(nbr.size(), num);
+
+	for (int i = 0; i < num; i++)
+	{
+		std::vector<int> expected;
+		for (int j = 0; j < num; j++)
+		{
+			if ((points[i] - points[j]).norm() < h)
+				expected.push_back(j);
+		}
+
+		std::vector<int> found;
+		for (int n = 0; n < nbr.getNeighborSize(i); n++)
+			found.push_back(nbr.getElement(i, n));
+		std::sort(found.begin(), found.end());
+
+		EXPECT_EQ(found, expected);
+	}
+
+	//The k nearest come sorted by distance and agree with the brute force distances
+	const int k = 8;
+	HostNeighborList<int> knn;
+	query.queryKNearest(knn, points, k, 0.3f);
+	for (int i = 0; i < num; i++)
+	{
+		std::vector<float> distance;
+		for (int j = 0; j < num; j++)
+			distance.push_back((points[i] - points[j]).norm());
+		std::sort(distance.begin(), distance.end());
+
+		ASSERT_EQ(knn.getNeighborSize(i), k);
+		for (int n = 0; n < k; n++)
+		{
+			float d = (points[i] - points[knn.getElement(i, n)]).norm();
+			EXPECT_FLOAT_EQ(d, distance[n]);
+		}
+	}
+
+	nbr.release();
+	knn.release();
+	points.release();
+}
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+#include "Framework/Topology/KNearestHeap.h"
+#include <vector>
+#include <algorithm>
+#include <random>
+
+using namespace PhysIKA;
+
+TEST(KNearestHeap, ordering)
+{
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<float> dist(0.0f, 10.0f);
+
+	std::vector<float> candidates(1000);
+	for (auto& d : candidates)
+		d = dist(gen);
+
+	const int k = 16;
+	std::vector<int> ids(k);
+	std::vector<float> distance(k);
+	KNearestHeap<float> heap(ids.data(), distance.data(), k);
+	for (int i = 0; i < (int)candidates.size(); i++)
+	{
+		heap.insert(i, candidates[i]);
+
+		//The farthest kept candidate stays at the root
+		int kept = std::min(i + 1, k);
+		EXPECT_EQ(heap.size(), kept);
+		EXPECT_EQ(heap.maxDistance(), *std::max_element(distance.begin(), distance.begin() + kept));
+	}
+	EXPECT_TRUE(heap.isFull());
+
+	heap.sort();
+
+	std::vector<float> expected = candidates;
+	std::sort(expected.begin(), expected.end());
+	for (int n = 0; n < k; n++)
+	{
+		EXPECT_EQ(heap.getDistance(n), expected[n]);
+		EXPECT_EQ(candidates[heap.getId(n)], heap.getDistance(n));
+	}
+}
+
+TEST(KNearestHeap, partial)
+{
+	int ids[4];
+	float distance[4];
+	KNearestHeap<float> heap(ids, distance, 4);
+	heap.insert(7, 3.0f);
+	heap.insert(2, 1.0f);
+	EXPECT_FALSE(heap.isFull());
+
+	heap.sort();
+	EXPECT_EQ(heap.size(), 2);
+	EXPECT_EQ(heap.getId(0), 2);
+	EXPECT_EQ(heap.getId(1), 7);
+
+	//A heap without capacity ignores every candidate
+	KNearestHeap<float> empty(ids, distance, 0);
+	empty.insert(1, 0.5f);
+	EXPECT_EQ(empty.size(), 0);
+}
@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+#include "Framework/Framework/Log.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+
+using namespace PhysIKA;
+
+static std::atomic<int> s_received(0);
+
+static void countMessage(const Log::Message& m)
+{
+	if (m.type == Log::User)
+		s_received++;
+}
+
+TEST(Log, history)
+{
+	Log::setLevel(Log::DebugInfo);
+	Log::setHistorySize(5);
+	for (int i = 0; i < 10; i++)
+		Log::sendMessage(Log::Info, "history " + std::to_string(i));
+
+	//Only the most recent messages are kept, in the order they were sent
+	std::list<Log::Message> messages = Log::getMessages();
+	ASSERT_EQ(messages.size(), 5u);
+
+	int i = 5;
+	for (auto& m : messages)
+	{
+		EXPECT_EQ(m.type, Log::Info);
+		EXPECT_EQ(m.text, "history " + std::to_string(i++));
+	}
+	EXPECT_EQ(Log::getLastMessage().text, "history 9");
+
+	Log::setHistorySize(1000);
+}
+
+TEST(Log, level)
+{
+	Log::setLevel(Log::Warning);
+	EXPECT_FALSE(Log::isEnabled(Log::Info));
+	EXPECT_TRUE(Log::isEnabled(Log::Error));
+
+	Log::sendMessage(Log::Warning, "level kept");
+	Log::sendMessage(Log::Info, "level filtered");
+	EXPECT_EQ(Log::getLastMessage().text, "level kept");
+
+	Log::setLevel(Log::DebugInfo);
+}
+
+TEST(Log, concurrentSenders)
+{
+	const int threadNum = 4;
+	const int messageNum = 2000;
+
+	Log::setLevel(Log::DebugInfo);
+	Log::setHistorySize(threadNum * messageNum);
+	Log::flush();
+	size_t dropped = Log::getDroppedCount();
+
+	s_received = 0;
+	Log::setUserReceiver(&countMessage);
+
+	std::vector<std::thread> senders;
+	for (int t = 0; t < threadNum; t++)
+	{
+		senders.push_back(std::thread([t, messageNum]() {
+			for (int i = 0; i < messageNum; i++)
+				Log::sendMessage(Log::User, std::to_string(t) + " " + std::to_string(i));
+		}));
+	}
+	for (auto& s : senders)
+		s.join();
+
+	//Every message is either delivered or counted as dropped
+	Log::flush();
+	EXPECT_EQ((size_t)s_received.load() + (Log::getDroppedCount() - dropped), (size_t)(threadNum * messageNum));
+
+	//Messages of the same sender keep their order
+	std::vector<int> last(threadNum, -1);
+	for (auto& m : Log::getMessages())
+	{
+		if (m.type != Log::User)
+			continue;
+
+		int t = std::stoi(m.text.substr(0, m.text.find(' ')));
+		int i = std::stoi(m.text.substr(m.text.find(' ') + 1));
+		EXPECT_GT(i, last[t]);
+		last[t] = i;
+	}
+
+	Log::setUserReceiver(NULL);
+	Log::setHistorySize(1000);
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "Framework/Topology/MeshAdjacency.h"
+#include <vector>
+#include <algorithm>
+
+using namespace PhysIKA;
+
+typedef TopologyModule::Edge Edge;
+typedef TopologyModule::Triangle Triangle;
+
+static std::vector<std::vector<int>> toLists(NeighborList<int>& nbr, bool sorted = false)
+{
+	HostNeighborList<int> hostNbr;
+	hostNbr.copyFrom(nbr);
+
+	std::vector<std::vector<int>> lists(hostNbr.size());
+	for (int i = 0; i < hostNbr.size(); i++)
+	{
+		for (int n = 0; n < hostNbr.getNeighborSize(i); n++)
+			lists[i].push_back(hostNbr.getElement(i, n));
+		if (sorted)
+			std::sort(lists[i].begin(), lists[i].end());
+	}
+
+	hostNbr.release();
+	return lists;
+}
+
+TEST(MeshAdjacency, triangles)
+{
+	//Two triangles forming a quad, vertex 4 is not used
+	std::vector<Triangle> hostTriangles;
+	hostTriangles.push_back(Triangle(0, 1, 2));
+	hostTriangles.push_back(Triangle(0, 2, 3));
+
+	DeviceArray<Triangle> triangles(2);
+	Function1Pt::copy(triangles, hostTriangles);
+
+	std::vector<std::vector<int>> vertexNeighbors = { { 1, 2, 3 }, { 0, 2 }, { 0, 1, 3 }, { 0, 2 }, {} };
+	std::vector<std::vector<int>> vertexTriangles = { { 0, 1 }, { 0 }, { 0, 1 }, { 1 }, {} };
+	std::vector<std::vector<int>> triangleNeighbors = { { 1 }, { 0 } };
+
+	DeviceType types[2] = { DeviceType::CPU, DeviceType::GPU };
+	for (DeviceType type : types)
+	{
+		NeighborList<int> vv;
+		NeighborList<int> vt;
+		NeighborList<int> tt;
+		MeshAdjacency::buildVertexNeighbors(vv, triangles, 5, type);
+		MeshAdjacency::buildVertexTriangles(vt, triangles, 5, type);
+		MeshAdjacency::buildTriangleNeighbors(tt, triangles, vt, type);
+
+		EXPECT_EQ(toLists(vv), vertexNeighbors);
+		EXPECT_EQ(toLists(vt), vertexTriangles);
+		EXPECT_EQ(toLists(tt, true), triangleNeighbors);
+
+		vv.release();
+		vt.release();
+		tt.release();
+	}
+
+	triangles.release();
+}
+
+TEST(MeshAdjacency, edges)
+{
+	//A path 0 - 1 - 2 with a duplicated and a degenerate edge
+	std::vector<Edge> hostEdges;
+	hostEdges.push_back(Edge(0, 1));
+	hostEdges.push_back(Edge(1, 2));
+	hostEdges.push_back(Edge(2, 1));
+	hostEdges.push_back(Edge(2, 2));
+
+	DeviceArray<Edge> edges(4);
+	Function1Pt::copy(edges, hostEdges);
+
+	std::vector<std::vector<int>> expected = { { 1 }, { 0, 2 }, { 1 } };
+
+	NeighborList<int> cpu;
+	NeighborList<int> gpu;
+	MeshAdjacency::buildVertexNeighbors(cpu, edges, 3, DeviceType::CPU);
+	MeshAdjacency::buildVertexNeighbors(gpu, edges, 3, DeviceType::GPU);
+
+	EXPECT_EQ(toLists(cpu), expected);
+	EXPECT_EQ(toLists(gpu), expected);
+
+	cpu.release();
+	gpu.release();
+	edges.release();
+}
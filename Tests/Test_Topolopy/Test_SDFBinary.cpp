@@ -0,0 +1,159 @@
+#include "gtest/gtest.h"
+#include "IO/Asset_Cache/AssetCache.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+using namespace PhysIKA;
+
+static bool fileExists(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	return file.good();
+}
+
+TEST(SDFBinary, roundTrip)
+{
+	const std::string sdfb = "Test_SDFBinary_field.sdfb";
+
+	std::vector<float> distances(3 * 4 * 5);
+	for (int i = 0; i < (int)distances.size(); i++)
+		distances[i] = 0.5f * i - 7.0f;
+
+	SDFAsset sdf;
+	sdf.nx = 3;
+	sdf.ny = 4;
+	sdf.nz = 5;
+	sdf.origin[0] = -0.1;
+	sdf.origin[1] = 0.2;
+	sdf.origin[2] = 1.0 / 3.0;
+	sdf.h = 0.01;
+	sdf.spacing[0] = 0.01;
+	sdf.spacing[1] = 0.02;
+	sdf.spacing[2] = 0.03;
+	sdf.distances = distances.data();
+
+	AssetCache& cache = AssetCache::getInstance();
+	cache.clear();
+	ASSERT_TRUE(cache.writeSDF(sdfb, sdf));
+
+	auto loaded = cache.getSDF(sdfb);
+	ASSERT_TRUE(loaded != nullptr);
+	EXPECT_EQ(loaded->nx, 3);
+	EXPECT_EQ(loaded->ny, 4);
+	EXPECT_EQ(loaded->nz, 5);
+
+	//The header keeps the origin and the spacing in double precision
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_EQ(loaded->origin[i], sdf.origin[i]);
+		EXPECT_EQ(loaded->spacing[i], sdf.spacing[i]);
+	}
+	for (int i = 0; i < (int)distances.size(); i++)
+		EXPECT_EQ(loaded->distances[i], distances[i]);
+
+	loaded.reset();
+	cache.clear();
+	std::remove(sdfb.c_str());
+}
+
+TEST(SDFBinary, textSidecar)
+{
+	const std::string sdf = "Test_SDFBinary_field.sdf";
+	const std::string sidecar = sdf + ".sdfb";
+	{
+		std::ofstream file(sdf, std::ios::binary);
+		file << "2 2 3\n0.1 1 2 0.25\n1 2 3 4 5 6 7 8 9 10 11 12\n";
+	}
+
+	//Files modified during the last seconds are not cached
+#ifdef _WIN32
+	_utimbuf times;
+	times.actime = times.modtime = time(nullptr) - 3600;
+	_utime(sdf.c_str(), &times);
+#else
+	utimbuf times;
+	times.actime = times.modtime = time(nullptr) - 3600;
+	utime(sdf.c_str(), &times);
+#endif
+
+	AssetCache& cache = AssetCache::getInstance();
+	cache.clear();
+	cache.setSidecarEnabled(true);
+
+	auto parsed = cache.getSDF(sdf);
+	ASSERT_TRUE(parsed != nullptr);
+	EXPECT_TRUE(fileExists(sidecar));
+	EXPECT_FALSE(fileExists(sdf + ".cache"));
+
+	//The text is converted into a regular .sdfb file that can be loaded on its own
+	cache.clear();
+	auto converted = cache.getSDF(sidecar);
+	ASSERT_TRUE(converted != nullptr);
+	EXPECT_EQ(converted->nz, 3);
+	EXPECT_EQ(converted->origin[0], 0.1);
+	EXPECT_EQ(converted->spacing[2], 0.25);
+	EXPECT_EQ(converted->distances[11], 12.0f);
+
+	//A later run maps it instead of parsing the text
+	auto cached = cache.getSDF(sdf);
+	ASSERT_TRUE(cached != nullptr);
+	EXPECT_EQ(cached->h, 0.25);
+	EXPECT_EQ(cached->distances[5], 6.0f);
+
+	parsed.reset();
+	converted.reset();
+	cached.reset();
+	cache.setSidecarEnabled(false);
+	cache.clear();
+	std::remove(sdf.c_str());
+	std::remove(sidecar.c_str());
+}
+
+TEST(SDFBinary, version1)
+{
+	//64-byte header of the first version with float origin and spacing
+	const std::string sdfb = "Test_SDFBinary_v1.sdfb";
+	{
+		char header[64];
+		memset(header, 0, sizeof(header));
+		memcpy(header, "PKSDF\0\0\0", 8);
+		uint32_t version = 1;
+		uint32_t valueSize = 4;
+		int32_t dims[3] = { 1, 1, 2 };
+		float params[6] = { 1.0f, 2.0f, 3.0f, 0.5f, 0.5f, 0.5f };
+		uint64_t offset = 64;
+		memcpy(header + 8, &version, 4);
+		memcpy(header + 12, &valueSize, 4);
+		memcpy(header + 16, dims, 12);
+		memcpy(header + 32, params, 24);
+		memcpy(header + 56, &offset, 8);
+
+		float values[2] = { 7.0f, 8.0f };
+		std::ofstream file(sdfb, std::ios::binary);
+		file.write(header, sizeof(header));
+		file.write((const char*)values, sizeof(values));
+	}
+
+	AssetCache& cache = AssetCache::getInstance();
+	cache.clear();
+
+	auto loaded = cache.getSDF(sdfb);
+	ASSERT_TRUE(loaded != nullptr);
+	EXPECT_EQ(loaded->nz, 2);
+	EXPECT_EQ(loaded->origin[2], 3.0);
+	EXPECT_EQ(loaded->spacing[0], 0.5);
+	EXPECT_EQ(loaded->distances[1], 8.0f);
+
+	loaded.reset();
+	cache.clear();
+	std::remove(sdfb.c_str());
+}